@@ -0,0 +1,963 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <spawn.h>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include <Batch.h>
+#include <Calculator.h>
+#include <ColumnFile.h>
+#include <Follow.h>
+#include <HoursMinutes.h>
+#include <HoursMinutesArray.h>
+#include <Optimizer.h>
+#include <Planner.h>
+#include <Recurrence.h>
+#include <Stats.h>
+#include <TaskGraph.h>
+#include <TimeOfDay.h>
+#include <TimingWheel.h>
+
+namespace {
+
+	/** Number of allocations through operator new since startup. */
+	std::atomic<uint64_t> allocations(0);
+
+	/** Keep the compiler from optimizing away the computation of a value. */
+	template <typename T>
+	inline void keep(const T & value_i)
+	{
+		asm volatile("" : : "g"(&value_i) : "memory");
+	}
+
+	/** Stream buffer that discards everything written to it. */
+	class NullBuffer : public std::streambuf
+	{
+		protected:
+			int_type overflow(int_type ch_i) override { return traits_type::not_eof(ch_i); }
+			std::streamsize xsputn(const char *, std::streamsize size_i) override { return size_i; }
+	};
+
+	/** Schedule file of the cli/follow benchmark, removed again when the
+	 * benchmarks are done. */
+	struct FollowedFile {
+		/** Path of the schedule, the output gets ".out" appended. */
+		std::string path;
+
+		/** Schedule opened for editing. */
+		int fd = -1;
+
+		/** Follows the schedule. */
+		std::unique_ptr<SdH::Follow> follow;
+
+		/** Destructor removes the files. */
+		~FollowedFile() {
+			follow.reset();
+			if (fd < 0) return;
+			close(fd);
+			unlink(path.c_str());
+			unlink((path + ".out").c_str());
+		}
+	};
+
+	/** A benchmark performs a number of repetitions of its work and
+	 * returns the number of operations this amounts to. */
+	typedef std::function<uint64_t(uint64_t)> Body;
+
+	/** A named benchmark. */
+	struct Benchmark {
+		/** Name of the benchmark. */
+		std::string name;
+
+		/** Work to measure. */
+		Body body;
+	};
+
+	/** Outcome of a single benchmark. */
+	struct Result {
+		/** Name of the benchmark. */
+		std::string name;
+
+		/** Number of operations measured. */
+		uint64_t ops = 0;
+
+		/** Median time per operation in nanoseconds. */
+		double nsPerOp = 0.0;
+
+		/** Allocations per operation. */
+		double allocsPerOp = 0.0;
+	};
+
+	/** Command-line options. */
+	struct Options {
+		/** Only run benchmarks with this text in their name. */
+		std::string filter;
+
+		/** File to write JSON results to, "-" for standard output. */
+		std::string json;
+
+		/** JSON results of an earlier run to compare with. */
+		std::string baseline;
+
+		/** Slowdown in percent compared to the baseline that fails. */
+		double tolerance = 10.0;
+
+		/** Minimum duration of a single sample in seconds. */
+		double minTime = 0.05;
+
+		/** Number of generated input lines for the end-to-end runs. */
+		size_t lines = 100000;
+	};
+
+	/** Number of samples taken per benchmark. */
+	constexpr size_t samples = 5;
+
+	/** Valid times and durations, cycled through by the benchmarks. */
+	const std::string_view validTimes[16] = {
+		"0", ":", "9:34", "23:59", "12:", ":45", "1:48", "6:7",
+		"00:00", "17:30", "30", "2:54", "23:12", "08:05", "14:", "59"
+	};
+
+	/** Invalid times, cycled through by the benchmarks. */
+	const std::string_view invalidTimes[16] = {
+		"24:00", "1:60", "abc", "123", "1:2:3", "x", "99:", ":99",
+		"12:3x", "-1", "1 2", "007", "25", "+1", "9:345", "a:b"
+	};
+
+	/** Seconds since an arbitrary moment, as a double. */
+	inline double seconds()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/** Measure a benchmark. The number of repetitions is doubled until a
+	 * sample takes at least Options::minTime, then the median of a few
+	 * samples is reported. */
+	Result measure(const std::string & name_i, const Body & body_i, const Options & opts_i)
+	{
+		std::vector<double> nsPerOp;
+		uint64_t reps = 1, ops = 0, totalOps = 0, allocs = 0;
+		double start = 0.0, elapsed = 0.0;
+
+		// Warm up caches and find the number of repetitions
+		for (;;) {
+			start = seconds();
+			ops = body_i(reps);
+			elapsed = seconds() - start;
+			if (elapsed >= opts_i.minTime || reps >= (1ULL << 40)) break;
+			reps *= elapsed > 0.0 ? std::min(std::max(opts_i.minTime * 1.2 / elapsed, 2.0), 100.0) : 100.0;
+		}
+
+		for (size_t i = 0; i < samples; i++) {
+			const uint64_t before = allocations.load(std::memory_order_relaxed);
+
+			start = seconds();
+			ops = body_i(reps);
+			elapsed = seconds() - start;
+			allocs += allocations.load(std::memory_order_relaxed) - before;
+			totalOps += ops;
+			nsPerOp.push_back(elapsed * 1e9 / ops);
+		}
+
+		std::sort(nsPerOp.begin(), nsPerOp.end());
+		return {name_i, totalOps, nsPerOp[samples / 2], static_cast<double>(allocs) / totalOps};
+	}
+
+	/** Generate input lines in the grammar of the interactive mode.
+	 * @param lines_i Number of lines.
+	 * @param invalid_i Percentage of invalid lines. */
+	std::string generate(const size_t lines_i, const unsigned invalid_i)
+	{
+		std::mt19937 rng(20200101);
+		std::string retval;
+
+		for (size_t i = 0; i < lines_i; i++) {
+			if (rng() % 100 < invalid_i) {
+				retval += invalidTimes[rng() % 16];
+				if (rng() % 2) {
+					retval += ' ';
+					retval += validTimes[rng() % 16];
+				}
+			} else {
+				switch (rng() % 4) {
+					case 0:
+						retval += '+';
+						retval += validTimes[rng() % 16];
+						break;
+
+					case 1:
+						retval += validTimes[rng() % 16];
+						break;
+
+					default:
+						retval += validTimes[rng() % 16];
+						retval += ' ';
+						retval += validTimes[rng() % 16];
+				}
+			}
+			retval += '\n';
+		}
+
+		return retval;
+	}
+
+	/** Create an anonymous temporary file with the given contents.
+	 * @throws std::runtime_error when the file can't be created. */
+	int tempFile(const std::string & contents_i)
+	{
+		FILE *fp = tmpfile();
+		int fd = -1;
+
+		if (fp == nullptr) throw std::runtime_error("Unable to create temporary file");
+		fd = dup(fileno(fp));
+		fclose(fp);
+		if (fd < 0 || write(fd, contents_i.data(), contents_i.size()) != static_cast<ssize_t>(contents_i.size())) {
+			throw std::runtime_error("Unable to write temporary file");
+		}
+		return fd;
+	}
+
+	/** Benchmarks of the HoursMinutes class. */
+	void coreBenchmarks(std::vector<Benchmark> & benches_o)
+	{
+		benches_o.push_back({"HoursMinutes::set", [](const uint64_t reps_i) {
+			SdH::HoursMinutes hm;
+
+			for (uint64_t i = 0; i < reps_i; i++) {
+				hm.set(validTimes[i & 15]);
+				keep(hm);
+			}
+			return reps_i;
+		}});
+
+		benches_o.push_back({"HoursMinutes::set/invalid", [](const uint64_t reps_i) {
+			SdH::HoursMinutes hm;
+
+			for (uint64_t i = 0; i < reps_i; i++) {
+				try {
+					hm.set(invalidTimes[i & 15]);
+				} catch (const std::exception &) {
+					keep(hm);
+				}
+			}
+			return reps_i;
+		}});
+
+		benches_o.push_back({"HoursMinutes::fromChars", [](const uint64_t reps_i) {
+			SdH::HoursMinutes hm;
+
+			for (uint64_t i = 0; i < reps_i; i++) {
+				const std::string_view & str = validTimes[i & 15];
+
+				keep(SdH::HoursMinutes::fromChars(str.data(), str.data() + str.size(), hm));
+				keep(hm);
+			}
+			return reps_i;
+		}});
+
+		benches_o.push_back({"HoursMinutes::fromChars/invalid", [](const uint64_t reps_i) {
+			SdH::HoursMinutes hm;
+
+			for (uint64_t i = 0; i < reps_i; i++) {
+				const std::string_view & str = invalidTimes[i & 15];
+
+				keep(SdH::HoursMinutes::fromChars(str.data(), str.data() + str.size(), hm));
+				keep(hm);
+			}
+			return reps_i;
+		}});
+
+		benches_o.push_back({"HoursMinutes::operator+=", [](const uint64_t reps_i) {
+			SdH::HoursMinutes durs[16];
+			SdH::HoursMinutes hm(9, 34);
+
+			for (size_t i = 0; i < 16; i++) durs[i].set(validTimes[i]);
+			for (uint64_t i = 0; i < reps_i; i++) {
+				hm += durs[i & 15];
+				keep(hm);
+			}
+			return reps_i;
+		}});
+
+		benches_o.push_back({"HoursMinutes::operator<<", [](const uint64_t reps_i) {
+			NullBuffer nullbuf;
+			std::ostream out(&nullbuf);
+			SdH::HoursMinutes hm;
+
+			for (uint64_t i = 0; i < reps_i; i++) {
+				hm.minutesOfDay(i % SdH::HoursMinutes::minutesPerDay);
+				out << hm;
+			}
+			return reps_i;
+		}});
+
+		benches_o.push_back({"HoursMinutes::toChars", [](const uint64_t reps_i) {
+			char buf[SdH::HoursMinutes::charsLength];
+			SdH::HoursMinutes hm;
+
+			for (uint64_t i = 0; i < reps_i; i++) {
+				hm.minutesOfDay(i % SdH::HoursMinutes::minutesPerDay);
+				keep(hm.toChars(buf));
+				keep(buf);
+			}
+			return reps_i;
+		}});
+
+		benches_o.push_back({"TimeOfDay<seconds>::fromChars", [](const uint64_t reps_i) {
+			static const std::string_view times[4] = {"09:34:12", "23:59:59", "0:0:1", "12:00:30"};
+			SdH::HoursMinutesSeconds tod;
+
+			for (uint64_t i = 0; i < reps_i; i++) {
+				const std::string_view & str = times[i & 3];
+
+				keep(SdH::HoursMinutesSeconds::fromChars(str.data(), str.data() + str.size(), tod));
+				keep(tod);
+			}
+			return reps_i;
+		}});
+
+		benches_o.push_back({"TimeOfDay<milliseconds>::operator+=", [](const uint64_t reps_i) {
+			SdH::HoursMinutesMillis durs[16];
+			SdH::HoursMinutesMillis tod("09:34:00.000");
+
+			for (size_t i = 0; i < 16; i++) durs[i] = SdH::HoursMinutesMillis::fromTicks(i * 5400017);
+			for (uint64_t i = 0; i < reps_i; i++) {
+				tod += durs[i & 15];
+				keep(tod);
+			}
+			return reps_i;
+		}});
+
+		benches_o.push_back({"HoursMinutesArray::scan", [](const uint64_t reps_i) {
+			std::vector<uint16_t> durs(4096), mins(durs.size());
+			std::vector<uint32_t> days(durs.size());
+
+			for (size_t i = 0; i < durs.size(); i++) durs[i] = (i * 577) % SdH::HoursMinutes::minutesPerDay;
+			for (uint64_t r = 0; r < reps_i; r++) {
+				keep(SdH::HoursMinutesArray::scan(durs.data(), durs.size(), r % SdH::HoursMinutes::minutesPerDay, mins.data(), days.data()));
+				keep(mins.data());
+			}
+			return reps_i * durs.size();
+		}});
+
+		benches_o.push_back({"HoursMinutesArray::sort", [](const uint64_t reps_i) {
+			std::vector<uint16_t> mins(4096);
+			std::vector<size_t> order(mins.size());
+
+			for (size_t i = 0; i < mins.size(); i++) mins[i] = (i * 577) % SdH::HoursMinutes::minutesPerDay;
+			for (uint64_t r = 0; r < reps_i; r++) {
+				SdH::HoursMinutesArray::sort(mins.data(), nullptr, mins.size(), order.data());
+				keep(order.data());
+			}
+			return reps_i * mins.size();
+		}});
+
+		benches_o.push_back({"HoursMinutesArray::next", [](const uint64_t reps_i) {
+			std::vector<uint16_t> mins(4096);
+
+			for (size_t i = 0; i < mins.size(); i++) mins[i] = (i * 577) % SdH::HoursMinutes::minutesPerDay;
+			for (uint64_t r = 0; r < reps_i; r++) {
+				keep(SdH::HoursMinutesArray::next(mins.data(), mins.size(), r % SdH::HoursMinutes::minutesPerDay));
+			}
+			return reps_i * mins.size();
+		}});
+
+		benches_o.push_back({"HoursMinutesArray::count", [](const uint64_t reps_i) {
+			std::vector<uint16_t> mins(4096);
+
+			for (size_t i = 0; i < mins.size(); i++) mins[i] = (i * 577) % SdH::HoursMinutes::minutesPerDay;
+			for (uint64_t r = 0; r < reps_i; r++) {
+				const uint16_t from = r % SdH::HoursMinutes::minutesPerDay;
+
+				keep(SdH::HoursMinutesArray::count(mins.data(), mins.size(), from, (from + 90) % SdH::HoursMinutes::minutesPerDay));
+			}
+			return reps_i * mins.size();
+		}});
+	}
+
+	/** Planner benchmark, one operation per job. */
+	void plannerBenchmarks(std::vector<Benchmark> & benches_o, const Options & opts_i)
+	{
+		std::mt19937 rng(20200101);
+		const std::shared_ptr<SdH::Planner> planner(new SdH::Planner(SdH::HoursMinutes(6, 0)));
+		const size_t slots = std::max<size_t>(opts_i.lines / 5, 1);
+		const size_t jobs = opts_i.lines;
+		SdH::HoursMinutes dur;
+
+		for (size_t s = 0; s < slots; s++) planner->addSlot("s" + std::to_string(s), 1 + rng() % 4);
+		for (size_t j = 0; j < jobs; j++) {
+			dur.minutesOfDay(rng() % SdH::HoursMinutes::minutesPerDay);
+			planner->addJob("s" + std::to_string(rng() % slots), dur);
+		}
+
+		benches_o.push_back({"Planner::plan", [planner, jobs](const uint64_t reps_i) {
+			for (uint64_t r = 0; r < reps_i; r++) keep(planner->plan().size());
+			return reps_i * jobs;
+		}});
+	}
+
+	/** Optimizer benchmark on all processors, one operation per searched
+	 * schedule. */
+	void optimizerBenchmarks(std::vector<Benchmark> & benches_o)
+	{
+		std::mt19937 rng(20200101);
+		const std::shared_ptr<SdH::Planner> planner(new SdH::Planner(SdH::HoursMinutes(6, 0)));
+		SdH::HoursMinutes dur;
+
+		planner->addSlot("a", 3);
+		planner->addSlot("b", 2);
+		for (size_t j = 0; j < 12; j++) {
+			dur.minutesOfDay(5 + rng() % 300);
+			planner->addJob(j % 2 ? "a" : "b", dur);
+		}
+
+		benches_o.push_back({"Optimizer::solve", [planner](const uint64_t reps_i) {
+			uint64_t nodes = 0;
+
+			for (uint64_t r = 0; r < reps_i; r++) {
+				SdH::Optimizer optimizer(*planner, SdH::Optimizer::Goal::checkins);
+
+				optimizer.solve(std::chrono::hours(1));
+				nodes += optimizer.nodes();
+			}
+			return nodes;
+		}});
+	}
+
+	/** Task graph benchmark, one operation per edit and update. */
+	void taskGraphBenchmarks(std::vector<Benchmark> & benches_o, const Options & opts_i)
+	{
+		std::mt19937 rng(20200101);
+		const std::shared_ptr<SdH::TaskGraph> graph(new SdH::TaskGraph(SdH::HoursMinutes(6, 0)));
+		SdH::HoursMinutes dur;
+
+		for (size_t n = 0; n < opts_i.lines; n++) {
+			dur.minutesOfDay(rng() % 600);
+			graph->addNode(dur);
+			for (size_t e = 0; n && e < 2; e++) graph->addEdge(rng() % n, n);
+		}
+		graph->update();
+
+		benches_o.push_back({"TaskGraph::update", [graph, rng](const uint64_t reps_i) mutable {
+			SdH::HoursMinutes dur;
+
+			for (uint64_t r = 0; r < reps_i; r++) {
+				dur.minutesOfDay(rng() % 600);
+				graph->duration(rng() % graph->size(), dur);
+				keep(graph->update());
+			}
+			return reps_i;
+		}});
+	}
+
+	/** Timing wheel benchmark with about 100k timers pending, one
+	 * operation per added and fired timer. */
+	void timingWheelBenchmarks(std::vector<Benchmark> & benches_o)
+	{
+		const std::shared_ptr<SdH::TimingWheel> wheel(new SdH::TimingWheel());
+		std::mt19937 rng(20200101);
+		uint64_t fired = 0;
+
+		for (size_t i = 0; i < 100000; i++) wheel->add(1 + rng() % 200000);
+
+		benches_o.push_back({"TimingWheel::advance", [wheel, rng, fired](const uint64_t reps_i) mutable {
+			const SdH::TimingWheel::Fire fire = [&fired](const SdH::TimingWheel::Timer, const uint64_t) { fired++; };
+
+			for (uint64_t r = 0; r < reps_i; r++) {
+				wheel->add(wheel->now() + 1 + rng() % 200000);
+				wheel->advance(wheel->now() + 1, fire);
+			}
+			keep(fired);
+			return reps_i;
+		}});
+	}
+
+	/** Benchmarks of recurrences, one operation per occurrence. */
+	void recurrenceBenchmarks(std::vector<Benchmark> & benches_o)
+	{
+		benches_o.push_back({"Recurrence::iterator", [](const uint64_t reps_i) {
+			const SdH::Recurrence every(SdH::HoursMinutes(6, 10), SdH::HoursMinutes(0, 7), UINT32_MAX);
+			SdH::Recurrence::iterator pos = every.begin();
+
+			for (uint64_t r = 0; r < reps_i; r++, ++pos) keep(pos->minutes());
+			return reps_i;
+		}});
+
+		// A thousand recurring jobs over a quarter, started again when done
+		const std::shared_ptr<std::vector<SdH::Recurrence>> jobs(new std::vector<SdH::Recurrence>());
+		std::mt19937 rng(20200101);
+
+		for (size_t i = 0; i < 1000; i++) {
+			jobs->emplace_back(SdH::HoursMinutes(rng() % 24, rng() % 60), SdH::HoursMinutes(1 + rng() % 12, rng() % 60), 90);
+		}
+
+		benches_o.push_back({"RecurrenceMerge::next", [jobs](const uint64_t reps_i) {
+			SdH::RecurrenceMerge merge;
+			SdH::Moment occ;
+			size_t source = 0;
+
+			for (uint64_t r = 0; r < reps_i; r++) {
+				if (!merge.next(occ, source)) {
+					for (const SdH::Recurrence & job : *jobs) merge.add(job);
+					merge.next(occ, source);
+				}
+				keep(occ.minutes());
+			}
+			return reps_i;
+		}});
+	}
+
+	/** End-to-end benchmarks on generated input, one operation per line. */
+	void cliBenchmarks(std::vector<Benchmark> & benches_o, const Options & opts_i)
+	{
+		static const std::pair<const char *, unsigned> kinds[] = {
+			{"valid", 0}, {"invalid", 100}, {"mixed", 10}
+		};
+
+		for (const auto & kind : kinds) {
+			const std::shared_ptr<const std::string> input(new std::string(generate(opts_i.lines, kind.second)));
+			const size_t lines = opts_i.lines;
+
+			// The interactive loop of timecal, without prompts
+			benches_o.push_back({std::string("cli/interactive/") + kind.first, [input, lines](const uint64_t reps_i) {
+				NullBuffer nullbuf;
+				std::ostream out(&nullbuf);
+				std::string line;
+
+				for (uint64_t r = 0; r < reps_i; r++) {
+					std::istringstream in(*input);
+					SdH::Calculator calc;
+
+					while (std::getline(in, line)) {
+						if (line.empty()) continue;
+
+						const SdH::HoursMinutes::ParseResult res = calc.evaluate(line);
+
+						if (res.ec == std::errc()) {
+							out << calc.reference() << " + " << calc.duration() << " = " << calc.result() << '\n';
+						} else {
+							SdH::HoursMinutes::printError(out, res, line.data() + line.size()) << '\n';
+						}
+					}
+				}
+				return reps_i * lines;
+			}});
+
+			// timecal --batch and timecal --parallel
+			for (const bool parallel : {false, true}) {
+				const std::string name = std::string(parallel ? "cli/parallel/" : "cli/batch/") + kind.first;
+
+				benches_o.push_back({name, [input, lines, parallel](const uint64_t reps_i) {
+					const int in = tempFile(*input);
+					const int out = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+					for (uint64_t r = 0; r < reps_i; r++) {
+						lseek(in, 0, SEEK_SET);
+						if (parallel) {
+							SdH::processParallel(in, out);
+						} else {
+							SdH::processBatch(in, out);
+						}
+					}
+					close(in);
+					close(out);
+					return reps_i * lines;
+				}});
+			}
+		}
+
+		// timecal --sorted on valid lines only, as it stops at the first error
+		const std::shared_ptr<const std::string> valid(new std::string(generate(opts_i.lines, 0)));
+
+		benches_o.push_back({"cli/sorted", [valid, lines = opts_i.lines](const uint64_t reps_i) {
+			const int in = tempFile(*valid);
+			const int out = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+			for (uint64_t r = 0; r < reps_i; r++) {
+				lseek(in, 0, SEEK_SET);
+				SdH::processSorted(in, out, true);
+			}
+			close(in);
+			close(out);
+			return reps_i * lines;
+		}});
+
+		// timecal --to-binary and --from-binary on the same lines
+		benches_o.push_back({"cli/to-binary", [valid, lines = opts_i.lines](const uint64_t reps_i) {
+			const int in = tempFile(*valid);
+			const int out = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+			for (uint64_t r = 0; r < reps_i; r++) {
+				lseek(in, 0, SEEK_SET);
+				SdH::convertToColumns(in, out, true);
+			}
+			close(in);
+			close(out);
+			return reps_i * lines;
+		}});
+
+		const int text = tempFile(*valid);
+		const int binary = tempFile("");
+
+		lseek(text, 0, SEEK_SET);
+		SdH::convertToColumns(text, binary, true);
+		close(text);
+
+		const std::shared_ptr<const int> columns(new int(binary), [](const int * fd_i) { close(*fd_i); delete fd_i; });
+
+		benches_o.push_back({"cli/from-binary", [columns, lines = opts_i.lines](const uint64_t reps_i) {
+			const int out = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+			for (uint64_t r = 0; r < reps_i; r++) SdH::convertFromColumns(*columns, out);
+			close(out);
+			return reps_i * lines;
+		}});
+
+		// timecal --from-binary --next, on the mapped results
+		benches_o.push_back({"cli/next/binary", [columns, lines = opts_i.lines](const uint64_t reps_i) {
+			for (uint64_t r = 0; r < reps_i; r++) {
+				const SdH::ColumnFile file(*columns);
+
+				keep(SdH::HoursMinutesArray::next(file.results(), file.size(), r % SdH::HoursMinutes::minutesPerDay));
+			}
+			return reps_i * lines;
+		}});
+
+		// timecal --chain on a start time and durations
+		std::mt19937 rng(20200101);
+		const std::shared_ptr<std::string> chain(new std::string("09:34\n"));
+		const size_t lines = opts_i.lines + 1;
+
+		for (size_t i = 0; i < opts_i.lines; i++) {
+			*chain += '+';
+			*chain += validTimes[rng() % 16];
+			*chain += '\n';
+		}
+
+		benches_o.push_back({"cli/chain", [chain, lines](const uint64_t reps_i) {
+			const int in = tempFile(*chain);
+			const int out = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+			for (uint64_t r = 0; r < reps_i; r++) {
+				lseek(in, 0, SEEK_SET);
+				SdH::processChain(in, out);
+			}
+			close(in);
+			close(out);
+			return reps_i * lines;
+		}});
+
+		// timecal --follow, one operation per single line edit
+		const std::shared_ptr<FollowedFile> followed(new FollowedFile());
+
+		benches_o.push_back({"cli/follow", [valid, followed](const uint64_t reps_i) {
+			const size_t pos = valid->find_first_of("01", valid->find('\n', valid->size() / 2));
+			size_t lines = 0;
+
+			// Follow the schedule on the first call, which only warms up
+			if (!followed->follow) {
+				followed->path = "/tmp/timecal-bench-" + std::to_string(getpid()) + ".schedule";
+				followed->fd = open(followed->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+				if (followed->fd < 0 || write(followed->fd, valid->data(), valid->size()) != static_cast<ssize_t>(valid->size())) {
+					throw std::runtime_error("Unable to write " + followed->path);
+				}
+				followed->follow.reset(new SdH::Follow(followed->path, followed->path + ".out"));
+				followed->follow->update();
+			}
+
+			// Flip an hour between 0x and 1x, which keeps it valid, and
+			// leave the schedule as it was
+			for (uint64_t r = 0; r <= reps_i; r++) {
+				const char digit = (*valid)[pos] ^ (r % 2 == 0 && r < reps_i ? 1 : 0);
+
+				if (pwrite(followed->fd, &digit, 1, pos) != 1) throw std::runtime_error("Unable to edit " + followed->path);
+				lines += followed->follow->update();
+			}
+			keep(lines);
+			return reps_i;
+		}});
+
+		// timecal --batch --stats, last as collecting can't be turned off
+		benches_o.push_back({"cli/stats", [valid, lines = opts_i.lines](const uint64_t reps_i) {
+			const int in = tempFile(*valid);
+			const int out = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+			SdH::Stats::instance().enable();
+			for (uint64_t r = 0; r < reps_i; r++) {
+				lseek(in, 0, SEEK_SET);
+				SdH::processBatch(in, out);
+			}
+			close(in);
+			close(out);
+			return reps_i * lines;
+		}});
+	}
+
+	/** Start-up benchmarks of the timecal application, one operation per
+	 * one-shot call from spawning it until it exited. */
+	void startupBenchmarks(std::vector<Benchmark> & benches_o)
+	{
+		static const char * const reference[] = {TIMECAL_PATH, "09:34", "1:48", nullptr};
+		static const char * const now[] = {TIMECAL_PATH, "1:30", nullptr};
+		static const std::pair<const char *, const char * const *> calls[] = {
+			{"startup/reference", reference}, {"startup/now", now}
+		};
+
+		for (const auto & call : calls) {
+			benches_o.push_back({call.first, [argv = call.second](const uint64_t reps_i) {
+				posix_spawn_file_actions_t actions;
+				pid_t pid = -1;
+				int status = 0;
+
+				posix_spawn_file_actions_init(&actions);
+				posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+				for (uint64_t r = 0; r < reps_i; r++) {
+					if (posix_spawn(&pid, argv[0], &actions, nullptr, const_cast<char * const *>(argv), environ) != 0) {
+						throw std::runtime_error(std::string("Unable to start ") + argv[0]);
+					}
+					if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+						throw std::runtime_error(std::string("Failed to run ") + argv[0]);
+					}
+				}
+				posix_spawn_file_actions_destroy(&actions);
+				return reps_i;
+			}});
+		}
+	}
+
+	/** Write results as JSON, one benchmark per line. */
+	void writeJson(std::ostream & os_io, const std::vector<Result> & results_i)
+	{
+		char buf[512];
+
+		os_io << "{\n\t\"benchmarks\": [\n";
+		for (size_t i = 0; i < results_i.size(); i++) {
+			const Result & res = results_i[i];
+
+			snprintf(buf, sizeof(buf),
+				"\t\t{\"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.3f, \"ops_per_s\": %.0f, \"allocs_per_op\": %.4f}%s\n",
+				res.name.c_str(), static_cast<unsigned long long>(res.ops), res.nsPerOp, 1e9 / res.nsPerOp,
+				res.allocsPerOp, i + 1 < results_i.size() ? "," : "");
+			os_io << buf;
+		}
+		os_io << "\t]\n}\n";
+	}
+
+	/** Read the results of each benchmark from JSON written by writeJson().
+	 * Only the name, the time and the allocations are filled in. */
+	std::map<std::string, Result> readJson(const std::string & path_i)
+	{
+		std::map<std::string, Result> retval;
+		std::ifstream in(path_i);
+		std::string line;
+		size_t pos = 0, end = 0;
+
+		if (!in) throw std::runtime_error("Unable to read " + path_i);
+		while (std::getline(in, line)) {
+			pos = line.find("\"name\": \"");
+			if (pos == std::string::npos) continue;
+			pos += 9;
+			end = line.find('"', pos);
+			const std::string name = line.substr(pos, end - pos);
+
+			Result & res = retval[name];
+
+			res.name = name;
+			pos = line.find("\"ns_per_op\": ");
+			if (pos != std::string::npos) res.nsPerOp = strtod(line.c_str() + pos + 13, nullptr);
+			pos = line.find("\"allocs_per_op\": ");
+			if (pos != std::string::npos) res.allocsPerOp = strtod(line.c_str() + pos + 17, nullptr);
+		}
+
+		return retval;
+	}
+
+	/** Print usage information.
+	 * @returns 1 when @p msg_i is given, 0 otherwise. */
+	int help(const char * appname_i, const std::string & msg_i = "")
+	{
+		if (!msg_i.empty()) std::cerr << "Error: " << msg_i << std::endl << std::endl;
+		std::cerr << "Usage: " << appname_i << " [options]" << std::endl;
+		std::cerr << "Measures the speed of timecal and prints nanoseconds per operation," << std::endl;
+		std::cerr << "operations (lines for cli/*) per second and allocations per operation." << std::endl;
+		std::cerr << "--filter <text>    Only run benchmarks with <text> in their name." << std::endl;
+		std::cerr << "--json <file>      Also write the results as JSON to <file>, - for stdout." << std::endl;
+		std::cerr << "--baseline <file>  Compare with JSON results of an earlier run and fail when" << std::endl;
+		std::cerr << "                   a benchmark got slower than the tolerance." << std::endl;
+		std::cerr << "--tolerance <pct>  Allowed slowdown in percent, default 10." << std::endl;
+		std::cerr << "--min-time <sec>   Minimum duration of a sample, default 0.05." << std::endl;
+		std::cerr << "--lines <n>        Number of generated lines for cli/*, default 100000." << std::endl;
+		return msg_i.empty() ? 0 : 1;
+	}
+
+} // anonymous namespace
+
+// Not inlined, as GCC then mistakes free() for a mismatched deallocation
+__attribute__((noinline)) void * operator new(size_t size_i)
+{
+	void *retval = malloc(size_i > 0 ? size_i : 1);
+
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (retval == nullptr) throw std::bad_alloc();
+	return retval;
+}
+
+__attribute__((noinline)) void operator delete(void * ptr_i) noexcept
+{
+	free(ptr_i);
+}
+
+__attribute__((noinline)) void operator delete(void * ptr_i, size_t) noexcept
+{
+	free(ptr_i);
+}
+
+/** Runs the benchmarks.
+ * @returns 0 on success, 1 on errors or regressions. */
+int main(int argc, char *argv[])
+{
+	std::vector<Benchmark> benches;
+	std::vector<Result> results;
+	Options opts;
+	int retval = 0;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string opt(argv[i]);
+
+		if (opt == "--help") return help(argv[0]);
+		if (i + 1 == argc) return help(argv[0], "Unknown option or missing value " + opt);
+
+		const char *value = argv[++i];
+
+		if (opt == "--filter") {
+			opts.filter = value;
+		} else if (opt == "--json") {
+			opts.json = value;
+		} else if (opt == "--baseline") {
+			opts.baseline = value;
+		} else if (opt == "--tolerance") {
+			opts.tolerance = strtod(value, nullptr);
+		} else if (opt == "--min-time") {
+			opts.minTime = strtod(value, nullptr);
+		} else if (opt == "--lines") {
+			opts.lines = strtoul(value, nullptr, 10);
+			if (opts.lines == 0) return help(argv[0], "Invalid number of lines");
+		} else {
+			return help(argv[0], "Unknown option " + opt);
+		}
+	}
+
+	coreBenchmarks(benches);
+	plannerBenchmarks(benches, opts);
+	taskGraphBenchmarks(benches, opts);
+	optimizerBenchmarks(benches);
+	timingWheelBenchmarks(benches);
+	recurrenceBenchmarks(benches);
+	cliBenchmarks(benches, opts);
+	startupBenchmarks(benches);
+
+	printf("%-34s %12s %12s %14s %10s\n", "benchmark", "ops", "ns/op", "ops/s", "allocs/op");
+	for (const auto & bench : benches) {
+		if (bench.name.find(opts.filter) == std::string::npos) continue;
+		results.push_back(measure(bench.name, bench.body, opts));
+
+		const Result & res = results.back();
+
+		printf("%-34s %12llu %12.2f %14.0f %10.3f\n", res.name.c_str(),
+			static_cast<unsigned long long>(res.ops), res.nsPerOp, 1e9 / res.nsPerOp, res.allocsPerOp);
+		fflush(stdout);
+	}
+
+	try {
+		if (opts.json == "-") {
+			writeJson(std::cout, results);
+		} else if (!opts.json.empty()) {
+			std::ofstream out(opts.json);
+
+			writeJson(out, results);
+			if (!out) throw std::runtime_error("Unable to write " + opts.json);
+		}
+
+		if (!opts.baseline.empty()) {
+			const std::map<std::string, Result> baseline = readJson(opts.baseline);
+
+			for (const Result & res : results) {
+				const auto it = baseline.find(res.name);
+
+				if (it == baseline.end()) continue;
+
+				const Result & old = it->second;
+				const double change = old.nsPerOp > 0.0 ? (res.nsPerOp / old.nsPerOp - 1.0) * 100.0 : 0.0;
+
+				if (change > opts.tolerance) {
+					printf("REGRESSION %s: %.2f ns/op -> %.2f ns/op (+%.1f%%)\n",
+						res.name.c_str(), old.nsPerOp, res.nsPerOp, change);
+					retval = 1;
+				}
+
+				// Allocations don't depend on the machine, but amortized
+				// buffer growth does depend on --lines
+				if (res.allocsPerOp > old.allocsPerOp * (1.0 + opts.tolerance / 100.0) + 0.001) {
+					printf("REGRESSION %s: %.4f allocs/op -> %.4f allocs/op\n",
+						res.name.c_str(), old.allocsPerOp, res.allocsPerOp);
+					retval = 1;
+				}
+			}
+		}
+	} catch (const std::exception & e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return retval;
+}
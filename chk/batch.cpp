@@ -0,0 +1,290 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <Batch.h>
+#include <HoursMinutes.h>
+#include <HoursMinutesArray.h>
+#include <LineReader.h>
+#include "files.h"
+
+#define CHECKNAME batchCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(lines);
+	CPPUNIT_TEST(batch);
+	CPPUNIT_TEST(parallel);
+	CPPUNIT_TEST(chain);
+	CPPUNIT_TEST(collect);
+	CPPUNIT_TEST(sorted);
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void lines() {
+		// A tiny buffer forces refills and growing for long lines
+		int fd = tempFile("a\n\nlonger line\nno newline");
+		SdH::LineReader reader(fd, 4);
+		std::string_view line;
+
+		CPPUNIT_ASSERT(reader.next(line));
+		CPPUNIT_ASSERT(line == "a");
+		CPPUNIT_ASSERT(reader.next(line));
+		CPPUNIT_ASSERT(line.empty());
+		CPPUNIT_ASSERT(reader.next(line));
+		CPPUNIT_ASSERT(line == "longer line");
+		CPPUNIT_ASSERT(reader.next(line));
+		CPPUNIT_ASSERT(line == "no newline");
+		CPPUNIT_ASSERT(!reader.next(line));
+		CPPUNIT_ASSERT(!reader.next(line));
+		close(fd);
+	}
+
+	void batch() {
+		int in = tempFile("09:34 1:48\n23:12 2:54\n+30\n\n28:00 1:00\n+1:\n");
+		int out = tempFile("");
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(6), SdH::processBatch(in, out));
+
+		const std::string result = readAll(out);
+		const size_t errpos = result.find('\n', result.find("\n\n") + 2);
+
+		CPPUNIT_ASSERT_EQUAL(std::string("11:22\n02:06\n02:36\n\n"), result.substr(0, 19));
+		CPPUNIT_ASSERT(errpos != std::string::npos);
+		CPPUNIT_ASSERT_EQUAL(std::string("03:36\n"), result.substr(errpos + 1));
+		close(in);
+		close(out);
+	}
+
+	void parallel() {
+		// Mostly '+' lines, so answers have to be carried across chunks
+		static const char * const lines[] = {
+			"+1:", "+30", "+0", "+23:59", "09:34 1:48", "+45", "", "25:00 1", "+x"
+		};
+		std::mt19937 rng(1234);
+		std::string input;
+
+		for (size_t i = 0; i < 5000; i++) {
+			input += lines[rng() % (sizeof(lines) / sizeof(lines[0]))];
+			input += '\n';
+		}
+		input += "+7";
+
+		int in = tempFile(input);
+		int out = tempFile("");
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(5001), SdH::processBatch(in, out));
+
+		const std::string expected = readAll(out);
+
+		close(out);
+		for (const unsigned threads : {1U, 2U, 3U, 8U}) {
+			for (const size_t chunkSize : {1UL, 7UL, 1000UL, 1UL << 20}) {
+				out = tempFile("");
+				CPPUNIT_ASSERT_EQUAL(
+					static_cast<size_t>(5001),
+					SdH::processParallel(in, out, threads, chunkSize)
+				);
+				CPPUNIT_ASSERT(expected == readAll(out));
+				close(out);
+			}
+		}
+
+		// Empty input and pipes, which can't be mapped
+		int pipefd[2];
+
+		out = tempFile("");
+		CPPUNIT_ASSERT_EQUAL(0, pipe(pipefd));
+		CPPUNIT_ASSERT_EQUAL(static_cast<ssize_t>(7), write(pipefd[1], "+1:\n+30", 7));
+		close(pipefd[1]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), SdH::processParallel(pipefd[0], out, 2));
+		CPPUNIT_ASSERT_EQUAL(std::string("01:00\n01:30\n"), readAll(out));
+		close(pipefd[0]);
+		close(out);
+		close(in);
+
+		in = tempFile("");
+		out = tempFile("");
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), SdH::processParallel(in, out, 2));
+		CPPUNIT_ASSERT(readAll(out).empty());
+		close(in);
+		close(out);
+	}
+
+	void chain() {
+		int in = tempFile("22:15\n3:15\n+30\n\n23:59\n1:00 2:00\nx\n+1:\n");
+		int out = tempFile("");
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(8), SdH::processChain(in, out, 1));
+
+		const std::string prefix("+0 22:15\n+1 01:30\n+1 02:00\n\n+2 01:59\nExpected a single duration\n");
+		const std::string result = readAll(out);
+		const size_t errpos = result.find('\n', prefix.size());
+
+		CPPUNIT_ASSERT_EQUAL(prefix, result.substr(0, prefix.size()));
+		CPPUNIT_ASSERT(errpos != std::string::npos);
+		CPPUNIT_ASSERT_EQUAL(std::string("+2 02:59\n"), result.substr(errpos + 1));
+		close(in);
+		close(out);
+
+		// Long chains across chunks, compared with adding one by one
+		std::mt19937 rng(4321);
+		std::string input("09:34\n"), expected("+0 09:34\n");
+		SdH::HoursMinutes hm("09:34");
+		size_t day = 0;
+		char buf[SdH::HoursMinutes::charsLength];
+
+		for (size_t i = 0; i < 5000; i++) {
+			SdH::HoursMinutes dur;
+
+			dur.minutesOfDay(rng() % SdH::HoursMinutes::minutesPerDay);
+			input += i % 2 ? "+" : "";
+			input.append(buf, dur.toChars(buf) - buf) += '\n';
+			if (hm.minutesOfDay() + dur.minutesOfDay() >= SdH::HoursMinutes::minutesPerDay) day++;
+			hm += dur;
+			expected += '+' + std::to_string(day) + ' ';
+			expected.append(buf, hm.toChars(buf) - buf) += '\n';
+		}
+
+		in = tempFile(input);
+		for (const unsigned threads : {1U, 2U, 3U, 8U}) {
+			for (const size_t chunkSize : {1UL, 7UL, 1000UL, 1UL << 20}) {
+				out = tempFile("");
+				CPPUNIT_ASSERT_EQUAL(
+					static_cast<size_t>(5001),
+					SdH::processChain(in, out, threads, chunkSize)
+				);
+				CPPUNIT_ASSERT(expected == readAll(out));
+				close(out);
+			}
+		}
+		close(in);
+
+		// Pipes, which can't be mapped
+		int pipefd[2];
+
+		out = tempFile("");
+		CPPUNIT_ASSERT_EQUAL(0, pipe(pipefd));
+		CPPUNIT_ASSERT_EQUAL(static_cast<ssize_t>(10), write(pipefd[1], "23:00\n1:30", 10));
+		close(pipefd[1]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), SdH::processChain(pipefd[0], out, 2));
+		CPPUNIT_ASSERT_EQUAL(std::string("+0 23:00\n+1 00:30\n"), readAll(out));
+		close(pipefd[0]);
+		close(out);
+
+		// The first line needs a single time
+		for (const char * const start : {"", "\n1:00\n", "+1:\n", "9:00 1:00\n", "25:00\n"}) {
+			in = tempFile(start);
+			out = tempFile("");
+			if (*start == '\0') {
+				CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), SdH::processChain(in, out));
+			} else {
+				CPPUNIT_ASSERT_THROW(SdH::processChain(in, out), std::invalid_argument);
+			}
+			close(in);
+			close(out);
+		}
+	}
+
+	void collect() {
+		int in = tempFile("09:34 1:48\n+30\n\n23:12 2:54");
+		SdH::HoursMinutesArray times;
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), SdH::collectBatch(in, times));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), times.size());
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(682), times.data()[0]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(712), times.data()[1]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(126), times.data()[2]);
+		close(in);
+
+		in = tempFile("09:34 1:48\n\n25:00 1\n");
+		try {
+			SdH::collectBatch(in, times);
+			CPPUNIT_FAIL("Invalid line accepted");
+		} catch (const std::invalid_argument & ia) {
+			CPPUNIT_ASSERT_EQUAL(std::string("Line 3: "), std::string(ia.what()).substr(0, 8));
+		}
+		close(in);
+	}
+
+	void sorted() {
+		int in = tempFile("09:34 1:48\n+30\n23:12 2:54\n\n1:00 1:06\n+12:00\n+12:00\n11:00 0:22");
+		int out = tempFile("");
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(8), SdH::processSorted(in, out));
+		CPPUNIT_ASSERT_EQUAL(std::string("02:06 3 5 7\n11:22 1 8\n11:52 2\n14:06 6\n"), readAll(out));
+		close(out);
+
+		// A '+' line continues on the day of the answer before it
+		out = tempFile("");
+		lseek(in, 0, SEEK_SET);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(8), SdH::processSorted(in, out, true));
+		CPPUNIT_ASSERT_EQUAL(
+			std::string("+0 02:06 5\n+0 11:22 1 8\n+0 11:52 2\n+0 14:06 6\n+1 02:06 3 7\n"),
+			readAll(out)
+		);
+		close(out);
+		close(in);
+
+		in = tempFile("");
+		out = tempFile("");
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), SdH::processSorted(in, out));
+		CPPUNIT_ASSERT(readAll(out).empty());
+		close(in);
+		close(out);
+
+		in = tempFile("1:00\n+x\n");
+		out = tempFile("");
+		CPPUNIT_ASSERT_THROW(SdH::processSorted(in, out), std::invalid_argument);
+		close(in);
+		close(out);
+	}
+
+};
+
+#undef CHECKNAME
@@ -0,0 +1,168 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <BatchParser.h>
+
+#define CHECKNAME batchparserCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(edgeCases);
+	CPPUNIT_TEST(random);
+	CPPUNIT_TEST(longLines);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Parse @p input_i with every instruction set and compare each record
+	 * to the outcome of the scalar line parser. */
+	static void compare(const std::string & input_i, const size_t lines_i)
+	{
+		const SdH::BatchParser::Isa isas[] = {
+			SdH::BatchParser::Isa::scalar,
+			SdH::BatchParser::Isa::sse2,
+			SdH::BatchParser::Isa::avx2
+		};
+		std::vector<SdH::BatchParser::Record> recs(lines_i + 1);
+
+		for (const SdH::BatchParser::Isa isa : isas) {
+			const SdH::BatchParser parser(isa);
+			const char *pos = input_i.data();
+			const char *last = pos + input_i.size();
+			size_t total = 0, count = 0;
+
+			// Use a small record array to exercise resuming
+			while (pos != last) {
+				pos = parser.parse(pos, last, recs.data() + total, 7, count);
+				total += count;
+				CPPUNIT_ASSERT(total <= lines_i);
+			}
+			CPPUNIT_ASSERT_EQUAL(lines_i, total);
+
+			for (size_t i = 0; i < total; i++) {
+				const SdH::BatchParser::Record & rec = recs[i];
+				SdH::BatchParser::Record ref;
+
+				SdH::BatchParser::parseLine(rec.first, rec.last, ref);
+				CPPUNIT_ASSERT(rec.result.ec == ref.result.ec);
+				CPPUNIT_ASSERT(rec.result.ptr == ref.result.ptr);
+				CPPUNIT_ASSERT(rec.kind == ref.kind);
+				if (ref.result.ec != std::errc()) continue;
+				CPPUNIT_ASSERT_EQUAL(ref.reference.hours(), rec.reference.hours());
+				CPPUNIT_ASSERT_EQUAL(ref.reference.minutes(), rec.reference.minutes());
+				CPPUNIT_ASSERT_EQUAL(ref.duration.hours(), rec.duration.hours());
+				CPPUNIT_ASSERT_EQUAL(ref.duration.minutes(), rec.duration.minutes());
+			}
+		}
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void edgeCases() {
+		const char *tokens[] = {
+			"", "0", "00", "000", ":", "::", ":0", ":00", ":000", "0:", "0:0",
+			"0:00", "0:000", "00:", "00:0", "00:00", "00:000", "000:", "000:0",
+			"000:00", "000:000", "7", "07", "007", ":7", ":07", ":007", "0:7",
+			"0:07", "0:007", "00:7", "00:07", "00:007", "000:7", "000:07",
+			"000:007", "42", "042", ":42", ":042", "0:42", "0:042", "00:42",
+			"00:042", "000:42", "000:042", "9:5", "7:13", "10:3", "11:48", "6:",
+			"22:", "InvalidTime", "28:92", "11:87", "42:19", "23:59", "24:00",
+			"1:60", "+", "+5", "+:", "+23:59", "+24:"
+		};
+		std::string input;
+		size_t lines = 0;
+
+		// Every token alone, chained and combined with a few others
+		for (const char *tok : tokens) {
+			input += std::string(tok) + "\n";
+			input += std::string("+") + tok + "\n";
+			input += std::string(tok) + " 1:30\n";
+			input += std::string("12:00 ") + tok + "\n";
+			input += std::string(tok) + " " + tok + "\n";
+			input += std::string(tok) + "  " + tok + "\n";
+			lines += 6;
+		}
+
+		compare(input, lines);
+
+		// The same without a final newline
+		input.pop_back();
+		compare(input, lines);
+	}
+
+	void random() {
+		const char alphabet[] = "0123456789::  +x\r";
+		std::mt19937 gen(1440);
+		std::uniform_int_distribution<size_t> len(0, 14);
+		std::uniform_int_distribution<size_t> chr(0, sizeof(alphabet) - 2);
+		std::uniform_int_distribution<unsigned> val(0, 99);
+		std::string input;
+		char buf[16];
+
+		for (size_t i = 0; i < 20000; i++) {
+			if (i % 2) {
+				for (size_t n = len(gen); n > 0; n--) input += alphabet[chr(gen)];
+			} else {
+				// Mostly well formed records
+				snprintf(buf, sizeof(buf), "%u:%02u %u:%u", val(gen) % 30, val(gen) % 64, val(gen) % 25, val(gen));
+				input += buf;
+			}
+			input += '\n';
+		}
+
+		compare(input, 20000);
+	}
+
+	void longLines() {
+		// Lines longer than the fast path and the classification window
+		std::string input = "1:00 2:00\n";
+
+		input += std::string(100, '1') + "\n";
+		input += std::string(5000, ' ') + "\n";
+		input += "+5\n";
+		input += std::string(9000, ':');
+		compare(input, 5);
+	}
+
+};
+
+#undef CHECKNAME
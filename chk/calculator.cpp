@@ -0,0 +1,102 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <string_view>
+#include <Calculator.h>
+
+#define CHECKNAME calculatorCheck
+
+#define CALCULATE(CALC, LINE, REF, DUR, RES) \
+{ \
+	CPPUNIT_ASSERT_NO_THROW(CALC.process(LINE)); \
+	CPPUNIT_ASSERT_EQUAL(SdH::HoursMinutes(REF).hours(), CALC.reference().hours()); \
+	CPPUNIT_ASSERT_EQUAL(SdH::HoursMinutes(REF).minutes(), CALC.reference().minutes()); \
+	CPPUNIT_ASSERT_EQUAL(SdH::HoursMinutes(DUR).hours(), CALC.duration().hours()); \
+	CPPUNIT_ASSERT_EQUAL(SdH::HoursMinutes(DUR).minutes(), CALC.duration().minutes()); \
+	CPPUNIT_ASSERT_EQUAL(SdH::HoursMinutes(RES).hours(), CALC.result().hours()); \
+	CPPUNIT_ASSERT_EQUAL(SdH::HoursMinutes(RES).minutes(), CALC.result().minutes()); \
+}
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(process);
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void process() {
+		SdH::Calculator calc;
+
+		// Previous answer starts at midnight
+		CALCULATE(calc, "+1:15", "00:00", "01:15", "01:15");
+
+		// Reference and duration
+		CALCULATE(calc, "09:34 1:48", "09:34", "01:48", "11:22");
+		CALCULATE(calc, "23:12 2:54", "23:12", "02:54", "02:06");
+
+		// Chaining on the previous answer
+		CALCULATE(calc, "+30", "02:06", "00:30", "02:36");
+		CALCULATE(calc, "+:", "02:36", "00:00", "02:36");
+
+		// Failures leave the previous answer alone
+		CPPUNIT_ASSERT_THROW(calc.process("12:00 1:87"), std::overflow_error);
+		CPPUNIT_ASSERT_THROW(calc.process("+abc"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(calc.process("1:00  2:00"), std::invalid_argument);
+		CALCULATE(calc, "+1:", "02:36", "01:00", "03:36");
+
+		// The non-throwing interface points at the offending field
+		{
+			const std::string_view line("12:00 1:87");
+			const SdH::HoursMinutes::ParseResult res = calc.evaluate(line);
+			CPPUNIT_ASSERT(res.ec == std::errc::result_out_of_range);
+			CPPUNIT_ASSERT(res.ptr == line.data() + 8);
+			CPPUNIT_ASSERT(calc.evaluate("+2:24").ec == std::errc());
+			CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(6), calc.result().hours());
+		}
+
+		// A lone duration is added to the current time
+		CPPUNIT_ASSERT_NO_THROW(calc.process("0"));
+		CPPUNIT_ASSERT(calc.duration().isZero());
+	}
+
+};
+
+#undef CHECKNAME
@@ -0,0 +1,242 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <Batch.h>
+#include <ColumnFile.h>
+#include "files.h"
+
+#define CHECKNAME columnFileCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(convert);
+	CPPUNIT_TEST(pipes);
+	CPPUNIT_TEST(invalid);
+	CPPUNIT_TEST(checksum);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Convert lines to the bytes of a column file. */
+	static std::string toColumns(const std::string & lines_i, const bool carries_i)
+	{
+		const int in = tempFile(lines_i);
+		const int out = tempFile("");
+		std::string retval;
+
+		SdH::convertToColumns(in, out, carries_i);
+		retval = readAll(out);
+		close(in);
+		close(out);
+		return retval;
+	}
+
+	/** Check that reading a column file fails with a message. */
+	static void reject(const std::string & bytes_i, const std::string & msg_i)
+	{
+		const int fd = tempFile(bytes_i);
+
+		try {
+			SdH::ColumnFile columns(fd);
+			CPPUNIT_FAIL("Accepted an invalid column file, expected: " + msg_i);
+		} catch (const std::invalid_argument & ia) {
+			CPPUNIT_ASSERT_EQUAL(msg_i, std::string(ia.what()));
+		}
+		close(fd);
+	}
+
+	/** Fletcher-64 the slow way, one word at a time. */
+	static uint64_t fletcher(const std::vector<uint8_t> & data_i, uint64_t previous_i)
+	{
+		std::vector<uint8_t> padded(data_i);
+		uint64_t a = previous_i & 0xFFFFFFFF, b = previous_i >> 32;
+
+		padded.resize(SdH::ColumnFile::columnSize(data_i.size(), 1));
+		for (size_t i = 0; i < padded.size(); i += 4) {
+			const uint32_t word = padded[i] | padded[i + 1] << 8 | padded[i + 2] << 16 | uint32_t(padded[i + 3]) << 24;
+
+			a = (a + word) % 0xFFFFFFFF;
+			b = (b + a) % 0xFFFFFFFF;
+		}
+		return b << 32 | a;
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void convert() {
+		const std::string bytes = toColumns("09:34 1:48\n\n+30\n23:12 2:54\n", true);
+		const int fd = tempFile(bytes);
+		const int out = tempFile("");
+
+		// Header and four padded columns of three records
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(32 + 3 * 16 + 16), bytes.size());
+		CPPUNIT_ASSERT_EQUAL(std::string("TCAL"), bytes.substr(0, 4));
+		{
+			const SdH::ColumnFile columns(fd);
+			const uint16_t refs[] = {9 * 60 + 34, 11 * 60 + 22, 23 * 60 + 12};
+			const uint16_t durs[] = {1 * 60 + 48, 30, 2 * 60 + 54};
+			const uint16_t results[] = {11 * 60 + 22, 11 * 60 + 52, 2 * 60 + 6};
+			const uint8_t carries[] = {0, 0, 1};
+
+			CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), columns.size());
+			CPPUNIT_ASSERT(columns.carries() != nullptr);
+			CPPUNIT_ASSERT_EQUAL(0, memcmp(refs, columns.references(), sizeof(refs)));
+			CPPUNIT_ASSERT_EQUAL(0, memcmp(durs, columns.durations(), sizeof(durs)));
+			CPPUNIT_ASSERT_EQUAL(0, memcmp(results, columns.results(), sizeof(results)));
+			CPPUNIT_ASSERT_EQUAL(0, memcmp(carries, columns.carries(), sizeof(carries)));
+			CPPUNIT_ASSERT_EQUAL(static_cast<uintptr_t>(0), reinterpret_cast<uintptr_t>(columns.results()) % SdH::ColumnFile::alignment);
+		}
+
+		// Back to lines that evaluate to the same results
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), SdH::convertFromColumns(fd, out));
+		CPPUNIT_ASSERT_EQUAL(std::string("09:34 01:48\n11:22 00:30\n23:12 02:54\n"), readAll(out));
+		close(fd);
+		close(out);
+
+		// Without carries and without records
+		{
+			const int plain = tempFile(toColumns("23:12 2:54\n", false));
+			const SdH::ColumnFile columns(plain);
+
+			CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), columns.size());
+			CPPUNIT_ASSERT(columns.carries() == nullptr);
+			close(plain);
+		}
+		{
+			const int empty = tempFile(toColumns("", true));
+			const SdH::ColumnFile columns(empty);
+
+			CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), columns.size());
+			close(empty);
+		}
+
+		// Lines that can't be parsed are errors
+		try {
+			toColumns("09:34 1:48\n1:87\n", false);
+			CPPUNIT_FAIL("Accepted an invalid line");
+		} catch (const std::invalid_argument & ia) {
+			CPPUNIT_ASSERT_EQUAL(std::string("Line 2: "), std::string(ia.what()).substr(0, 8));
+		}
+	}
+
+	void pipes() {
+		const std::string bytes = toColumns("09:34 1:48\n+30\n", false);
+		int pipefd[2];
+
+		CPPUNIT_ASSERT_EQUAL(0, pipe(pipefd));
+		CPPUNIT_ASSERT_EQUAL(static_cast<ssize_t>(bytes.size()), write(pipefd[1], bytes.data(), bytes.size()));
+		close(pipefd[1]);
+		{
+			const SdH::ColumnFile columns(pipefd[0]);
+
+			CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), columns.size());
+			CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(11 * 60 + 52), columns.results()[1]);
+			CPPUNIT_ASSERT_EQUAL(static_cast<uintptr_t>(0), reinterpret_cast<uintptr_t>(columns.results()) % SdH::ColumnFile::alignment);
+		}
+		close(pipefd[0]);
+	}
+
+	void invalid() {
+		const std::string bytes = toColumns("09:34 1:48\n+30\n23:12 2:54\n", true);
+		std::string broken;
+		SdH::ColumnFile::Header header;
+
+		reject("", "Not a column file, it is too short");
+		reject("09:34 1:48\n09:34 1:48\n09:34 1:48\n", "Not a column file");
+
+		broken = bytes;
+		broken[4] = 2;
+		reject(broken, "Unsupported column file version 2");
+
+		broken = bytes;
+		broken[6] = 2;
+		reject(broken, "Column file has unknown flags");
+
+		reject(bytes.substr(0, bytes.size() - 1), "Column file has 95 bytes instead of 96");
+		reject(bytes + std::string(16, '\0'), "Column file has 112 bytes instead of 96");
+
+		// A count that would overflow the size of the columns
+		broken = bytes;
+		memcpy(&header, broken.data(), sizeof(header));
+		header.count = ~uint64_t(0) / 2;
+		memcpy(&broken[0], &header, sizeof(header));
+		reject(broken, "Column file is truncated");
+
+		// Any changed bit in the columns fails the checksum
+		broken = bytes;
+		broken[32 + 16 + 2] ^= 4;
+		reject(broken, "Column file fails its checksum");
+
+		// Times beyond the day with a valid checksum
+		broken = bytes;
+		broken[32 + 32] = static_cast<char>(0xA0);
+		broken[32 + 33] = 0x05;
+		memcpy(&header, broken.data(), sizeof(header));
+		header.checksum = SdH::ColumnFile::checksum(broken.data() + 32, broken.size() - 32);
+		memcpy(&broken[0], &header, sizeof(header));
+		reject(broken, "Column file holds times of 24:00 or more");
+	}
+
+	void checksum() {
+		std::mt19937 rng(1440);
+		std::uniform_int_distribution<int> byte(0, 255);
+		std::vector<uint8_t> data;
+
+		// Long runs of large words exercise the delayed reduction
+		data.assign(1 << 20, 0xFF);
+		CPPUNIT_ASSERT_EQUAL(fletcher(data, 0), SdH::ColumnFile::checksum(data.data(), data.size()));
+
+		for (size_t size = 0; size < 300; size++) {
+			const uint64_t previous = uint64_t(rng() % 0xFFFFFFFF) << 32 | rng() % 0xFFFFFFFF;
+
+			data.resize(size);
+			for (uint8_t & b : data) b = byte(rng);
+			CPPUNIT_ASSERT_EQUAL(fletcher(data, previous), SdH::ColumnFile::checksum(data.data(), size, previous));
+		}
+	}
+};
+
+#undef CHECKNAME
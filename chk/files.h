@@ -0,0 +1,69 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#pragma once
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+/** Create an anonymous temporary file with the given contents.
+ * @returns File descriptor positioned at the start of the file. */
+inline int tempFile(const std::string & contents_i)
+{
+	FILE *fp = tmpfile();
+	int fd = -1;
+
+	CPPUNIT_ASSERT(fp != nullptr);
+	fd = dup(fileno(fp));
+	fclose(fp);
+	CPPUNIT_ASSERT(fd >= 0);
+	CPPUNIT_ASSERT_EQUAL(
+		static_cast<ssize_t>(contents_i.size()),
+		write(fd, contents_i.data(), contents_i.size())
+	);
+	CPPUNIT_ASSERT_EQUAL(static_cast<off_t>(0), lseek(fd, 0, SEEK_SET));
+	return fd;
+}
+
+/** Read a file descriptor from the start until the end. */
+inline std::string readAll(const int fd_i)
+{
+	std::string retval;
+	char buf[256];
+	ssize_t count = 0;
+
+	lseek(fd_i, 0, SEEK_SET);
+	while ((count = read(fd_i, buf, sizeof(buf))) > 0) retval.append(buf, count);
+	return retval;
+}
@@ -0,0 +1,245 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <Calculator.h>
+#include <Follow.h>
+
+#define CHECKNAME followCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(edits);
+	CPPUNIT_TEST(random);
+	CPPUNIT_TEST(watch);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Path of the schedule file used by the checks. */
+	std::string inPath_a;
+
+	/** Path of the output file used by the checks. */
+	std::string outPath_a;
+
+	/** Replace the schedule file, through a rename like editors do. */
+	void save(const std::string & text_i) const
+	{
+		const std::string tmp = inPath_a + ".tmp";
+
+		{
+			std::ofstream out(tmp);
+
+			out << text_i;
+		}
+		CPPUNIT_ASSERT_EQUAL(0, rename(tmp.c_str(), inPath_a.c_str()));
+	}
+
+	/** Read the output file. */
+	std::string load() const
+	{
+		std::ifstream in(outPath_a);
+
+		return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	/** Evaluate a whole schedule like the interactive mode does. */
+	static std::string expected(const std::string & text_i)
+	{
+		std::istringstream in(text_i);
+		std::ostringstream out;
+		SdH::Calculator calc;
+		std::string line;
+
+		while (std::getline(in, line)) {
+			if (!line.empty()) {
+				const SdH::HoursMinutes::ParseResult res = calc.evaluate(line);
+
+				if (res.ec == std::errc()) {
+					out << calc.result();
+				} else {
+					SdH::HoursMinutes::printError(out, res, line.data() + line.size());
+				}
+			}
+			out << '\n';
+		}
+		return out.str();
+	}
+
+	/** Join lines with newlines after each. */
+	static std::string join(const std::vector<std::string> & lines_i)
+	{
+		std::string retval;
+
+		for (const std::string & line : lines_i) retval += line + '\n';
+		return retval;
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void setUp()
+	{
+		inPath_a = "/tmp/timecal-chk-" + std::to_string(getpid()) + ".schedule";
+		outPath_a = "/tmp/timecal-chk-" + std::to_string(getpid()) + ".out";
+		unlink(inPath_a.c_str());
+	}
+
+	void tearDown()
+	{
+		unlink(inPath_a.c_str());
+		unlink(outPath_a.c_str());
+	}
+
+	void edits() {
+		SdH::Follow follow(inPath_a, outPath_a);
+		std::vector<std::string> lines = {"09:34 1:48", "+30", "", "23:12 2:54", "+1:", "x", "+5", "10:00 0"};
+
+		// A missing schedule is not an error, it may be renamed in later
+		CPPUNIT_ASSERT_EQUAL(size_t(0), follow.update());
+		save(join(lines));
+		CPPUNIT_ASSERT_EQUAL(size_t(8), follow.update());
+		CPPUNIT_ASSERT_EQUAL(expected(join(lines)), follow.output());
+		CPPUNIT_ASSERT_EQUAL(follow.output(), load());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), follow.update());
+
+		// Only the changed line, then the lines chained to it
+		lines[7] = "10:00 1";
+		save(join(lines));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), follow.update());
+		lines[3] = "23:13 2:54";
+		save(join(lines));
+		CPPUNIT_ASSERT_EQUAL(size_t(4), follow.update());
+		CPPUNIT_ASSERT_EQUAL(expected(join(lines)), follow.output());
+		CPPUNIT_ASSERT_EQUAL(follow.output(), load());
+
+		// Output of another size moves the rest, the lines between two
+		// changes count as changed too
+		lines[5] = "25:00 1";
+		lines.insert(lines.begin() + 1, "08:00 0");
+		save(join(lines));
+		CPPUNIT_ASSERT_EQUAL(size_t(6), follow.update());
+		CPPUNIT_ASSERT_EQUAL(expected(join(lines)), follow.output());
+		CPPUNIT_ASSERT_EQUAL(follow.output(), load());
+		lines.erase(lines.begin(), lines.begin() + 4);
+		save(join(lines));
+		CPPUNIT_ASSERT_EQUAL(size_t(0), follow.update());
+		CPPUNIT_ASSERT_EQUAL(lines.size(), follow.lines());
+		CPPUNIT_ASSERT_EQUAL(expected(join(lines)), follow.output());
+		CPPUNIT_ASSERT_EQUAL(follow.output(), load());
+
+		// A last line without newline, then nothing at all
+		save("+1");
+		CPPUNIT_ASSERT_EQUAL(size_t(1), follow.update());
+		CPPUNIT_ASSERT_EQUAL(std::string("00:01\n"), load());
+		save("");
+		CPPUNIT_ASSERT_EQUAL(size_t(0), follow.update());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), follow.lines());
+		CPPUNIT_ASSERT_EQUAL(std::string(), load());
+	}
+
+	void random() {
+		static const char * const kinds[] = {"%02u:%02u %u:%02u", "+%.0u%u:%02u", "%02u:%02u x", "", "%u%u:%02u:"};
+		static const char * const similar[] = {"+1", "+10", "1:00 1", "1:00 10", "", "+1:"};
+		std::mt19937 rng(42);
+		SdH::Follow follow(inPath_a, outPath_a);
+		std::vector<std::string> lines;
+		char buf[32];
+
+		// Compare with evaluating everything after every edit
+		for (size_t round = 0; round < 300; round++) {
+			const size_t edits = 1 + rng() % 3;
+
+			for (size_t e = 0; e < edits; e++) {
+				const size_t pos = lines.empty() ? 0 : rng() % lines.size();
+				const unsigned action = rng() % 3;
+
+				// Similar lines make the changed bytes end mid-line
+				if (round % 2 == 0) {
+					snprintf(buf, sizeof(buf), "%s", similar[rng() % 6]);
+				} else {
+					snprintf(buf, sizeof(buf), kinds[rng() % 5], rng() % 24, rng() % 60, rng() % 30, rng() % 60);
+				}
+				if (action == 0 || lines.size() < 50) {
+					lines.insert(lines.begin() + pos, buf);
+				} else if (action == 1) {
+					lines[pos] = buf;
+				} else {
+					lines.erase(lines.begin() + pos);
+				}
+			}
+			// Sometimes without the last newline
+			std::string text = join(lines);
+
+			if (round % 7 == 0 && !text.empty()) text.pop_back();
+			save(text);
+			follow.update();
+			CPPUNIT_ASSERT_EQUAL(expected(text), follow.output());
+			CPPUNIT_ASSERT_EQUAL(follow.output(), load());
+		}
+	}
+
+	void watch() {
+		SdH::Follow follow(inPath_a, outPath_a);
+		std::thread runner(&SdH::Follow::run, &follow);
+		const std::string text = "09:34 1:48\n+30\n";
+		std::string out;
+
+		// Wait for run() to pick up the new schedule
+		save(text);
+		for (size_t i = 0; i < 200 && out != expected(text); i++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			out = load();
+		}
+		follow.stop();
+		runner.join();
+		CPPUNIT_ASSERT_EQUAL(std::string("11:22\n11:52\n"), out);
+	}
+
+};
+
+#undef CHECKNAME
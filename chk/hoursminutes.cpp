@@ -32,10 +32,27 @@
 
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
 #include <HoursMinutes.h>
 
 #define CHECKNAME hoursminutesCheck
 
+using namespace SdH::literals;
+
+// A schedule table computed by the compiler
+constexpr SdH::HoursMinutes schedule[] = {
+	"09:34"_hm, "09:34"_hm + "1:48"_hm, "23:12"_hm + "2:54"_hm, "45"_hm + ":"_hm
+};
+
+static_assert(schedule[0].minutesOfDay() == 574, "Literal is parsed at compile time");
+static_assert(schedule[1].hours() == 11 && schedule[1].minutes() == 22, "Sum is added at compile time");
+static_assert(schedule[2].minutesOfDay() == 126, "Sum wraps at midnight at compile time");
+static_assert(schedule[3].minutesOfDay() == 45, "Minutes only");
+static_assert(SdH::HoursMinutes(23, 59).minutesOfDay() == 1439, "Field constructor is constexpr");
+
 #define VALIDATE(STR, HRS, MINUTES) \
 { \
 	CPPUNIT_ASSERT_NO_THROW(SdH::HoursMinutes hm(STR)); \
@@ -44,6 +61,29 @@
 	CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(MINUTES), hm.minutes()); \
 }
 
+#define FROMCHARS(STR, EC, HRS, MINUTES) \
+{ \
+	const std::string_view sv(STR); \
+	SdH::HoursMinutes hm(23, 59); \
+	const SdH::HoursMinutes::ParseResult res = \
+		SdH::HoursMinutes::fromChars(sv.data(), sv.data() + sv.size(), hm); \
+	CPPUNIT_ASSERT(res.ec == EC); \
+	CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(HRS), hm.hours()); \
+	CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(MINUTES), hm.minutes()); \
+	if (res.ec == std::errc()) CPPUNIT_ASSERT(res.ptr == sv.data() + sv.size()); \
+}
+
+#define MESSAGE(STR, TEXT) \
+{ \
+	const std::string_view sv(STR); \
+	SdH::HoursMinutes hm; \
+	std::ostringstream oss; \
+	const SdH::HoursMinutes::ParseResult res = \
+		SdH::HoursMinutes::fromChars(sv.data(), sv.data() + sv.size(), hm); \
+	SdH::HoursMinutes::printError(oss, res, sv.data() + sv.size()); \
+	CPPUNIT_ASSERT_EQUAL(std::string(TEXT), oss.str()); \
+}
+
 class CHECKNAME;
 
 CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
@@ -51,6 +91,10 @@ CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
 class CHECKNAME : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE(CHECKNAME);
 	CPPUNIT_TEST(constructors);
+	CPPUNIT_TEST(fromChars);
+	CPPUNIT_TEST(addition);
+	CPPUNIT_TEST(formatting);
+	CPPUNIT_TEST(literals);
 	CPPUNIT_TEST_SUITE_END();
 
 	public:
@@ -135,6 +179,114 @@ class CHECKNAME : public CppUnit::TestFixture {
 		CPPUNIT_ASSERT_THROW(SdH::HoursMinutes hm("42:19"), std::overflow_error);
 	}
 
+	void fromChars() {
+		const std::errc ok = std::errc();
+		const std::errc inv = std::errc::invalid_argument;
+		const std::errc ofe = std::errc::result_out_of_range;
+		const std::errc lng = std::errc::value_too_large;
+
+		// Successful parses replace the value
+		FROMCHARS("", ok, 0, 0);
+		FROMCHARS(":", ok, 0, 0);
+		FROMCHARS("0:", ok, 0, 0);
+		FROMCHARS("7", ok, 0, 7);
+		FROMCHARS(":07", ok, 0, 7);
+		FROMCHARS("00:7", ok, 0, 7);
+		FROMCHARS("9:5", ok, 9, 5);
+		FROMCHARS("22:", ok, 22, 0);
+		FROMCHARS("11:48", ok, 11, 48);
+
+		// Failures leave the value untouched
+		FROMCHARS("000", lng, 23, 59);
+		FROMCHARS("::", inv, 23, 59);
+		FROMCHARS(":007", lng, 23, 59);
+		FROMCHARS("000:7", lng, 23, 59);
+		FROMCHARS("InvalidTime", lng, 23, 59);
+		FROMCHARS("1a", inv, 23, 59);
+		FROMCHARS("28:92", ofe, 23, 59);
+		FROMCHARS("11:87", ofe, 23, 59);
+		FROMCHARS("75", ofe, 23, 59);
+
+		// Error positions
+		{
+			const char str[] = "11:8x";
+			SdH::HoursMinutes hm;
+			const SdH::HoursMinutes::ParseResult res =
+				SdH::HoursMinutes::fromChars(str, str + 5, hm);
+			CPPUNIT_ASSERT(res.ptr == str + 4);
+		}
+
+		// Descriptions match the exceptions of the throwing interface
+		MESSAGE("1a", "Invalid character 'a' in time string");
+		MESSAGE("::", "Invalid character ':' in time string");
+		MESSAGE("007", "Integer string longer than two characters");
+		MESSAGE("abc", "Integer string longer than two characters");
+		MESSAGE("1:2:3", "Integer string longer than two characters");
+		MESSAGE("28:92", "String value \"28\" is a valid integer but is larger than 23");
+		MESSAGE("11:87", "String value \"87\" is a valid integer but is larger than 59");
+		MESSAGE("75", "String value \"75\" is a valid integer but is larger than 59");
+	}
+
+	void addition() {
+		// Compare with field by field addition for every combination
+		for (uint16_t lhs = 0; lhs < SdH::HoursMinutes::minutesPerDay; lhs++) {
+			for (uint16_t rhs = 0; rhs < SdH::HoursMinutes::minutesPerDay; rhs += 7) {
+				SdH::HoursMinutes hm(lhs / 60, lhs % 60);
+				unsigned hrs = lhs / 60 + rhs / 60;
+				unsigned min = lhs % 60 + rhs % 60;
+
+				if (min > 59) { hrs++; min %= 60; }
+				hrs %= 24;
+
+				hm += SdH::HoursMinutes(rhs / 60, rhs % 60);
+				CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(hrs), hm.hours());
+				CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(min), hm.minutes());
+			}
+		}
+
+		// Minutes of day conversion
+		{
+			SdH::HoursMinutes hm("23:59");
+			CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(1439), hm.minutesOfDay());
+			hm.minutesOfDay(754);
+			CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(12), hm.hours());
+			CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(34), hm.minutes());
+			CPPUNIT_ASSERT_THROW(hm.minutesOfDay(1440), std::overflow_error);
+		}
+	}
+
+	void formatting() {
+		char buf[8] = "xxxxxxx";
+
+		// Every time formats like the classic stream manipulators would
+		for (uint8_t hrs = 0; hrs < 24; hrs++) {
+			for (uint8_t min = 0; min < 60; min++) {
+				const SdH::HoursMinutes hm(hrs, min);
+				std::ostringstream expected, oss;
+
+				expected << std::setw(2) << std::setfill('0') << static_cast<unsigned>(hrs) << ':';
+				expected << std::setw(2) << std::setfill('0') << static_cast<unsigned>(min);
+				CPPUNIT_ASSERT(hm.toChars(buf) == buf + SdH::HoursMinutes::charsLength);
+				CPPUNIT_ASSERT_EQUAL(expected.str(), std::string(buf, SdH::HoursMinutes::charsLength));
+				oss << hm;
+				CPPUNIT_ASSERT_EQUAL(expected.str(), oss.str());
+			}
+		}
+
+		// Nothing beyond the five characters is touched
+		CPPUNIT_ASSERT_EQUAL(std::string("xx"), std::string(buf + 5));
+	}
+
+	void literals() {
+		// The same literals evaluated at run time
+		const std::string_view bad[] = {"24:00", "1x"};
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(574), schedule[0].minutesOfDay());
+		CPPUNIT_ASSERT_EQUAL(schedule[1].minutesOfDay(), SdH::HoursMinutes("11:22").minutesOfDay());
+		CPPUNIT_ASSERT_THROW(SdH::HoursMinutes hm(bad[0]), std::overflow_error);
+		CPPUNIT_ASSERT_THROW(SdH::HoursMinutes hm(bad[1]), std::invalid_argument);
+	}
+
 };
 
 #undef CHECKNAME
@@ -0,0 +1,256 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include <HoursMinutesArray.h>
+
+#define CHECKNAME hoursminutesarrayCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(conversion);
+	CPPUNIT_TEST(addition);
+	CPPUNIT_TEST(formatting);
+	CPPUNIT_TEST(scan);
+	CPPUNIT_TEST(queries);
+	CPPUNIT_TEST(sorting);
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void conversion() {
+		SdH::HoursMinutesArray arr;
+
+		for (uint8_t hrs = 0; hrs < 24; hrs++) {
+			for (uint8_t min = 0; min < 60; min++) {
+				arr.push_back(SdH::HoursMinutes(hrs, min));
+			}
+		}
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1440), arr.size());
+		for (uint16_t i = 0; i < arr.size(); i++) {
+			CPPUNIT_ASSERT_EQUAL(i, arr.data()[i]);
+			CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(i / 60), arr.get(i).hours());
+			CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(i % 60), arr.get(i).minutes());
+		}
+
+		arr.set(3, SdH::HoursMinutes("17:45"));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(1065), arr.data()[3]);
+	}
+
+	void addition() {
+		SdH::HoursMinutesArray refs, durs, out;
+
+		// Every reference against a spread of durations, compared with
+		// the HoursMinutes operator
+		for (uint16_t ref = 0; ref < SdH::HoursMinutes::minutesPerDay; ref++) {
+			for (uint16_t dur = ref % 11; dur < SdH::HoursMinutes::minutesPerDay; dur += 11) {
+				SdH::HoursMinutes hm;
+				hm.minutesOfDay(ref);
+				refs.push_back(hm);
+				hm.minutesOfDay(dur);
+				durs.push_back(hm);
+			}
+		}
+
+		SdH::HoursMinutesArray::add(refs, durs, out);
+		CPPUNIT_ASSERT_EQUAL(refs.size(), out.size());
+		for (size_t i = 0; i < out.size(); i++) {
+			const SdH::HoursMinutes sum = refs.get(i) + durs.get(i);
+			CPPUNIT_ASSERT_EQUAL(sum.minutesOfDay(), out.data()[i]);
+		}
+
+		// Single duration in place
+		out = refs;
+		out += SdH::HoursMinutes("23:59");
+		for (size_t i = 0; i < out.size(); i++) {
+			const SdH::HoursMinutes sum = refs.get(i) + SdH::HoursMinutes("23:59");
+			CPPUNIT_ASSERT_EQUAL(sum.minutesOfDay(), out.data()[i]);
+		}
+
+		durs.resize(1);
+		CPPUNIT_ASSERT_THROW(SdH::HoursMinutesArray::add(refs, durs, out), std::invalid_argument);
+	}
+
+	void formatting() {
+		SdH::HoursMinutesArray arr;
+		std::string expected;
+		char buf[1440 * 6];
+
+		for (uint16_t i = 0; i < SdH::HoursMinutes::minutesPerDay; i++) {
+			SdH::HoursMinutes hm;
+			char one[SdH::HoursMinutes::charsLength];
+
+			hm.minutesOfDay(i);
+			arr.push_back(hm);
+			expected.append(one, hm.toChars(one) - one);
+			expected += ' ';
+		}
+
+		CPPUNIT_ASSERT(arr.format(buf, ' ') == buf + sizeof(buf));
+		CPPUNIT_ASSERT_EQUAL(expected, std::string(buf, sizeof(buf)));
+	}
+
+	void scan() {
+		std::mt19937 rng(1440);
+		std::vector<uint16_t> durs;
+
+		// Mostly long durations, so every run of 8 passes midnight
+		for (size_t i = 0; i < 1000; i++) {
+			durs.push_back(i % 5 == 0 ? rng() % 60 : SdH::HoursMinutes::minutesPerDay - 1 - rng() % 60);
+		}
+
+		// Every count exercises a different tail after the runs of 8
+		for (const size_t count : {0UL, 1UL, 7UL, 8UL, 9UL, 17UL, 1000UL}) {
+			for (const uint16_t start : {0, 1, 1439}) {
+				std::vector<uint16_t> mins(count);
+				std::vector<uint32_t> days(count);
+				SdH::HoursMinutes hm;
+				uint32_t day = 0;
+
+				hm.minutesOfDay(start);
+
+				const uint32_t total = SdH::HoursMinutesArray::scan(durs.data(), count, start, mins.data(), days.data());
+
+				for (size_t i = 0; i < count; i++) {
+					SdH::HoursMinutes dur;
+
+					dur.minutesOfDay(durs[i]);
+					if (hm.minutesOfDay() + durs[i] >= SdH::HoursMinutes::minutesPerDay) day++;
+					hm += dur;
+					CPPUNIT_ASSERT_EQUAL(hm.minutesOfDay(), mins[i]);
+					CPPUNIT_ASSERT_EQUAL(day, days[i]);
+				}
+				CPPUNIT_ASSERT_EQUAL(day, total);
+			}
+		}
+	}
+
+	void queries() {
+		std::mt19937 rng(1234);
+		SdH::HoursMinutesArray arr;
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), arr.next(SdH::HoursMinutes("12:00")));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), arr.count(SdH::HoursMinutes("12:00"), SdH::HoursMinutes("13:00")));
+
+		// Every size up to a few runs of 8, compared with a plain loop
+		for (size_t size = 1; size < 40; size++) {
+			arr.resize(size);
+			for (size_t i = 0; i < size; i++) arr.data()[i] = rng() % SdH::HoursMinutes::minutesPerDay;
+
+			for (size_t round = 0; round < 50; round++) {
+				const uint16_t from = rng() % SdH::HoursMinutes::minutesPerDay;
+				const uint16_t to = round % 10 ? rng() % SdH::HoursMinutes::minutesPerDay : from;
+				const uint16_t span = (to + SdH::HoursMinutes::minutesPerDay - from) % SdH::HoursMinutes::minutesPerDay;
+				size_t best = size, found = 0;
+				uint16_t least = SdH::HoursMinutes::minutesPerDay;
+
+				for (size_t i = 0; i < size; i++) {
+					const uint16_t dist = (arr.data()[i] + SdH::HoursMinutes::minutesPerDay - from) % SdH::HoursMinutes::minutesPerDay;
+
+					if (dist < least) {
+						least = dist;
+						best = i;
+					}
+					found += dist <= span;
+				}
+
+				CPPUNIT_ASSERT_EQUAL(best, SdH::HoursMinutesArray::next(arr.data(), size, from));
+				CPPUNIT_ASSERT_EQUAL(found, SdH::HoursMinutesArray::count(arr.data(), size, from, to));
+			}
+		}
+
+		// Windows past midnight and more matches than a 16 bit lane holds
+		arr.resize(0);
+		for (size_t i = 0; i < 600000; i++) arr.push_back(SdH::HoursMinutes(i % 2 ? 23 : 0, 30));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(600000), arr.count(SdH::HoursMinutes("23:00"), SdH::HoursMinutes("1:00")));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(300000), arr.count(SdH::HoursMinutes("0:30"), SdH::HoursMinutes("23:00")));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), arr.next(SdH::HoursMinutes("1:00")));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), arr.next(SdH::HoursMinutes("23:31")));
+	}
+
+	void sorting() {
+		std::mt19937 rng(4711);
+
+		// No days, few days in one pass and many days in two passes
+		for (const uint32_t spread : {0U, 3U, 100000U}) {
+			const size_t count = 5000;
+			std::vector<uint16_t> mins(count);
+			std::vector<uint32_t> days(count);
+			std::vector<size_t> order(count), expected(count);
+
+			for (size_t i = 0; i < count; i++) {
+				mins[i] = rng() % 50 * 29;
+				days[i] = spread == 0 ? 0 : rng() % spread;
+			}
+
+			std::iota(expected.begin(), expected.end(), 0);
+			std::stable_sort(expected.begin(), expected.end(), [&](const size_t a_i, const size_t b_i) {
+				return days[a_i] != days[b_i] ? days[a_i] < days[b_i] : mins[a_i] < mins[b_i];
+			});
+			SdH::HoursMinutesArray::sort(mins.data(), spread == 0 ? nullptr : days.data(), count, order.data());
+			CPPUNIT_ASSERT(expected == order);
+		}
+
+		// Without days, later days mix with earlier ones
+		const uint16_t mins[] = {600, 60, 600, 60};
+		const uint32_t days[] = {0, 1, 1, 0};
+		size_t order[4];
+
+		SdH::HoursMinutesArray::sort(mins, nullptr, 4, order);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), order[0]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), order[1]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), order[2]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), order[3]);
+		SdH::HoursMinutesArray::sort(mins, days, 4, order);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), order[0]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), order[1]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), order[2]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), order[3]);
+	}
+
+};
+
+#undef CHECKNAME
@@ -0,0 +1,234 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <libtimecal.h>
+
+#define CHECKNAME libtimecalCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(values);
+	CPPUNIT_TEST(arrays);
+	CPPUNIT_TEST(calculator);
+	CPPUNIT_TEST(timezones);
+	CPPUNIT_TEST(recurrences);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Parse a NUL terminated string. */
+	static int parse(const char * str_i, uint16_t & minutes_o)
+	{
+		return timecal_parse(str_i, strlen(str_i), &minutes_o);
+	}
+
+	/** Evaluate a NUL terminated line. */
+	static int eval(timecal_calc * calc_io, const char * line_i, uint16_t & result_o)
+	{
+		return timecal_calc_eval(calc_io, line_i, strlen(line_i), &result_o);
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void values() {
+		uint16_t mins = 0;
+		char buf[8];
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_OK), parse("9:34", mins));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(574), mins);
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_OK), parse(":", mins));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0), mins);
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_EINVAL), parse("1a", mins));
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_EINVAL), parse("123", mins));
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_ERANGE), parse("24:00", mins));
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_ERANGE), parse("60", mins));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0), mins);
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(126), timecal_add(1392, 174));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0), timecal_add(1439, 1));
+		CPPUNIT_ASSERT(timecal_now() < TIMECAL_MINUTES_PER_DAY);
+
+		CPPUNIT_ASSERT(timecal_format(126, buf) == buf + TIMECAL_CHARS);
+		CPPUNIT_ASSERT_EQUAL(std::string("02:06"), std::string(buf, TIMECAL_CHARS));
+
+		// Messages are those of the command-line interface
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), timecal_message("09:34 1:48", 10, buf, sizeof(buf)));
+		CPPUNIT_ASSERT_EQUAL(std::string(), std::string(buf));
+
+		const std::string msg("Invalid character 'x' in time string");
+
+		CPPUNIT_ASSERT_EQUAL(msg.size(), timecal_message("1x", 2, buf, sizeof(buf)));
+		CPPUNIT_ASSERT_EQUAL(msg.substr(0, sizeof(buf) - 1), std::string(buf));
+		CPPUNIT_ASSERT_EQUAL(msg.size(), timecal_message("1x", 2, nullptr, 0));
+	}
+
+	void arrays() {
+		const uint16_t refs[] = {0, 574, 1392, 1439, 720};
+		const uint16_t durs[] = {0, 108, 174, 1439, 720};
+		uint16_t out[5];
+		char buf[5 * (TIMECAL_CHARS + 1)];
+
+		timecal_add_n(refs, durs, out, 5);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0), out[0]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(682), out[1]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(126), out[2]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(1438), out[3]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(0), out[4]);
+
+		CPPUNIT_ASSERT(timecal_format_n(out, 5, buf, ',') == buf + sizeof(buf));
+		CPPUNIT_ASSERT_EQUAL(std::string("00:00,11:22,02:06,23:58,00:00,"), std::string(buf, sizeof(buf)));
+
+		timecal_add_duration_n(refs, 60, out, 5);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(60), out[0]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(12), out[2]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(59), out[3]);
+
+		// 01:00, 10:34, 00:12, 00:59 and 13:00
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), timecal_next_n(out, 5, 120));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), timecal_next_n(out, 5, 1000));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), timecal_next_n(out, 0, 1000));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), timecal_count_n(out, 5, 1380, 60));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), timecal_count_n(out, 5, 60, 60));
+	}
+
+	void calculator() {
+		timecal_calc *a = timecal_calc_new();
+		timecal_calc *b = timecal_calc_new();
+		const std::string text("09:34 1:48\n+30\n\n25:00 1\n+x\n+1:");
+		uint16_t results[8];
+		uint8_t status[8];
+		uint16_t result = 0;
+		size_t consumed = 0;
+
+		CPPUNIT_ASSERT(a != nullptr && b != nullptr);
+
+		// Each calculator has its own previous answer
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_OK), eval(a, "+1:", result));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(60), result);
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_OK), eval(b, "23:12 2:54", result));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(126), result);
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_ERANGE), eval(a, "12:00 1:87", result));
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_EINVAL), eval(a, "+abc", result));
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_EEMPTY), eval(a, "", result));
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_OK), eval(a, "+30", result));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(90), result);
+		CPPUNIT_ASSERT_EQUAL(static_cast<int>(TIMECAL_OK), eval(b, "+30", result));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(156), result);
+
+		// Lines in batches, limited by the capacity of the arrays
+		CPPUNIT_ASSERT_EQUAL(
+			static_cast<size_t>(4),
+			timecal_calc_eval_lines(a, text.data(), text.size(), results, status, 4, &consumed)
+		);
+		CPPUNIT_ASSERT_EQUAL(text.find("+x"), consumed);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(TIMECAL_OK), status[0]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(682), results[0]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(TIMECAL_OK), status[1]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(712), results[1]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(TIMECAL_EEMPTY), status[2]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(TIMECAL_ERANGE), status[3]);
+
+		CPPUNIT_ASSERT_EQUAL(
+			static_cast<size_t>(2),
+			timecal_calc_eval_lines(a, text.data() + consumed, text.size() - consumed, results, status, 8, nullptr)
+		);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(TIMECAL_EINVAL), status[0]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(TIMECAL_OK), status[1]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(772), results[1]);
+
+		timecal_calc_free(a);
+		timecal_calc_free(b);
+		timecal_calc_free(nullptr);
+	}
+
+	void timezones() {
+		timecal_tz *tz = timecal_tz_named("CET-1CEST,M3.5.0,M10.5.0/3");
+		timecal_tz *local = timecal_tz_local();
+		// 2020-03-29 00:59:59 UTC is just before the switch to summer time
+		const int64_t epochs[] = {1585443599, 1585443600, 0};
+		uint16_t mins[3];
+
+		CPPUNIT_ASSERT(tz != nullptr);
+		CPPUNIT_ASSERT(local != nullptr);
+		CPPUNIT_ASSERT(timecal_tz_named("No/Such/Zone,") == nullptr);
+
+		timecal_tz_convert(tz, epochs, 3, mins);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(119), mins[0]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(180), mins[1]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(60), mins[2]);
+
+		timecal_tz_free(tz);
+		timecal_tz_free(local);
+		timecal_tz_free(nullptr);
+	}
+
+
+	void recurrences() {
+		// Every 10:00 from 06:10 and every 8:00 from 22:00, for two days
+		const uint16_t starts[] = {370, 1320};
+		const uint16_t intervals[] = {600, 480};
+		const uint16_t bad[] = {0, 1440};
+		timecal_recur *recur = timecal_recur_new(starts, intervals, 2, 2);
+		uint32_t days[8];
+		uint16_t mins[8];
+		size_t sources[8];
+
+		CPPUNIT_ASSERT(recur != nullptr);
+		CPPUNIT_ASSERT(timecal_recur_new(starts, bad, 1, 2) == nullptr);
+		CPPUNIT_ASSERT(timecal_recur_new(bad + 1, intervals, 1, 2) == nullptr);
+
+		// 06:10, 16:10, 22:00, +1 02:10, +1 06:00, +1 12:10, +1 14:00, +1 22:00 and +1 22:10
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), timecal_recur_next_n(recur, days, mins, sources, 4));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(1320), mins[2]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), sources[2]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(1), days[3]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(130), mins[3]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(5), timecal_recur_next_n(recur, days, mins, nullptr, 8));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(1330), mins[4]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), timecal_recur_next_n(recur, days, mins, sources, 8));
+
+		timecal_recur_free(recur);
+		timecal_recur_free(nullptr);
+	}
+};
+
+#undef CHECKNAME
@@ -0,0 +1,155 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <LocalClock.h>
+
+#define CHECKNAME localclockCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(transitions);
+	CPPUNIT_TEST(now);
+	CPPUNIT_TEST(threads);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Previous value of TZ, restored after each check. */
+	std::string oldtz_a;
+
+	/** Whether TZ was set before the check. */
+	bool hadtz_a;
+
+	/** Compare the clock with localtime_r() at a certain moment. */
+	static void compare(SdH::LocalClock & clock_i, const time_t & time_i)
+	{
+		struct tm tmbuf;
+		SdH::HoursMinutes hm;
+
+		CPPUNIT_ASSERT(localtime_r(&time_i, &tmbuf) != nullptr);
+		hm = clock_i.at(time_i);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(tmbuf.tm_hour), hm.hours());
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(tmbuf.tm_min), hm.minutes());
+		CPPUNIT_ASSERT_EQUAL(static_cast<int32_t>(tmbuf.tm_gmtoff), clock_i.utcOffset(time_i));
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void setUp() override {
+		const char *tz = getenv("TZ");
+
+		hadtz_a = tz != nullptr;
+		if (hadtz_a) oldtz_a = tz;
+
+		// A zone with daylight saving time, falls back to UTC without
+		// time zone data
+		setenv("TZ", "Europe/Amsterdam", 1);
+		tzset();
+	}
+
+	void tearDown() override {
+		if (hadtz_a) setenv("TZ", oldtz_a.c_str(), 1); else unsetenv("TZ");
+		tzset();
+	}
+
+	void transitions() {
+		SdH::LocalClock clock;
+
+		// Walk forward through two years in steps of 7 minutes, crossing
+		// four daylight saving transitions
+		for (time_t t = 1577836800; t < 1640995200; t += 7 * 60) compare(clock, t);
+
+		// Right around the transition of 2021-03-28 01:00 UTC
+		for (time_t t = 1616893200 - 120; t < 1616893200 + 120; t++) compare(clock, t);
+
+		// Going back in time
+		compare(clock, 946684800);
+		compare(clock, 1616893200 - 1);
+	}
+
+	void now() {
+		// A fresh clock, as the process wide one may have cached the
+		// offset of the zone used before setUp()
+		SdH::LocalClock clock;
+		const time_t before = time(nullptr);
+		const SdH::HoursMinutes hm = clock.now();
+		const time_t after = time(nullptr);
+		const SdH::HoursMinutes hmbefore(before), hmafter(after);
+
+		// The coarse clock may lag a tick behind time(2)
+		CPPUNIT_ASSERT(
+			hm.minutesOfDay() == hmbefore.minutesOfDay() ||
+			hm.minutesOfDay() == hmafter.minutesOfDay() ||
+			(hm + SdH::HoursMinutes(0, 1)).minutesOfDay() == hmbefore.minutesOfDay()
+		);
+	}
+
+	void threads() {
+		SdH::LocalClock clock;
+		std::vector<std::thread> workers;
+		std::atomic<unsigned> failures(0);
+
+		// Threads ask for moments spread over a day around a transition,
+		// so readers race with refreshes
+		for (unsigned i = 0; i < 8; i++) {
+			workers.emplace_back([&clock, &failures, i]() {
+				for (time_t t = 1616850000 + i * 60; t < 1616850000 + 86400; t += 8 * 60) {
+					struct tm tmbuf;
+					const SdH::HoursMinutes hm = clock.at(t);
+
+					localtime_r(&t, &tmbuf);
+					if (hm.hours() != tmbuf.tm_hour || hm.minutes() != tmbuf.tm_min) failures++;
+				}
+			});
+		}
+
+		for (std::thread & worker : workers) worker.join();
+		CPPUNIT_ASSERT_EQUAL(0u, failures.load());
+	}
+
+};
+
+#undef CHECKNAME
@@ -0,0 +1,207 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <Optimizer.h>
+#include <Planner.h>
+#include "durations.h"
+
+#define CHECKNAME optimizerCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(finish);
+	CPPUNIT_TEST(checkins);
+	CPPUNIT_TEST(random);
+	CPPUNIT_TEST(budget);
+	CPPUNIT_TEST_SUITE_END();
+
+	typedef std::pair<uint64_t, size_t> Outcome;
+
+	/** Plan and return the finish and number of check-ins. */
+	static Outcome outcome(SdH::Planner & planner_io)
+	{
+		planner_io.plan();
+		return {planner_io.finish().minutes(), planner_io.checkins()};
+	}
+
+	/** Find the best outcome over all orders of the slots from @p slot_i
+	 * on, by trying them all. */
+	static Outcome brute(SdH::Planner & planner_io, const SdH::Optimizer::Goal goal_i, const size_t slot_i = 0)
+	{
+		if (slot_i == planner_io.slots()) {
+			const Outcome retval = outcome(planner_io);
+
+			return goal_i == SdH::Optimizer::Goal::finish ? retval : Outcome(retval.second, retval.first);
+		}
+
+		std::vector<size_t> queue(planner_io.queue(slot_i));
+		Outcome retval(UINT64_MAX, SIZE_MAX);
+
+		std::sort(queue.begin(), queue.end());
+		do {
+			planner_io.queue(slot_i, queue);
+			retval = std::min(retval, brute(planner_io, goal_i, slot_i + 1));
+		} while (std::next_permutation(queue.begin(), queue.end()));
+		return retval;
+	}
+
+	/** Optimize for a goal and check the result against the planner. */
+	static Outcome optimize(SdH::Planner & planner_io, const SdH::Optimizer::Goal goal_i, const unsigned threads_i)
+	{
+		SdH::Optimizer optimizer(planner_io, goal_i);
+
+		CPPUNIT_ASSERT(optimizer.solve(std::chrono::seconds(60), threads_i));
+		optimizer.apply(planner_io);
+
+		const Outcome retval = outcome(planner_io);
+
+		CPPUNIT_ASSERT_EQUAL(retval.first, optimizer.finish().minutes());
+		CPPUNIT_ASSERT_EQUAL(retval.second, optimizer.checkins());
+		return goal_i == SdH::Optimizer::Goal::finish ? retval : Outcome(retval.second, retval.first);
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void finish() {
+		SdH::Planner planner(SdH::HoursMinutes(22, 0));
+
+		// Longest first leaves one lane idle at the end
+		planner.addSlot("mill", 2);
+		for (const uint16_t dur : {180, 180, 120, 120, 120}) planner.addJob("mill", minutes(dur), std::to_string(dur));
+		planner.addSlot("empty", 3);
+		CPPUNIT_ASSERT_EQUAL(uint64_t(22 * 60 + 420), outcome(planner).first);
+
+		const Outcome best = optimize(planner, SdH::Optimizer::Goal::finish, 1);
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(22 * 60 + 360), best.first);
+		CPPUNIT_ASSERT_EQUAL(uint32_t(1), planner.finish().day);
+		CPPUNIT_ASSERT_EQUAL(uint16_t(4 * 60), planner.finish().time.minutesOfDay());
+
+		// Nothing to do
+		SdH::Planner empty(SdH::HoursMinutes(8, 0));
+		SdH::Optimizer optimizer(empty, SdH::Optimizer::Goal::checkins);
+
+		CPPUNIT_ASSERT(optimizer.solve(std::chrono::seconds(1)));
+		CPPUNIT_ASSERT_EQUAL(size_t(0), optimizer.checkins());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(8 * 60), optimizer.finish().minutes());
+		optimizer.apply(empty);
+	}
+
+	void checkins() {
+		SdH::Planner planner(SdH::HoursMinutes(7, 0));
+
+		// Starting the short jobs together saves a check-in
+		planner.addSlot("farm", 2);
+		planner.addJob("farm", minutes(60));
+		planner.addJob("farm", minutes(20));
+		planner.addJob("farm", minutes(20));
+		planner.addJob("farm", minutes(40));
+		planner.addSlot("pasture");
+		planner.addJob("pasture", minutes(40));
+		planner.addJob("pasture", minutes(20));
+		CPPUNIT_ASSERT_EQUAL(size_t(4), outcome(planner).second);
+
+		const Outcome best = optimize(planner, SdH::Optimizer::Goal::checkins, 2);
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(3), best.first);
+		CPPUNIT_ASSERT_EQUAL(uint64_t(8 * 60 + 20), best.second);
+	}
+
+	void random() {
+		// Compare with trying every order
+		std::mt19937 rng(42);
+
+		for (size_t round = 0; round < 60; round++) {
+			SdH::Planner planner(SdH::HoursMinutes(rng() % 24, rng() % 60));
+			const size_t slots = 1 + rng() % 2;
+			const SdH::Optimizer::Goal goal = round % 2 ? SdH::Optimizer::Goal::finish : SdH::Optimizer::Goal::checkins;
+
+			for (size_t s = 0; s < slots; s++) {
+				const size_t jobs = rng() % (8 / slots);
+
+				planner.addSlot("s" + std::to_string(s), 1 + rng() % 3);
+				for (size_t j = 0; j < jobs; j++) {
+					planner.addJob("s" + std::to_string(s), minutes(rng() % 4 ? 10 * (rng() % 12) : rng() % 1440));
+				}
+			}
+
+			const Outcome expected = brute(planner, goal);
+
+			CPPUNIT_ASSERT(expected == optimize(planner, goal, 1 + round % 4));
+		}
+	}
+
+	void budget() {
+		std::mt19937 rng(7);
+		SdH::Planner planner(SdH::HoursMinutes(6, 0));
+		std::vector<Outcome> found;
+
+		planner.addSlot("a", 3);
+		planner.addSlot("b", 2);
+		for (size_t j = 0; j < 200; j++) planner.addJob(j % 3 ? "a" : "b", minutes(1 + rng() % 600));
+
+		const Outcome before = outcome(planner);
+		SdH::Optimizer optimizer(planner, SdH::Optimizer::Goal::checkins);
+
+		// Too large to finish, but improvements come in order
+		CPPUNIT_ASSERT(!optimizer.solve(std::chrono::milliseconds(200), 2, [&found](const SdH::Moment & finish_i, const size_t checkins_i) {
+			found.emplace_back(checkins_i, finish_i.minutes());
+		}));
+		CPPUNIT_ASSERT(!found.empty());
+		CPPUNIT_ASSERT(std::is_sorted(found.rbegin(), found.rend()));
+		CPPUNIT_ASSERT(found.back() < Outcome(before.second, before.first));
+
+		optimizer.apply(planner);
+
+		const Outcome after = outcome(planner);
+
+		CPPUNIT_ASSERT(found.back() == Outcome(after.second, after.first));
+	}
+
+};
+
+#undef CHECKNAME
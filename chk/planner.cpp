@@ -0,0 +1,205 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <Planner.h>
+
+#define CHECKNAME plannerCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(timetable);
+	CPPUNIT_TEST(days);
+	CPPUNIT_TEST(errors);
+	CPPUNIT_TEST(random);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Plan a description and return the printed timetable. */
+	static std::string plan(const std::string & desc_i)
+	{
+		std::istringstream in(desc_i);
+		std::ostringstream out;
+		SdH::Planner planner;
+
+		planner.read(in);
+		planner.plan();
+		planner.print(out);
+		return out.str();
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void timetable() {
+		CPPUNIT_ASSERT_EQUAL(
+			std::string(
+				"+0 09:34 +0 11:22 bakery/1 bread\n"
+				"+0 09:34 +0 09:39 bakery/2 cookies\n"
+				"+0 09:34 +0 10:04 dairy/1\n"
+				"+0 09:39 +0 10:09 bakery/2 cake with cream\n"
+				"+0 10:04 +0 10:04 dairy/1 nothing\n"
+				"+0 10:04 +0 11:04 dairy/1 cheese\n"
+			),
+			plan(
+				"# Comments and empty lines are ignored\n"
+				"\n"
+				"start 9:34\n"
+				"slot bakery 2\n"
+				"slot dairy\n"
+				"slot idle 3\n"
+				"job bakery 1:48 bread\n"
+				"job bakery 5 cookies\n"
+				"job dairy 30\n"
+				"job bakery 30   cake with cream  \n"
+				"job dairy 0 nothing\n"
+				"job dairy 1: cheese\n"
+			)
+		);
+		CPPUNIT_ASSERT(plan("slot empty\n").empty());
+	}
+
+	void days() {
+		SdH::Planner planner(SdH::HoursMinutes(22, 0));
+
+		planner.addSlot("farm");
+		for (size_t i = 0; i < 10; i++) planner.addJob("farm", SdH::HoursMinutes(23, 59));
+
+		const std::vector<SdH::Planner::Entry> & tt = planner.plan();
+
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(10), tt.size());
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(0), tt[0].start.day);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(1), tt[0].end.day);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(21 * 60 + 59), tt[0].end.time.minutesOfDay());
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(9), tt[9].start.day);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(10), tt[9].end.day);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(21 * 60 + 50), tt[9].end.time.minutesOfDay());
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(10), planner.finish().day);
+
+		// Planning again gives the same timetable
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(10), planner.plan().size());
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(10), planner.finish().day);
+	}
+
+	void errors() {
+		static const char * const invalid[] = {
+			"slot a\nslot a\n",
+			"slot a 0\n",
+			"slot a 70000\n",
+			"slot a 1x\n",
+			"slot\n",
+			"slot a 1 2\n",
+			"job a 10\n",
+			"slot a\njob a 24:00\n",
+			"slot a\njob a\n",
+			"start 1:2:3\n",
+			"start\n",
+			"begin 10:00\n",
+		};
+
+		for (const char * desc : invalid) {
+			CPPUNIT_ASSERT_THROW(plan(desc), std::invalid_argument);
+		}
+
+		try {
+			plan("slot a\n\njob b 10\n");
+			CPPUNIT_ASSERT(false);
+		} catch (const std::invalid_argument & e) {
+			CPPUNIT_ASSERT_EQUAL(std::string("Line 3: Unknown slot \"b\""), std::string(e.what()));
+		}
+	}
+
+	void random() {
+		// Compare with assigning each job to the lane that is free first
+		std::mt19937 rng(42);
+		SdH::Planner planner(SdH::HoursMinutes(13, 37));
+		std::vector<std::vector<uint64_t>> free;
+		std::vector<SdH::Planner::Entry> expected;
+
+		for (size_t s = 0; s < 300; s++) {
+			const uint16_t lanes = 1 + rng() % 5;
+
+			planner.addSlot("s" + std::to_string(s), lanes);
+			free.emplace_back(lanes, 13 * 60 + 37);
+		}
+		for (size_t j = 0; j < 20000; j++) {
+			const size_t slot = rng() % free.size();
+			// Lanes idle at the same time are equivalent, except for zero
+			// durations, so leave those out
+			const uint16_t dur = 1 + rng() % (SdH::HoursMinutes::minutesPerDay - 1);
+			std::vector<uint64_t> & lanes = free[slot];
+			const size_t lane = std::min_element(lanes.begin(), lanes.end()) - lanes.begin();
+			SdH::HoursMinutes hm;
+
+			hm.minutesOfDay(dur);
+			planner.addJob("s" + std::to_string(slot), hm);
+			expected.push_back({j, slot, static_cast<uint16_t>(lane), {}, {}});
+			expected.back().start.day = lanes[lane] / SdH::HoursMinutes::minutesPerDay;
+			lanes[lane] += dur;
+			expected.back().end.day = lanes[lane] / SdH::HoursMinutes::minutesPerDay;
+			expected.back().end.time.minutesOfDay(lanes[lane] % SdH::HoursMinutes::minutesPerDay);
+		}
+
+		std::vector<SdH::Planner::Entry> tt = planner.plan();
+
+		CPPUNIT_ASSERT_EQUAL(expected.size(), tt.size());
+		for (size_t i = 1; i < tt.size(); i++) {
+			CPPUNIT_ASSERT(tt[i - 1].start.minutes() <= tt[i].start.minutes());
+		}
+
+		std::sort(tt.begin(), tt.end(), [](const SdH::Planner::Entry & a, const SdH::Planner::Entry & b) {
+			return a.job < b.job;
+		});
+		for (size_t i = 0; i < tt.size(); i++) {
+			CPPUNIT_ASSERT_EQUAL(expected[i].slot, tt[i].slot);
+			CPPUNIT_ASSERT_EQUAL(expected[i].lane, tt[i].lane);
+			CPPUNIT_ASSERT_EQUAL(expected[i].start.day, tt[i].start.day);
+			CPPUNIT_ASSERT_EQUAL(expected[i].end.day, tt[i].end.day);
+			CPPUNIT_ASSERT_EQUAL(expected[i].end.time.minutesOfDay(), tt[i].end.time.minutesOfDay());
+		}
+	}
+
+};
+
+#undef CHECKNAME
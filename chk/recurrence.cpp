@@ -0,0 +1,204 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <Recurrence.h>
+
+using namespace SdH::literals;
+
+#define CHECKNAME recurrenceCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(occurrences);
+	CPPUNIT_TEST(merge);
+	CPPUNIT_TEST(read);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Check that reading recurrences fails with a message. */
+	static void reject(const std::string & text_i, const std::string & msg_i)
+	{
+		std::istringstream iss(text_i);
+		SdH::RecurrenceMerge merge;
+
+		try {
+			merge.read(iss, 1, SdH::HoursMinutes());
+			CPPUNIT_FAIL("Accepted invalid recurrences, expected: " + msg_i);
+		} catch (const std::invalid_argument & ia) {
+			CPPUNIT_ASSERT_EQUAL(msg_i, std::string(ia.what()));
+		}
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void occurrences() {
+		std::mt19937 rng(610);
+		const SdH::Recurrence every("06:10"_hm, "02:45"_hm, 2);
+		std::vector<std::string> seen;
+
+		for (const SdH::Moment & occ : every) {
+			std::ostringstream oss;
+
+			oss << '+' << occ.day << ' ' << occ.time;
+			seen.push_back(oss.str());
+		}
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(16), seen.size());
+		CPPUNIT_ASSERT_EQUAL(std::string("+0 06:10"), seen[0]);
+		CPPUNIT_ASSERT_EQUAL(std::string("+0 22:40"), seen[6]);
+		CPPUNIT_ASSERT_EQUAL(std::string("+1 01:25"), seen[7]);
+		CPPUNIT_ASSERT_EQUAL(std::string("+1 23:25"), seen[15]);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(16), every.size());
+
+		// Empty windows and intervals that would never end
+		CPPUNIT_ASSERT(SdH::Recurrence("06:10"_hm, "02:45"_hm, 0).begin() == SdH::Recurrence("06:10"_hm, "02:45"_hm, 0).end());
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(0), SdH::Recurrence("06:10"_hm, "02:45"_hm, 0).size());
+		CPPUNIT_ASSERT_THROW(SdH::Recurrence("06:10"_hm, "00:00"_hm, 1), std::invalid_argument);
+
+		// The same as counting minutes from the start of the first day
+		for (int round = 0; round < 200; round++) {
+			SdH::HoursMinutes start, interval;
+			const uint32_t days = rng() % 5;
+			uint64_t minute = 0, count = 0;
+
+			start.minutesOfDay(rng() % 1440);
+			interval.minutesOfDay(1 + rng() % 1439);
+			const SdH::Recurrence recurrence(start, interval, days);
+
+			minute = start.minutesOfDay();
+			for (const SdH::Moment & occ : recurrence) {
+				CPPUNIT_ASSERT_EQUAL(minute, occ.minutes());
+				CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(minute / 1440), occ.day);
+				minute += interval.minutesOfDay();
+				count++;
+			}
+			CPPUNIT_ASSERT(minute >= days * 1440ULL || days == 0);
+			CPPUNIT_ASSERT_EQUAL(count, recurrence.size());
+			CPPUNIT_ASSERT_EQUAL(count, static_cast<uint64_t>(std::distance(recurrence.begin(), recurrence.end())));
+		}
+	}
+
+	void merge() {
+		std::mt19937 rng(245);
+
+		for (int round = 0; round < 50; round++) {
+			SdH::RecurrenceMerge merge;
+			std::vector<std::pair<uint64_t, size_t>> expected;
+			const size_t count = rng() % 40;
+			const uint32_t days = 1 + rng() % 3;
+			SdH::Moment occ;
+			size_t source = 0, taken = 0;
+
+			// Few distinct intervals give many equal times
+			for (size_t i = 0; i < count; i++) {
+				SdH::HoursMinutes start, interval;
+
+				start.minutesOfDay(rng() % 1440);
+				interval.minutesOfDay(15 * (1 + rng() % 8));
+				CPPUNIT_ASSERT_EQUAL(i, merge.add(SdH::Recurrence(start, interval, days)));
+				for (uint64_t m = start.minutesOfDay(); m < days * 1440ULL; m += interval.minutesOfDay()) {
+					expected.push_back({m, i});
+				}
+			}
+			std::sort(expected.begin(), expected.end());
+
+			CPPUNIT_ASSERT_EQUAL(count, merge.size());
+			while (merge.next(occ, source)) {
+				CPPUNIT_ASSERT(taken < expected.size());
+				CPPUNIT_ASSERT_EQUAL(expected[taken].first, occ.minutes());
+				CPPUNIT_ASSERT_EQUAL(expected[taken].second, source);
+				taken++;
+			}
+			CPPUNIT_ASSERT_EQUAL(expected.size(), taken);
+			CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), merge.size());
+			CPPUNIT_ASSERT(!merge.next(occ, source));
+		}
+	}
+
+	void read() {
+		std::istringstream iss(
+			"# Bakery\n"
+			"06:10 2:45 # bread\n"
+			"\n"
+			"  23:00 12:00\t\n"
+			"8:00 # now\n"
+		);
+		SdH::RecurrenceMerge merge;
+		SdH::Moment occ;
+		size_t source = 0;
+
+		merge.read(iss, 1, "05:00"_hm);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), merge.size());
+		CPPUNIT_ASSERT_EQUAL(std::string("bread"), merge.label(0));
+		CPPUNIT_ASSERT_EQUAL(std::string(""), merge.label(1));
+		CPPUNIT_ASSERT_EQUAL(std::string("now"), merge.label(2));
+
+		// 05:00 from now, then 06:10 and 08:55 of the bread
+		CPPUNIT_ASSERT(merge.next(occ, source));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), source);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(300), occ.time.minutesOfDay());
+		CPPUNIT_ASSERT(merge.next(occ, source));
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), source);
+		CPPUNIT_ASSERT(merge.next(occ, source));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(535), occ.time.minutesOfDay());
+
+		reject("06:10 2:45\n+30\n", "Line 2: A recurrence can't continue another one");
+		reject("\n06:10 0\n", "Line 2: Recurrence needs an interval of at least a minute");
+
+		// Parse errors point at the line like in batch mode
+		try {
+			std::istringstream iss("06:10 2:65\n");
+
+			merge.read(iss, 1, SdH::HoursMinutes());
+			CPPUNIT_FAIL("Accepted minutes above 59");
+		} catch (const std::invalid_argument & ia) {
+			CPPUNIT_ASSERT_EQUAL(std::string("Line 1: "), std::string(ia.what()).substr(0, 8));
+		}
+	}
+};
+
+#undef CHECKNAME
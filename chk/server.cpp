@@ -0,0 +1,268 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <Server.h>
+
+#define CHECKNAME serverCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(sessions);
+	CPPUNIT_TEST(clients);
+	CPPUNIT_TEST(socketFile);
+	CPPUNIT_TEST(exhausted);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Path of the socket file used by the checks. */
+	std::string path_a;
+
+	/** Connect a client to the server socket. */
+	int connectClient() const
+	{
+		sockaddr_un addr;
+		int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+		CPPUNIT_ASSERT(fd >= 0);
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, path_a.c_str());
+		CPPUNIT_ASSERT_EQUAL(0, connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)));
+		return fd;
+	}
+
+	/** Send a complete string to a client socket. */
+	static void sendAll(const int fd_i, const std::string & data_i)
+	{
+		CPPUNIT_ASSERT_EQUAL(
+			static_cast<ssize_t>(data_i.size()),
+			send(fd_i, data_i.data(), data_i.size(), MSG_NOSIGNAL)
+		);
+	}
+
+	/** Receive until @p lines_i complete lines arrived or the server
+	 * closed the connection. */
+	static std::string receiveLines(const int fd_i, size_t lines_i)
+	{
+		std::string retval;
+		char buf[4096];
+		ssize_t count = 0;
+
+		while (lines_i > 0 && (count = recv(fd_i, buf, sizeof(buf), 0)) > 0) {
+			for (ssize_t i = 0; i < count; i++) {
+				if (buf[i] == '\n') lines_i--;
+			}
+			retval.append(buf, count);
+		}
+		return retval;
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void setUp()
+	{
+		path_a = "/tmp/timecal-chk-" + std::to_string(getpid()) + ".sock";
+	}
+
+	void sessions() {
+		SdH::Server server(path_a);
+		std::thread runner(&SdH::Server::run, &server);
+		int a = connectClient();
+		int b = connectClient();
+		std::string errline;
+
+		// Pipelined requests, a line split over two sends and interleaved
+		// clients that each keep their own previous answer
+		sendAll(a, "09:34 1:48\n+30\n\n10:");
+		sendAll(b, "23:12 2:54\n");
+		CPPUNIT_ASSERT_EQUAL(std::string("11:22\n11:52\n\n"), receiveLines(a, 3));
+		CPPUNIT_ASSERT_EQUAL(std::string("02:06\n"), receiveLines(b, 1));
+		sendAll(a, "00 0\n+5\n");
+		sendAll(b, "+1:\n28:00 1:00\n+1\n");
+		CPPUNIT_ASSERT_EQUAL(std::string("10:00\n10:05\n"), receiveLines(a, 2));
+
+		errline = receiveLines(b, 3);
+		CPPUNIT_ASSERT_EQUAL(std::string("03:06\n"), errline.substr(0, 6));
+		CPPUNIT_ASSERT(errline.find("larger than 23") != std::string::npos);
+		CPPUNIT_ASSERT_EQUAL(std::string("03:07\n"), errline.substr(errline.size() - 6));
+
+		// Quit ignores everything after it
+		sendAll(a, "+5\nquit\n+5\n");
+		CPPUNIT_ASSERT_EQUAL(std::string("10:10\n"), receiveLines(a, 5));
+
+		// A last line without newline is answered on shutdown
+		sendAll(b, "+2");
+		shutdown(b, SHUT_WR);
+		CPPUNIT_ASSERT_EQUAL(std::string("03:09\n"), receiveLines(b, 5));
+
+		// Overly long lines close the connection
+		close(a);
+		a = connectClient();
+		sendAll(a, std::string(SdH::Server::maxLineLength + 1, '1'));
+		CPPUNIT_ASSERT(receiveLines(a, 1).empty());
+
+		server.stop();
+		runner.join();
+		close(a);
+		close(b);
+	}
+
+	void clients() {
+		static constexpr size_t count = 50;
+		static constexpr size_t requests = 200;
+		SdH::Server server(path_a);
+		std::thread runner(&SdH::Server::run, &server);
+		std::vector<int> fds;
+		std::string request;
+		std::string expected;
+
+		// Many concurrent clients, each one pipelining all its requests
+		for (size_t i = 0; i < count; i++) fds.push_back(connectClient());
+		for (size_t i = 0; i < count; i++) {
+			sendAll(fds[i], std::to_string(i) + ":00 0\n");
+		}
+		for (size_t r = 0; r < requests; r++) request += "+1\n";
+		for (size_t i = 0; i < count; i++) sendAll(fds[i], request);
+
+		for (size_t i = 0; i < count; i++) {
+			const std::string reply = receiveLines(fds[i], requests + 1);
+			SdH::HoursMinutes hm(i % 24, 0);
+			char buf[SdH::HoursMinutes::charsLength];
+
+			hm += SdH::HoursMinutes(requests / 60, requests % 60);
+			expected.assign(buf, hm.toChars(buf) - buf);
+			expected += '\n';
+			CPPUNIT_ASSERT(reply.size() >= 6 * (requests + 1));
+			if (i < 24) {
+				CPPUNIT_ASSERT_EQUAL(6 * (requests + 1), reply.size());
+				CPPUNIT_ASSERT_EQUAL(expected, reply.substr(reply.size() - 6));
+			} else {
+				// Hours of 24 and up are errors, so start from 00:00
+				CPPUNIT_ASSERT_EQUAL(std::string("03:20\n"), reply.substr(reply.size() - 6));
+			}
+			close(fds[i]);
+		}
+
+		server.stop();
+		runner.join();
+	}
+
+	void socketFile() {
+		CPPUNIT_ASSERT_THROW(SdH::Server(std::string(200, 'x')), std::invalid_argument);
+
+		{
+			SdH::Server server(path_a);
+
+			// A running server is never replaced
+			CPPUNIT_ASSERT_THROW(SdH::Server other(path_a), std::system_error);
+			CPPUNIT_ASSERT_EQUAL(0, access(path_a.c_str(), F_OK));
+		}
+		CPPUNIT_ASSERT(access(path_a.c_str(), F_OK) < 0);
+
+		// A stale socket file is replaced
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un addr;
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, path_a.c_str());
+		CPPUNIT_ASSERT_EQUAL(0, bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)));
+		close(fd);
+		CPPUNIT_ASSERT_NO_THROW(SdH::Server stale(path_a));
+	}
+
+	void exhausted() {
+		SdH::Server server(path_a);
+		std::thread runner(&SdH::Server::run, &server);
+		rlimit old, limit;
+		const int lowest = dup(STDIN_FILENO);
+		timespec before, after;
+		int a = -1, b = -1;
+
+		CPPUNIT_ASSERT(lowest >= 0);
+		close(lowest);
+		CPPUNIT_ASSERT_EQUAL(0, getrlimit(RLIMIT_NOFILE, &old));
+		limit = old;
+
+		// Without a connection to wait for, the pending one is refused
+		limit.rlim_cur = lowest + 1;
+		CPPUNIT_ASSERT_EQUAL(0, setrlimit(RLIMIT_NOFILE, &limit));
+		a = connectClient();
+		CPPUNIT_ASSERT(receiveLines(a, 1).empty());
+		close(a);
+
+		// Otherwise it waits until a connection closes, without spinning
+		limit.rlim_cur = lowest + 3;
+		CPPUNIT_ASSERT_EQUAL(0, setrlimit(RLIMIT_NOFILE, &limit));
+		a = connectClient();
+		sendAll(a, "09:00 1:00\n");
+		CPPUNIT_ASSERT_EQUAL(std::string("10:00\n"), receiveLines(a, 1));
+		b = connectClient();
+		sendAll(b, "11:00 1:00\n");
+
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &before);
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &after);
+		CPPUNIT_ASSERT((after.tv_sec - before.tv_sec) * 1000000000L + after.tv_nsec - before.tv_nsec < 100000000L);
+
+		close(a);
+		CPPUNIT_ASSERT_EQUAL(std::string("12:00\n"), receiveLines(b, 1));
+		close(b);
+
+		CPPUNIT_ASSERT_EQUAL(0, setrlimit(RLIMIT_NOFILE, &old));
+		server.stop();
+		runner.join();
+	}
+
+};
+
+#undef CHECKNAME
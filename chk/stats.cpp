@@ -0,0 +1,185 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <Stats.h>
+
+#define CHECKNAME statsCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(buckets);
+	CPPUNIT_TEST(counting);
+	CPPUNIT_TEST(stages);
+	CPPUNIT_TEST_SUITE_END();
+
+	typedef SdH::Stats::Histogram Histogram;
+
+	/** Totals of a report: lines per outcome, then lines per stage. */
+	typedef std::array<unsigned long long, 7> Totals;
+
+	/** Write a report and read the totals back from it. */
+	static Totals totals()
+	{
+		std::ostringstream oss;
+		Totals retval = {};
+		std::string line;
+
+		SdH::Stats::instance().report(oss);
+
+		std::istringstream iss(oss.str());
+
+		std::getline(iss, line);
+		CPPUNIT_ASSERT_EQUAL(4, sscanf(line.c_str(), "Lines: %*u (%llu valid, %llu empty, %llu invalid, %llu out of range)",
+			&retval[0], &retval[1], &retval[2], &retval[3]));
+		std::getline(iss, line);
+		CPPUNIT_ASSERT_EQUAL(std::string("Throughput: "), line.substr(0, 12));
+		std::getline(iss, line);
+		CPPUNIT_ASSERT_EQUAL(std::string("Stage "), line.substr(0, 6));
+
+		static const char * const names[] = {"parse", "compute", "format"};
+
+		for (size_t i = 0; i < 3; i++) {
+			char name[16] = "";
+
+			std::getline(iss, line);
+			CPPUNIT_ASSERT_EQUAL(2, sscanf(line.c_str(), "%15s %llu", name, &retval[4 + i]));
+			CPPUNIT_ASSERT_EQUAL(std::string(names[i]), std::string(name));
+		}
+		CPPUNIT_ASSERT(!std::getline(iss, line));
+		return retval;
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void buckets() {
+		static_assert(Histogram::bucket(0) == 0 && Histogram::bucket(15) == 15);
+		static_assert(Histogram::bucket(31) == 31 && Histogram::bucket(32) == 32 && Histogram::bucket(33) == 32);
+		static_assert(Histogram::bucket(UINT64_MAX) == Histogram::bucketCount - 1);
+		static_assert(Histogram::lowest(32) == 32 && Histogram::lowest(33) == 34);
+
+		// Every value lies within its bucket, which is at most 1/16 wide
+		std::mt19937_64 rng(42);
+
+		for (size_t i = 0; i < 100000; i++) {
+			const uint64_t value = rng() >> (rng() % 64);
+			const size_t bucket = Histogram::bucket(value);
+
+			CPPUNIT_ASSERT(bucket < Histogram::bucketCount);
+			CPPUNIT_ASSERT(Histogram::lowest(bucket) <= value);
+			if (bucket + 1 < Histogram::bucketCount) {
+				CPPUNIT_ASSERT(value < Histogram::lowest(bucket + 1));
+				CPPUNIT_ASSERT((Histogram::lowest(bucket + 1) - Histogram::lowest(bucket)) * 16 <= std::max<uint64_t>(16, value));
+			}
+		}
+
+		Histogram histogram;
+		std::vector<uint64_t> sums;
+
+		histogram.record(5);
+		histogram.record(1000, 3);
+		histogram.addTo(sums);
+		histogram.addTo(sums);
+		CPPUNIT_ASSERT_EQUAL(Histogram::bucketCount, sums.size());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2), sums[5]);
+		CPPUNIT_ASSERT_EQUAL(uint64_t(6), sums[Histogram::bucket(1000)]);
+	}
+
+	void counting() {
+		SdH::Stats & stats = SdH::Stats::instance();
+
+		stats.enable();
+		CPPUNIT_ASSERT(stats.enabled());
+
+		const Totals before = totals();
+
+		stats.local().count(SdH::Stats::Outcome::valid, 10);
+		stats.local().count(true, std::errc());
+		stats.local().count(false, std::errc::invalid_argument);
+
+		// Counts of finished threads stay in the totals
+		for (size_t i = 0; i < 2; i++) {
+			std::thread([]() {
+				SdH::Stats::instance().local().count(false, std::errc::result_out_of_range);
+				SdH::Stats::instance().local().count(false, std::errc());
+			}).join();
+		}
+
+		const Totals after = totals();
+
+		CPPUNIT_ASSERT_EQUAL(12ULL, after[0] - before[0]);
+		CPPUNIT_ASSERT_EQUAL(1ULL, after[1] - before[1]);
+		CPPUNIT_ASSERT_EQUAL(1ULL, after[2] - before[2]);
+		CPPUNIT_ASSERT_EQUAL(2ULL, after[3] - before[3]);
+	}
+
+	void stages() {
+		SdH::Stats & stats = SdH::Stats::instance();
+
+		stats.enable();
+
+		const Totals before = totals();
+
+		// A round of lines counts as that many lines
+		stats.local().time(SdH::Stats::Stage::parse, 1000, 4);
+		stats.local().time(SdH::Stats::Stage::compute, 1000, 0);
+		std::thread([]() {
+			SdH::Stats::instance().local().time(SdH::Stats::Stage::format, 70);
+		}).join();
+
+		const Totals after = totals();
+
+		CPPUNIT_ASSERT_EQUAL(4ULL, after[4] - before[4]);
+		CPPUNIT_ASSERT_EQUAL(0ULL, after[5] - before[5]);
+		CPPUNIT_ASSERT_EQUAL(1ULL, after[6] - before[6]);
+	}
+
+};
+
+#undef CHECKNAME
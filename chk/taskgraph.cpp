@@ -0,0 +1,268 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <TaskGraph.h>
+#include "durations.h"
+
+#define CHECKNAME taskGraphCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(criticalPath);
+	CPPUNIT_TEST(cycles);
+	CPPUNIT_TEST(chain);
+	CPPUNIT_TEST(random);
+	CPPUNIT_TEST_SUITE_END();
+
+	typedef SdH::TaskGraph::Node Node;
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void criticalPath() {
+		SdH::TaskGraph graph(SdH::HoursMinutes(9, 0));
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(9 * 60), graph.finish().minutes());
+		CPPUNIT_ASSERT(graph.criticalPath().empty());
+
+		// 0 -> {1, 2} -> 3
+		const Node a = graph.addNode(SdH::HoursMinutes(1, 0));
+		const Node b = graph.addNode(minutes(30));
+		const Node c = graph.addNode(SdH::HoursMinutes(2, 0));
+		const Node d = graph.addNode(minutes(15));
+
+		graph.addEdge(a, b);
+		graph.addEdge(a, c);
+		graph.addEdge(b, d);
+		graph.addEdge(c, d);
+		graph.addEdge(c, d);
+		CPPUNIT_ASSERT_EQUAL(size_t(3), graph.update());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(12 * 60 + 15), graph.finish().minutes());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(12 * 60), graph.earliestStart(d).minutes());
+		CPPUNIT_ASSERT_EQUAL(c, graph.criticalPredecessor(d));
+		CPPUNIT_ASSERT_EQUAL(SdH::TaskGraph::none, graph.criticalPredecessor(a));
+		CPPUNIT_ASSERT((std::vector<Node>{a, c, d}) == graph.criticalPath());
+
+		// Nothing to do without edits
+		CPPUNIT_ASSERT_EQUAL(size_t(0), graph.update());
+
+		// A longer branch takes over the critical path
+		graph.duration(b, SdH::HoursMinutes(3, 0));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), graph.update());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(13 * 60 + 15), graph.finish().minutes());
+		CPPUNIT_ASSERT((std::vector<Node>{a, b, d}) == graph.criticalPath());
+
+		// Past midnight
+		SdH::Moment release = {1, SdH::HoursMinutes(23, 0)};
+
+		graph.release(c, release);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), graph.update());
+		CPPUNIT_ASSERT_EQUAL(uint32_t(2), graph.finish().day);
+		CPPUNIT_ASSERT_EQUAL(uint16_t(1 * 60 + 15), graph.finish().time.minutesOfDay());
+		CPPUNIT_ASSERT((std::vector<Node>{c, d}) == graph.criticalPath());
+		CPPUNIT_ASSERT_EQUAL(release.minutes(), graph.release(c).minutes());
+
+		// Removing edges
+		CPPUNIT_ASSERT(graph.removeEdge(c, d));
+		CPPUNIT_ASSERT(!graph.removeEdge(c, d));
+		graph.update();
+		CPPUNIT_ASSERT_EQUAL(uint64_t(13 * 60 + 15), graph.earliestFinish(d).minutes());
+		CPPUNIT_ASSERT((std::vector<Node>{c}) == graph.criticalPath());
+
+		CPPUNIT_ASSERT_THROW(graph.addEdge(a, 4), std::out_of_range);
+		CPPUNIT_ASSERT_THROW(graph.duration(4, minutes(1)), std::out_of_range);
+	}
+
+	void cycles() {
+		SdH::TaskGraph graph;
+		std::vector<Node> nodes;
+
+		for (size_t i = 0; i < 6; i++) nodes.push_back(graph.addNode(minutes(10)));
+
+		CPPUNIT_ASSERT_THROW(graph.addEdge(nodes[2], nodes[2]), std::invalid_argument);
+
+		// Edges against the order of creation force reordering
+		for (size_t i = 5; i > 0; i--) graph.addEdge(nodes[i], nodes[i - 1]);
+		for (size_t i = 0; i < 5; i++) {
+			CPPUNIT_ASSERT_THROW(graph.addEdge(nodes[i], nodes[5]), std::invalid_argument);
+		}
+		CPPUNIT_ASSERT_THROW(graph.addEdge(nodes[0], nodes[1]), std::invalid_argument);
+
+		// A failed edge leaves the graph as it was
+		graph.update();
+		CPPUNIT_ASSERT_EQUAL(uint64_t(60), graph.finish().minutes());
+		CPPUNIT_ASSERT((std::vector<Node>{5, 4, 3, 2, 1, 0}) == graph.criticalPath());
+
+		graph.removeEdge(nodes[3], nodes[2]);
+		graph.addEdge(nodes[0], nodes[3]);
+		graph.update();
+		CPPUNIT_ASSERT((std::vector<Node>{2, 1, 0, 3}) == graph.criticalPath());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(30), graph.earliestStart(nodes[3]).minutes());
+	}
+
+	void chain() {
+		SdH::TaskGraph graph;
+		const size_t length = 100000;
+
+		for (size_t i = 0; i < length; i++) {
+			graph.addNode(minutes(i % 60));
+			if (i) graph.addEdge(i - 1, i);
+		}
+		graph.update();
+
+		const uint64_t total = graph.finish().minutes();
+		const uint64_t saved = graph.duration(length - 1).minutesOfDay() + graph.duration(length - 10).minutesOfDay();
+
+		// Only what comes after an edit is recomputed
+		graph.duration(length - 1, minutes(0));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), graph.update());
+		graph.duration(length - 10, minutes(0));
+		CPPUNIT_ASSERT_EQUAL(size_t(10), graph.update());
+		CPPUNIT_ASSERT_EQUAL(total - saved, graph.finish().minutes());
+		CPPUNIT_ASSERT_EQUAL(length - 1, graph.criticalPath().size());
+
+		// And only as far as finish times change
+		graph.addNode(minutes(1));
+		graph.addEdge(0, length);
+		graph.addEdge(length, 3);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), graph.update());
+		CPPUNIT_ASSERT_EQUAL(total - saved, graph.finish().minutes());
+	}
+
+	void random() {
+		// Compare with computing everything from scratch after each edit
+		std::mt19937 rng(42);
+		SdH::TaskGraph graph(SdH::HoursMinutes(13, 37));
+		std::set<std::pair<Node, Node>> edges;
+		const size_t count = 300;
+
+		for (size_t i = 0; i < count; i++) graph.addNode(minutes(rng() % 600));
+
+		for (size_t round = 0; round < 2000; round++) {
+			const Node from = rng() % count;
+			const Node to = rng() % count;
+
+			switch (rng() % 4) {
+				case 0:
+					if (graph.removeEdge(from, to)) edges.erase({from, to});
+					break;
+				case 1:
+					graph.duration(from, minutes(rng() % 600));
+					break;
+				case 2:
+					if (rng() % 8 == 0) graph.release(from, SdH::Moment::fromMinutes(rng() % 5000));
+					break;
+				default:
+					if (from == to) break;
+					try {
+						graph.addEdge(from, to);
+						edges.insert({from, to});
+					} catch (std::invalid_argument &) {
+						// The reference must agree that it is a cycle
+						std::vector<bool> reached(count, false);
+						std::vector<Node> todo(1, to);
+
+						while (!todo.empty()) {
+							const Node node = todo.back();
+
+							todo.pop_back();
+							for (auto it = edges.lower_bound({node, 0}); it != edges.end() && it->first == node; ++it) {
+								if (!reached[it->second]) todo.push_back(it->second);
+								reached[it->second] = true;
+							}
+						}
+						CPPUNIT_ASSERT(reached[from]);
+					}
+			}
+			if (round % 3) continue;
+			graph.update();
+
+			// Kahn's algorithm over the reference edges
+			std::vector<size_t> indegree(count, 0);
+			std::vector<uint64_t> finish(count);
+			std::vector<Node> ready;
+			uint64_t latest = 0;
+
+			for (const auto & edge : edges) indegree[edge.second]++;
+			for (Node node = 0; node < count; node++) {
+				finish[node] = graph.release(node).minutes();
+				if (!indegree[node]) ready.push_back(node);
+			}
+			for (size_t done = 0; done < count; done++) {
+				CPPUNIT_ASSERT(!ready.empty());
+
+				const Node node = ready.back();
+
+				ready.pop_back();
+				CPPUNIT_ASSERT_EQUAL(finish[node], graph.earliestStart(node).minutes());
+				finish[node] += graph.duration(node).minutesOfDay();
+				CPPUNIT_ASSERT_EQUAL(finish[node], graph.earliestFinish(node).minutes());
+				latest = std::max(latest, finish[node]);
+				for (auto it = edges.lower_bound({node, 0}); it != edges.end() && it->first == node; ++it) {
+					finish[it->second] = std::max(finish[it->second], finish[node]);
+					if (!--indegree[it->second]) ready.push_back(it->second);
+				}
+			}
+			CPPUNIT_ASSERT_EQUAL(latest, graph.finish().minutes());
+
+			// The critical path is a chain of edges without slack
+			const std::vector<Node> path = graph.criticalPath();
+
+			CPPUNIT_ASSERT_EQUAL(latest, graph.earliestFinish(path.back()).minutes());
+			CPPUNIT_ASSERT_EQUAL(graph.release(path.front()).minutes(), graph.earliestStart(path.front()).minutes());
+			for (size_t i = 1; i < path.size(); i++) {
+				CPPUNIT_ASSERT(edges.count({path[i - 1], path[i]}));
+				CPPUNIT_ASSERT_EQUAL(
+					graph.earliestFinish(path[i - 1]).minutes(),
+					graph.earliestStart(path[i]).minutes()
+				);
+			}
+		}
+	}
+
+};
+
+#undef CHECKNAME
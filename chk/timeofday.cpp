@@ -0,0 +1,159 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <TimeOfDay.h>
+
+#define CHECKNAME timeOfDayCheck
+
+typedef SdH::TimeOfDay<SdH::Resolution::minutes> Minutes;
+typedef SdH::HoursMinutesSeconds Seconds;
+typedef SdH::HoursMinutesMillis Millis;
+
+static_assert(std::is_same<SdH::Time<SdH::Resolution::minutes>, SdH::HoursMinutes>::value, "Minutes keep HoursMinutes");
+static_assert(sizeof(Minutes) == 2 && sizeof(Seconds) == 4 && sizeof(Millis) == 4, "Smallest type that holds two days");
+static_assert(Millis("12:34:56.789").ticks() == ((12 * 60 + 34) * 60 + 56) * 1000 + 789, "Parsed at compile time");
+static_assert((Seconds("23:59:59") + Seconds("0:0:2")).ticks() == 1, "Sum wraps at midnight");
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(parsing);
+	CPPUNIT_TEST(formatting);
+	CPPUNIT_TEST(addition);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Format a time into a string. */
+	template <typename T>
+	static std::string str(const T & tod_i)
+	{
+		char buf[T::charsLength];
+
+		return std::string(buf, tod_i.toChars(buf) - buf);
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void parsing() {
+		// A lone field holds minutes and two fields hours and minutes
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(45 * 60), static_cast<uint32_t>(Seconds("45").ticks()));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(90 * 60), static_cast<uint32_t>(Seconds("1:30").ticks()));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(5400007), static_cast<uint32_t>(Millis("1:30:0.007").ticks()));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(500), static_cast<uint32_t>(Millis("::.5").ticks()));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(50), static_cast<uint32_t>(Millis("0:0:0.05").ticks()));
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(90), Minutes("1:30").ticks());
+
+		// Fields beyond the resolution are rejected
+		CPPUNIT_ASSERT_THROW(Minutes("1:30:00"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(Seconds("1:30:00.5"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(Millis("1:30.5"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(Millis("1:30:00.1234"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(Millis("1:30:00:00"), std::invalid_argument);
+
+		// Values out of range and malformed fields
+		CPPUNIT_ASSERT_THROW(Seconds("24:00:00"), std::overflow_error);
+		CPPUNIT_ASSERT_THROW(Seconds("12:60:00"), std::overflow_error);
+		CPPUNIT_ASSERT_THROW(Seconds("12:00:60"), std::overflow_error);
+		CPPUNIT_ASSERT_THROW(Seconds("60"), std::overflow_error);
+		CPPUNIT_ASSERT_THROW(Seconds("1x"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(Seconds("123"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(Millis("1:00:00.x"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(Seconds::fromTicks(Seconds::ticksPerDay), std::overflow_error);
+
+		// The non-throwing parser leaves the time untouched on failure
+		const std::string bad("12:34:5x");
+		Seconds tod = Seconds::fromTicks(42);
+
+		CPPUNIT_ASSERT(Seconds::fromChars(bad.data(), bad.data() + bad.size(), tod).ec == std::errc::invalid_argument);
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(42), static_cast<uint32_t>(tod.ticks()));
+	}
+
+	void formatting() {
+		const Millis ms("9:05:03.042");
+
+		CPPUNIT_ASSERT_EQUAL(std::string("09:05"), str(Minutes("9:05")));
+		CPPUNIT_ASSERT_EQUAL(std::string("09:05:03"), str(Seconds("9:05:03")));
+		CPPUNIT_ASSERT_EQUAL(std::string("09:05:03.042"), str(ms));
+		CPPUNIT_ASSERT_EQUAL(std::string("23:59:59.999"), str(Millis::fromTicks(Millis::ticksPerDay - 1)));
+
+		// Conversion from and to minute resolution
+		CPPUNIT_ASSERT_EQUAL(static_cast<uint16_t>(545), ms.hoursMinutes().minutesOfDay());
+		CPPUNIT_ASSERT(Seconds(SdH::HoursMinutes(9, 5)) == Seconds("9:05:00"));
+		CPPUNIT_ASSERT(Seconds(SdH::HoursMinutes(9, 5)) != Seconds("9:05:01"));
+
+		// Fields read back from every second of the day
+		for (uint32_t t = 0; t < Seconds::ticksPerDay; t += 7) {
+			const Seconds tod = Seconds::fromTicks(t);
+
+			CPPUNIT_ASSERT_EQUAL(tod.ticks(), Seconds(str(tod)).ticks());
+			CPPUNIT_ASSERT_EQUAL(t, (tod.hours() * 60U + tod.minutes()) * 60U + tod.seconds());
+		}
+	}
+
+	void addition() {
+		std::mt19937 rng(86400);
+
+		for (size_t i = 0; i < 100000; i++) {
+			const uint32_t lhs = rng() % Millis::ticksPerDay;
+			const uint32_t rhs = rng() % Millis::ticksPerDay;
+			Millis sum = Millis::fromTicks(lhs);
+
+			sum += Millis::fromTicks(rhs);
+			CPPUNIT_ASSERT_EQUAL((lhs + rhs) % Millis::ticksPerDay, sum.ticks());
+			CPPUNIT_ASSERT(sum == Millis::fromTicks(lhs) + Millis::fromTicks(rhs));
+		}
+
+		// Minute resolution adds like HoursMinutes
+		for (uint16_t lhs = 0; lhs < Minutes::ticksPerDay; lhs += 13) {
+			for (uint16_t rhs = 0; rhs < Minutes::ticksPerDay; rhs += 11) {
+				SdH::HoursMinutes hm(lhs / 60, lhs % 60);
+
+				hm += SdH::HoursMinutes(rhs / 60, rhs % 60);
+				CPPUNIT_ASSERT_EQUAL(hm.minutesOfDay(), (Minutes::fromTicks(lhs) + Minutes::fromTicks(rhs)).ticks());
+			}
+		}
+	}
+
+};
+
+#undef CHECKNAME
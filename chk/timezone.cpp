@@ -0,0 +1,255 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <limits>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <TimeZone.h>
+#include "files.h"
+
+#define CHECKNAME timezoneCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(files);
+	CPPUNIT_TEST(rules);
+	CPPUNIT_TEST(convert);
+	CPPUNIT_TEST(limits);
+	CPPUNIT_TEST(malformed);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Previous value of TZ, restored after each check. */
+	std::string oldtz_a;
+
+	/** Whether TZ was set before the check. */
+	bool hadtz_a;
+
+	/** Compare a time zone with localtime_r() for the same TZ value at
+	 * moments spread over a range, and around every transition. */
+	static void compare(const std::string & tzname_i, const int64_t from_i, const int64_t to_i)
+	{
+		const SdH::TimeZone tz = SdH::TimeZone::named(tzname_i);
+		std::vector<int64_t> moments;
+
+		setenv("TZ", tzname_i.c_str(), 1);
+		tzset();
+
+		for (int64_t t = from_i; t < to_i; t += 3 * 86400 + 1234) moments.push_back(t);
+		for (size_t i = 0; i < tz.transitions(); i++) {
+			for (int64_t delta = -1; delta <= 1; delta++) {
+				const int64_t t = tz.transition(i) + delta;
+				if (t >= from_i && t < to_i) moments.push_back(t);
+			}
+		}
+
+		for (const int64_t t : moments) {
+			const time_t tt = t;
+			struct tm tmbuf;
+			SdH::HoursMinutes hm;
+
+			CPPUNIT_ASSERT(localtime_r(&tt, &tmbuf) != nullptr);
+			CPPUNIT_ASSERT_EQUAL_MESSAGE(
+				tzname_i + " at " + std::to_string(t),
+				static_cast<int32_t>(tmbuf.tm_gmtoff), tz.utcOffset(t)
+			);
+			hm = tz.at(t);
+			CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(tmbuf.tm_hour), hm.hours());
+			CPPUNIT_ASSERT_EQUAL(static_cast<uint8_t>(tmbuf.tm_min), hm.minutes());
+		}
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void setUp() override {
+		const char *tz = getenv("TZ");
+
+		hadtz_a = tz != nullptr;
+		if (hadtz_a) oldtz_a = tz;
+	}
+
+	void tearDown() override {
+		if (hadtz_a) setenv("TZ", oldtz_a.c_str(), 1); else unsetenv("TZ");
+		tzset();
+	}
+
+	void files() {
+		const char *zones[] = {
+			"Europe/Amsterdam",   // Regular northern daylight saving time
+			"America/New_York",
+			"Australia/Sydney",   // Southern hemisphere
+			"Europe/Dublin",      // Negative daylight saving time
+			"America/Nuuk",       // Changes at negative rule times
+			"America/Sao_Paulo",  // Abolished daylight saving time
+			"Asia/Kolkata",       // Half hour offset
+			"Pacific/Chatham",    // Quarter hour offsets
+			"Africa/Casablanca",
+			"UTC"
+		};
+		unsigned tested = 0;
+
+		for (const char *zone : zones) {
+			// Skip zones missing from this system
+			if (access((std::string("/usr/share/zoneinfo/") + zone).c_str(), R_OK) != 0) continue;
+			compare(zone, -5364662400, 13569465600); // 1800 up to 2400
+			tested++;
+		}
+
+		// An unknown zone that is no valid rule either
+		CPPUNIT_ASSERT_THROW(SdH::TimeZone::named("No/Such_Zone"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(SdH::TimeZone::fromFile("/nonexistent"), std::runtime_error);
+		CPPUNIT_ASSERT_THROW(SdH::TimeZone::fromFile("/etc/hostname"), std::runtime_error);
+		if (tested == 0) return;
+		CPPUNIT_ASSERT(SdH::TimeZone::named("Europe/Amsterdam").transitions() > 100);
+	}
+
+	void rules() {
+		const char *rules[] = {
+			"CET-1CEST,M3.5.0,M10.5.0/3",
+			"AEST-10AEDT,M10.1.0,M4.1.0/3",
+			"<+0330>-3:30",
+			"<-02>2<-01>,M3.5.0/-1,M10.5.0/0",
+			"XXX3YYY,J60/2,J300",
+			"ABC-2DEF,100,200/-1:30",
+			"STD+5:45DST+4:15,M5.5.6/25,M9.1.1/1:15"
+		};
+
+		// The C library evaluates rules for years before 1971 as if they
+		// were 1970, so only compare from 1971 on
+		for (const char *rule : rules) {
+			compare(rule, 31536000, 13569465600); // 1971 up to 2400
+		}
+
+		CPPUNIT_ASSERT_THROW(SdH::TimeZone::fromRule("CET"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(SdH::TimeZone::fromRule("CET-1CEST,M13.5.0,M10.5.0"), std::invalid_argument);
+		CPPUNIT_ASSERT_THROW(SdH::TimeZone::fromRule("CET-1CEST,M3.5.0"), std::invalid_argument);
+		CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), SdH::TimeZone::fromRule("<+0330>-3:30").transitions());
+	}
+
+	void convert() {
+		const SdH::TimeZone tz = SdH::TimeZone::fromRule("CET-1CEST,M3.5.0,M10.5.0/3");
+		std::mt19937_64 gen(1440);
+		std::uniform_int_distribution<int64_t> dist(-2177452800, 4102444800);
+		std::vector<int64_t> epochs(50000);
+		std::vector<uint16_t> mins(epochs.size());
+
+		for (int64_t & epoch : epochs) epoch = dist(gen);
+
+		// Unsorted input searches every time
+		tz.convert(epochs.data(), epochs.size(), mins.data());
+		for (size_t i = 0; i < epochs.size(); i++) {
+			CPPUNIT_ASSERT_EQUAL(tz.at(epochs[i]).minutesOfDay(), mins[i]);
+		}
+
+		// Sorted input walks along the transitions
+		std::sort(epochs.begin(), epochs.end());
+		tz.convert(epochs.data(), epochs.size(), mins.data());
+		for (size_t i = 0; i < epochs.size(); i++) {
+			CPPUNIT_ASSERT_EQUAL(tz.at(epochs[i]).minutesOfDay(), mins[i]);
+		}
+	}
+
+	void limits() {
+		const SdH::TimeZone tz = SdH::TimeZone::fromRule("<+0330>-3:30");
+		const int64_t epochs[] = {
+			std::numeric_limits<int64_t>::min(),
+			std::numeric_limits<int64_t>::max()
+		};
+		// Minutes of day of the timestamps at 03:30 east of UTC
+		const uint16_t expected[] = {
+			static_cast<uint16_t>((epochs[0] % 86400 + 86400 + 12600) % 86400 / 60),
+			static_cast<uint16_t>((epochs[1] % 86400 + 12600) % 86400 / 60)
+		};
+		uint16_t mins[2];
+
+		tz.convert(epochs, 2, mins);
+		for (size_t i = 0; i < 2; i++) {
+			CPPUNIT_ASSERT_EQUAL(expected[i], tz.at(epochs[i]).minutesOfDay());
+			CPPUNIT_ASSERT_EQUAL(expected[i], mins[i]);
+		}
+	}
+
+	void malformed() {
+		// Header of a version 1 file with the given counts
+		const auto header = [](const uint32_t timecnt_i, const uint32_t typecnt_i) {
+			std::string retval("TZif");
+			const uint32_t counts[] = {0, 0, 0, timecnt_i, typecnt_i, 0};
+
+			retval.append(16, '\0');
+			for (const uint32_t count : counts) {
+				for (int shift = 24; shift >= 0; shift -= 8) retval += static_cast<char>(count >> shift);
+			}
+			return retval;
+		};
+		const std::string files[] = {
+			header(0, 0x2AAAAAAB) + std::string(2, '\0'), // typecnt * 6 wraps to 2
+			header(0, 1) + std::string(5, '\0'),          // Truncated type
+			header(1, 1) + std::string(10, '\0'),         // Truncated transition
+			header(0, 1).substr(0, 40)                     // Truncated header
+		};
+
+		for (const std::string & contents : files) {
+			const int fd = tempFile(contents);
+
+			CPPUNIT_ASSERT_THROW(
+				SdH::TimeZone::fromFile("/proc/self/fd/" + std::to_string(fd)),
+				std::runtime_error
+			);
+			close(fd);
+		}
+
+		// The same header with complete data is accepted
+		const int fd = tempFile(header(0, 1) + std::string("\0\0\x0e\x10\0\0", 6));
+
+		CPPUNIT_ASSERT_EQUAL(
+			static_cast<int32_t>(3600),
+			SdH::TimeZone::fromFile("/proc/self/fd/" + std::to_string(fd)).utcOffset(0)
+		);
+		close(fd);
+	}
+
+};
+
+#undef CHECKNAME
@@ -0,0 +1,188 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include <TimingWheel.h>
+
+#define CHECKNAME timingWheelCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(fire);
+	CPPUNIT_TEST(cancel);
+	CPPUNIT_TEST(callback);
+	CPPUNIT_TEST(random);
+	CPPUNIT_TEST_SUITE_END();
+
+	typedef std::vector<std::pair<uint64_t, uint64_t>> Fired;
+
+	/** Advance a wheel and collect the tick and tag of fired timers. */
+	static size_t advance(SdH::TimingWheel & wheel_io, const uint64_t to_i, Fired & fired_io)
+	{
+		return wheel_io.advance(to_i, [&wheel_io, &fired_io](const SdH::TimingWheel::Timer, const uint64_t tag_i) {
+			fired_io.emplace_back(wheel_io.now(), tag_i);
+		});
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void fire() {
+		SdH::TimingWheel wheel(1000);
+		Fired fired;
+
+		CPPUNIT_ASSERT_EQUAL(UINT64_MAX, wheel.next());
+		wheel.add(1005, 1);
+		wheel.add(1003, 2);
+		wheel.add(1005, 3);
+		wheel.add(900, 4);
+		wheel.add(1000 + 100000, 5);
+		wheel.add(uint64_t(1) << 40, 6);
+		CPPUNIT_ASSERT_EQUAL(size_t(6), wheel.size());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1001), wheel.next());
+
+		CPPUNIT_ASSERT_EQUAL(size_t(2), advance(wheel, 1004, fired));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1004), wheel.now());
+		CPPUNIT_ASSERT_EQUAL(size_t(2), advance(wheel, 1005, fired));
+		CPPUNIT_ASSERT(fired == (Fired{{1001, 4}, {1003, 2}, {1005, 1}, {1005, 3}}));
+
+		// Far timers move down the levels on their way
+		fired.clear();
+		CPPUNIT_ASSERT(wheel.next() > 1005 && wheel.next() <= 101000);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), advance(wheel, 200000, fired));
+		CPPUNIT_ASSERT(fired == (Fired{{101000, 5}}));
+		CPPUNIT_ASSERT_EQUAL(size_t(0), advance(wheel, 100, fired));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(200000), wheel.now());
+		CPPUNIT_ASSERT_EQUAL(size_t(1), advance(wheel, UINT64_MAX - 1, fired));
+		CPPUNIT_ASSERT_EQUAL((uint64_t(1) << 40), fired.back().first);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), wheel.size());
+		CPPUNIT_ASSERT_EQUAL(UINT64_MAX, wheel.next());
+	}
+
+	void cancel() {
+		SdH::TimingWheel wheel;
+		Fired fired;
+		const SdH::TimingWheel::Timer a = wheel.add(10, 1);
+		const SdH::TimingWheel::Timer b = wheel.add(5000, 2);
+		const SdH::TimingWheel::Timer c = wheel.add(10, 3);
+
+		CPPUNIT_ASSERT(wheel.cancel(b));
+		CPPUNIT_ASSERT(!wheel.cancel(b));
+		CPPUNIT_ASSERT(wheel.cancel(a));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(10), wheel.next());
+		CPPUNIT_ASSERT_EQUAL(size_t(1), advance(wheel, 10000, fired));
+		CPPUNIT_ASSERT(!wheel.cancel(c));
+		CPPUNIT_ASSERT(!wheel.cancel(12345));
+
+		// Reused entries don't answer to old identifiers
+		const SdH::TimingWheel::Timer d = wheel.add(20000, 4);
+
+		CPPUNIT_ASSERT(d != a && d != b && d != c);
+		CPPUNIT_ASSERT(!wheel.cancel(a));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), wheel.size());
+		CPPUNIT_ASSERT(wheel.cancel(d));
+		CPPUNIT_ASSERT_EQUAL(size_t(0), wheel.size());
+	}
+
+	void callback() {
+		SdH::TimingWheel wheel;
+		std::vector<SdH::TimingWheel::Timer> timers;
+		Fired fired;
+
+		for (uint64_t i = 0; i < 4; i++) timers.push_back(wheel.add(100, i));
+
+		// Timers added from the callback fire in the same call when due
+		const size_t count = wheel.advance(1000, [&](const SdH::TimingWheel::Timer timer_i, const uint64_t tag_i) {
+			fired.emplace_back(wheel.now(), tag_i);
+			CPPUNIT_ASSERT(!wheel.cancel(timer_i));
+			if (tag_i == 0) CPPUNIT_ASSERT(wheel.cancel(timers[2]));
+			if (tag_i < 4) wheel.add(wheel.now() + 450, tag_i + 10);
+			if (tag_i == 1) wheel.add(0, 20);
+		});
+
+		CPPUNIT_ASSERT_EQUAL(size_t(7), count);
+		CPPUNIT_ASSERT(fired == (Fired{{100, 0}, {100, 1}, {100, 3}, {101, 20}, {550, 10}, {550, 11}, {550, 13}}));
+	}
+
+	void random() {
+		// Compare with a sorted map of due ticks
+		std::mt19937_64 rng(42);
+		SdH::TimingWheel wheel((uint64_t(1) << 24) - 5000);
+		std::map<std::pair<uint64_t, uint64_t>, SdH::TimingWheel::Timer> expected;
+		uint64_t tag = 0;
+
+		for (size_t round = 0; round < 3000; round++) {
+			const unsigned action = rng() % 10;
+
+			if (action < 6) {
+				const uint64_t span = uint64_t(1) << (rng() % 30);
+				const uint64_t when = wheel.now() + 1 + rng() % span;
+
+				expected[{when, tag}] = wheel.add(when, tag);
+				tag++;
+			} else if (action < 8 && !expected.empty()) {
+				auto it = expected.begin();
+
+				std::advance(it, rng() % expected.size());
+				CPPUNIT_ASSERT(wheel.cancel(it->second));
+				expected.erase(it);
+			} else {
+				const uint64_t to = wheel.now() + rng() % (uint64_t(1) << (rng() % 26));
+				Fired fired;
+
+				CPPUNIT_ASSERT(expected.empty() || wheel.next() <= expected.begin()->first.first);
+				advance(wheel, to, fired);
+				for (const auto & entry : fired) {
+					CPPUNIT_ASSERT(!expected.empty());
+					CPPUNIT_ASSERT(entry == expected.begin()->first);
+					expected.erase(expected.begin());
+				}
+				CPPUNIT_ASSERT(expected.empty() || expected.begin()->first.first > to);
+			}
+			CPPUNIT_ASSERT_EQUAL(expected.size(), wheel.size());
+		}
+	}
+
+};
+
+#undef CHECKNAME
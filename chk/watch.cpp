@@ -0,0 +1,169 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noet: */
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <TimeZone.h>
+#include <Watch.h>
+
+#define CHECKNAME watchCheck
+
+class CHECKNAME;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CHECKNAME);
+
+class CHECKNAME : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(CHECKNAME);
+	CPPUNIT_TEST(read);
+	CPPUNIT_TEST(errors);
+	CPPUNIT_TEST(wait);
+	CPPUNIT_TEST(hook);
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Format a local time of day in UTC. */
+	static std::string hhmm(const int64_t epoch_i)
+	{
+		std::ostringstream oss;
+
+		oss << SdH::TimeZone().at(epoch_i);
+		return oss.str();
+	}
+
+	/** Read timers relative to the current time in UTC and return what
+	 * watching them writes. */
+	static std::string watch(const std::string & timers_i, const std::string & hook_i = "")
+	{
+		std::istringstream in(timers_i);
+		std::ostringstream out;
+		SdH::Watch watch(time(nullptr));
+
+		watch.read(in, SdH::TimeZone());
+		watch.hook(hook_i);
+		watch.run(out);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), watch.size());
+		return out.str();
+	}
+
+	public:
+
+	CHECKNAME()
+	{ }
+
+	void read() {
+		const int64_t now = time(nullptr);
+
+		// Every timer here is done already, so they fire in order
+		CPPUNIT_ASSERT_EQUAL(
+			hhmm(now - 3600) + " bread\n" +
+			hhmm(now - 1800) + " cake\n" +
+			hhmm(now - 3660) + "\n" +
+			hhmm(now - 4000) + " second bread\n",
+			watch(
+				"# Bakery\n"
+				"\n" +
+				hhmm(now - 7200) + " 1:00 # bread\n" +
+				"+30   #  cake \n" +
+				hhmm(now - 7200) + " 59\n" +
+				"  " + hhmm(now - 4000) + " 0 # second bread\n"
+			)
+		);
+	}
+
+	void errors() {
+		SdH::Watch watch(1600000000);
+		std::istringstream bad("1:00\n25:00 1\n");
+		std::istringstream chained("# Nothing before\n+10\n");
+
+		CPPUNIT_ASSERT_THROW(watch.read(bad, SdH::TimeZone()), std::invalid_argument);
+		try {
+			watch.read(chained, SdH::TimeZone());
+			CPPUNIT_FAIL("No exception");
+		} catch (const std::invalid_argument & ia) {
+			CPPUNIT_ASSERT_EQUAL(std::string("Line 2: No previous timer to continue"), std::string(ia.what()));
+		}
+	}
+
+	void wait() {
+		const int64_t now = time(nullptr);
+		const auto begin = std::chrono::steady_clock::now();
+		std::ostringstream out;
+		timespec after;
+		SdH::Watch watch(now);
+
+		// Sleeps until the next second
+		watch.add(now + 1, SdH::HoursMinutes(12, 34), "later");
+		watch.add(now - 10, SdH::HoursMinutes(12, 33));
+		watch.run(out);
+		CPPUNIT_ASSERT_EQUAL(std::string("12:33\n12:34 later\n"), out.str());
+		CPPUNIT_ASSERT(std::chrono::steady_clock::now() - begin < std::chrono::seconds(3));
+		clock_gettime(CLOCK_REALTIME, &after);
+		CPPUNIT_ASSERT(after.tv_sec >= now + 1);
+	}
+
+	void hook() {
+		const std::string path = "/tmp/timecal-chk-" + std::to_string(getpid()) + ".hook";
+		const int64_t now = time(nullptr);
+
+		// The hook gets the rest of the environment, with the variables
+		// of the timer replacing any of the same name
+		setenv("TIMECAL_LABEL", "stale", 1);
+		setenv("TIMECAL_CHK", "kept", 1);
+		unlink(path.c_str());
+		watch(
+			hhmm(now - 600) + " 1 # a\n+1 # b c\n",
+			"echo \"$TIMECAL_TIME $TIMECAL_LABEL $TIMECAL_CHK\" >> " + path
+		);
+		unsetenv("TIMECAL_LABEL");
+		unsetenv("TIMECAL_CHK");
+
+		std::ifstream file(path);
+		std::string first, second;
+
+		std::getline(file, first);
+		std::getline(file, second);
+		unlink(path.c_str());
+		CPPUNIT_ASSERT(first != second);
+		CPPUNIT_ASSERT(first == hhmm(now - 540) + " a kept" || first == hhmm(now - 480) + " b c kept");
+		CPPUNIT_ASSERT(second == hhmm(now - 540) + " a kept" || second == hhmm(now - 480) + " b c kept");
+	}
+
+};
+
+#undef CHECKNAME
@@ -0,0 +1,847 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Batch.h"
+#include "BatchParser.h"
+#include "Calculator.h"
+#include "ColumnFile.h"
+#include "HoursMinutesArray.h"
+#include "LineReader.h"
+#include "MappedFile.h"
+#include "OutputBuffer.h"
+#include "Stats.h"
+#include "TimeZone.h"
+
+namespace {
+
+	/** Number of records parsed in one go. */
+	constexpr size_t recordCount = 4096;
+
+	/** Outcome of parsing an epoch timestamp line. */
+	enum EpochStatus : uint8_t { epochValid, epochInvalid, epochEmpty };
+
+	/** A part of the input evaluated by a single thread. */
+	struct Chunk {
+		/** First character of the chunk. */
+		const char * first;
+
+		/** One past the last character of the chunk. */
+		const char * last;
+
+		/** Output lines, only the first @p used bytes are valid. */
+		std::string output;
+
+		/** Number of valid bytes in @p output. */
+		size_t used;
+
+		/** Number of evaluated lines. */
+		size_t lines;
+
+		/** Output offsets of '+' lines evaluated before any line in this
+		 * chunk set an answer of its own, with the answer as calculated
+		 * from a previous answer of 00:00. */
+		std::vector<std::pair<size_t, uint16_t>> pending;
+
+		/** Whether a line in this chunk set an answer of its own. */
+		bool anchored;
+
+		/** Last answer, relative to 00:00 when not anchored. */
+		SdH::HoursMinutes result;
+
+		/** Exception thrown while evaluating. */
+		std::exception_ptr error;
+	};
+
+	/** Outcome of parsing a duration of a chain. */
+	enum ChainStatus : uint8_t { chainValid, chainInvalid, chainEmpty };
+
+	/** A part of a chain of durations summed by a single thread. */
+	struct Link {
+		/** First character of the link. */
+		const char * first;
+
+		/** One past the last character of the link. */
+		const char * last;
+
+		/** Duration in minutes per line, 0 for failing and empty lines. */
+		std::vector<uint16_t> durations;
+
+		/** ChainStatus per line. */
+		std::vector<uint8_t> status;
+
+		/** Failing lines, in input order. */
+		std::vector<SdH::BatchParser::Record> failed;
+
+		/** Sum of all durations. */
+		uint64_t total;
+
+		/** Time after each duration, filled by scanLink(). */
+		std::vector<uint16_t> mins;
+
+		/** Midnights passed after each duration, filled by scanLink(). */
+		std::vector<uint32_t> days;
+
+		/** Output lines, only the first @p used bytes are valid. */
+		std::string output;
+
+		/** Number of valid bytes in @p output. */
+		size_t used;
+
+		/** Exception thrown while evaluating. */
+		std::exception_ptr error;
+	};
+
+	/** Get room for @p size_i more bytes of chunk or link output.
+	 * @returns Position to write to. */
+	template <typename Part>
+	inline char * room(Part & chunk_io, const size_t size_i)
+	{
+		if (chunk_io.output.size() - chunk_io.used < size_i) {
+			chunk_io.output.resize(std::max(chunk_io.output.size() * 2, chunk_io.used + size_i));
+		}
+		return &chunk_io.output[chunk_io.used];
+	}
+
+	/** Evaluate all lines of a chunk, starting with a previous answer of
+	 * 00:00. Does not throw, exceptions are stored in the chunk. */
+	void processChunk(Chunk & chunk_io, const SdH::BatchParser & parser_i) noexcept
+	{
+		using SdH::BatchParser;
+
+		try {
+			using SdH::Stats;
+
+			std::unique_ptr<BatchParser::Record[]> recs(new BatchParser::Record[recordCount]);
+			std::unique_ptr<SdH::HoursMinutes[]> results(new SdH::HoursMinutes[recordCount]);
+			std::ostringstream err;
+			SdH::Calculator calc;
+			Stats & stats = Stats::instance();
+			const char *pos = chunk_io.first;
+			size_t parsed = 0, pending = 0;
+
+			room(chunk_io, chunk_io.last - chunk_io.first);
+			while (pos != chunk_io.last) {
+				const bool timed = stats.enabled();
+				uint64_t ticks[4] = {timed ? Stats::ticks() : 0, 0, 0, 0};
+
+				pos = parser_i.parse(pos, chunk_io.last, recs.get(), recordCount, parsed);
+				if (timed) ticks[1] = Stats::ticks();
+
+				// Compute all answers of the round, noting how many of them
+				// still depend on the previous chunk
+				pending = 0;
+				for (size_t i = 0; i < parsed; i++) {
+					const BatchParser::Record & rec = recs[i];
+
+					if (rec.first != rec.last && rec.result.ec == std::errc()) {
+						calc.apply(rec);
+						results[i] = calc.result();
+						if (!chunk_io.anchored) {
+							if (rec.kind == BatchParser::Kind::chained) {
+								pending = i + 1;
+							} else {
+								chunk_io.anchored = true;
+							}
+						}
+					}
+				}
+				if (timed) ticks[2] = Stats::ticks();
+
+				for (size_t i = 0; i < parsed; i++) {
+					const BatchParser::Record & rec = recs[i];
+
+					if (rec.first != rec.last && rec.result.ec == std::errc()) {
+						char *buf = room(chunk_io, SdH::HoursMinutes::charsLength + 1);
+
+						if (i < pending) chunk_io.pending.emplace_back(chunk_io.used, results[i].minutesOfDay());
+						buf = results[i].toChars(buf);
+						*buf++ = '\n';
+						chunk_io.used = buf - chunk_io.output.data();
+						continue;
+					}
+
+					// Error message, or nothing for an empty line
+					if (rec.first != rec.last) {
+						err.str("");
+						SdH::HoursMinutes::printError(err, rec.result, rec.last);
+
+						const std::string msg = err.str();
+
+						memcpy(room(chunk_io, msg.size()), msg.data(), msg.size());
+						chunk_io.used += msg.size();
+					}
+					*room(chunk_io, 1) = '\n';
+					chunk_io.used++;
+				}
+				chunk_io.lines += parsed;
+
+				if (timed) {
+					Stats::Counters & counters = stats.local();
+
+					counters.round(ticks, parsed);
+					for (size_t i = 0; i < parsed; i++) counters.count(recs[i].first == recs[i].last, recs[i].result.ec);
+				}
+			}
+			chunk_io.result = calc.result();
+		} catch (...) {
+			chunk_io.error = std::current_exception();
+		}
+	}
+
+	/** Parse all durations of a link and sum them. Does not throw,
+	 * exceptions are stored in the link. */
+	void parseLink(Link & link_io, const SdH::BatchParser & parser_i) noexcept
+	{
+		using SdH::BatchParser;
+
+		try {
+			std::unique_ptr<BatchParser::Record[]> recs(new BatchParser::Record[recordCount]);
+			const char *pos = link_io.first;
+			size_t parsed = 0;
+
+			while (pos != link_io.last) {
+				pos = parser_i.parse(pos, link_io.last, recs.get(), recordCount, parsed);
+
+				for (size_t i = 0; i < parsed; i++) {
+					const BatchParser::Record & rec = recs[i];
+
+					if (rec.first == rec.last) {
+						link_io.durations.push_back(0);
+						link_io.status.push_back(chainEmpty);
+					} else if (rec.result.ec == std::errc() && rec.kind != BatchParser::Kind::full) {
+						link_io.durations.push_back(rec.duration.minutesOfDay());
+						link_io.status.push_back(chainValid);
+						link_io.total += link_io.durations.back();
+					} else {
+						link_io.durations.push_back(0);
+						link_io.status.push_back(chainInvalid);
+						link_io.failed.push_back(rec);
+					}
+				}
+			}
+		} catch (...) {
+			link_io.error = std::current_exception();
+		}
+	}
+
+	/** Add the durations of a link to a start and write the end times.
+	 * Does not throw, exceptions are stored in the link.
+	 * @param start_i Time at the start of the link.
+	 * @param day_i Days passed since the start of the chain. */
+	void scanLink(Link & link_io, const uint16_t start_i, const uint64_t day_i) noexcept
+	{
+		try {
+			const size_t count = link_io.durations.size();
+			std::ostringstream err;
+			size_t failed = 0;
+
+			link_io.mins.resize(count);
+			link_io.days.resize(count);
+			SdH::HoursMinutesArray::scan(link_io.durations.data(), count, start_i, link_io.mins.data(), link_io.days.data());
+
+			for (size_t i = 0; i < count; i++) {
+				// Plus sign, days, space, time and newline
+				char *buf = room(link_io, 22 + SdH::HoursMinutes::charsLength + 1);
+
+				switch (link_io.status[i]) {
+					case chainValid: {
+						SdH::HoursMinutes hm;
+
+						hm.minutesOfDay(link_io.mins[i]);
+						*buf++ = '+';
+						buf = std::to_chars(buf, buf + 20, day_i + link_io.days[i]).ptr;
+						*buf++ = ' ';
+						buf = hm.toChars(buf);
+						break;
+					}
+
+					case chainInvalid: {
+						const SdH::BatchParser::Record & rec = link_io.failed[failed++];
+
+						err.str("");
+						if (rec.result.ec == std::errc()) {
+							err << "Expected a single duration";
+						} else {
+							SdH::HoursMinutes::printError(err, rec.result, rec.last);
+						}
+
+						const std::string msg = err.str();
+
+						buf = static_cast<char *>(memcpy(room(link_io, msg.size() + 1), msg.data(), msg.size())) + msg.size();
+						break;
+					}
+
+					default:
+						break;
+				}
+				*buf++ = '\n';
+				link_io.used = buf - link_io.output.data();
+			}
+		} catch (...) {
+			link_io.error = std::current_exception();
+		}
+	}
+
+} // anonymous namespace
+
+namespace SdH {
+
+	size_t processBatch(const int inFd_i, const int outFd_i)
+	{
+		LineReader reader(inFd_i);
+		OutputBuffer outbuf(outFd_i);
+		std::ostream out(&outbuf);
+		const BatchParser parser;
+		std::unique_ptr<BatchParser::Record[]> recs(new BatchParser::Record[recordCount]);
+		std::unique_ptr<HoursMinutes[]> results(new HoursMinutes[recordCount]);
+		Calculator calc;
+		Stats & stats = Stats::instance();
+		std::string_view block;
+		size_t count = 0, parsed = 0;
+
+		while (reader.nextBlock(block)) {
+			const char *pos = block.data();
+			const char *last = pos + block.size();
+
+			while (pos != last) {
+				const bool timed = stats.enabled();
+				uint64_t ticks[4] = {timed ? Stats::ticks() : 0, 0, 0, 0};
+
+				pos = parser.parse(pos, last, recs.get(), recordCount, parsed);
+				if (timed) ticks[1] = Stats::ticks();
+
+				// Compute all answers of the round before formatting them
+				for (size_t i = 0; i < parsed; i++) {
+					const BatchParser::Record & rec = recs[i];
+
+					if (rec.first != rec.last && rec.result.ec == std::errc()) {
+						calc.apply(rec);
+						results[i] = calc.result();
+					}
+				}
+				if (timed) ticks[2] = Stats::ticks();
+
+				for (size_t i = 0; i < parsed; i++) {
+					const BatchParser::Record & rec = recs[i];
+
+					if (rec.first != rec.last && rec.result.ec == std::errc()) {
+						char *buf = outbuf.reserve(HoursMinutes::charsLength + 1);
+
+						buf = results[i].toChars(buf);
+						*buf++ = '\n';
+						outbuf.commit(buf);
+						continue;
+					}
+
+					// Error message, or nothing for an empty line
+					if (rec.first != rec.last) {
+						HoursMinutes::printError(out, rec.result, rec.last);
+					}
+					out.put('\n');
+				}
+				count += parsed;
+
+				if (timed) {
+					Stats::Counters & counters = stats.local();
+
+					counters.round(ticks, parsed);
+					for (size_t i = 0; i < parsed; i++) counters.count(recs[i].first == recs[i].last, recs[i].result.ec);
+				}
+			}
+		}
+
+		outbuf.flush();
+		return count;
+	}
+
+	size_t collectBatch(const int inFd_i, HoursMinutesArray & times_o)
+	{
+		LineReader reader(inFd_i);
+		const BatchParser parser;
+		std::unique_ptr<BatchParser::Record[]> recs(new BatchParser::Record[recordCount]);
+		Calculator calc;
+		std::string_view block;
+		size_t count = 0, parsed = 0;
+
+		while (reader.nextBlock(block)) {
+			const char *pos = block.data();
+			const char *last = pos + block.size();
+
+			while (pos != last) {
+				pos = parser.parse(pos, last, recs.get(), recordCount, parsed);
+
+				for (size_t i = 0; i < parsed; i++) {
+					const BatchParser::Record & rec = recs[i];
+
+					if (rec.first == rec.last) continue;
+					if (rec.result.ec != std::errc()) {
+						std::ostringstream err;
+
+						err << "Line " << count + i + 1 << ": ";
+						HoursMinutes::printError(err, rec.result, rec.last);
+						throw std::invalid_argument(err.str());
+					}
+					calc.apply(rec);
+					times_o.push_back(calc.result());
+				}
+				count += parsed;
+			}
+		}
+
+		return count;
+	}
+
+	size_t processSorted(const int inFd_i, const int outFd_i, const bool days_i)
+	{
+		LineReader reader(inFd_i);
+		const BatchParser parser;
+		std::unique_ptr<BatchParser::Record[]> recs(new BatchParser::Record[recordCount]);
+		Calculator calc;
+		std::vector<uint16_t> mins;
+		std::vector<uint32_t> days;
+		std::vector<size_t> lines;
+		std::string_view block;
+		uint32_t day = 0;
+		size_t count = 0, parsed = 0;
+
+		while (reader.nextBlock(block)) {
+			const char *pos = block.data();
+			const char *last = pos + block.size();
+
+			while (pos != last) {
+				pos = parser.parse(pos, last, recs.get(), recordCount, parsed);
+
+				for (size_t i = 0; i < parsed; i++) {
+					const BatchParser::Record & rec = recs[i];
+
+					if (rec.first == rec.last) continue;
+					if (rec.result.ec != std::errc()) {
+						std::ostringstream err;
+
+						err << "Line " << count + i + 1 << ": ";
+						HoursMinutes::printError(err, rec.result, rec.last);
+						throw std::invalid_argument(err.str());
+					}
+					calc.apply(rec);
+
+					// Only a '+' line continues on the day of the previous answer
+					if (rec.kind != BatchParser::Kind::chained) day = 0;
+					if (calc.result().minutesOfDay() < calc.reference().minutesOfDay()) day++;
+					mins.push_back(calc.result().minutesOfDay());
+					days.push_back(day);
+					lines.push_back(count + i + 1);
+				}
+				count += parsed;
+			}
+		}
+
+		OutputBuffer outbuf(outFd_i);
+		std::vector<size_t> order(mins.size());
+
+		HoursMinutesArray::sort(mins.data(), days_i ? days.data() : nullptr, mins.size(), order.data());
+		for (size_t i = 0; i < order.size(); i++) {
+			const size_t idx = order[i];
+			char *buf = outbuf.reserve(1 + 10 + 1 + HoursMinutes::charsLength);
+			HoursMinutes hm;
+
+			// The first of a group of equal results writes the result
+			if (i == 0 || mins[idx] != mins[order[i - 1]] || (days_i && days[idx] != days[order[i - 1]])) {
+				if (i != 0) *buf++ = '\n';
+				if (days_i) {
+					*buf++ = '+';
+					buf = std::to_chars(buf, buf + 10, days[idx]).ptr;
+					*buf++ = ' ';
+				}
+				hm.minutesOfDay(mins[idx]);
+				buf = hm.toChars(buf);
+			}
+			outbuf.commit(buf);
+
+			buf = outbuf.reserve(1 + 20);
+			*buf++ = ' ';
+			buf = std::to_chars(buf, buf + 20, lines[idx]).ptr;
+			outbuf.commit(buf);
+		}
+		if (!order.empty()) outbuf.append("\n", 1);
+
+		outbuf.flush();
+		return count;
+	}
+
+	size_t convertToColumns(const int inFd_i, const int outFd_i, const bool carries_i)
+	{
+		LineReader reader(inFd_i);
+		const BatchParser parser;
+		std::unique_ptr<BatchParser::Record[]> recs(new BatchParser::Record[recordCount]);
+		Calculator calc;
+		std::vector<uint16_t> refs, durs, results;
+		std::vector<uint8_t> carries;
+		std::string_view block;
+		size_t count = 0, parsed = 0;
+
+		while (reader.nextBlock(block)) {
+			const char *pos = block.data();
+			const char *last = pos + block.size();
+
+			while (pos != last) {
+				pos = parser.parse(pos, last, recs.get(), recordCount, parsed);
+
+				for (size_t i = 0; i < parsed; i++) {
+					const BatchParser::Record & rec = recs[i];
+
+					if (rec.first == rec.last) continue;
+					if (rec.result.ec != std::errc()) {
+						std::ostringstream err;
+
+						err << "Line " << count + i + 1 << ": ";
+						HoursMinutes::printError(err, rec.result, rec.last);
+						throw std::invalid_argument(err.str());
+					}
+					calc.apply(rec);
+					refs.push_back(calc.reference().minutesOfDay());
+					durs.push_back(calc.duration().minutesOfDay());
+					results.push_back(calc.result().minutesOfDay());
+					if (carries_i) carries.push_back(results.back() < refs.back());
+				}
+				count += parsed;
+			}
+		}
+
+		ColumnFile::write(
+			outFd_i, refs.data(), durs.data(), results.data(), carries_i ? carries.data() : nullptr, refs.size()
+		);
+		return count;
+	}
+
+	size_t convertFromColumns(const int inFd_i, const int outFd_i)
+	{
+		const ColumnFile columns(inFd_i);
+		const uint16_t *refs = columns.references();
+		const uint16_t *durs = columns.durations();
+		OutputBuffer outbuf(outFd_i);
+		HoursMinutes hm;
+
+		for (size_t i = 0; i < columns.size(); i++) {
+			char *buf = outbuf.reserve(2 * HoursMinutes::charsLength + 2);
+
+			hm.minutesOfDay(refs[i]);
+			buf = hm.toChars(buf);
+			*buf++ = ' ';
+			hm.minutesOfDay(durs[i]);
+			buf = hm.toChars(buf);
+			*buf++ = '\n';
+			outbuf.commit(buf);
+		}
+
+		outbuf.flush();
+		return columns.size();
+	}
+
+	size_t processParallel(
+		const int inFd_i,
+		const int outFd_i,
+		const unsigned threads_i,
+		const size_t chunkSize_i
+	) {
+		if (!MappedFile::mappable(inFd_i)) return processBatch(inFd_i, outFd_i);
+
+		const MappedFile input(inFd_i);
+		const unsigned threads = threads_i > 0 ? threads_i : std::max(std::thread::hardware_concurrency(), 1U);
+		const size_t chunkSize = std::max<size_t>(std::min(chunkSize_i, input.size() / threads + 1), 1);
+		OutputBuffer outbuf(outFd_i);
+		const BatchParser parser;
+		std::vector<Chunk> chunks(threads);
+		std::vector<std::thread> workers;
+		HoursMinutes carry;
+		const char *pos = input.data();
+		size_t count = 0;
+
+		while (pos != input.end()) {
+			size_t used = 0;
+
+			// Split the next part of the input at newlines
+			for (; used < threads && pos != input.end(); used++) {
+				Chunk & chunk = chunks[used];
+				const char *end = input.end();
+
+				if (static_cast<size_t>(end - pos) > chunkSize) {
+					const char *nl = static_cast<const char *>(memchr(pos + chunkSize - 1, '\n', end - pos - chunkSize + 1));
+
+					if (nl != nullptr) end = nl + 1;
+				}
+
+				chunk.first = pos;
+				chunk.last = end;
+				chunk.used = 0;
+				chunk.lines = 0;
+				chunk.pending.clear();
+				chunk.anchored = false;
+				chunk.error = nullptr;
+				pos = end;
+			}
+
+			// The first chunk is evaluated on this thread
+			for (size_t i = 1; i < used; i++) {
+				workers.emplace_back(processChunk, std::ref(chunks[i]), std::cref(parser));
+			}
+			processChunk(chunks[0], parser);
+			for (std::thread & worker : workers) worker.join();
+			workers.clear();
+
+			// Patch leading '+' lines and write everything in order
+			for (size_t i = 0; i < used; i++) {
+				Chunk & chunk = chunks[i];
+
+				if (chunk.error) std::rethrow_exception(chunk.error);
+
+				for (const std::pair<size_t, uint16_t> & slot : chunk.pending) {
+					HoursMinutes hm;
+
+					hm.minutesOfDay(slot.second);
+					hm += carry;
+					hm.toChars(&chunk.output[slot.first]);
+				}
+
+				if (chunk.anchored) {
+					carry = chunk.result;
+				} else {
+					carry += chunk.result;
+				}
+
+				outbuf.append(chunk.output.data(), chunk.used);
+				count += chunk.lines;
+			}
+		}
+
+		outbuf.flush();
+		return count;
+	}
+
+	size_t processChain(
+		const int inFd_i,
+		const int outFd_i,
+		const unsigned threads_i,
+		const size_t chunkSize_i
+	) {
+		const bool mapped = MappedFile::mappable(inFd_i);
+		const unsigned threads = !mapped ? 1 : threads_i > 0 ? threads_i : std::max(std::thread::hardware_concurrency(), 1U);
+		OutputBuffer outbuf(outFd_i);
+		const BatchParser parser;
+		std::vector<Link> links(threads);
+		std::vector<std::thread> workers;
+		bool started = false;
+		uint64_t total = 0;
+		size_t count = 0;
+
+		// Evaluate a piece of input in rounds of one link per thread
+		const auto process = [&](const char * pos_i, const char * end_i) {
+			const size_t chunkSize = std::max<size_t>(std::min<size_t>(chunkSize_i, (end_i - pos_i) / threads + 1), 1);
+
+			if (!started && pos_i != end_i) {
+				BatchParser::Record rec;
+				size_t parsed = 0;
+
+				pos_i = parser.parse(pos_i, end_i, &rec, 1, parsed);
+				if (rec.result.ec != std::errc()) {
+					std::ostringstream err;
+
+					err << "Line 1: ";
+					HoursMinutes::printError(err, rec.result, rec.last);
+					throw std::invalid_argument(err.str());
+				}
+				// An empty line parses as midnight, but gives no start time
+				if (rec.kind != BatchParser::Kind::now || rec.first == rec.last) {
+					throw std::invalid_argument("Line 1: Expected a single start time");
+				}
+
+				char *buf = outbuf.reserve(3 + HoursMinutes::charsLength + 1);
+
+				buf = std::copy_n("+0 ", 3, buf);
+				buf = rec.duration.toChars(buf);
+				*buf++ = '\n';
+				outbuf.commit(buf);
+				total = rec.duration.minutesOfDay();
+				started = true;
+				count++;
+			}
+
+			while (pos_i != end_i) {
+				size_t used = 0;
+
+				// Split the next part of the input at newlines
+				for (; used < threads && pos_i != end_i; used++) {
+					Link & link = links[used];
+					const char *end = end_i;
+
+					if (static_cast<size_t>(end - pos_i) > chunkSize) {
+						const char *nl = static_cast<const char *>(memchr(pos_i + chunkSize - 1, '\n', end - pos_i - chunkSize + 1));
+
+						if (nl != nullptr) end = nl + 1;
+					}
+
+					link.first = pos_i;
+					link.last = end;
+					link.durations.clear();
+					link.status.clear();
+					link.failed.clear();
+					link.total = 0;
+					link.used = 0;
+					link.error = nullptr;
+					pos_i = end;
+				}
+
+				// Sum the durations of every link, the first on this thread
+				for (size_t i = 1; i < used; i++) {
+					workers.emplace_back(parseLink, std::ref(links[i]), std::cref(parser));
+				}
+				parseLink(links[0], parser);
+				for (std::thread & worker : workers) worker.join();
+				workers.clear();
+
+				// Every link starts where the links before it end
+				std::vector<uint64_t> starts(used);
+
+				for (size_t i = 0; i < used; i++) {
+					if (links[i].error) std::rethrow_exception(links[i].error);
+					starts[i] = total;
+					total += links[i].total;
+				}
+
+				for (size_t i = 1; i < used; i++) {
+					workers.emplace_back(scanLink, std::ref(links[i]),
+						starts[i] % HoursMinutes::minutesPerDay, starts[i] / HoursMinutes::minutesPerDay);
+				}
+				scanLink(links[0], starts[0] % HoursMinutes::minutesPerDay, starts[0] / HoursMinutes::minutesPerDay);
+				for (std::thread & worker : workers) worker.join();
+				workers.clear();
+
+				for (size_t i = 0; i < used; i++) {
+					if (links[i].error) std::rethrow_exception(links[i].error);
+					outbuf.append(links[i].output.data(), links[i].used);
+					count += links[i].durations.size();
+				}
+			}
+		};
+
+		if (mapped) {
+			const MappedFile input(inFd_i);
+
+			process(input.data(), input.end());
+		} else {
+			LineReader reader(inFd_i);
+			std::string_view block;
+
+			while (reader.nextBlock(block)) process(block.data(), block.data() + block.size());
+		}
+
+		outbuf.flush();
+		return count;
+	}
+
+	size_t processEpochs(const int inFd_i, const int outFd_i, const TimeZone & tz_i)
+	{
+		LineReader reader(inFd_i);
+		OutputBuffer outbuf(outFd_i);
+		std::unique_ptr<int64_t[]> epochs(new int64_t[recordCount]);
+		std::unique_ptr<uint16_t[]> mins(new uint16_t[recordCount]);
+		std::unique_ptr<uint8_t[]> status(new uint8_t[recordCount]);
+		std::string_view block;
+		size_t count = 0;
+
+		while (reader.nextBlock(block)) {
+			const char *pos = block.data();
+			const char *last = pos + block.size();
+
+			while (pos != last) {
+				size_t lines = 0;
+
+				// Parse a round of timestamps
+				while (pos != last && lines < recordCount) {
+					const char *nl = static_cast<const char *>(memchr(pos, '\n', last - pos));
+					const char *end = nl == nullptr ? last : nl;
+					const std::from_chars_result res = std::from_chars(pos, end, epochs[lines]);
+
+					if (pos == end) {
+						status[lines] = epochEmpty;
+						epochs[lines] = 0;
+					} else if (res.ec != std::errc() || res.ptr != end) {
+						status[lines] = epochInvalid;
+						epochs[lines] = 0;
+					} else {
+						status[lines] = epochValid;
+					}
+					lines++;
+					pos = nl == nullptr ? last : nl + 1;
+				}
+
+				tz_i.convert(epochs.get(), lines, mins.get());
+
+				for (size_t i = 0; i < lines; i++) {
+					static const char invalid[] = "Invalid epoch timestamp\n";
+					char *buf = outbuf.reserve(sizeof(invalid));
+
+					switch (status[i]) {
+						case epochValid:
+							buf = HoursMinutesArray::format(mins.get() + i, 1, buf);
+							break;
+
+						case epochInvalid:
+							buf = std::copy(invalid, invalid + sizeof(invalid) - 1, buf);
+							break;
+
+						default:
+							*buf++ = '\n';
+					}
+					outbuf.commit(buf);
+				}
+				count += lines;
+			}
+		}
+
+		outbuf.flush();
+		return count;
+	}
+
+} // SdH namespace
@@ -0,0 +1,155 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+
+namespace SdH {
+
+	class HoursMinutesArray;
+	class TimeZone;
+
+	/** Evaluate every line read from @p inFd_i with a Calculator and write
+	 * one line per input line to @p outFd_i. Successful lines produce the
+	 * resulting time, failing lines the error message and empty lines an
+	 * empty line. There is no prompt and output is only flushed when the
+	 * output buffer is full or the input is exhausted.
+	 * @param inFd_i File descriptor to read lines from.
+	 * @param outFd_i File descriptor to write results to.
+	 * @returns The number of lines processed.
+	 * @throws std::system_error when reading or writing fails. */
+	size_t processBatch(const int inFd_i, const int outFd_i);
+
+	/** Evaluate every line read from @p inFd_i like processBatch(), but
+	 * keep the resulting times instead of writing them. Empty lines are
+	 * skipped.
+	 * @param inFd_i File descriptor to read lines from.
+	 * @param times_o Receives the resulting times, in input order.
+	 * @returns The number of lines processed.
+	 * @throws std::invalid_argument for the first line that can't be
+	 * parsed, with its line number.
+	 * @throws std::system_error when reading fails. */
+	size_t collectBatch(const int inFd_i, HoursMinutesArray & times_o);
+
+	/** Evaluate every line read from @p inFd_i like processBatch() and
+	 * write the results ordered by time of day, one line per distinct
+	 * result. Each line holds the result and the numbers of the input
+	 * lines with that result, in input order. Empty lines are skipped.
+	 * @param inFd_i File descriptor to read lines from.
+	 * @param outFd_i File descriptor to write results to.
+	 * @param days_i Whether to order on the number of midnights passed
+	 * first, written before the result like "+1 02:06". That number
+	 * carries over to lines with a leading plus sign.
+	 * @returns The number of lines processed.
+	 * @throws std::invalid_argument for the first line that can't be
+	 * parsed, with its line number.
+	 * @throws std::system_error when reading or writing fails. */
+	size_t processSorted(const int inFd_i, const int outFd_i, const bool days_i = false);
+
+	/** Evaluate every line read from @p inFd_i like collectBatch() and
+	 * write the reference times, durations and results to @p outFd_i as a
+	 * ColumnFile. Empty lines are skipped.
+	 * @param inFd_i File descriptor to read lines from.
+	 * @param outFd_i File descriptor to write the column file to.
+	 * @param carries_i Whether to add the column with the number of
+	 * midnights passed by every line.
+	 * @returns The number of lines processed.
+	 * @throws std::invalid_argument for the first line that can't be
+	 * parsed, with its line number.
+	 * @throws std::system_error when reading or writing fails. */
+	size_t convertToColumns(const int inFd_i, const int outFd_i, const bool carries_i = false);
+
+	/** Read a ColumnFile from @p inFd_i and write every record as a line
+	 * with its reference time and duration, like "09:34 01:48", which
+	 * evaluates to the same result again.
+	 * @param inFd_i File descriptor to read the column file from.
+	 * @param outFd_i File descriptor to write lines to.
+	 * @returns The number of records.
+	 * @throws std::invalid_argument when the input is not a valid column
+	 * file.
+	 * @throws std::system_error when reading or writing fails. */
+	size_t convertFromColumns(const int inFd_i, const int outFd_i);
+
+	/** Like processBatch(), but map the input into memory and split it at
+	 * newlines into chunks that are evaluated on separate threads. Results
+	 * are written in input order. Lines with a leading plus sign at the
+	 * start of a chunk are corrected with the last answer of the previous
+	 * chunk once that is known. Input that can't be mapped, like a pipe,
+	 * is handed to processBatch().
+	 * @param inFd_i File descriptor to read lines from.
+	 * @param outFd_i File descriptor to write results to.
+	 * @param threads_i Number of threads, 0 for one per processor.
+	 * @param chunkSize_i Maximum number of input bytes per chunk, which
+	 * bounds the memory used for buffered results.
+	 * @returns The number of lines processed.
+	 * @throws std::system_error when reading or writing fails. */
+	size_t processParallel(
+		const int inFd_i,
+		const int outFd_i,
+		const unsigned threads_i = 0,
+		const size_t chunkSize_i = 64 << 20
+	);
+
+	/** Read a start time on the first line of @p inFd_i and a duration,
+	 * with or without a leading plus sign, on every following line. Write
+	 * the start and the end of every duration as the number of days after
+	 * the start day and the time, like "+1 02:15". Failing lines produce
+	 * the error message and empty lines an empty line, both adding
+	 * nothing. Durations are summed per chunk on separate threads, after
+	 * which every chunk continues from the sum of the chunks before it.
+	 * Input that can't be mapped, like a pipe, is handled on this thread.
+	 * @param inFd_i File descriptor to read the chain from.
+	 * @param outFd_i File descriptor to write end times to.
+	 * @param threads_i Number of threads, 0 for one per processor.
+	 * @param chunkSize_i Maximum number of input bytes per chunk.
+	 * @returns The number of lines processed.
+	 * @throws std::invalid_argument when the first line holds no time.
+	 * @throws std::system_error when reading or writing fails. */
+	size_t processChain(
+		const int inFd_i,
+		const int outFd_i,
+		const unsigned threads_i = 0,
+		const size_t chunkSize_i = 64 << 20
+	);
+
+	/** Convert every line read from @p inFd_i, holding an epoch timestamp,
+	 * to the local time of day in @p tz_i and write one line per input
+	 * line to @p outFd_i, like processBatch().
+	 * @param inFd_i File descriptor to read timestamps from.
+	 * @param outFd_i File descriptor to write local times to.
+	 * @param tz_i Time zone to convert to.
+	 * @returns The number of lines processed.
+	 * @throws std::system_error when reading or writing fails. */
+	size_t processEpochs(const int inFd_i, const int outFd_i, const TimeZone & tz_i);
+
+} // SdH namespace
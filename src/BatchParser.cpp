@@ -0,0 +1,455 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "BatchParser.h"
+
+namespace {
+
+	/** Kinds of bytes that get a classification mask. */
+	enum MaskIndex { newlineIdx, colonIdx, spaceIdx, digitIdx, maskCount };
+
+	/** Number of bytes classified in one round. */
+	constexpr size_t windowSize = 4096;
+
+	/** Number of 64-bit words per mask, including the slack needed to
+	 * classify the record that crosses the end of a window and to read one
+	 * word past any record. */
+	constexpr size_t stride = windowSize / 64 + 2;
+
+	/** Number of records whose ranges are validated together. */
+	constexpr unsigned laneCount = 16;
+
+	void classifyScalar(const char * block_i, uint64_t * masks_o, const size_t word_i)
+	{
+		uint64_t nl = 0, co = 0, sp = 0, dg = 0;
+
+		for (unsigned i = 0; i < 64; i++) {
+			const uint64_t bit = static_cast<uint64_t>(1) << i;
+			const char c = block_i[i];
+
+			nl |= c == '\n' ? bit : 0;
+			co |= c == ':' ? bit : 0;
+			sp |= c == ' ' ? bit : 0;
+			dg |= c >= '0' && c <= '9' ? bit : 0;
+		}
+
+		masks_o[newlineIdx * stride + word_i] = nl;
+		masks_o[colonIdx * stride + word_i] = co;
+		masks_o[spaceIdx * stride + word_i] = sp;
+		masks_o[digitIdx * stride + word_i] = dg;
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	__attribute__((target("sse2")))
+	void classifySse2(const char * block_i, uint64_t * masks_o, const size_t word_i)
+	{
+		const __m128i nlv = _mm_set1_epi8('\n');
+		const __m128i cov = _mm_set1_epi8(':');
+		const __m128i spv = _mm_set1_epi8(' ');
+		const __m128i lov = _mm_set1_epi8('0' - 1);
+		const __m128i hiv = _mm_set1_epi8('9' + 1);
+		uint64_t nl = 0, co = 0, sp = 0, dg = 0;
+
+		for (unsigned i = 0; i < 4; i++) {
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block_i + 16 * i));
+			const unsigned shift = 16 * i;
+
+			nl |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nlv)))) << shift;
+			co |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, cov)))) << shift;
+			sp |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, spv)))) << shift;
+			dg |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_and_si128(
+				_mm_cmpgt_epi8(v, lov), _mm_cmplt_epi8(v, hiv)
+			)))) << shift;
+		}
+
+		masks_o[newlineIdx * stride + word_i] = nl;
+		masks_o[colonIdx * stride + word_i] = co;
+		masks_o[spaceIdx * stride + word_i] = sp;
+		masks_o[digitIdx * stride + word_i] = dg;
+	}
+
+	__attribute__((target("avx2")))
+	void classifyAvx2(const char * block_i, uint64_t * masks_o, const size_t word_i)
+	{
+		const __m256i nlv = _mm256_set1_epi8('\n');
+		const __m256i cov = _mm256_set1_epi8(':');
+		const __m256i spv = _mm256_set1_epi8(' ');
+		const __m256i lov = _mm256_set1_epi8('0' - 1);
+		const __m256i hiv = _mm256_set1_epi8('9' + 1);
+		uint64_t nl = 0, co = 0, sp = 0, dg = 0;
+
+		for (unsigned i = 0; i < 2; i++) {
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block_i + 32 * i));
+			const unsigned shift = 32 * i;
+
+			nl |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nlv)))) << shift;
+			co |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, cov)))) << shift;
+			sp |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, spv)))) << shift;
+			dg |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(
+				_mm256_cmpgt_epi8(v, lov), _mm256_cmpgt_epi8(hiv, v)
+			)))) << shift;
+		}
+
+		masks_o[newlineIdx * stride + word_i] = nl;
+		masks_o[colonIdx * stride + word_i] = co;
+		masks_o[spaceIdx * stride + word_i] = sp;
+		masks_o[digitIdx * stride + word_i] = dg;
+	}
+#endif
+
+	/** Classify 64 bytes with the given instruction set. */
+	inline void classify(
+		const SdH::BatchParser::Isa isa_i,
+		const char * block_i,
+		uint64_t * masks_o,
+		const size_t word_i
+	)
+	{
+		switch (isa_i) {
+#if defined(__x86_64__) || defined(__i386__)
+			case SdH::BatchParser::Isa::avx2:
+				classifyAvx2(block_i, masks_o, word_i);
+				break;
+
+			case SdH::BatchParser::Isa::sse2:
+				classifySse2(block_i, masks_o, word_i);
+				break;
+#endif
+
+			default:
+				classifyScalar(block_i, masks_o, word_i);
+		}
+	}
+
+	/** Get 16 bits of a mask starting at bit @p pos_i. */
+	inline uint32_t window(const uint64_t * mask_i, const size_t pos_i)
+	{
+		const size_t word = pos_i >> 6;
+		const unsigned bit = pos_i & 63;
+		uint64_t rv = mask_i[word] >> bit;
+
+		if (bit > 48) rv |= mask_i[word + 1] << (64 - bit);
+		return rv & 0xffff;
+	}
+
+	/** Decode a field of at most two digits that are known to be digits.
+	 * @returns False when the field is too long. */
+	inline bool field(const char * str_i, const unsigned len_i, uint8_t & value_o)
+	{
+		switch (len_i) {
+			case 0: value_o = 0; return true;
+			case 1: value_o = str_i[0] - '0'; return true;
+			case 2: value_o = (str_i[0] - '0') * 10 + (str_i[1] - '0'); return true;
+			default: return false;
+		}
+	}
+
+	/** Decode a time token between offsets @p begin_i and @p end_i of a
+	 * record, given the colon bits of the record.
+	 * @returns False when the token needs the scalar parser. */
+	inline bool token(
+		const char * rec_i,
+		const unsigned begin_i,
+		const unsigned end_i,
+		const uint32_t colons_i,
+		uint8_t & hours_o,
+		uint8_t & minutes_o
+	)
+	{
+		const uint32_t c = colons_i & ((1u << end_i) - 1) & ~((1u << begin_i) - 1);
+		unsigned pos = 0;
+
+		if (c == 0) {
+			hours_o = 0;
+			return field(rec_i + begin_i, end_i - begin_i, minutes_o);
+		}
+
+		if (c & (c - 1)) return false; // More than one colon
+		pos = __builtin_ctz(c);
+		return
+			field(rec_i + begin_i, pos - begin_i, hours_o) &&
+			field(rec_i + pos + 1, end_i - pos - 1, minutes_o);
+	}
+
+	/** Records decoded by the fast path, waiting for range validation. */
+	struct Lanes {
+		alignas(16) uint8_t refHours[laneCount];
+		alignas(16) uint8_t refMinutes[laneCount];
+		alignas(16) uint8_t durHours[laneCount];
+		alignas(16) uint8_t durMinutes[laneCount];
+		SdH::BatchParser::Record * recs[laneCount];
+		unsigned count;
+	};
+
+	/** Validate the ranges of all pending lanes and store the values of
+	 * valid records. Invalid ones are reparsed to get the proper error. */
+	void flush(Lanes & lanes_io)
+	{
+		uint32_t bad = 0;
+
+#if defined(__SSE2__)
+		const __m128i maxhrs = _mm_set1_epi8(23);
+		const __m128i maxmin = _mm_set1_epi8(59);
+
+		// All values are at most 99, so signed compares are fine
+		bad = _mm_movemask_epi8(_mm_or_si128(
+			_mm_or_si128(
+				_mm_cmpgt_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(lanes_io.refHours)), maxhrs),
+				_mm_cmpgt_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(lanes_io.refMinutes)), maxmin)
+			),
+			_mm_or_si128(
+				_mm_cmpgt_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(lanes_io.durHours)), maxhrs),
+				_mm_cmpgt_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(lanes_io.durMinutes)), maxmin)
+			)
+		));
+#else
+		for (unsigned i = 0; i < laneCount; i++) {
+			bad |= (
+				lanes_io.refHours[i] > 23 || lanes_io.refMinutes[i] > 59 ||
+				lanes_io.durHours[i] > 23 || lanes_io.durMinutes[i] > 59
+			) ? 1u << i : 0;
+		}
+#endif
+
+		for (unsigned i = 0; i < lanes_io.count; i++) {
+			SdH::BatchParser::Record & rec = *lanes_io.recs[i];
+
+			if (bad & (1u << i)) {
+				SdH::BatchParser::parseLine(rec.first, rec.last, rec);
+				continue;
+			}
+			rec.reference = SdH::HoursMinutes(lanes_io.refHours[i], lanes_io.refMinutes[i]);
+			rec.duration = SdH::HoursMinutes(lanes_io.durHours[i], lanes_io.durMinutes[i]);
+			rec.result = {rec.last, std::errc()};
+		}
+
+		lanes_io.count = 0;
+	}
+
+	/** Find the first newline at or after bit @p pos_i.
+	 * @returns Bit position, or @p words_i * 64 when there is none. */
+	inline size_t nextNewline(const uint64_t * masks_i, const size_t pos_i, const size_t words_i)
+	{
+		const uint64_t *nl = masks_i + newlineIdx * stride;
+		size_t word = pos_i >> 6;
+		uint64_t m = 0;
+
+		if (word >= words_i) return words_i * 64;
+		m = nl[word] & (~static_cast<uint64_t>(0) << (pos_i & 63));
+		while (m == 0 && ++word < words_i) m = nl[word];
+		return m == 0 ? words_i * 64 : word * 64 + __builtin_ctzll(m);
+	}
+
+	/** Decode a record of the current window into the lanes.
+	 * @returns False when the record needs the scalar parser. */
+	bool decode(
+		const char * base_i,
+		const uint64_t * masks_i,
+		const size_t begin_i,
+		const size_t end_i,
+		SdH::BatchParser::Record & rec_io,
+		Lanes & lanes_io
+	)
+	{
+		const char *rec = base_i + begin_i;
+		const size_t len = end_i - begin_i;
+		uint32_t valid = 0, colons = 0, spaces = 0, digits = 0;
+		const unsigned lane = lanes_io.count;
+		unsigned start = 0;
+
+		if (len == 0 || len > 16) return false;
+
+		valid = (1u << len) - 1;
+		colons = window(masks_i + colonIdx * stride, begin_i) & valid;
+		spaces = window(masks_i + spaceIdx * stride, begin_i) & valid;
+		digits = window(masks_i + digitIdx * stride, begin_i) & valid;
+
+		if (rec[0] == '+') {
+			if (spaces != 0) return false;
+			start = 1;
+		}
+
+		if ((colons | spaces | digits) != (valid & ~((1u << start) - 1))) return false;
+		if (spaces & (spaces - 1)) return false; // More than one space
+
+		if (spaces != 0) {
+			const unsigned pos = __builtin_ctz(spaces);
+
+			if (
+				!token(rec, 0, pos, colons, lanes_io.refHours[lane], lanes_io.refMinutes[lane]) ||
+				!token(rec, pos + 1, len, colons, lanes_io.durHours[lane], lanes_io.durMinutes[lane])
+			) {
+				return false;
+			}
+			rec_io.kind = SdH::BatchParser::Kind::full;
+		} else {
+			if (!token(rec, start, len, colons, lanes_io.durHours[lane], lanes_io.durMinutes[lane])) {
+				return false;
+			}
+			lanes_io.refHours[lane] = 0;
+			lanes_io.refMinutes[lane] = 0;
+			rec_io.kind = start ? SdH::BatchParser::Kind::chained : SdH::BatchParser::Kind::now;
+		}
+
+		lanes_io.recs[lane] = &rec_io;
+		lanes_io.count++;
+		return true;
+	}
+
+} // anonymous namespace
+
+namespace SdH {
+
+	BatchParser::BatchParser(const Isa isa_i):
+		isa_a(isa_i)
+	{
+		const Isa best = bestIsa();
+
+		if (static_cast<uint8_t>(isa_a) > static_cast<uint8_t>(best)) isa_a = best;
+	}
+
+	BatchParser::Isa BatchParser::bestIsa() noexcept
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) return Isa::avx2;
+		if (__builtin_cpu_supports("sse2")) return Isa::sse2;
+#endif
+		return Isa::scalar;
+	}
+
+	void BatchParser::parseLine(
+		const char * first_i,
+		const char * last_i,
+		Record & rec_o
+	) noexcept
+	{
+		const char *space = first_i; // Position of the first space
+
+		while (space != last_i && *space != ' ') space++;
+
+		rec_o.first = first_i;
+		rec_o.last = last_i;
+		rec_o.reference.reset();
+
+		if (space == last_i) {
+			if (first_i != last_i && *first_i == '+') {
+				rec_o.kind = Kind::chained;
+				rec_o.result = HoursMinutes::fromChars(first_i + 1, last_i, rec_o.duration);
+			} else {
+				rec_o.kind = Kind::now;
+				rec_o.result = HoursMinutes::fromChars(first_i, last_i, rec_o.duration);
+			}
+		} else {
+			rec_o.kind = Kind::full;
+			rec_o.result = HoursMinutes::fromChars(first_i, space, rec_o.reference);
+			if (rec_o.result.ec == std::errc()) {
+				rec_o.result = HoursMinutes::fromChars(space + 1, last_i, rec_o.duration);
+			}
+		}
+	}
+
+	const char * BatchParser::parse(
+		const char * first_i,
+		const char * last_i,
+		Record * recs_o,
+		const size_t max_i,
+		size_t & count_o
+	) const noexcept
+	{
+		uint64_t masks[maskCount * stride];
+		char tail[64];
+		Lanes lanes = {};
+		const char *pos = first_i;
+
+		count_o = 0;
+
+		while (pos != last_i && count_o < max_i) {
+			const size_t avail = last_i - pos;
+			const size_t span = avail < windowSize + 64 ? avail : windowSize + 64;
+			const size_t limit = avail < windowSize ? avail : windowSize;
+			const size_t words = (span + 63) / 64;
+			size_t begin = 0, end = 0;
+
+			// Classify the window, padding a partial last block with zeroes
+			for (size_t w = 0; w < words; w++) {
+				if (w * 64 + 64 <= span) {
+					classify(isa_a, pos + w * 64, masks, w);
+				} else {
+					memset(tail, 0, sizeof(tail));
+					memcpy(tail, pos + w * 64, span - w * 64);
+					classify(isa_a, tail, masks, w);
+				}
+			}
+			for (unsigned m = 0; m < maskCount; m++) {
+				memset(masks + m * stride + words, 0, (stride - words) * sizeof(uint64_t));
+			}
+
+			while (begin < limit && count_o < max_i) {
+				end = nextNewline(masks, begin, words);
+				if (end > span) end = span;
+
+				if (end == span && span != avail) {
+					// Record continues beyond the classified bytes
+					if (begin > 0) break;
+
+					// A single huge record, which never fits the fast path
+					const char *nl = static_cast<const char *>(memchr(pos, '\n', avail));
+					end = nl == nullptr ? avail : nl - pos;
+					parseLine(pos, pos + end, recs_o[count_o++]);
+					begin = end + 1;
+					break;
+				}
+
+				Record & rec = recs_o[count_o++];
+				rec.first = pos + begin;
+				rec.last = pos + end;
+				if (!decode(pos, masks, begin, end, rec, lanes)) {
+					parseLine(rec.first, rec.last, rec);
+				} else if (lanes.count == laneCount) {
+					flush(lanes);
+				}
+				begin = end + 1;
+			}
+
+			pos += begin < avail ? begin : avail;
+		}
+
+		if (lanes.count > 0) flush(lanes);
+		return pos;
+	}
+
+} // SdH namespace
@@ -0,0 +1,134 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "HoursMinutes.h"
+
+namespace SdH {
+
+	/** Parses blocks of newline separated records in the grammar of the
+	 * interactive mode: "[HH:]MM", "+[HH:]MM" or "[HH:]MM [HH:]MM".
+	 *
+	 * Each block of 64 input bytes is classified into bitmasks for
+	 * newlines, colons, spaces and digits with vector instructions. Records
+	 * are then split and decoded with bit operations on those masks and
+	 * their ranges are validated 16 records at a time with vector compares.
+	 * Any record that does not have an obviously valid shape is handed to
+	 * parseLine(), so the accepted grammar and the reported errors are
+	 * exactly those of HoursMinutes::fromChars(). */
+	class BatchParser
+	{
+		public:
+			/** Instruction set used to classify input bytes. */
+			enum class Isa : uint8_t {
+				scalar, ///< Portable C++
+				sse2,   ///< 16 bytes per instruction
+				avx2    ///< 32 bytes per instruction
+			};
+
+			/** What a record asks for. */
+			enum class Kind : uint8_t {
+				now,     ///< Add the duration to the current time
+				chained, ///< Add the duration to the previous answer
+				full     ///< Add the duration to the given reference
+			};
+
+			/** A single parsed record. */
+			struct Record {
+				/** First character of the line. */
+				const char * first;
+
+				/** One past the last character, excluding the newline. */
+				const char * last;
+
+				/** Parse result, as with HoursMinutes::fromChars(). */
+				HoursMinutes::ParseResult result;
+
+				/** Reference time, only set for Kind::full. */
+				HoursMinutes reference;
+
+				/** Duration to add. */
+				HoursMinutes duration;
+
+				/** What to add the duration to. */
+				Kind kind;
+			};
+
+		protected:
+			/** Instruction set in use. */
+			Isa isa_a;
+
+		public:
+			/** Constructor.
+			 * @param isa_i Instruction set to use. Falls back to the best
+			 * supported one when the CPU lacks @p isa_i. */
+			BatchParser(const Isa isa_i = bestIsa());
+
+			/** Get the best instruction set supported by this CPU. */
+			static Isa bestIsa() noexcept;
+
+			/** Get the instruction set in use. */
+			inline Isa isa() const { return isa_a; }
+
+			/** Parse a single line in the scalar way.
+			 * @param first_i First character of the line.
+			 * @param last_i One past the last character, excluding newline.
+			 * @param rec_o Receives the parsed record. */
+			static void parseLine(
+				const char * first_i,
+				const char * last_i,
+				Record & rec_o
+			) noexcept;
+
+			/** Parse records from a block of lines. Every newline ends a
+			 * record and trailing characters without a newline form the
+			 * last record.
+			 * @param first_i First character of the block.
+			 * @param last_i One past the last character of the block.
+			 * @param recs_o Array receiving parsed records.
+			 * @param max_i Capacity of @p recs_o.
+			 * @param count_o Receives the number of parsed records.
+			 * @returns Position after the last consumed record, which is
+			 * @p last_i once the whole block is parsed. */
+			const char * parse(
+				const char * first_i,
+				const char * last_i,
+				Record * recs_o,
+				const size_t max_i,
+				size_t & count_o
+			) const noexcept;
+	};
+
+} // SdH namespace
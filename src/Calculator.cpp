@@ -0,0 +1,82 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <sstream>
+#include <stdexcept>
+#include "Calculator.h"
+
+namespace SdH {
+
+	HoursMinutes::ParseResult Calculator::evaluate(const std::string_view & line_i)
+	{
+		BatchParser::Record rec;
+
+		BatchParser::parseLine(line_i.data(), line_i.data() + line_i.size(), rec);
+		if (rec.result.ec == std::errc()) apply(rec);
+		return rec.result;
+	}
+
+	void Calculator::apply(const BatchParser::Record & rec_i)
+	{
+		switch (rec_i.kind) {
+			case BatchParser::Kind::now:
+				reference_a = HoursMinutes::now();
+				break;
+
+			case BatchParser::Kind::chained:
+				reference_a = result_a;
+				break;
+
+			case BatchParser::Kind::full:
+				reference_a = rec_i.reference;
+				break;
+		}
+
+		duration_a = rec_i.duration;
+		result_a = reference_a + duration_a;
+	}
+
+	void Calculator::process(const std::string_view & line_i)
+	{
+		const HoursMinutes::ParseResult res = evaluate(line_i);
+
+		if (res.ec == std::errc()) return;
+
+		std::ostringstream oss;
+		HoursMinutes::printError(oss, res, line_i.data() + line_i.size());
+		if (res.ec == std::errc::result_out_of_range) {
+			throw std::overflow_error(oss.str());
+		}
+		throw std::invalid_argument(oss.str());
+	}
+
+} // SdH namespace
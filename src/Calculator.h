@@ -0,0 +1,94 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <string_view>
+#include "BatchParser.h"
+#include "HoursMinutes.h"
+
+namespace SdH {
+
+	/** Evaluates lines in the grammar of the interactive mode. A line holds
+	 * either a reference time and a duration separated by a single space,
+	 * or only a duration. A lone duration is added to the current time, or
+	 * to the previous answer when it is prefixed with a plus sign (+). */
+	class Calculator
+	{
+		protected:
+			/** Reference time of the last successful calculation. */
+			HoursMinutes reference_a;
+
+			/** Duration of the last successful calculation. */
+			HoursMinutes duration_a;
+
+			/** Previous answer, used as reference for a '+' line. */
+			HoursMinutes result_a;
+
+		public:
+			/** Empty constructor starts with a previous answer of 00:00 */
+			Calculator() = default;
+
+			/** Constructor that continues after an earlier answer, which is
+			 * used as reference for a '+' line. */
+			explicit Calculator(const HoursMinutes & result_i) : result_a(result_i) {}
+
+			/** Evaluate a single line without throwing or allocating on
+			 * malformed input. On failure the previous answer is left
+			 * untouched.
+			 * @param line_i Line to evaluate, without trailing newline.
+			 * @returns The parse result. On failure its ptr points into
+			 * @p line_i, for use with HoursMinutes::printError(). */
+			HoursMinutes::ParseResult evaluate(const std::string_view & line_i);
+
+			/** Calculate the result of a successfully parsed record.
+			 * @param rec_i Record parsed by BatchParser without errors. */
+			void apply(const BatchParser::Record & rec_i);
+
+			/** Evaluate a single line. On failure the previous answer is
+			 * left untouched.
+			 * @param line_i Line to evaluate, without trailing newline.
+			 * @throws std::invalid_argument when a time can't be parsed.
+			 * @throws std::overflow_error when a time is out of range. */
+			void process(const std::string_view & line_i);
+
+			/** Get the reference time of the last calculation. */
+			inline const HoursMinutes & reference() const { return reference_a; }
+
+			/** Get the duration of the last calculation. */
+			inline const HoursMinutes & duration() const { return duration_a; }
+
+			/** Get the result of the last calculation. */
+			inline const HoursMinutes & result() const { return result_a; }
+	};
+
+} // SdH namespace
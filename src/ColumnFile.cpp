@@ -0,0 +1,241 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include "ColumnFile.h"
+#include "MappedFile.h"
+
+namespace {
+
+	/** Identifies a column file. */
+	constexpr char magic[4] = {'T', 'C', 'A', 'L'};
+
+	/** Fletcher-64 sums can take this many words before reducing them. */
+	constexpr size_t wordsPerReduction = 65536;
+
+	/** Modulus of the Fletcher-64 sums. */
+	constexpr uint64_t modulus = 0xFFFFFFFF;
+
+	static_assert(sizeof(SdH::ColumnFile::Header) == 32, "The header is part of the file format");
+
+	/** Column files are little-endian, so values are used as they are. */
+	constexpr bool littleEndian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+	/** Get the highest value of a column. */
+	template <typename T>
+	T highest(const T * values_i, const size_t count_i) noexcept
+	{
+		T retval = 0;
+
+		for (size_t i = 0; i < count_i; i++) retval = std::max(retval, values_i[i]);
+		return retval;
+	}
+
+	/** Write all bytes of a buffer.
+	 * @throws std::system_error when writing fails. */
+	void writeAll(const int fd_i, const void * data_i, const size_t size_i)
+	{
+		const char *pos = static_cast<const char *>(data_i);
+		size_t done = 0;
+
+		while (done < size_i) {
+			const ssize_t written = write(fd_i, pos + done, size_i - done);
+
+			if (written < 0) {
+				if (errno == EINTR) continue;
+				throw std::system_error(errno, std::generic_category(), "Unable to write output");
+			}
+			done += written;
+		}
+	}
+
+	/** Write a column followed by its padding.
+	 * @throws std::system_error when writing fails. */
+	void writeColumn(const int fd_i, const void * data_i, const size_t size_i)
+	{
+		static const char zeroes[SdH::ColumnFile::alignment] = {};
+
+		writeAll(fd_i, data_i, size_i);
+		writeAll(fd_i, zeroes, SdH::ColumnFile::columnSize(size_i, 1) - size_i);
+	}
+
+} // anonymous namespace
+
+namespace SdH {
+
+	ColumnFile::ColumnFile(const int fd_i):
+		header_a(),
+		references_a(nullptr),
+		durations_a(nullptr),
+		results_a(nullptr),
+		carries_a(nullptr)
+	{
+		if (!littleEndian) throw std::invalid_argument("Column files can only be read on little-endian processors");
+
+		if (MappedFile::mappable(fd_i)) {
+			file_a.reset(new MappedFile(fd_i));
+			open(file_a->data(), file_a->size());
+			return;
+		}
+
+		// Read what can't be mapped, the vector keeps the columns aligned
+		ssize_t got = 0;
+		size_t used = 0;
+
+		buffer_a.resize(1 << 16);
+		for (;;) {
+			if (used == buffer_a.size()) buffer_a.resize(used * 2);
+			got = read(fd_i, buffer_a.data() + used, buffer_a.size() - used);
+			if (got < 0) {
+				if (errno == EINTR) continue;
+				throw std::system_error(errno, std::generic_category(), "Unable to read input");
+			}
+			if (got == 0) break;
+			used += got;
+		}
+		open(buffer_a.data(), used);
+	}
+
+	ColumnFile::~ColumnFile()
+	{ }
+
+	void ColumnFile::open(const char * data_i, const size_t size_i)
+	{
+		if (size_i < sizeof(Header)) throw std::invalid_argument("Not a column file, it is too short");
+		memcpy(&header_a, data_i, sizeof(Header));
+		if (memcmp(header_a.magic, magic, sizeof(magic))) throw std::invalid_argument("Not a column file");
+		if (header_a.version != currentVersion) {
+			throw std::invalid_argument("Unsupported column file version " + std::to_string(header_a.version));
+		}
+		if ((header_a.flags & ~withCarries) != 0 || header_a.reserved != 0) {
+			throw std::invalid_argument("Column file has unknown flags");
+		}
+
+		// The count must fit before the sizes can be computed
+		const size_t count = header_a.count;
+		const bool carries = (header_a.flags & withCarries) != 0;
+
+		if (count > size_i / 6) throw std::invalid_argument("Column file is truncated");
+
+		const size_t wide = columnSize(count, sizeof(uint16_t));
+		const size_t size = sizeof(Header) + 3 * wide + (carries ? columnSize(count, sizeof(uint8_t)) : 0);
+
+		if (size_i != size) {
+			throw std::invalid_argument(
+				"Column file has " + std::to_string(size_i) + " bytes instead of " + std::to_string(size)
+			);
+		}
+		if (checksum(data_i + sizeof(Header), size_i - sizeof(Header)) != header_a.checksum) {
+			throw std::invalid_argument("Column file fails its checksum");
+		}
+
+		references_a = reinterpret_cast<const uint16_t *>(data_i + sizeof(Header));
+		durations_a = reinterpret_cast<const uint16_t *>(data_i + sizeof(Header) + wide);
+		results_a = reinterpret_cast<const uint16_t *>(data_i + sizeof(Header) + 2 * wide);
+		if (carries) carries_a = reinterpret_cast<const uint8_t *>(data_i + sizeof(Header) + 3 * wide);
+
+		// Kernels like HoursMinutesArray::next() rely on valid times
+		if (
+			highest(references_a, count) >= 1440 || highest(durations_a, count) >= 1440 ||
+			highest(results_a, count) >= 1440 || (carries && highest(carries_a, count) > 1)
+		) {
+			throw std::invalid_argument("Column file holds times of 24:00 or more");
+		}
+	}
+
+	uint64_t ColumnFile::checksum(const void * data_i, const size_t size_i, const uint64_t previous_i) noexcept
+	{
+		const char *pos = static_cast<const char *>(data_i);
+		const size_t words = size_i / 4;
+		uint64_t a = previous_i & modulus, b = previous_i >> 32;
+		uint32_t word = 0;
+
+		for (size_t done = 0; done < words;) {
+			const size_t last = std::min(words, done + wordsPerReduction);
+
+			for (; done < last; done++) {
+				memcpy(&word, pos + 4 * done, sizeof(word));
+				a += word;
+				b += a;
+			}
+			a %= modulus;
+			b %= modulus;
+		}
+
+		// Trailing bytes and the padding, which holds zero words
+		const size_t padded = columnSize(size_i, 1) / 4;
+
+		if (words < padded) {
+			word = 0;
+			memcpy(&word, pos + 4 * words, size_i - 4 * words);
+			a = (a + word) % modulus;
+			b = (b + a + (padded - words - 1) * a) % modulus;
+		}
+
+		return b << 32 | a;
+	}
+
+	void ColumnFile::write(
+		const int fd_i,
+		const uint16_t * references_i,
+		const uint16_t * durations_i,
+		const uint16_t * results_i,
+		const uint8_t * carries_i,
+		const size_t count_i
+	) {
+		Header header = {};
+
+		if (!littleEndian) throw std::invalid_argument("Column files can only be written on little-endian processors");
+
+		memcpy(header.magic, magic, sizeof(magic));
+		header.version = currentVersion;
+		header.flags = carries_i != nullptr ? withCarries : 0;
+		header.count = count_i;
+		header.checksum = checksum(references_i, count_i * sizeof(uint16_t));
+		header.checksum = checksum(durations_i, count_i * sizeof(uint16_t), header.checksum);
+		header.checksum = checksum(results_i, count_i * sizeof(uint16_t), header.checksum);
+		if (carries_i != nullptr) header.checksum = checksum(carries_i, count_i, header.checksum);
+
+		writeAll(fd_i, &header, sizeof(header));
+		writeColumn(fd_i, references_i, count_i * sizeof(uint16_t));
+		writeColumn(fd_i, durations_i, count_i * sizeof(uint16_t));
+		writeColumn(fd_i, results_i, count_i * sizeof(uint16_t));
+		if (carries_i != nullptr) writeColumn(fd_i, carries_i, count_i);
+	}
+
+} // SdH namespace
@@ -0,0 +1,187 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace SdH {
+
+	class MappedFile;
+
+	/** Versioned binary file with the reference times, durations and
+	 * results of evaluated lines, so other programs can use them without
+	 * parsing or formatting text. All numbers are little-endian.
+	 *
+	 * The file starts with a Header, followed by a column per field that
+	 * holds a uint16_t per record: the reference times, the durations and
+	 * the results, all in minutes since midnight. With the withCarries
+	 * flag, a last column holds a uint8_t per record with the number of
+	 * midnights passed by adding the duration, 0 or 1. Every column is
+	 * padded with zero bytes to a multiple of alignment bytes, so all of
+	 * them are aligned for vector instructions.
+	 *
+	 * Reading maps the file into memory where possible and hands out
+	 * pointers into the mapping, so the columns can be used in place, for
+	 * example with HoursMinutesArray. */
+	class ColumnFile
+	{
+		public:
+			/** Fixed size start of the file. */
+			struct Header {
+				/** Identifies the file, always "TCAL". */
+				char magic[4];
+
+				/** Version of the format, currently 1. */
+				uint16_t version;
+
+				/** Combination of flags like withCarries. */
+				uint16_t flags;
+
+				/** Number of records. */
+				uint64_t count;
+
+				/** Fletcher-64 checksum of the 32 bit words of all
+				 * columns, including their padding. */
+				uint64_t checksum;
+
+				/** Always zero in this version. */
+				uint64_t reserved;
+			};
+
+			/** Version written by write(). */
+			static constexpr uint16_t currentVersion = 1;
+
+			/** Flag for a column with the midnights passed per record. */
+			static constexpr uint16_t withCarries = 1;
+
+			/** Columns are padded to a multiple of this number of bytes. */
+			static constexpr size_t alignment = 16;
+
+		protected:
+			/** Mapped file, when it could be mapped. */
+			std::unique_ptr<MappedFile> file_a;
+
+			/** Contents of a file that couldn't be mapped, like a pipe. */
+			std::vector<char> buffer_a;
+
+			/** Header of the file. */
+			Header header_a;
+
+			/** Reference times. */
+			const uint16_t * references_a;
+
+			/** Durations. */
+			const uint16_t * durations_a;
+
+			/** Results. */
+			const uint16_t * results_a;
+
+			/** Midnights passed, nullptr without that column. */
+			const uint8_t * carries_a;
+
+			/** Check the header and the columns and set the pointers.
+			 * @throws std::invalid_argument when they are not valid. */
+			void open(const char * data_i, const size_t size_i);
+
+		public:
+			/** Constructor reads a column file. Regular files are mapped
+			 * into memory, other files are read into a buffer.
+			 * @param fd_i File descriptor to read from. Ownership is not
+			 * transferred and it may be closed after construction.
+			 * @throws std::invalid_argument when the file is not a column
+			 * file, of another version, truncated, fails its checksum or
+			 * holds times of 24:00 or more.
+			 * @throws std::system_error when reading fails. */
+			explicit ColumnFile(const int fd_i);
+
+			/** Destructor unmaps the file. */
+			~ColumnFile();
+
+			/** Copying would unmap the file twice, so don't. */
+			ColumnFile(const ColumnFile &) = delete;
+			ColumnFile & operator=(const ColumnFile &) = delete;
+
+			/** Get the size of a column in bytes, including its padding.
+			 * @param count_i Number of records.
+			 * @param width_i Size of a single value in bytes. */
+			static constexpr size_t columnSize(const size_t count_i, const size_t width_i) noexcept {
+				return (count_i * width_i + alignment - 1) / alignment * alignment;
+			}
+
+			/** Continue a Fletcher-64 checksum over the 32 bit words of a
+			 * column, as if it were padded with zero bytes to a multiple of
+			 * alignment bytes.
+			 * @param data_i First byte of the column.
+			 * @param size_i Size of the column in bytes, without padding.
+			 * @param previous_i Checksum of the columns before it. */
+			static uint64_t checksum(const void * data_i, const size_t size_i, const uint64_t previous_i = 0) noexcept;
+
+			/** Write a column file.
+			 * @param fd_i File descriptor to write to.
+			 * @param references_i Reference times in minutes since midnight.
+			 * @param durations_i Durations in minutes.
+			 * @param results_i Results in minutes since midnight.
+			 * @param carries_i Midnights passed per record, or nullptr to
+			 * leave that column out.
+			 * @param count_i Number of records.
+			 * @throws std::system_error when writing fails. */
+			static void write(
+				const int fd_i,
+				const uint16_t * references_i,
+				const uint16_t * durations_i,
+				const uint16_t * results_i,
+				const uint8_t * carries_i,
+				const size_t count_i
+			);
+
+			/** Get the number of records. */
+			inline size_t size() const { return header_a.count; }
+
+			/** Get the reference times in minutes since midnight. */
+			inline const uint16_t * references() const { return references_a; }
+
+			/** Get the durations in minutes. */
+			inline const uint16_t * durations() const { return durations_a; }
+
+			/** Get the results in minutes since midnight. */
+			inline const uint16_t * results() const { return results_a; }
+
+			/** Get the midnights passed per record, nullptr when the file
+			 * lacks that column. */
+			inline const uint8_t * carries() const { return carries_a; }
+	};
+
+} // SdH namespace
@@ -0,0 +1,340 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <system_error>
+#include <unistd.h>
+#include "BatchParser.h"
+#include "Calculator.h"
+#include "Follow.h"
+#include "MappedFile.h"
+#include "Stats.h"
+
+namespace {
+
+	/** Number of bytes compared with a single memcmp(3) call. */
+	constexpr size_t blockSize = 1024;
+
+	/** Get the number of equal bytes at the start of two buffers. */
+	size_t commonPrefix(const char * a_i, const char * b_i, const size_t size_i) noexcept
+	{
+		size_t retval = 0;
+
+		while (size_i - retval >= blockSize && !memcmp(a_i + retval, b_i + retval, blockSize)) retval += blockSize;
+		while (retval < size_i && a_i[retval] == b_i[retval]) retval++;
+		return retval;
+	}
+
+	/** Get the number of equal bytes at the end of two buffers.
+	 * @param a_i One past the last byte of the first buffer.
+	 * @param b_i One past the last byte of the second buffer.
+	 * @param size_i Maximum number of bytes to compare. */
+	size_t commonSuffix(const char * a_i, const char * b_i, const size_t size_i) noexcept
+	{
+		size_t retval = 0;
+
+		while (size_i - retval >= blockSize && !memcmp(a_i - retval - blockSize, b_i - retval - blockSize, blockSize)) {
+			retval += blockSize;
+		}
+		while (retval < size_i && a_i[-1 - static_cast<ptrdiff_t>(retval)] == b_i[-1 - static_cast<ptrdiff_t>(retval)]) retval++;
+		return retval;
+	}
+
+} // anonymous namespace
+
+namespace SdH {
+
+	Follow::Follow(const std::string & inPath_i, const std::string & outPath_i):
+		inPath_a(inPath_i),
+		outFd_a(-1),
+		notifyFd_a(-1),
+		wakeFd_a(-1)
+	{
+		const size_t slash = inPath_i.rfind('/');
+		const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : inPath_i.substr(0, slash);
+
+		try {
+			outFd_a = open(outPath_i.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+			if (outFd_a < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to open " + outPath_i);
+			}
+
+			notifyFd_a = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (notifyFd_a < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to create inotify instance");
+			}
+			if (inotify_add_watch(notifyFd_a, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to watch " + dir);
+			}
+
+			wakeFd_a = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (wakeFd_a < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to create event file descriptor");
+			}
+		} catch (...) {
+			cleanup();
+			throw;
+		}
+	}
+
+	Follow::~Follow()
+	{
+		cleanup();
+	}
+
+	void Follow::cleanup() noexcept
+	{
+		if (wakeFd_a >= 0) close(wakeFd_a);
+		if (notifyFd_a >= 0) close(notifyFd_a);
+		if (outFd_a >= 0) close(outFd_a);
+		wakeFd_a = notifyFd_a = outFd_a = -1;
+	}
+
+	void Follow::write(const size_t offset_i, const size_t size_i)
+	{
+		size_t done = 0;
+
+		while (done < size_i) {
+			const ssize_t written = pwrite(outFd_a, output_a.data() + offset_i + done, size_i - done, offset_i + done);
+
+			if (written < 0) {
+				if (errno == EINTR) continue;
+				throw std::system_error(errno, std::generic_category(), "Unable to write output");
+			}
+			done += written;
+		}
+	}
+
+	size_t Follow::update()
+	{
+		const int fd = open(inPath_a.c_str(), O_RDONLY | O_CLOEXEC);
+		std::unique_ptr<MappedFile> file;
+
+		if (fd < 0) {
+			if (errno == ENOENT) return 0;
+			throw std::system_error(errno, std::generic_category(), "Unable to open " + inPath_a);
+		}
+		try {
+			file.reset(new MappedFile(fd));
+		} catch (...) {
+			close(fd);
+			throw;
+		}
+		close(fd);
+
+		// Find the bytes that changed and take the new version
+		const size_t oldSize = input_a.size();
+		const size_t newSize = file->size();
+		const size_t head = commonPrefix(input_a.data(), file->data(), std::min(oldSize, newSize));
+
+		if (head == oldSize && head == newSize) return 0;
+
+		const size_t tail = commonSuffix(input_a.data() + oldSize, file->end(), std::min(oldSize, newSize) - head);
+
+		input_a.replace(head, oldSize - tail - head, file->data() + head, newSize - tail - head);
+		file.reset();
+
+		// Lines before the first change stay the same, unless the last one
+		// lacked a newline. Lines after the last change stay the same when
+		// they start a line in both versions.
+		const auto before = [](const size_t offset_i, const Line & line_i) { return offset_i < line_i.inEnd; };
+		const size_t oldCount = lines_a.size();
+		const size_t moved = newSize - oldSize;
+		size_t first = std::upper_bound(lines_a.begin(), lines_a.end(), head, before) - lines_a.begin();
+		size_t oldLast = std::upper_bound(lines_a.begin() + first, lines_a.end(), oldSize - tail, before) - lines_a.begin();
+
+		if (first == oldCount && first > 0 && input_a[lines_a[first - 1].inEnd - 1] != '\n') first--;
+		if (oldLast < oldCount) {
+			const size_t start = oldLast == 0 ? 0 : lines_a[oldLast - 1].inEnd;
+
+			if (start != oldSize - tail || (newSize != tail && input_a[newSize - tail - 1] != '\n')) oldLast++;
+		}
+
+		const size_t from = first == 0 ? 0 : lines_a[first - 1].outEnd;
+		const char * const data = input_a.data();
+		const char *pos = data + (first == 0 ? 0 : lines_a[first - 1].inEnd);
+		const char * const last = data + (oldLast == oldCount ? newSize : (oldLast == 0 ? 0 : lines_a[oldLast - 1].inEnd) + moved);
+		Calculator calc(first == 0 ? HoursMinutes() : lines_a[first - 1].answer);
+		BatchParser::Record rec;
+		std::string text;
+		Stats & stats = Stats::instance();
+		const bool timed = stats.enabled();
+		uint64_t ticks[Stats::stageCount + 1] = {0, 0, 0, 0};
+
+		// Parse a line, without its newline
+		const auto parse = [&rec, &ticks, timed](const char * first_i, const char * last_i) {
+			if (timed) ticks[0] = Stats::ticks();
+			BatchParser::parseLine(first_i, last_i != first_i && last_i[-1] == '\n' ? last_i - 1 : last_i, rec);
+			if (timed) ticks[1] = Stats::ticks();
+		};
+
+		// Evaluate a parsed line and append its output
+		const auto evaluate = [this, &calc, &text, &rec, &ticks, &stats, timed, data, from](const char * last_i) {
+			if (rec.first != rec.last && rec.result.ec == std::errc()) {
+				char buf[HoursMinutes::charsLength];
+
+				calc.apply(rec);
+				if (timed) ticks[2] = Stats::ticks();
+				text.append(buf, calc.result().toChars(buf));
+			} else if (rec.first != rec.last) {
+				if (timed) ticks[2] = Stats::ticks();
+				errors_a.str("");
+				HoursMinutes::printError(errors_a, rec.result, rec.last);
+				text += errors_a.str();
+			}
+			text += '\n';
+			changed_a.push_back({static_cast<size_t>(last_i - data), from + text.size(), calc.result()});
+
+			if (timed) {
+				Stats::Counters & counters = stats.local();
+
+				if (rec.first != rec.last) counters.round(ticks);
+				counters.count(rec.first == rec.last, rec.result.ec);
+			}
+		};
+
+		changed_a.clear();
+		while (pos != last) {
+			const char *newline = static_cast<const char *>(memchr(pos, '\n', last - pos));
+			const char *eol = newline == nullptr ? last : newline + 1;
+
+			parse(pos, eol);
+			evaluate(eol);
+			pos = eol;
+		}
+
+		// Lines after the changes only need evaluating while they depend
+		// on a previous answer that changed
+		size_t oldPos = oldLast;
+
+		for (; oldPos < oldCount; oldPos++) {
+			const HoursMinutes answer = oldPos == 0 ? HoursMinutes() : lines_a[oldPos - 1].answer;
+			const char *eol = data + lines_a[oldPos].inEnd + moved;
+
+			if (answer.minutesOfDay() == calc.result().minutesOfDay()) break;
+			parse(pos, eol);
+			if (rec.first != rec.last && rec.result.ec == std::errc() && rec.kind != BatchParser::Kind::chained) break;
+			evaluate(eol);
+			pos = eol;
+		}
+
+		// Replace the output of the evaluated lines and move the rest
+		const size_t to = oldPos == 0 ? 0 : lines_a[oldPos - 1].outEnd;
+		const size_t size = output_a.size();
+
+		output_a.replace(from, to - from, text);
+		if (changed_a.size() > oldPos - first) {
+			lines_a.insert(lines_a.begin() + oldPos, changed_a.size() - (oldPos - first), Line());
+		} else {
+			lines_a.erase(lines_a.begin() + first + changed_a.size(), lines_a.begin() + oldPos);
+		}
+		std::copy(changed_a.begin(), changed_a.end(), lines_a.begin() + first);
+		if (moved != 0 || output_a.size() != size) {
+			for (size_t i = first + changed_a.size(); i < lines_a.size(); i++) {
+				lines_a[i].inEnd += moved;
+				lines_a[i].outEnd += output_a.size() - size;
+			}
+		}
+
+		if (output_a.size() == size) {
+			write(from, text.size());
+		} else {
+			write(from, output_a.size() - from);
+			if (ftruncate(outFd_a, output_a.size()) < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to truncate output");
+			}
+		}
+
+		return changed_a.size();
+	}
+
+	void Follow::run()
+	{
+		const size_t slash = inPath_a.rfind('/');
+		const std::string name = slash == std::string::npos ? inPath_a : inPath_a.substr(slash + 1);
+		alignas(inotify_event) char buf[4096];
+		pollfd fds[2] = {{notifyFd_a, POLLIN, 0}, {wakeFd_a, POLLIN, 0}};
+		uint64_t wakeups = 0;
+
+		update();
+		for (;;) {
+			if (poll(fds, 2, -1) < 0) {
+				if (errno == EINTR) continue;
+				throw std::system_error(errno, std::generic_category(), "Unable to wait for changes");
+			}
+
+			if (fds[1].revents != 0) {
+				// Reset the counter, so a later run() keeps running
+				if (read(wakeFd_a, &wakeups, sizeof(wakeups)) < 0) {
+					// Nothing to reset
+				}
+				return;
+			}
+
+			// Editors often write a new file and rename it, so look at all
+			// files in the directory with the right name
+			bool changed = false;
+			ssize_t got = 0;
+
+			while ((got = read(notifyFd_a, buf, sizeof(buf))) > 0) {
+				for (const char *pos = buf; pos < buf + got;) {
+					const inotify_event *ev = reinterpret_cast<const inotify_event *>(pos);
+
+					if ((ev->mask & IN_Q_OVERFLOW) || (ev->len > 0 && name == ev->name)) changed = true;
+					pos += sizeof(inotify_event) + ev->len;
+				}
+			}
+			if (got < 0 && errno != EAGAIN && errno != EINTR) {
+				throw std::system_error(errno, std::generic_category(), "Unable to read changes");
+			}
+			if (changed) update();
+		}
+	}
+
+	void Follow::stop() noexcept
+	{
+		const uint64_t one = 1;
+
+		if (::write(wakeFd_a, &one, sizeof(one)) < 0) {
+			// The counter is already non-zero, so run() wakes up anyway
+		}
+	}
+
+} // SdH namespace
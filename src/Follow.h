@@ -0,0 +1,145 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "HoursMinutes.h"
+
+namespace SdH {
+
+	/** Keeps an output file with the results of a schedule file up to date
+	 * while the schedule is edited. The output holds one line per input
+	 * line like in batch mode.
+	 *
+	 * Every update compares the schedule with the previous version from
+	 * both ends with memcmp(3), which is several times faster than hashing
+	 * every line. Only the lines between the first and the last changed
+	 * byte are evaluated again, together with the lines with a plus sign
+	 * after them whose previous answer changed. Their output replaces the
+	 * old output in place when it has the same size, otherwise the output
+	 * file is rewritten from the first changed line on. Lines with only a
+	 * duration keep the time at which they were evaluated. */
+	class Follow
+	{
+		protected:
+			/** What is kept of every input line. */
+			struct Line {
+				/** Offset of the end of the line, including the newline. */
+				size_t inEnd;
+
+				/** Offset of the end of its output, including the newline. */
+				size_t outEnd;
+
+				/** Previous answer after evaluating the line. */
+				HoursMinutes answer;
+			};
+
+			/** Path of the schedule file. */
+			std::string inPath_a;
+
+			/** Output file, -1 when not open. */
+			int outFd_a;
+
+			/** Inotify instance, -1 when not open. */
+			int notifyFd_a;
+
+			/** Event file descriptor used to wake up run(), -1 when not open. */
+			int wakeFd_a;
+
+			/** Lines of the last version of the schedule. */
+			std::vector<Line> lines_a;
+
+			/** Contents of the last version of the schedule. */
+			std::string input_a;
+
+			/** Contents of the output file. */
+			std::string output_a;
+
+			/** Evaluated lines of an update, kept to avoid allocations. */
+			std::vector<Line> changed_a;
+
+			/** Formats error messages. */
+			std::ostringstream errors_a;
+
+			/** Close all file descriptors. */
+			void cleanup() noexcept;
+
+			/** Write @p size_i bytes of the output from @p offset_i on.
+			 * @throws std::system_error when writing fails. */
+			void write(const size_t offset_i, const size_t size_i);
+
+		public:
+			/** Constructor opens the output file, which is truncated, and
+			 * starts watching the directory of the schedule file, so that
+			 * files saved under a temporary name and renamed also count.
+			 * @param inPath_i Path of the schedule file.
+			 * @param outPath_i Path of the output file.
+			 * @throws std::system_error when a file can't be opened or
+			 * watched. */
+			Follow(const std::string & inPath_i, const std::string & outPath_i);
+
+			/** Destructor closes the files. */
+			~Follow();
+
+			/** Copying would close the files twice, so don't. */
+			Follow(const Follow &) = delete;
+			Follow & operator=(const Follow &) = delete;
+
+			/** Read the schedule file and update the output file. A missing
+			 * schedule file is left for a later update, as editors may
+			 * replace it.
+			 * @returns The number of lines evaluated.
+			 * @throws std::system_error when reading or writing fails. */
+			size_t update();
+
+			/** Update the output file, then again every time the schedule
+			 * file is written or replaced, until stop() is called.
+			 * @throws std::system_error when waiting for changes, reading or
+			 * writing fails. */
+			void run();
+
+			/** Make run() return. Safe to call from another thread and
+			 * from a signal handler. */
+			void stop() noexcept;
+
+			/** Get the number of lines of the schedule. */
+			inline size_t lines() const { return lines_a.size(); }
+
+			/** Get the contents of the output file. */
+			inline const std::string & output() const { return output_a; }
+	};
+
+} // SdH namespace
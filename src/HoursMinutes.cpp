@@ -32,114 +32,71 @@
 
 #include <cerrno>
 #include <ctime>
-#include <iomanip>
-#include <iostream>
+#include <ostream>
 #include <sstream>
 #include <stdexcept>
 #include "HoursMinutes.h"
+#include "LocalClock.h"
 
 namespace SdH {
 
-	uint8_t HoursMinutes::parseChar(const char char_i)
+	std::ostream & HoursMinutes::printError(
+		std::ostream & os_io,
+		const ParseResult & res_i,
+		const char * last_i
+	)
 	{
-		if (char_i < '0' || char_i > '9') {
-			throw std::invalid_argument(
-				std::string("Invalid character '") + char_i + "' in time string"
-			);
+		const char *end = res_i.ptr; // End of the offending field
+
+		if (res_i.ec == std::errc::result_out_of_range) {
+			while (end != last_i && *end >= '0' && *end <= '9') end++;
+			os_io << "String value \"";
+			os_io.write(res_i.ptr, end - res_i.ptr);
+			os_io << "\" is a valid integer but is larger than ";
+			os_io << (end != last_i && *end == ':' ? 23 : 59);
+		} else if (res_i.ec == std::errc::value_too_large) {
+			os_io << "Integer string longer than two characters";
+		} else {
+			os_io << "Invalid character '" << *res_i.ptr << "' in time string";
 		}
 
-		return char_i - '0';
+		return os_io;
 	}
 
-	uint8_t HoursMinutes::parse(const std::string & str_i, const uint8_t max_i)
+	void HoursMinutes::throwParseError(const std::string_view & hm_i, const ParseResult & res_i)
 	{
-		if (str_i.empty() || str_i == "0" || str_i == "00") return 0;
+		std::ostringstream oss;
 
-		uint8_t rv = 0; // Return Value
-
-		switch (str_i.size()) {
-			case 2:
-				rv = parseChar(str_i[0]) * 10 + parseChar(str_i[1]);
-				break;
-
-			case 1:
-				rv = parseChar(str_i[0]);
-				break;
-
-			default:
-				throw std::invalid_argument("Integer string longer than two characters");
-		}
-
-		if (rv > max_i) {
-			std::ostringstream oss;
-
-			oss << "String value \"" << str_i << "\" is a valid integer but is larger than ";
-			oss << static_cast<uint16_t>(max_i);
+		printError(oss, res_i, hm_i.data() + hm_i.size());
+		if (res_i.ec == std::errc::result_out_of_range) {
 			throw std::overflow_error(oss.str());
 		}
-
-		return rv;
-	}
-
-	void HoursMinutes::set(const std::string & hm_i)
-	{
-		size_t pos = 0;
-		uint8_t tmphrs = 0;
-		uint8_t tmpmin = 0;
-
-		if (hm_i.empty() || hm_i == ":") {
-			reset();
-			return;
-		}
-
-		pos = hm_i.find(':');
-		if (pos == std::string::npos) {
-			// No hours specified, just minutes
-			tmpmin = parse(hm_i, 59);
-			hours_a = 0;
-			minutes_a = tmpmin;
-			return;
-		}
-
-		tmphrs = parse(hm_i.substr(0, pos), 23);
-		tmpmin = parse(hm_i.substr(pos+1), 59);
-		hours_a = tmphrs;
-		minutes_a = tmpmin;
+		throw std::invalid_argument(oss.str());
 	}
 
 	void HoursMinutes::set(const time_t & time_i)
 	{
-		struct tm *tmptr = nullptr;
+		struct tm tmbuf;
 
-		tmptr = localtime(&time_i);
-		if (tmptr == nullptr) {
+		if (localtime_r(&time_i, &tmbuf) == nullptr) {
 			throw std::runtime_error("Unable to break down time to parts");
 		}
 
-		hours_a = tmptr->tm_hour;
-		minutes_a = tmptr->tm_min;
+		hours_a = tmbuf.tm_hour;
+		minutes_a = tmbuf.tm_min;
 	}
 
-	HoursMinutes & HoursMinutes::operator+=(const HoursMinutes & rhs_i)
+	HoursMinutes HoursMinutes::now()
 	{
-		hours_a += rhs_i.hours_a;
-		minutes_a += rhs_i.minutes_a;
-		if (minutes_a > 59) {
-			hours_a++;
-			minutes_a %= 60;
-		}
-
-		if (hours_a > 23) hours_a %= 24;
-
-		return (*this);
+		return LocalClock::instance().now();
 	}
 
 } // SdH namespace
 
 std::ostream & operator<<(std::ostream & os, const SdH::HoursMinutes & hm)
 {
-	os << std::dec << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(hm.hours());
-	os << ':';
-	os << std::dec << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(hm.minutes());
-	return os;
+	char buf[SdH::HoursMinutes::charsLength];
+
+	hm.toChars(buf);
+	return os.write(buf, sizeof(buf));
 }
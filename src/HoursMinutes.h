@@ -32,10 +32,14 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <ctime>
+#include <iosfwd>
 #include <stdexcept>
-#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
 
 #define UNUSED(expr) (void)(expr)
 
@@ -43,6 +47,33 @@ namespace SdH {
 
 	class HoursMinutes
 	{
+		public:
+			/** Outcome of a non-throwing parse, modeled after
+			 * std::from_chars_result. */
+			struct ParseResult {
+				/** One past the parsed input on success. On failure it
+				 * points to the offending position in the input. */
+				const char * ptr;
+
+				/** Default constructed on success,
+				 * std::errc::invalid_argument when the input can't be parsed,
+				 * std::errc::value_too_large when the hours or minutes have
+				 * more than two characters and std::errc::result_out_of_range
+				 * when they are too large. */
+				std::errc ec;
+			};
+
+			/** Number of characters written by toChars(). */
+			static constexpr size_t charsLength = 5;
+
+			/** Two-digit decimal representations of 0 up to 99. */
+			static constexpr char digitPairs[] =
+				"00010203040506070809" "10111213141516171819"
+				"20212223242526272829" "30313233343536373839"
+				"40414243444546474849" "50515253545556575859"
+				"60616263646566676869" "70717273747576777879"
+				"80818283848586878889" "90919293949596979899";
+
 		protected:
 			/** Number of hours in 24-hour format. */
 			uint8_t hours_a;
@@ -50,28 +81,69 @@ namespace SdH {
 			/** Number of minutes. */
 			uint8_t minutes_a;
 
-			/** Parse a character into a number
-			 * @param char_i Input character to parse
-			 * @returns The integer value if parsed properly
-			 * @throws std::invalid_argument if character is not a digit */
-			static uint8_t parseChar(const char char_i);
+			/** Parse one field of at most two digits with a given maximum.
+			 * @param first_i First character of the field.
+			 * @param last_i One past the last character of the field.
+			 * @param max_i Maximum value for the field.
+			 * @param value_o Receives the value when parsed properly.
+			 * @returns Parse result, see fromChars(). */
+			static constexpr ParseResult parseField(
+				const char * first_i,
+				const char * last_i,
+				const uint8_t max_i,
+				uint8_t & value_o
+			) noexcept {
+				uint8_t rv = 0; // Return Value
+
+				switch (last_i - first_i) {
+					case 2:
+						if (first_i[0] < '0' || first_i[0] > '9') return {first_i, std::errc::invalid_argument};
+						if (first_i[1] < '0' || first_i[1] > '9') return {first_i + 1, std::errc::invalid_argument};
+						rv = (first_i[0] - '0') * 10 + (first_i[1] - '0');
+						break;
+
+					case 1:
+						if (first_i[0] < '0' || first_i[0] > '9') return {first_i, std::errc::invalid_argument};
+						rv = first_i[0] - '0';
+						break;
+
+					case 0:
+						break;
+
+					default:
+						// The length is checked before the characters, and
+						// points just past the two that would be allowed
+						return {first_i + 2, std::errc::value_too_large};
+				}
 
-			/** Parse a string into a number with a given maximum.
-			 * @param str_i Input string to parse
-			 * @param max_i Maximum value for int
-			 * @returns The integer value if parsed properly
-			 * @throws std::overflow_error if int exceeds @p max_i
-			 * @throws std::invalid_argument if string can't be parsed */
-			static uint8_t parse(const std::string & str_i, const uint8_t max_i);
+				if (rv > max_i) return {first_i, std::errc::result_out_of_range};
+
+				value_o = rv;
+				return {last_i, std::errc()};
+			}
+
+			/** Throw the exception belonging to a failed parse. Not being
+			 * constexpr, reaching it while evaluating a constant expression
+			 * makes the compilation fail.
+			 * @param hm_i The string that failed to parse.
+			 * @param res_i Failed result returned by fromChars().
+			 * @throws std::invalid_argument when string can't be parsed.
+			 * @throws std::overflow_error when a value is out of range. */
+			[[noreturn]] static void throwParseError(const std::string_view & hm_i, const ParseResult & res_i);
 
 		public:
+			/** Number of minutes in a day. */
+			static constexpr uint16_t minutesPerDay = 24 * 60;
+
 			/** Empty constructor initializes to 00:00 */
-			inline HoursMinutes() : hours_a(0), minutes_a(0) {}
+			constexpr HoursMinutes() : hours_a(0), minutes_a(0) {}
 
-			/** String constructor reads HH:MM
+			/** String constructor reads HH:MM, at compile time when used
+			 * in a constant expression.
 			 * @param hm_i String to parse
-			 * @throws std::invalid_argument when string can't be parsed. */
-			inline HoursMinutes(const std::string & hm_i) {
+			 * @throws std::invalid_argument when string can't be parsed.
+			 * @throws std::overflow_error when a value is out of range. */
+			constexpr HoursMinutes(const std::string_view & hm_i) : hours_a(0), minutes_a(0) {
 				set(hm_i);
 			}
 
@@ -83,7 +155,7 @@ namespace SdH {
 			 * @param minutes_i Number of minutes.
 			 * @throws std::overflow_error when any parameter is out of range.
 			 */
-			inline HoursMinutes(const uint8_t hours_i, const uint8_t minutes_i) {
+			constexpr HoursMinutes(const uint8_t hours_i, const uint8_t minutes_i) : hours_a(0), minutes_a(0) {
 				hours(hours_i); minutes(minutes_i);
 			}
 
@@ -95,73 +167,185 @@ namespace SdH {
 
 			/** Get the number of hours in 24-hour format.
 			 * @returns Internal number of hours. */
-			inline uint8_t hours() const { return hours_a; }
+			constexpr uint8_t hours() const { return hours_a; }
 
 			/** Manually set the number of hours.
 			 * @param hours_i Hours to set in 24-hour format.
 			 * @throws std::overflow_error in case @p hours_i > 23. */
-			inline void hours(const uint8_t hours_i) {
+			constexpr void hours(const uint8_t hours_i) {
 				if (hours_i > 23) throw std::overflow_error("Hours should be smaller than 24.");
 				hours_a = hours_i;
 			}
 
 			/** Get the number of minutes.
 			 * @returns Internal number of minutes. */
-			inline uint8_t minutes() const { return minutes_a; }
+			constexpr uint8_t minutes() const { return minutes_a; }
 
 			/** Manually set the number of minutes.
 			 * @param minutes_i Number of minutes to set.
 			 * @throws std::overflow_error in case @p minutes_i > 59. */
-			inline void minutes(const uint8_t minutes_i) {
+			constexpr void minutes(const uint8_t minutes_i) {
 				if (minutes_i > 59) throw std::overflow_error("Minutes should be smaller than 60.");
 				minutes_a = minutes_i;
 			}
 
+			/** Get the number of minutes since midnight.
+			 * @returns Hours times 60 plus minutes. */
+			constexpr uint16_t minutesOfDay() const { return hours_a * 60 + minutes_a; }
+
+			/** Set the time from the number of minutes since midnight.
+			 * @param minutes_i Minutes since midnight.
+			 * @throws std::overflow_error in case @p minutes_i > 1439. */
+			constexpr void minutesOfDay(const uint16_t minutes_i) {
+				if (minutes_i >= minutesPerDay) throw std::overflow_error("Minutes of day should be smaller than 1440.");
+				hours_a = minutes_i / 60;
+				minutes_a = minutes_i % 60;
+			}
+
 			/** Add in-place object operator.
 			 * @param rhs_i Righthand side HoursMinutes object to add to this
 			 * one.
 			 * @returns A reference to the current object with @p rhs_i added.
 			 */
-			HoursMinutes & operator+=(const HoursMinutes & rhs_i);
+			constexpr HoursMinutes & operator+=(const HoursMinutes & rhs_i) {
+				// Both sides are below one day, so one conditional subtraction
+				// wraps the sum, which compilers turn into a conditional move.
+				uint16_t sum = minutesOfDay() + rhs_i.minutesOfDay();
+
+				sum -= sum >= minutesPerDay ? minutesPerDay : 0;
+				hours_a = sum / 60;
+				minutes_a = sum - hours_a * 60;
+				return (*this);
+			}
 
 			/** Add in-place string operator.
 			 * @param rhs_i Righthand side string to parse and add to this
 			 * object.
 			 * @returns A reference to the current object with @p rhs_i added.
 			 */
-			inline HoursMinutes & operator+=(const std::string & rhs_i) {
+			constexpr HoursMinutes & operator+=(const std::string_view & rhs_i) {
 				return (*this) += HoursMinutes(rhs_i);
 			}
 
 			/** Addition operator. */
-			inline HoursMinutes operator+(const HoursMinutes & rhs_i) const {
+			constexpr HoursMinutes operator+(const HoursMinutes & rhs_i) const {
 				HoursMinutes retval(*this);
 				return retval += rhs_i;
 			}
 
 			/** Check whether the set time is zero (00:00).
 			 * @returns True if zero (00:00), false if another time is set. */
-			inline bool isZero() const { return hours_a == 0 && minutes_a == 0; }
+			constexpr bool isZero() const { return hours_a == 0 && minutes_a == 0; }
 
 			/** Shortcut to get an HoursMinutes object with the current local
-			 * time.
+			 * time, read from the cached LocalClock.
 			 * @return An object with the current local time. */
-			static inline HoursMinutes now() { return HoursMinutes(time(nullptr)); }
+			static HoursMinutes now();
 
 			/** Reset the time to zero (00:00) */
-			inline void reset() { hours_a = 0; minutes_a = 0; }
+			constexpr void reset() { hours_a = 0; minutes_a = 0; }
 
 			/** Set the time from a string formatted like HH:MM.
 			 * @param hm_i String to parse
-			 * @throws std::invalid_argument when string can't be parsed. */
-			void set(const std::string & hm_i);
+			 * @throws std::invalid_argument when string can't be parsed.
+			 * @throws std::overflow_error when a value is out of range. */
+			constexpr void set(const std::string_view & hm_i) {
+				const ParseResult res = fromChars(hm_i.data(), hm_i.data() + hm_i.size(), *this);
+
+				if (res.ec != std::errc()) throwParseError(hm_i, res);
+			}
 
 			/** Set the time from an epoch value.
-			 * @param time_i Epoch timestamp to use. */
+			 * @param time_i Epoch timestamp to use.
+			 * @throws std::runtime_error when the time can't be broken down. */
 			void set(const time_t & time_i);
 
+			/** Parse a time formatted like [HH:]MM without throwing or
+			 * allocating memory. The whole range must be consumed.
+			 * @param first_i First character to parse.
+			 * @param last_i One past the last character to parse.
+			 * @param hm_o Receives the time on success, untouched otherwise.
+			 * @returns The parse result, with ptr set to @p last_i on
+			 * success. */
+			static constexpr ParseResult fromChars(
+				const char * first_i,
+				const char * last_i,
+				HoursMinutes & hm_o
+			) noexcept {
+				const char *colon = first_i; // Position of the first colon
+				uint8_t tmphrs = 0;
+				uint8_t tmpmin = 0;
+				ParseResult res = {last_i, std::errc()};
+
+				while (colon != last_i && *colon != ':') colon++;
+
+				if (colon == last_i) {
+					// No hours specified, just minutes
+					res = parseField(first_i, last_i, 59, tmpmin);
+				} else {
+					res = parseField(first_i, colon, 23, tmphrs);
+					if (res.ec != std::errc()) return res;
+					res = parseField(colon + 1, last_i, 59, tmpmin);
+				}
+
+				if (res.ec != std::errc()) return res;
+
+				hm_o.hours_a = tmphrs;
+				hm_o.minutes_a = tmpmin;
+				return res;
+			}
+
+			/** Write the time formatted as HH:MM, without terminating null
+			 * character.
+			 * @param out_o Buffer with room for charsLength characters.
+			 * @returns Position after the last written character. */
+			inline char * toChars(char * out_o) const noexcept {
+				out_o[0] = digitPairs[2 * hours_a];
+				out_o[1] = digitPairs[2 * hours_a + 1];
+				out_o[2] = ':';
+				out_o[3] = digitPairs[2 * minutes_a];
+				out_o[4] = digitPairs[2 * minutes_a + 1];
+				return out_o + charsLength;
+			}
+
+			/** Write the human readable description of a failed parse.
+			 * @param os_io Stream to write the description to.
+			 * @param res_i Failed result returned by fromChars().
+			 * @param last_i The same end of input as passed to fromChars().
+			 * @returns @p os_io */
+			static std::ostream & printError(
+				std::ostream & os_io,
+				const ParseResult & res_i,
+				const char * last_i
+			);
+
 	};
 
+	/** User-defined literals, brought in with
+	 * using namespace SdH::literals. */
+	namespace literals {
+
+		/** Value of a literal, computed when the literal is compiled. */
+		template <typename C, C... chars_i>
+		struct HoursMinutesLiteral {
+			/** Characters of the literal. */
+			static constexpr char chars[] = {chars_i..., '\0'};
+
+			/** Parsed literal. An invalid literal throws while the
+			 * compiler initialises it, which fails to compile. */
+			static constexpr HoursMinutes value = HoursMinutes(std::string_view(chars, sizeof...(chars_i)));
+		};
+
+		/** Time or duration literal like "09:30"_hm, computed by the
+		 * compiler. Every invalid literal fails to compile. */
+		template <typename C, C... chars_i>
+		constexpr HoursMinutes operator""_hm() {
+			static_assert(std::is_same<C, char>::value, "Time literals are narrow strings");
+			return HoursMinutesLiteral<C, chars_i...>::value;
+		}
+
+	} // literals namespace
+
 } // SdH namespace
 
 /** Stream output operator for SdH::HoursMinutes object. */
@@ -0,0 +1,316 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "HoursMinutesArray.h"
+
+namespace SdH {
+
+	void HoursMinutesArray::add(
+		const uint16_t * refs_i,
+		const uint16_t * durs_i,
+		uint16_t * out_o,
+		const size_t count_i
+	) noexcept
+	{
+		// Branchless, so the loop vectorizes into compare, and, subtract
+		for (size_t i = 0; i < count_i; i++) {
+			const uint16_t sum = refs_i[i] + durs_i[i];
+			out_o[i] = sum - (sum >= HoursMinutes::minutesPerDay ? HoursMinutes::minutesPerDay : 0);
+		}
+	}
+
+	void HoursMinutesArray::add(
+		const uint16_t * refs_i,
+		const uint16_t dur_i,
+		uint16_t * out_o,
+		const size_t count_i
+	) noexcept
+	{
+		for (size_t i = 0; i < count_i; i++) {
+			const uint16_t sum = refs_i[i] + dur_i;
+			out_o[i] = sum - (sum >= HoursMinutes::minutesPerDay ? HoursMinutes::minutesPerDay : 0);
+		}
+	}
+
+	void HoursMinutesArray::add(
+		const HoursMinutesArray & refs_i,
+		const HoursMinutesArray & durs_i,
+		HoursMinutesArray & out_o
+	)
+	{
+		if (refs_i.size() != durs_i.size()) {
+			throw std::invalid_argument("Arrays to add differ in size");
+		}
+
+		out_o.resize(refs_i.size());
+		add(refs_i.data(), durs_i.data(), out_o.data(), refs_i.size());
+	}
+
+	uint32_t HoursMinutesArray::scan(
+		const uint16_t * durs_i,
+		const size_t count_i,
+		const uint16_t start_i,
+		uint16_t * mins_o,
+		uint32_t * days_o
+	) noexcept
+	{
+		uint16_t carry = start_i;
+		uint32_t days = 0;
+		size_t i = 0;
+
+#if defined(__SSE2__)
+		const __m128i perDay = _mm_set1_epi16(HoursMinutes::minutesPerDay);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i carries = _mm_set1_epi16(carry);
+		__m128i base = zero;
+
+		for (; i + 8 <= count_i; i += 8) {
+			__m128i sum = _mm_loadu_si128(reinterpret_cast<const __m128i *>(durs_i + i));
+
+			// Running sums of the 8 lanes stay below 9 * 1440
+			sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 2));
+			sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 4));
+			sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 8));
+			sum = _mm_add_epi16(sum, carries);
+
+			// Divide by 1440 as by 32 and then by 45, which is exact for
+			// all 16 bit values when multiplying by 1457 / 65536
+			const __m128i quot = _mm_mulhi_epu16(_mm_srli_epi16(sum, 5), _mm_set1_epi16(1457));
+			const __m128i mins = _mm_sub_epi16(sum, _mm_mullo_epi16(quot, perDay));
+			const __m128i high = _mm_unpackhi_epi16(quot, zero);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(mins_o + i), mins);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(days_o + i), _mm_add_epi32(base, _mm_unpacklo_epi16(quot, zero)));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(days_o + i + 4), _mm_add_epi32(base, high));
+
+			// Spread the last lane over all lanes for the next run
+			carries = _mm_shuffle_epi32(_mm_shufflehi_epi16(mins, 0xFF), 0xFF);
+			base = _mm_add_epi32(base, _mm_shuffle_epi32(high, 0xFF));
+		}
+		carry = _mm_extract_epi16(carries, 0);
+		days = _mm_cvtsi128_si32(base);
+#endif
+
+		for (; i < count_i; i++) {
+			carry += durs_i[i];
+			if (carry >= HoursMinutes::minutesPerDay) {
+				carry -= HoursMinutes::minutesPerDay;
+				days++;
+			}
+			mins_o[i] = carry;
+			days_o[i] = days;
+		}
+
+		return days;
+	}
+
+	size_t HoursMinutesArray::next(
+		const uint16_t * mins_i,
+		const size_t count_i,
+		const uint16_t from_i
+	) noexcept
+	{
+		uint16_t best = HoursMinutes::minutesPerDay;
+		size_t i = 0;
+
+#if defined(__SSE2__)
+		const __m128i from = _mm_set1_epi16(from_i);
+		const __m128i perDay = _mm_set1_epi16(HoursMinutes::minutesPerDay);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i least = perDay;
+
+		// Minutes until each time, plus a day for times before the reference
+		for (; i + 8 <= count_i; i += 8) {
+			__m128i dist = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(mins_i + i)), from);
+
+			dist = _mm_add_epi16(dist, _mm_and_si128(_mm_cmplt_epi16(dist, zero), perDay));
+			least = _mm_min_epi16(least, dist);
+		}
+		least = _mm_min_epi16(least, _mm_shuffle_epi32(least, 0x4E));
+		least = _mm_min_epi16(least, _mm_shuffle_epi32(least, 0xB1));
+		least = _mm_min_epi16(least, _mm_shufflelo_epi16(least, 0xB1));
+		best = _mm_extract_epi16(least, 0);
+#endif
+
+		for (; i < count_i; i++) {
+			const uint16_t dist = mins_i[i] >= from_i ? mins_i[i] - from_i : mins_i[i] + HoursMinutes::minutesPerDay - from_i;
+
+			if (dist < best) best = dist;
+		}
+		if (best == HoursMinutes::minutesPerDay) return count_i;
+
+		// Every distance belongs to a single time, so look for its first copy
+		uint16_t target = from_i + best;
+
+		if (target >= HoursMinutes::minutesPerDay) target -= HoursMinutes::minutesPerDay;
+		i = 0;
+#if defined(__SSE2__)
+		const __m128i wanted = _mm_set1_epi16(target);
+
+		for (; i + 8 <= count_i; i += 8) {
+			const int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(mins_i + i)), wanted));
+
+			if (mask != 0) return i + __builtin_ctz(mask) / 2;
+		}
+#endif
+		while (mins_i[i] != target) i++;
+		return i;
+	}
+
+	size_t HoursMinutesArray::count(
+		const uint16_t * mins_i,
+		const size_t count_i,
+		const uint16_t from_i,
+		const uint16_t to_i
+	) noexcept
+	{
+		// A time is in the window when it is at most span minutes after from
+		const uint16_t span = to_i >= from_i ? to_i - from_i : to_i + HoursMinutes::minutesPerDay - from_i;
+		size_t retval = 0, i = 0;
+
+#if defined(__SSE2__)
+		const __m128i from = _mm_set1_epi16(from_i);
+		const __m128i perDay = _mm_set1_epi16(HoursMinutes::minutesPerDay);
+		const __m128i limit = _mm_set1_epi16(span + 1);
+		const __m128i zero = _mm_setzero_si128();
+
+		while (i + 8 <= count_i) {
+			// Lanes count down from 0 and hold at most 32768 matches
+			const size_t end = i + std::min<size_t>((count_i - i) & ~size_t(7), 8 << 15);
+			__m128i found = zero;
+
+			for (; i < end; i += 8) {
+				__m128i dist = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(mins_i + i)), from);
+
+				dist = _mm_add_epi16(dist, _mm_and_si128(_mm_cmplt_epi16(dist, zero), perDay));
+				found = _mm_add_epi16(found, _mm_cmplt_epi16(dist, limit));
+			}
+
+			// Negate and add pairs of lanes into 32 bits
+			const __m128i sums = _mm_madd_epi16(found, _mm_set1_epi16(-1));
+			uint32_t lanes[4];
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), sums);
+			retval += static_cast<size_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+		}
+#endif
+
+		for (; i < count_i; i++) {
+			const uint16_t dist = mins_i[i] >= from_i ? mins_i[i] - from_i : mins_i[i] + HoursMinutes::minutesPerDay - from_i;
+
+			retval += dist <= span;
+		}
+
+		return retval;
+	}
+
+	void HoursMinutesArray::sort(
+		const uint16_t * mins_i,
+		const uint32_t * days_i,
+		const size_t count_i,
+		size_t * order_o
+	) {
+		// Bucket count above which days get a pass of their own
+		constexpr size_t maxBuckets = 1 << 20;
+		uint32_t lastDay = 0;
+
+		if (days_i != nullptr) {
+			for (size_t i = 0; i < count_i; i++) lastDay = std::max(lastDay, days_i[i]);
+		}
+
+		const size_t days = static_cast<size_t>(lastDay) + 1;
+		const bool combined = days * HoursMinutes::minutesPerDay <= maxBuckets;
+		std::vector<size_t> starts(combined ? days * HoursMinutes::minutesPerDay + 1 : std::max<size_t>(days, HoursMinutes::minutesPerDay) + 1);
+
+		// Few days: a single pass on day and time together
+		if (combined) {
+			const auto key = [mins_i, days_i](const size_t i_i) {
+				return (days_i == nullptr ? 0 : static_cast<size_t>(days_i[i_i]) * HoursMinutes::minutesPerDay) + mins_i[i_i];
+			};
+
+			for (size_t i = 0; i < count_i; i++) starts[key(i) + 1]++;
+			for (size_t k = 1; k < starts.size(); k++) starts[k] += starts[k - 1];
+			for (size_t i = 0; i < count_i; i++) order_o[starts[key(i)]++] = i;
+			return;
+		}
+
+		// Many days: on the time of day first, then stable on the day
+		std::vector<size_t> byTime(count_i);
+
+		for (size_t i = 0; i < count_i; i++) starts[mins_i[i] + 1]++;
+		for (size_t k = 1; k <= HoursMinutes::minutesPerDay; k++) starts[k] += starts[k - 1];
+		for (size_t i = 0; i < count_i; i++) byTime[starts[mins_i[i]]++] = i;
+
+		std::fill(starts.begin(), starts.end(), 0);
+		for (size_t i = 0; i < count_i; i++) starts[days_i[i] + 1]++;
+		for (size_t k = 1; k <= days; k++) starts[k] += starts[k - 1];
+		for (const size_t i : byTime) order_o[starts[days_i[i]]++] = i;
+	}
+
+	char * HoursMinutesArray::format(
+		const uint16_t * mins_i,
+		const size_t count_i,
+		char * out_o,
+		const char sep_i
+	) noexcept
+	{
+		const char *pairs = HoursMinutes::digitPairs;
+
+		for (size_t i = 0; i < count_i; i++) {
+			// Division by a constant compiles to a multiplication
+			const unsigned hrs = mins_i[i] / 60;
+			const unsigned min = mins_i[i] - hrs * 60;
+
+			out_o[0] = pairs[2 * hrs];
+			out_o[1] = pairs[2 * hrs + 1];
+			out_o[2] = ':';
+			out_o[3] = pairs[2 * min];
+			out_o[4] = pairs[2 * min + 1];
+			out_o[5] = sep_i;
+			out_o += HoursMinutes::charsLength + 1;
+		}
+
+		return out_o;
+	}
+
+	HoursMinutesArray & HoursMinutesArray::operator+=(const HoursMinutes & rhs_i)
+	{
+		add(data(), rhs_i.minutesOfDay(), data(), size());
+		return (*this);
+	}
+
+} // SdH namespace
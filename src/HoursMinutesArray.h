@@ -0,0 +1,234 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "HoursMinutes.h"
+
+namespace SdH {
+
+	/** Contiguous array of times, stored as minutes since midnight in a
+	 * single uint16_t each. Bulk operations work on the raw buffer, so the
+	 * compiler can vectorize them. */
+	class HoursMinutesArray
+	{
+		protected:
+			/** Minutes since midnight, always below 1440. */
+			std::vector<uint16_t> minutes_a;
+
+		public:
+			/** Empty constructor creates an empty array. */
+			HoursMinutesArray() = default;
+
+			/** Size constructor.
+			 * @param size_i Number of elements, all initialized to 00:00 */
+			explicit HoursMinutesArray(const size_t size_i) : minutes_a(size_i, 0) {}
+
+			/** Get the number of elements. */
+			inline size_t size() const { return minutes_a.size(); }
+
+			/** Check whether there are no elements. */
+			inline bool empty() const { return minutes_a.empty(); }
+
+			/** Change the number of elements, new ones are 00:00 */
+			inline void resize(const size_t size_i) { minutes_a.resize(size_i, 0); }
+
+			/** Reserve room for a number of elements. */
+			inline void reserve(const size_t size_i) { minutes_a.reserve(size_i); }
+
+			/** Remove all elements. */
+			inline void clear() { minutes_a.clear(); }
+
+			/** Append a time. */
+			inline void push_back(const HoursMinutes & hm_i) { minutes_a.push_back(hm_i.minutesOfDay()); }
+
+			/** Get an element as HoursMinutes object.
+			 * @param index_i Index of the element, not range checked. */
+			inline HoursMinutes get(const size_t index_i) const {
+				HoursMinutes retval;
+				retval.minutesOfDay(minutes_a[index_i]);
+				return retval;
+			}
+
+			/** Set an element from an HoursMinutes object.
+			 * @param index_i Index of the element, not range checked.
+			 * @param hm_i Time to store. */
+			inline void set(const size_t index_i, const HoursMinutes & hm_i) {
+				minutes_a[index_i] = hm_i.minutesOfDay();
+			}
+
+			/** Get read access to the raw minutes since midnight. */
+			inline const uint16_t * data() const { return minutes_a.data(); }
+
+			/** Get write access to the raw minutes since midnight. Callers
+			 * must keep all values below 1440. */
+			inline uint16_t * data() { return minutes_a.data(); }
+
+			/** Add durations to reference times, wrapping at midnight.
+			 * Input values must be below 1440. The output may alias either
+			 * input exactly, but must not partially overlap it.
+			 * @param refs_i Reference times in minutes since midnight.
+			 * @param durs_i Durations in minutes, at most 23:59.
+			 * @param out_o Receives the sums.
+			 * @param count_i Number of elements in each array. */
+			static void add(
+				const uint16_t * refs_i,
+				const uint16_t * durs_i,
+				uint16_t * out_o,
+				const size_t count_i
+			) noexcept;
+
+			/** Add a single duration to many reference times.
+			 * @param refs_i Reference times in minutes since midnight.
+			 * @param dur_i Duration in minutes, at most 23:59.
+			 * @param out_o Receives the sums, may be @p refs_i.
+			 * @param count_i Number of elements. */
+			static void add(
+				const uint16_t * refs_i,
+				const uint16_t dur_i,
+				uint16_t * out_o,
+				const size_t count_i
+			) noexcept;
+
+			/** Add arrays element by element, resizing @p out_o to fit.
+			 * @throws std::invalid_argument when the input sizes differ. */
+			static void add(
+				const HoursMinutesArray & refs_i,
+				const HoursMinutesArray & durs_i,
+				HoursMinutesArray & out_o
+			);
+
+			/** Add durations one after the other to a start time, keeping
+			 * every intermediate time and the number of midnights passed.
+			 * Runs of 8 durations are summed in vector registers with
+			 * shifted additions, so only the last sum of a run depends on
+			 * the runs before it.
+			 * @param durs_i Durations in minutes, at most 23:59.
+			 * @param count_i Number of durations.
+			 * @param start_i Start time in minutes since midnight.
+			 * @param mins_o Receives the time after each duration.
+			 * @param days_o Receives the number of midnights passed since
+			 * the start after each duration.
+			 * @returns The number of midnights passed after all durations. */
+			static uint32_t scan(
+				const uint16_t * durs_i,
+				const size_t count_i,
+				const uint16_t start_i,
+				uint16_t * mins_o,
+				uint32_t * days_o
+			) noexcept;
+
+			/** Find the time that comes first at or after a reference
+			 * time, counting times before the reference as tomorrow.
+			 * @param mins_i Times in minutes since midnight, below 1440.
+			 * @param count_i Number of times.
+			 * @param from_i Reference time in minutes since midnight.
+			 * @returns Index of the first such time, or @p count_i when
+			 * there are no times. */
+			static size_t next(
+				const uint16_t * mins_i,
+				const size_t count_i,
+				const uint16_t from_i
+			) noexcept;
+
+			/** Count the times in a window that wraps past midnight when
+			 * it ends before it starts, like 23:00 to 01:00.
+			 * @param mins_i Times in minutes since midnight, below 1440.
+			 * @param count_i Number of times.
+			 * @param from_i First time of the window.
+			 * @param to_i Last time of the window, included.
+			 * @returns The number of times in the window. */
+			static size_t count(
+				const uint16_t * mins_i,
+				const size_t count_i,
+				const uint16_t from_i,
+				const uint16_t to_i
+			) noexcept;
+
+			/** Order times by time of day with a counting sort, keeping
+			 * equal times in their original order.
+			 * @param mins_i Times in minutes since midnight, below 1440.
+			 * @param days_i Days passed per time, ordered on before the
+			 * time of day, or nullptr to order on the time of day only.
+			 * @param count_i Number of times.
+			 * @param order_o Receives the indices of the times in order.
+			 * @throws std::bad_alloc when out of memory. */
+			static void sort(
+				const uint16_t * mins_i,
+				const uint32_t * days_i,
+				const size_t count_i,
+				size_t * order_o
+			);
+
+			/** Format times as HH:MM, each followed by a separator.
+			 * @param mins_i Times in minutes since midnight, below 1440.
+			 * @param count_i Number of times.
+			 * @param out_o Buffer with room for @p count_i times
+			 * (HoursMinutes::charsLength + 1) characters.
+			 * @param sep_i Character written after each time.
+			 * @returns Position after the last written character. */
+			static char * format(
+				const uint16_t * mins_i,
+				const size_t count_i,
+				char * out_o,
+				const char sep_i = '\n'
+			) noexcept;
+
+			/** Format all times as HH:MM, each followed by a separator.
+			 * @returns Position after the last written character.
+			 * @see format(const uint16_t *, size_t, char *, char) */
+			inline char * format(char * out_o, const char sep_i = '\n') const noexcept {
+				return format(data(), size(), out_o, sep_i);
+			}
+
+			/** Find the element that comes first at or after a time.
+			 * @returns Index of the element, or size() when empty.
+			 * @see next(const uint16_t *, size_t, uint16_t) */
+			inline size_t next(const HoursMinutes & from_i) const noexcept {
+				return next(data(), size(), from_i.minutesOfDay());
+			}
+
+			/** Count the elements from one time up to and including another.
+			 * @see count(const uint16_t *, size_t, uint16_t, uint16_t) */
+			inline size_t count(const HoursMinutes & from_i, const HoursMinutes & to_i) const noexcept {
+				return count(data(), size(), from_i.minutesOfDay(), to_i.minutesOfDay());
+			}
+
+			/** Add a single duration to every element in place.
+			 * @returns A reference to the current object. */
+			HoursMinutesArray & operator+=(const HoursMinutes & rhs_i);
+	};
+
+} // SdH namespace
@@ -0,0 +1,134 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <unistd.h>
+#include "LineReader.h"
+
+namespace SdH {
+
+	LineReader::LineReader(const int fd_i, const size_t size_i):
+		fd_a(fd_i),
+		buffer_a(new char[size_i > 0 ? size_i : 1]),
+		size_a(size_i > 0 ? size_i : 1),
+		begin_a(0),
+		end_a(0),
+		eof_a(false)
+	{ }
+
+	void LineReader::fill()
+	{
+		ssize_t count = 0;
+
+		if (begin_a > 0) {
+			memmove(buffer_a.get(), buffer_a.get() + begin_a, end_a - begin_a);
+			end_a -= begin_a;
+			begin_a = 0;
+		}
+
+		if (end_a == size_a) {
+			// A single line fills the whole buffer, so make room
+			std::unique_ptr<char[]> bigger(new char[size_a * 2]);
+
+			memcpy(bigger.get(), buffer_a.get(), end_a);
+			buffer_a.swap(bigger);
+			size_a *= 2;
+		}
+
+		do {
+			count = read(fd_a, buffer_a.get() + end_a, size_a - end_a);
+		} while (count < 0 && errno == EINTR);
+
+		if (count < 0) {
+			throw std::system_error(errno, std::generic_category(), "Unable to read input");
+		}
+
+		if (count == 0) eof_a = true;
+		end_a += count;
+	}
+
+	bool LineReader::next(std::string_view & line_o)
+	{
+		const char *nl = nullptr; // Newline position
+
+		for (;;) {
+			nl = static_cast<const char *>(
+				memchr(buffer_a.get() + begin_a, '\n', end_a - begin_a)
+			);
+
+			if (nl != nullptr) {
+				line_o = std::string_view(buffer_a.get() + begin_a, nl - buffer_a.get() - begin_a);
+				begin_a = nl - buffer_a.get() + 1;
+				return true;
+			}
+
+			if (eof_a) {
+				// Last line without a trailing newline
+				if (begin_a == end_a) return false;
+				line_o = std::string_view(buffer_a.get() + begin_a, end_a - begin_a);
+				begin_a = end_a;
+				return true;
+			}
+
+			fill();
+		}
+	}
+
+	bool LineReader::nextBlock(std::string_view & block_o)
+	{
+		const char *nl = nullptr; // Last newline position
+
+		for (;;) {
+			nl = static_cast<const char *>(
+				memrchr(buffer_a.get() + begin_a, '\n', end_a - begin_a)
+			);
+
+			if (nl != nullptr) {
+				block_o = std::string_view(buffer_a.get() + begin_a, nl - buffer_a.get() - begin_a + 1);
+				begin_a = nl - buffer_a.get() + 1;
+				return true;
+			}
+
+			if (eof_a) {
+				if (begin_a == end_a) return false;
+				block_o = std::string_view(buffer_a.get() + begin_a, end_a - begin_a);
+				begin_a = end_a;
+				return true;
+			}
+
+			fill();
+		}
+	}
+
+} // SdH namespace
@@ -0,0 +1,100 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace SdH {
+
+	/** Reads newline separated lines from a file descriptor through a large
+	 * buffer, without copying each line into a separate string. */
+	class LineReader
+	{
+		protected:
+			/** File descriptor to read from. */
+			int fd_a;
+
+			/** Read buffer, grows when a single line does not fit. */
+			std::unique_ptr<char[]> buffer_a;
+
+			/** Size of the read buffer in bytes. */
+			size_t size_a;
+
+			/** Offset of the first byte not yet returned as a line. */
+			size_t begin_a;
+
+			/** Offset one past the last valid byte in the buffer. */
+			size_t end_a;
+
+			/** Whether the end of the input has been reached. */
+			bool eof_a;
+
+			/** Move unprocessed bytes to the front of the buffer and read
+			 * more data behind them.
+			 * @throws std::system_error when reading fails. */
+			void fill();
+
+		public:
+			/** Default size of the read buffer. */
+			static constexpr size_t defaultSize = 1 << 20;
+
+			/** Constructor.
+			 * @param fd_i File descriptor to read from. Ownership is not
+			 * transferred.
+			 * @param size_i Initial size of the read buffer. */
+			LineReader(const int fd_i, const size_t size_i = defaultSize);
+
+			/** Copying would share the file position, so don't. */
+			LineReader(const LineReader &) = delete;
+			LineReader & operator=(const LineReader &) = delete;
+
+			/** Get the next line from the input.
+			 * @param line_o Set to the line contents, without the newline.
+			 * Only valid until the next call.
+			 * @returns False when the input is exhausted, true otherwise.
+			 * @throws std::system_error when reading fails. */
+			bool next(std::string_view & line_o);
+
+			/** Get all complete lines that are currently buffered, reading
+			 * more input when there are none.
+			 * @param block_o Set to the lines, including the newline of
+			 * the last one, except for a final line without newline. Only
+			 * valid until the next call.
+			 * @returns False when the input is exhausted, true otherwise.
+			 * @throws std::system_error when reading fails. */
+			bool nextBlock(std::string_view & block_o);
+	};
+
+} // SdH namespace
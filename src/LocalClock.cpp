@@ -0,0 +1,133 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <stdexcept>
+#include "LocalClock.h"
+
+namespace SdH {
+
+	LocalClock::LocalClock():
+		sequence_a(0),
+		validFrom_a(1),
+		validUntil_a(0), // Empty period, so the first use refreshes
+		offset_a(0)
+	{ }
+
+	LocalClock & LocalClock::instance()
+	{
+		static LocalClock clock;
+		return clock;
+	}
+
+	time_t LocalClock::epoch() noexcept
+	{
+		struct timespec ts;
+
+#ifdef CLOCK_REALTIME_COARSE
+		if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0) return ts.tv_sec;
+#endif
+		if (clock_gettime(CLOCK_REALTIME, &ts) == 0) return ts.tv_sec;
+		return time(nullptr);
+	}
+
+	int32_t LocalClock::offsetAt(const time_t & time_i)
+	{
+		struct tm tmbuf;
+
+		if (localtime_r(&time_i, &tmbuf) == nullptr) {
+			throw std::runtime_error("Unable to break down time to parts");
+		}
+
+		return tmbuf.tm_gmtoff;
+	}
+
+	int32_t LocalClock::refresh(const time_t & time_i)
+	{
+		std::lock_guard<std::mutex> lock(mutex_a);
+		int32_t offset = 0;
+		time_t until = time_i + horizon;
+		time_t lo = time_i, hi = until;
+
+		// Pick up changes to TZ or /etc/localtime
+		tzset();
+		offset = offsetAt(time_i);
+
+		// Offsets change rarely, so one probe usually suffices. Otherwise
+		// find the exact second of the transition.
+		if (offsetAt(until) != offset) {
+			while (hi - lo > 1) {
+				const time_t mid = lo + (hi - lo) / 2;
+				if (offsetAt(mid) == offset) lo = mid; else hi = mid;
+			}
+			until = hi;
+		}
+
+		sequence_a.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		validFrom_a.store(time_i, std::memory_order_relaxed);
+		validUntil_a.store(until, std::memory_order_relaxed);
+		offset_a.store(offset, std::memory_order_relaxed);
+		sequence_a.fetch_add(1, std::memory_order_release);
+
+		return offset;
+	}
+
+	int32_t LocalClock::utcOffset(const time_t & time_i)
+	{
+		uint32_t seq = 0;
+		int64_t from = 0, until = 0;
+		int32_t offset = 0;
+
+		do {
+			seq = sequence_a.load(std::memory_order_acquire);
+			from = validFrom_a.load(std::memory_order_relaxed);
+			until = validUntil_a.load(std::memory_order_relaxed);
+			offset = offset_a.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while ((seq & 1) || seq != sequence_a.load(std::memory_order_relaxed));
+
+		if (time_i >= from && time_i < until) return offset;
+		return refresh(time_i);
+	}
+
+	HoursMinutes LocalClock::at(const time_t & time_i)
+	{
+		const int64_t secsPerDay = 24 * 60 * 60;
+		int64_t secs = (static_cast<int64_t>(time_i) + utcOffset(time_i)) % secsPerDay;
+		HoursMinutes retval;
+
+		if (secs < 0) secs += secsPerDay;
+		retval.minutesOfDay(secs / 60);
+		return retval;
+	}
+
+} // SdH namespace
@@ -0,0 +1,114 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include "HoursMinutes.h"
+
+namespace SdH {
+
+	/** Local wall clock that avoids the C library time zone machinery on
+	 * every read. It caches the UTC offset together with the period in
+	 * which that offset is known to be valid, which ends at the next
+	 * daylight saving transition or a day later, whichever comes first.
+	 * Reading the local time is then a coarse clock read plus arithmetic.
+	 * Only crossing the end of the period takes a lock and calls
+	 * localtime_r(), which also picks up time zone changes daily.
+	 *
+	 * All members are safe to call from many threads at once. Readers never
+	 * block each other: the cached period is published with a sequence
+	 * lock. */
+	class LocalClock
+	{
+		protected:
+			/** Sequence number of the cached period, odd during updates. */
+			std::atomic<uint32_t> sequence_a;
+
+			/** Start of the cached period as epoch timestamp. */
+			std::atomic<int64_t> validFrom_a;
+
+			/** End of the cached period as epoch timestamp, exclusive. */
+			std::atomic<int64_t> validUntil_a;
+
+			/** UTC offset in seconds during the cached period. */
+			std::atomic<int32_t> offset_a;
+
+			/** Serializes refreshes of the cached period. */
+			std::mutex mutex_a;
+
+			/** Longest period to trust an offset without looking again. */
+			static constexpr time_t horizon = 24 * 60 * 60;
+
+			/** Get the UTC offset at a certain moment from the C library.
+			 * @throws std::runtime_error when the time can't be broken down. */
+			static int32_t offsetAt(const time_t & time_i);
+
+			/** Cache a new period that includes @p time_i.
+			 * @returns The UTC offset at @p time_i.
+			 * @throws std::runtime_error when the time can't be broken down. */
+			int32_t refresh(const time_t & time_i);
+
+		public:
+			/** Constructor, the time zone is only loaded on first use. */
+			LocalClock();
+
+			/** Copying would duplicate the cache, so don't. */
+			LocalClock(const LocalClock &) = delete;
+			LocalClock & operator=(const LocalClock &) = delete;
+
+			/** Get the process wide clock. */
+			static LocalClock & instance();
+
+			/** Read the current epoch timestamp from the coarse real time
+			 * clock, which is cheap and accurate to a few milliseconds. */
+			static time_t epoch() noexcept;
+
+			/** Get the UTC offset in seconds at a certain moment. Moments
+			 * far from the cached period cause a refresh, so this is meant
+			 * for timestamps close to now.
+			 * @throws std::runtime_error when the time can't be broken down. */
+			int32_t utcOffset(const time_t & time_i);
+
+			/** Get the local time of day at a certain moment.
+			 * @throws std::runtime_error when the time can't be broken down. */
+			HoursMinutes at(const time_t & time_i);
+
+			/** Get the current local time of day.
+			 * @throws std::runtime_error when the time can't be broken down. */
+			inline HoursMinutes now() { return at(epoch()); }
+	};
+
+} // SdH namespace
@@ -0,0 +1,80 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <cerrno>
+#include <system_error>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "MappedFile.h"
+
+namespace SdH {
+
+	MappedFile::MappedFile(const int fd_i):
+		data_a(nullptr),
+		size_a(0)
+	{
+		struct stat st;
+		void *addr = nullptr;
+
+		if (fstat(fd_i, &st) < 0) {
+			throw std::system_error(errno, std::generic_category(), "Unable to stat input");
+		}
+		if (!S_ISREG(st.st_mode)) {
+			throw std::system_error(EINVAL, std::generic_category(), "Input is not a regular file");
+		}
+
+		// mmap(2) refuses empty mappings
+		if (st.st_size == 0) return;
+
+		addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd_i, 0);
+		if (addr == MAP_FAILED) {
+			throw std::system_error(errno, std::generic_category(), "Unable to map input");
+		}
+
+		data_a = static_cast<const char *>(addr);
+		size_a = st.st_size;
+		madvise(addr, size_a, MADV_SEQUENTIAL);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (data_a != nullptr) munmap(const_cast<char *>(data_a), size_a);
+	}
+
+	bool MappedFile::mappable(const int fd_i) noexcept
+	{
+		struct stat st;
+
+		return fstat(fd_i, &st) == 0 && S_ISREG(st.st_mode);
+	}
+
+} // SdH namespace
@@ -0,0 +1,78 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+
+namespace SdH {
+
+	/** Maps a complete file read-only into memory, so its contents can be
+	 * processed in place without reading them into buffers first. */
+	class MappedFile
+	{
+		protected:
+			/** Start of the mapping, nullptr for an empty file. */
+			const char * data_a;
+
+			/** Size of the mapping in bytes. */
+			size_t size_a;
+
+		public:
+			/** Constructor maps the file behind @p fd_i and advises the
+			 * kernel that it will be read sequentially.
+			 * @param fd_i File descriptor of a regular file. Ownership is
+			 * not transferred and it may be closed after construction.
+			 * @throws std::system_error when the file can't be mapped. */
+			explicit MappedFile(const int fd_i);
+
+			/** Destructor unmaps the file. */
+			~MappedFile();
+
+			/** Copying would unmap the file twice, so don't. */
+			MappedFile(const MappedFile &) = delete;
+			MappedFile & operator=(const MappedFile &) = delete;
+
+			/** Check whether @p fd_i refers to a file that can be mapped. */
+			static bool mappable(const int fd_i) noexcept;
+
+			/** Get the first byte of the file. */
+			inline const char * data() const { return data_a; }
+
+			/** Get one past the last byte of the file. */
+			inline const char * end() const { return data_a + size_a; }
+
+			/** Get the size of the file in bytes. */
+			inline size_t size() const { return size_a; }
+	};
+
+} // SdH namespace
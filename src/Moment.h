@@ -0,0 +1,75 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstdint>
+#include "HoursMinutes.h"
+
+namespace SdH {
+
+	/** A time of day on a certain day, for schedules that run past
+	 * midnight. Days are counted from an arbitrary day 0. */
+	struct Moment {
+		/** Number of days after day 0. */
+		uint32_t day;
+
+		/** Time of day. */
+		HoursMinutes time;
+
+		/** Create a moment from the number of minutes since the start of
+		 * day 0. */
+		static inline Moment fromMinutes(const uint64_t minutes_i) {
+			Moment retval = {static_cast<uint32_t>(minutes_i / HoursMinutes::minutesPerDay), HoursMinutes()};
+
+			retval.time.minutesOfDay(minutes_i % HoursMinutes::minutesPerDay);
+			return retval;
+		}
+
+		/** Add a duration, moving to the next day past midnight.
+		 * @returns A reference to the current object. */
+		inline Moment & operator+=(const HoursMinutes & dur_i) {
+			const uint16_t before = time.minutesOfDay();
+
+			// Durations are below a day, so at most one wrap
+			time += dur_i;
+			if (time.minutesOfDay() < before) day++;
+			return *this;
+		}
+
+		/** Get the number of minutes since the start of day 0. */
+		inline uint64_t minutes() const {
+			return static_cast<uint64_t>(day) * HoursMinutes::minutesPerDay + time.minutesOfDay();
+		}
+	};
+
+} // SdH namespace
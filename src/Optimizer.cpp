@@ -0,0 +1,397 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include "Optimizer.h"
+
+namespace SdH {
+
+	Optimizer::Optimizer(const Planner & planner_i, const Goal goal_i):
+		goal_a(goal_i),
+		start_a(planner_i.start().minutesOfDay()),
+		bestKey_a(UINT64_MAX),
+		pending_a(0),
+		idle_a(0),
+		stop_a(false),
+		nodes_a(0)
+	{
+		uint64_t total = 0;
+
+		initial_a.total = 0;
+		for (size_t slot = 0; slot < planner_i.slots(); slot++) {
+			// Jobs of a kind keep their order, longest kinds first
+			std::map<uint16_t, std::vector<size_t>, std::greater<uint16_t>> kinds;
+
+			for (const size_t job : planner_i.queue(slot)) {
+				kinds[planner_i.duration(job).minutesOfDay()].push_back(job);
+			}
+
+			laneSlot_a.insert(laneSlot_a.end(), planner_i.lanes(slot), slot);
+			slotKinds_a.push_back(kindDuration_a.size());
+			initial_a.remaining.push_back(planner_i.queue(slot).size());
+			initial_a.work.push_back(0);
+			for (auto & kind : kinds) {
+				kindDuration_a.push_back(kind.first);
+				initial_a.left.push_back(kind.second.size());
+				initial_a.work.back() += kind.first * kind.second.size();
+				kindJobs_a.push_back(std::move(kind.second));
+			}
+			initial_a.total += planner_i.queue(slot).size();
+			total += initial_a.work.back();
+		}
+		slotKinds_a.push_back(kindDuration_a.size());
+
+		if (total >= UINT32_MAX || initial_a.total >= UINT32_MAX) {
+			throw std::length_error("Too many jobs to optimise");
+		}
+
+		initial_a.free.assign(laneSlot_a.size(), start_a);
+		initial_a.end = start_a;
+		initial_a.last = start_a;
+		initial_a.starts = 0;
+		initial_a.lane = none;
+
+		// The current order is the first to beat
+		State current(initial_a);
+		std::vector<size_t> next(planner_i.slots(), 0);
+
+		current.picks.reserve(current.total);
+		while (current.total) {
+			const uint32_t lane = nextLane(current);
+			const uint32_t slot = laneSlot_a[lane];
+			const uint16_t duration = planner_i.duration(planner_i.queue(slot)[next[slot]++]).minutesOfDay();
+			uint32_t kind = slotKinds_a[slot];
+
+			while (kindDuration_a[kind] != duration) kind++;
+			start(current, lane, kind);
+		}
+		offer(current);
+	}
+
+	uint64_t Optimizer::key(const uint64_t finish_i, const uint64_t checkins_i) const
+	{
+		return goal_a == Goal::finish ? finish_i << 32 | checkins_i : checkins_i << 32 | finish_i;
+	}
+
+	uint32_t Optimizer::nextLane(const State & state_i) const
+	{
+		uint32_t retval = none;
+
+		for (uint32_t lane = 0; lane < laneSlot_a.size(); lane++) {
+			if (!state_i.remaining[laneSlot_a[lane]]) continue;
+			if (retval == none || state_i.free[lane] < state_i.free[retval]) retval = lane;
+		}
+		return retval;
+	}
+
+	void Optimizer::start(State & state_io, const uint32_t lane_i, const uint32_t kind_i) const
+	{
+		const uint64_t at = state_io.free[lane_i];
+		const uint16_t duration = kindDuration_a[kind_i];
+		const uint32_t slot = laneSlot_a[lane_i];
+
+		state_io.free[lane_i] = at + duration;
+		state_io.left[kind_i]--;
+		state_io.remaining[slot]--;
+		state_io.work[slot] -= duration;
+		state_io.picks.push_back(kind_i);
+		state_io.total--;
+		if (!state_io.starts || at != state_io.last) {
+			state_io.starts++;
+			state_io.last = at;
+		}
+		state_io.end = std::max(state_io.end, at + duration);
+		state_io.lane = lane_i;
+	}
+
+	uint64_t Optimizer::bound(const State & state_i, const uint32_t lane_i) const
+	{
+		const uint64_t at = state_i.free[lane_i];
+		uint64_t finish = state_i.end;
+		uint64_t checkins = state_i.starts;
+		size_t startable = 0;
+		bool instant = false;
+
+		for (uint32_t first = 0, next = 0; first < laneSlot_a.size(); first = next) {
+			const uint32_t slot = laneSlot_a[first];
+			uint64_t sum = 0;
+			uint64_t earliest = UINT64_MAX;
+			size_t idle = 0;
+
+			for (next = first; next < laneSlot_a.size() && laneSlot_a[next] == slot; next++) {
+				sum += state_i.free[next];
+				earliest = std::min(earliest, state_i.free[next]);
+				if (state_i.free[next] == at) idle++;
+			}
+			if (!state_i.remaining[slot]) continue;
+
+			uint32_t longest = slotKinds_a[slot];
+
+			while (!state_i.left[longest]) longest++;
+			instant |= kindDuration_a[slotKinds_a[slot + 1] - 1] == 0 && state_i.left[slotKinds_a[slot + 1] - 1];
+			startable += std::min<size_t>(idle, state_i.remaining[slot]);
+
+			// The lanes can't do better than sharing the work evenly,
+			// nor finish before the longest job left ran
+			finish = std::max({
+				finish,
+				(sum + state_i.work[slot] + next - first - 1) / (next - first),
+				earliest + kindDuration_a[longest]
+			});
+		}
+
+		// A new start time, more when not all jobs fit on the lanes free
+		// now, and a check-in to collect the job started last, unless
+		// jobs without duration get in the way of counting
+		if (!state_i.starts || at != state_i.last) checkins++;
+		if (!instant) checkins += 1 + (state_i.total > startable);
+
+		return key(finish - start_a, checkins);
+	}
+
+	void Optimizer::offer(const State & state_i)
+	{
+		const uint64_t checkins = state_i.starts + (state_i.end != state_i.last);
+		const uint64_t key = this->key(state_i.end - start_a, checkins);
+
+		if (key >= bestKey_a) return;
+
+		std::lock_guard<std::mutex> guard(bestLock_a);
+
+		if (key >= bestKey_a) return;
+		best_a = state_i.picks;
+		bestKey_a = key;
+		if (progress_a) progress_a(Moment::fromMinutes(state_i.end), checkins);
+	}
+
+	void Optimizer::search(State & state_io, Worker & self_io)
+	{
+		/** A node being searched, with what to undo for its current child. */
+		struct Frame {
+			uint32_t lane;
+			uint32_t next;
+			uint32_t stop;
+			uint32_t kind;
+			uint64_t end;
+			uint64_t last;
+			uint32_t starts;
+			uint32_t previous;
+		};
+
+		std::vector<Frame> frames;
+
+		// Record a complete schedule, or prepare to try the kinds that can
+		// start next unless the bound rules them out
+		const auto open = [&]() {
+			if ((++self_io.nodes & 1023) == 0 && std::chrono::steady_clock::now() >= deadline_a) stop_a = true;
+			if (!state_io.total) return offer(state_io);
+
+			const uint32_t lane = nextLane(state_io);
+			const uint32_t slot = laneSlot_a[lane];
+			uint32_t first = slotKinds_a[slot];
+
+			if (bound(state_io, lane) >= bestKey_a.load(std::memory_order_relaxed)) return;
+
+			// Swapping the jobs of lanes that are free at the same time
+			// gives the same schedule, so only try them in kind order
+			if (
+				state_io.lane != none && state_io.lane != lane && laneSlot_a[state_io.lane] == slot &&
+				state_io.last == state_io.free[lane]
+			) {
+				first = state_io.picks.back();
+			}
+			frames.push_back({lane, first, slotKinds_a[slot + 1], none, 0, 0, 0, 0});
+		};
+
+		open();
+		while (!frames.empty() && !stop_a.load(std::memory_order_relaxed)) {
+			Frame & frame = frames.back();
+
+			if (frame.kind != none) {
+				const uint16_t duration = kindDuration_a[frame.kind];
+				const uint32_t slot = laneSlot_a[frame.lane];
+
+				state_io.free[frame.lane] -= duration;
+				state_io.left[frame.kind]++;
+				state_io.remaining[slot]++;
+				state_io.work[slot] += duration;
+				state_io.picks.pop_back();
+				state_io.total++;
+				state_io.end = frame.end;
+				state_io.last = frame.last;
+				state_io.starts = frame.starts;
+				state_io.lane = frame.previous;
+				frame.kind = none;
+			}
+
+			while (frame.next < frame.stop && !state_io.left[frame.next]) frame.next++;
+			if (frame.next == frame.stop) {
+				frames.pop_back();
+				continue;
+			}
+
+			const uint32_t kind = frame.next++;
+
+			// Hand out this child when another thread needs work and there
+			// is a sibling left for this one
+			if (idle_a.load(std::memory_order_relaxed)) {
+				uint32_t sibling = frame.next;
+
+				while (sibling < frame.stop && !state_io.left[sibling]) sibling++;
+				if (sibling < frame.stop) {
+					State task(state_io);
+
+					start(task, frame.lane, kind);
+					pending_a++;
+
+					std::lock_guard<std::mutex> guard(self_io.lock);
+
+					self_io.tasks.push_back(std::move(task));
+					continue;
+				}
+			}
+
+			frame.kind = kind;
+			frame.end = state_io.end;
+			frame.last = state_io.last;
+			frame.starts = state_io.starts;
+			frame.previous = state_io.lane;
+			start(state_io, frame.lane, kind);
+			open();
+		}
+	}
+
+	void Optimizer::work(const size_t self_i)
+	{
+		Worker & self = *workers_a[self_i];
+		bool idle = false;
+		State task;
+
+		while (!stop_a) {
+			bool found = false;
+
+			// Newest own task first, otherwise the oldest of another
+			{
+				std::lock_guard<std::mutex> guard(self.lock);
+
+				if (!self.tasks.empty()) {
+					task = std::move(self.tasks.back());
+					self.tasks.pop_back();
+					found = true;
+				}
+			}
+			for (size_t i = 1; !found && i < workers_a.size(); i++) {
+				Worker & victim = *workers_a[(self_i + i) % workers_a.size()];
+				std::lock_guard<std::mutex> guard(victim.lock);
+
+				if (!victim.tasks.empty()) {
+					task = std::move(victim.tasks.front());
+					victim.tasks.pop_front();
+					found = true;
+				}
+			}
+
+			if (!found) {
+				if (!pending_a) break;
+				if (!idle) idle_a++;
+				idle = true;
+				std::this_thread::yield();
+				continue;
+			}
+
+			if (idle) idle_a--;
+			idle = false;
+			search(task, self);
+			pending_a--;
+		}
+		if (idle) idle_a--;
+	}
+
+	bool Optimizer::solve(
+		const std::chrono::steady_clock::duration & budget_i,
+		const unsigned threads_i,
+		const Progress & progress_i
+	) {
+		const unsigned threads = threads_i > 0 ? threads_i : std::max(std::thread::hardware_concurrency(), 1U);
+		std::vector<std::thread> others;
+
+		progress_a = progress_i;
+		deadline_a = std::chrono::steady_clock::now() + budget_i;
+		stop_a = false;
+		idle_a = 0;
+		pending_a = 1;
+		workers_a.clear();
+		for (unsigned i = 0; i < threads; i++) workers_a.emplace_back(new Worker);
+		workers_a[0]->tasks.push_back(initial_a);
+
+		for (unsigned i = 1; i < threads; i++) others.emplace_back(&Optimizer::work, this, i);
+		work(0);
+		for (std::thread & other : others) other.join();
+
+		nodes_a = 0;
+		for (const auto & worker : workers_a) nodes_a += worker->nodes;
+		workers_a.clear();
+		progress_a = Progress();
+		return !stop_a;
+	}
+
+	Moment Optimizer::finish() const
+	{
+		const uint64_t key = bestKey_a;
+
+		return Moment::fromMinutes(start_a + (goal_a == Goal::finish ? key >> 32 : key & UINT32_MAX));
+	}
+
+	size_t Optimizer::checkins() const
+	{
+		const uint64_t key = bestKey_a;
+
+		return goal_a == Goal::checkins ? key >> 32 : key & UINT32_MAX;
+	}
+
+	void Optimizer::apply(Planner & planner_io) const
+	{
+		std::vector<std::vector<size_t>> queues(planner_io.slots());
+		std::vector<size_t> used(kindJobs_a.size(), 0);
+
+		for (const uint32_t kind : best_a) {
+			const size_t slot = std::upper_bound(slotKinds_a.begin(), slotKinds_a.end(), kind) - slotKinds_a.begin() - 1;
+
+			queues[slot].push_back(kindJobs_a[kind][used[kind]++]);
+		}
+		for (size_t slot = 0; slot < queues.size(); slot++) planner_io.queue(slot, queues[slot]);
+	}
+
+} // SdH namespace
@@ -0,0 +1,238 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Moment.h"
+#include "Planner.h"
+
+namespace SdH {
+
+	/** Searches the order of the queued jobs of a Planner that finishes
+	 * all jobs first, or that needs the fewest check-ins: moments at which
+	 * jobs are started or collected. Ties are broken by the other goal.
+	 *
+	 * Every order the Planner can run is a sequence of choices of which
+	 * job to start on the lane that is free first. The search is a depth
+	 * first branch-and-bound over these choices, where jobs with the same
+	 * duration on the same slot are interchangeable and lanes of a slot
+	 * that are free at the same time get their jobs in a fixed order.
+	 * Branches are pruned when a lower bound on the goal can't beat the
+	 * best order found so far, which starts out as the current order.
+	 *
+	 * Threads each search their own part of the tree and hand out parts
+	 * of it to threads that run out of work, which steal the oldest and
+	 * thus largest part from the others. */
+	class Optimizer
+	{
+		public:
+			/** What to minimise first. */
+			enum class Goal {
+				/** The moment all jobs are done. */
+				finish,
+
+				/** The number of check-ins. */
+				checkins
+			};
+
+			/** Called with the finish and number of check-ins whenever
+			 * a better order is found. Calls don't overlap. */
+			typedef std::function<void(const Moment & finish_i, const size_t checkins_i)> Progress;
+
+		protected:
+			/** Kind index meaning no kind. */
+			static constexpr uint32_t none = UINT32_MAX;
+
+			/** Partial schedule: the choices made so far and their effect. */
+			struct State {
+				/** Time at which each lane is free, in minutes since day 0. */
+				std::vector<uint64_t> free;
+
+				/** Number of jobs not started per kind. */
+				std::vector<uint32_t> left;
+
+				/** Number of jobs not started per slot. */
+				std::vector<uint32_t> remaining;
+
+				/** Total duration of the jobs not started per slot. */
+				std::vector<uint64_t> work;
+
+				/** Kind of every started job, in order of start. */
+				std::vector<uint32_t> picks;
+
+				/** Number of jobs not started. */
+				size_t total;
+
+				/** Latest end of the started jobs. */
+				uint64_t end;
+
+				/** Latest start. */
+				uint64_t last;
+
+				/** Number of distinct start times. */
+				uint32_t starts;
+
+				/** Lane of the latest start, or none. */
+				uint32_t lane;
+			};
+
+			/** A searching thread with the parts of the tree it has yet
+			 * to search, newest last. */
+			struct Worker {
+				std::mutex lock;
+				std::deque<State> tasks;
+				uint64_t nodes = 0;
+			};
+
+			/** What to minimise first. */
+			Goal goal_a;
+
+			/** Start of day 0 until all slots are available, in minutes. */
+			uint64_t start_a;
+
+			/** Slot per lane. Lanes of a slot are consecutive. */
+			std::vector<uint32_t> laneSlot_a;
+
+			/** First kind per slot, with an extra entry past the end.
+			 * Kinds of a slot are ordered by decreasing duration. */
+			std::vector<uint32_t> slotKinds_a;
+
+			/** Duration per kind in minutes. */
+			std::vector<uint16_t> kindDuration_a;
+
+			/** Jobs per kind in their current order. */
+			std::vector<std::vector<size_t>> kindJobs_a;
+
+			/** Schedule with the current order of the jobs. */
+			State initial_a;
+
+			/** Choices of the best schedule found. */
+			std::vector<uint32_t> best_a;
+
+			/** Goal and tie breaker of the best schedule found, as
+			 * returned by key(). */
+			std::atomic<uint64_t> bestKey_a;
+
+			/** Guards best_a and calls to the progress callback. */
+			std::mutex bestLock_a;
+
+			/** Progress callback of the current search. */
+			Progress progress_a;
+
+			/** All searching threads. */
+			std::vector<std::unique_ptr<Worker>> workers_a;
+
+			/** Number of tasks queued or being searched. */
+			std::atomic<size_t> pending_a;
+
+			/** Number of threads looking for work. */
+			std::atomic<unsigned> idle_a;
+
+			/** Whether the search ran out of time. */
+			std::atomic<bool> stop_a;
+
+			/** When the current search has to stop. */
+			std::chrono::steady_clock::time_point deadline_a;
+
+			/** Number of nodes searched by the last solve(). */
+			uint64_t nodes_a;
+
+			/** Combine a finish and number of check-ins into a single
+			 * number that orders schedules by the goal. */
+			uint64_t key(const uint64_t finish_i, const uint64_t checkins_i) const;
+
+			/** Find the lane with the earliest free time among the slots
+			 * with jobs left, the lowest one on a tie. */
+			uint32_t nextLane(const State & state_i) const;
+
+			/** Start a job of a kind on a lane, at the time it is free. */
+			void start(State & state_io, const uint32_t lane_i, const uint32_t kind_i) const;
+
+			/** Lower bound of key() over all completions of a schedule
+			 * whose next job starts on @p lane_i. */
+			uint64_t bound(const State & state_i, const uint32_t lane_i) const;
+
+			/** Record a complete schedule when it is better than the best
+			 * one so far. */
+			void offer(const State & state_i);
+
+			/** Search all completions of a schedule. */
+			void search(State & state_io, Worker & self_io);
+
+			/** Main loop of a searching thread. */
+			void work(const size_t self_i);
+
+		public:
+			/** Constructor.
+			 * @param planner_i Slots and jobs to find an order for.
+			 * @param goal_i What to minimise first.
+			 * @throws std::length_error when the jobs take too long to
+			 * compare schedules. */
+			Optimizer(const Planner & planner_i, const Goal goal_i);
+
+			/** Search for the best order, until the whole tree has been
+			 * searched or the time is up.
+			 * @param budget_i Maximum duration of the search.
+			 * @param threads_i Number of threads, 0 for one per processor.
+			 * @param progress_i Optional callback for better orders.
+			 * @returns True when the best order found is optimal. */
+			bool solve(
+				const std::chrono::steady_clock::duration & budget_i,
+				const unsigned threads_i = 0,
+				const Progress & progress_i = Progress()
+			);
+
+			/** Get the moment all jobs are done in the best order. */
+			Moment finish() const;
+
+			/** Get the number of check-ins of the best order. */
+			size_t checkins() const;
+
+			/** Get the number of schedules, complete or not, considered by
+			 * the last call to solve(). */
+			inline uint64_t nodes() const { return nodes_a; }
+
+			/** Reorder the jobs of a planner to the best order found.
+			 * @param planner_io The planner the optimizer was created with. */
+			void apply(Planner & planner_io) const;
+	};
+
+} // SdH namespace
@@ -0,0 +1,134 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <unistd.h>
+#include "OutputBuffer.h"
+
+namespace SdH {
+
+	OutputBuffer::OutputBuffer(const int fd_i, const size_t size_i):
+		fd_a(fd_i),
+		buffer_a(new char[size_i > 0 ? size_i : 1]),
+		size_a(size_i > 0 ? size_i : 1)
+	{
+		setp(buffer_a.get(), buffer_a.get() + size_a);
+	}
+
+	OutputBuffer::~OutputBuffer()
+	{
+		try {
+			flush();
+		} catch (const std::system_error &) {
+			// Nothing sensible to do in a destructor
+		}
+	}
+
+	void OutputBuffer::writeAll(const char * data_i, size_t size_i)
+	{
+		ssize_t count = 0;
+
+		while (size_i > 0) {
+			count = write(fd_a, data_i, size_i);
+			if (count < 0) {
+				if (errno == EINTR) continue;
+				throw std::system_error(errno, std::generic_category(), "Unable to write output");
+			}
+			data_i += count;
+			size_i -= count;
+		}
+	}
+
+	void OutputBuffer::flush()
+	{
+		const size_t used = pptr() - pbase();
+
+		// Reset first, so a failing write does not repeat old output
+		setp(buffer_a.get(), buffer_a.get() + size_a);
+		writeAll(buffer_a.get(), used);
+	}
+
+	OutputBuffer::int_type OutputBuffer::overflow(int_type ch_i)
+	{
+		try {
+			flush();
+		} catch (const std::system_error &) {
+			return traits_type::eof();
+		}
+
+		if (!traits_type::eq_int_type(ch_i, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(ch_i);
+			pbump(1);
+		}
+
+		return traits_type::not_eof(ch_i);
+	}
+
+	void OutputBuffer::append(const char * data_i, const size_t size_i)
+	{
+		if (size_i > static_cast<size_t>(epptr() - pptr())) {
+			flush();
+			if (size_i >= size_a) {
+				writeAll(data_i, size_i);
+				return;
+			}
+		}
+
+		memcpy(pptr(), data_i, size_i);
+		pbump(size_i);
+	}
+
+	std::streamsize OutputBuffer::xsputn(const char * str_i, std::streamsize size_i)
+	{
+		try {
+			append(str_i, size_i);
+		} catch (const std::system_error &) {
+			return 0;
+		}
+
+		return size_i;
+	}
+
+	int OutputBuffer::sync()
+	{
+		try {
+			flush();
+		} catch (const std::system_error &) {
+			return -1;
+		}
+
+		return 0;
+	}
+
+} // SdH namespace
@@ -0,0 +1,118 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <streambuf>
+
+namespace SdH {
+
+	/** Stream buffer that collects output in a large buffer and hands it to
+	 * a file descriptor with as few write(2) calls as possible. Use it with
+	 * an std::ostream to keep the regular stream operators. */
+	class OutputBuffer : public std::streambuf
+	{
+		protected:
+			/** File descriptor to write to. */
+			int fd_a;
+
+			/** Output buffer. */
+			std::unique_ptr<char[]> buffer_a;
+
+			/** Size of the output buffer in bytes. */
+			size_t size_a;
+
+			/** Write a block of data to the file descriptor completely.
+			 * @throws std::system_error when writing fails. */
+			void writeAll(const char * data_i, size_t size_i);
+
+			/** Flush the buffer and store @p ch_i in it. */
+			int_type overflow(int_type ch_i) override;
+
+			/** Store a block of characters, bypassing the buffer for large
+			 * blocks. */
+			std::streamsize xsputn(const char * str_i, std::streamsize size_i) override;
+
+			/** Flush the buffer.
+			 * @returns 0 on success, -1 on failure. */
+			int sync() override;
+
+		public:
+			/** Default size of the output buffer. */
+			static constexpr size_t defaultSize = 1 << 20;
+
+			/** Constructor.
+			 * @param fd_i File descriptor to write to. Ownership is not
+			 * transferred.
+			 * @param size_i Size of the output buffer. */
+			OutputBuffer(const int fd_i, const size_t size_i = defaultSize);
+
+			/** Destructor flushes remaining output, ignoring errors. */
+			~OutputBuffer();
+
+			/** Copying would duplicate buffered output, so don't. */
+			OutputBuffer(const OutputBuffer &) = delete;
+			OutputBuffer & operator=(const OutputBuffer &) = delete;
+
+			/** Get room to write directly into the buffer, flushing it
+			 * first when there is not enough room left. Call commit()
+			 * when done.
+			 * @param size_i Number of bytes needed, at most the buffer size.
+			 * @returns Position to write to.
+			 * @throws std::length_error when @p size_i exceeds the buffer.
+			 * @throws std::system_error when flushing fails. */
+			inline char * reserve(const size_t size_i) {
+				if (static_cast<size_t>(epptr() - pptr()) < size_i) {
+					if (size_i > size_a) throw std::length_error("Reservation exceeds output buffer");
+					flush();
+				}
+				return pptr();
+			}
+
+			/** Mark bytes written after reserve() as output.
+			 * @param end_i Position after the last written byte. */
+			inline void commit(const char * end_i) { pbump(end_i - pptr()); }
+
+			/** Append a block of data, bypassing the buffer when the block
+			 * is at least as large as the buffer itself.
+			 * @throws std::system_error when writing fails. */
+			void append(const char * data_i, const size_t size_i);
+
+			/** Write all buffered output to the file descriptor.
+			 * @throws std::system_error when writing fails. */
+			void flush();
+	};
+
+} // SdH namespace
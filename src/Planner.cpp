@@ -0,0 +1,288 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <string_view>
+#include "Planner.h"
+
+namespace {
+
+	/** Completion of the job running on a lane. */
+	struct Event {
+		/** Minutes since the start of day 0, for ordering. */
+		uint64_t when;
+
+		/** Global index of the lane. */
+		size_t lane;
+
+		/** Moment of completion. */
+		SdH::Moment at;
+
+		/** Order by time, then by lane, for a stable timetable. */
+		inline bool operator>(const Event & rhs_i) const {
+			return when != rhs_i.when ? when > rhs_i.when : lane > rhs_i.lane;
+		}
+	};
+
+	/** Split the first whitespace separated token off a line.
+	 * @param rest_io Remainder of the line, shortened past the token.
+	 * @returns The token, empty when there is none. */
+	std::string_view token(std::string_view & rest_io)
+	{
+		size_t begin = rest_io.find_first_not_of(" \t\r");
+		size_t end = 0;
+
+		if (begin == std::string_view::npos) begin = rest_io.size();
+		end = rest_io.find_first_of(" \t\r", begin);
+		if (end == std::string_view::npos) end = rest_io.size();
+
+		const std::string_view retval = rest_io.substr(begin, end - begin);
+
+		rest_io.remove_prefix(end);
+		return retval;
+	}
+
+	/** Append a moment formatted as "+D HH:MM". */
+	void append(std::string & out_io, const SdH::Moment & moment_i)
+	{
+		char buf[SdH::HoursMinutes::charsLength];
+
+		out_io += '+';
+		out_io += std::to_string(moment_i.day);
+		out_io += ' ';
+		out_io.append(buf, moment_i.time.toChars(buf) - buf);
+	}
+
+} // anonymous namespace
+
+namespace SdH {
+
+	Planner::Planner(const HoursMinutes & start_i):
+		start_a(start_i)
+	{ }
+
+	size_t Planner::addSlot(const std::string & name_i, const uint16_t lanes_i)
+	{
+		if (lanes_i == 0) {
+			throw std::invalid_argument("Slot \"" + name_i + "\" needs at least one lane");
+		}
+		if (!names_a.emplace(name_i, slots_a.size()).second) {
+			throw std::invalid_argument("Slot \"" + name_i + "\" already exists");
+		}
+
+		slots_a.push_back({name_i, lanes_i, {}});
+		return slots_a.size() - 1;
+	}
+
+	size_t Planner::addJob(
+		const std::string & slot_i,
+		const HoursMinutes & duration_i,
+		const std::string & label_i
+	) {
+		const auto it = names_a.find(slot_i);
+
+		if (it == names_a.end()) {
+			throw std::invalid_argument("Unknown slot \"" + slot_i + "\"");
+		}
+
+		slots_a[it->second].queue.push_back(jobs_a.size());
+		jobs_a.push_back({it->second, duration_i, label_i});
+		return jobs_a.size() - 1;
+	}
+
+	void Planner::queue(const size_t slot_i, const std::vector<size_t> & queue_i)
+	{
+		std::vector<size_t> before(slots_a.at(slot_i).queue), after(queue_i);
+
+		std::sort(before.begin(), before.end());
+		std::sort(after.begin(), after.end());
+		if (before != after) {
+			throw std::invalid_argument("New queue of slot \"" + slots_a[slot_i].name + "\" holds other jobs");
+		}
+		slots_a[slot_i].queue = queue_i;
+	}
+
+	void Planner::read(std::istream & is_io)
+	{
+		std::string line;
+		size_t lineno = 0;
+
+		while (std::getline(is_io, line)) {
+			std::string_view rest(line);
+			const std::string_view directive = token(rest);
+
+			lineno++;
+			if (directive.empty() || directive[0] == '#') continue;
+
+			try {
+				if (directive == "start") {
+					const std::string_view time = token(rest);
+
+					if (time.empty()) throw std::invalid_argument("Start without time");
+					start_a.set(time);
+				} else if (directive == "slot") {
+					const std::string name(token(rest));
+					const std::string_view lanestr = token(rest);
+					unsigned lanes = 1;
+
+					if (name.empty()) throw std::invalid_argument("Slot without name");
+					if (!lanestr.empty()) {
+						const std::from_chars_result res = std::from_chars(lanestr.data(), lanestr.data() + lanestr.size(), lanes);
+
+						if (res.ec != std::errc() || res.ptr != lanestr.data() + lanestr.size() || lanes > UINT16_MAX) {
+							throw std::invalid_argument("Invalid number of lanes \"" + std::string(lanestr) + "\"");
+						}
+					}
+					addSlot(name, lanes);
+				} else if (directive == "job") {
+					const std::string slot(token(rest));
+					const std::string_view durstr = token(rest);
+
+					if (durstr.empty()) throw std::invalid_argument("Job without duration");
+
+					const HoursMinutes duration(durstr);
+					const size_t begin = rest.find_first_not_of(" \t");
+					const size_t end = rest.find_last_not_of(" \t\r");
+
+					addJob(slot, duration, begin == std::string_view::npos ? "" : std::string(rest.substr(begin, end + 1 - begin)));
+				} else {
+					throw std::invalid_argument("Unknown directive \"" + std::string(directive) + "\"");
+				}
+
+				if (directive != "job" && !token(rest).empty()) {
+					throw std::invalid_argument("Trailing text after " + std::string(directive));
+				}
+			} catch (const std::exception & e) {
+				throw std::invalid_argument("Line " + std::to_string(lineno) + ": " + e.what());
+			}
+		}
+	}
+
+	const std::vector<Planner::Entry> & Planner::plan()
+	{
+		std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+		std::vector<size_t> laneSlot;
+		std::vector<uint16_t> laneNumber;
+		std::vector<size_t> next(slots_a.size(), 0);
+		const Moment begin = {0, start_a};
+
+		// Start the first job on a lane and schedule its completion
+		const auto startNext = [&](const size_t lane_i, const Moment & at_i) {
+			const size_t slot = laneSlot[lane_i];
+			size_t & cursor = next[slot];
+
+			if (cursor == slots_a[slot].queue.size()) return;
+
+			const size_t job = slots_a[slot].queue[cursor++];
+			Entry entry = {job, slot, laneNumber[lane_i], at_i, at_i};
+
+			entry.end += jobs_a[job].duration;
+			timetable_a.push_back(entry);
+			events.push({entry.end.minutes(), lane_i, entry.end});
+		};
+
+		timetable_a.clear();
+		timetable_a.reserve(jobs_a.size());
+		for (size_t s = 0; s < slots_a.size(); s++) {
+			for (uint16_t l = 0; l < slots_a[s].lanes; l++) {
+				laneSlot.push_back(s);
+				laneNumber.push_back(l);
+			}
+		}
+
+		for (size_t lane = 0; lane < laneSlot.size(); lane++) startNext(lane, begin);
+		while (!events.empty()) {
+			const Event ev = events.top();
+
+			events.pop();
+			startNext(ev.lane, ev.at);
+		}
+
+		return timetable_a;
+	}
+
+	Moment Planner::finish() const
+	{
+		Moment retval = {0, start_a};
+
+		for (const Entry & entry : timetable_a) {
+			if (entry.end.minutes() > retval.minutes()) retval = entry.end;
+		}
+		return retval;
+	}
+
+	size_t Planner::checkins() const
+	{
+		const Moment last = finish();
+		size_t retval = 0;
+		uint64_t previous = UINT64_MAX;
+
+		// The timetable is ordered by start
+		for (const Entry & entry : timetable_a) {
+			if (entry.start.minutes() != previous) retval++;
+			previous = entry.start.minutes();
+		}
+		if (!timetable_a.empty() && last.minutes() != previous) retval++;
+		return retval;
+	}
+
+	std::ostream & Planner::print(std::ostream & os_io) const
+	{
+		std::string line;
+
+		for (const Entry & entry : timetable_a) {
+			const std::string & label = jobs_a[entry.job].label;
+
+			line.clear();
+			append(line, entry.start);
+			line += ' ';
+			append(line, entry.end);
+			line += ' ';
+			line += slots_a[entry.slot].name;
+			line += '/';
+			line += std::to_string(entry.lane + 1);
+			if (!label.empty()) {
+				line += ' ';
+				line += label;
+			}
+			line += '\n';
+			os_io << line;
+		}
+
+		return os_io;
+	}
+
+} // SdH namespace
@@ -0,0 +1,203 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "HoursMinutes.h"
+#include "Moment.h"
+
+namespace SdH {
+
+	/** Plans a timetable for production slots that each work through a
+	 * queue of jobs. A slot has one or more lanes that run jobs at the same
+	 * time, like a building that produces several goods at once. A job
+	 * starts as soon as a lane of its slot is free, in the order the jobs
+	 * were added. Completions are simulated with a priority queue, so
+	 * planning takes O(n log n) for n jobs. */
+	class Planner
+	{
+		public:
+			/** A single job in the timetable. */
+			struct Entry {
+				/** Index of the job, in the order jobs were added. */
+				size_t job;
+
+				/** Index of the slot. */
+				size_t slot;
+
+				/** Lane within the slot, starting at 0. */
+				uint16_t lane;
+
+				/** When the job starts, the start day being day 0. */
+				Moment start;
+
+				/** When the job is done. */
+				Moment end;
+			};
+
+		protected:
+			/** A production slot. */
+			struct Slot {
+				/** Name of the slot. */
+				std::string name;
+
+				/** Number of jobs the slot runs at the same time. */
+				uint16_t lanes;
+
+				/** Indices of the jobs for this slot, in order. */
+				std::vector<size_t> queue;
+			};
+
+			/** A queued job. */
+			struct Job {
+				/** Index of the slot to run on. */
+				size_t slot;
+
+				/** How long the job takes. */
+				HoursMinutes duration;
+
+				/** Optional description. */
+				std::string label;
+			};
+
+			/** Time at which all slots are available. */
+			HoursMinutes start_a;
+
+			/** All slots, in the order they were added. */
+			std::vector<Slot> slots_a;
+
+			/** Slot indices by name. */
+			std::unordered_map<std::string, size_t> names_a;
+
+			/** All jobs, in the order they were added. */
+			std::vector<Job> jobs_a;
+
+			/** Planned jobs, ordered by start. */
+			std::vector<Entry> timetable_a;
+
+		public:
+			/** Constructor.
+			 * @param start_i Time at which all slots are available. */
+			explicit Planner(const HoursMinutes & start_i = HoursMinutes());
+
+			/** Get the time at which all slots are available. */
+			inline const HoursMinutes & start() const { return start_a; }
+
+			/** Set the time at which all slots are available. */
+			inline void start(const HoursMinutes & start_i) { start_a = start_i; }
+
+			/** Add a production slot.
+			 * @param name_i Unique name of the slot.
+			 * @param lanes_i Number of jobs the slot runs at the same time.
+			 * @returns The index of the new slot.
+			 * @throws std::invalid_argument when @p name_i is already in use
+			 * or @p lanes_i is 0. */
+			size_t addSlot(const std::string & name_i, const uint16_t lanes_i = 1);
+
+			/** Queue a job on a slot.
+			 * @param slot_i Name of the slot.
+			 * @param duration_i How long the job takes.
+			 * @param label_i Optional description.
+			 * @returns The index of the new job.
+			 * @throws std::invalid_argument when @p slot_i is unknown. */
+			size_t addJob(
+				const std::string & slot_i,
+				const HoursMinutes & duration_i,
+				const std::string & label_i = ""
+			);
+
+			/** Get the number of slots. */
+			inline size_t slots() const { return slots_a.size(); }
+
+			/** Get the number of lanes of a slot. */
+			inline uint16_t lanes(const size_t slot_i) const { return slots_a[slot_i].lanes; }
+
+			/** Get the jobs of a slot, in the order they will start. */
+			inline const std::vector<size_t> & queue(const size_t slot_i) const { return slots_a[slot_i].queue; }
+
+			/** Change the order in which the jobs of a slot start.
+			 * @param slot_i Index of the slot.
+			 * @param queue_i The jobs of the slot in their new order.
+			 * @throws std::invalid_argument when @p queue_i holds other
+			 * jobs than the slot. */
+			void queue(const size_t slot_i, const std::vector<size_t> & queue_i);
+
+			/** Get the duration of a job. */
+			inline const HoursMinutes & duration(const size_t job_i) const { return jobs_a[job_i].duration; }
+
+			/** Read a description with one directive per line. Empty lines
+			 * and lines starting with '#' are ignored. Directives are:
+			 * - "start <HH:MM>": time at which all slots are available;
+			 * - "slot <name> [<lanes>]": a slot, with one lane by default;
+			 * - "job <slot> <[HH:]MM> [<label>]": a job on an earlier slot.
+			 * @param is_io Stream to read from.
+			 * @throws std::invalid_argument when a line is invalid, with
+			 * the line number in the message. */
+			void read(std::istream & is_io);
+
+			/** Simulate all jobs and create the timetable.
+			 * @returns The timetable, ordered by start time. */
+			const std::vector<Entry> & plan();
+
+			/** Get the timetable created by the last call to plan(). */
+			inline const std::vector<Entry> & timetable() const { return timetable_a; }
+
+			/** Get the moment the last job of the timetable is done, or
+			 * the start when there are no jobs. */
+			Moment finish() const;
+
+			/** Get the number of check-ins the timetable of the last call
+			 * to plan() needs: one for every distinct start time and one to
+			 * collect the jobs that are done last. */
+			size_t checkins() const;
+
+			/** Get the name of a slot. */
+			inline const std::string & slotName(const size_t slot_i) const { return slots_a[slot_i].name; }
+
+			/** Get the description of a job. */
+			inline const std::string & jobLabel(const size_t job_i) const { return jobs_a[job_i].label; }
+
+			/** Write the timetable, one job per line: day and time of start
+			 * and end, slot name with lane number starting at 1, and the
+			 * job description, like "+0 09:34 +0 11:22 bakery/1 bread".
+			 * @returns @p os_io */
+			std::ostream & print(std::ostream & os_io) const;
+	};
+
+} // SdH namespace
@@ -0,0 +1,150 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include "BatchParser.h"
+#include "Recurrence.h"
+
+namespace SdH {
+
+	Recurrence::Recurrence(const HoursMinutes & start_i, const HoursMinutes & interval_i, const uint32_t days_i):
+		start_a(start_i),
+		interval_a(interval_i),
+		days_a(days_i)
+	{
+		// Adding nothing would never reach the end of the window
+		if (interval_a.minutesOfDay() == 0) throw std::invalid_argument("Recurrence needs an interval of at least a minute");
+	}
+
+	uint64_t Recurrence::size() const noexcept
+	{
+		const uint64_t window = uint64_t(days_a) * HoursMinutes::minutesPerDay;
+
+		if (days_a == 0) return 0;
+		return (window - start_a.minutesOfDay() - 1) / interval_a.minutesOfDay() + 1;
+	}
+
+	size_t RecurrenceMerge::add(const Recurrence & recurrence_i, const std::string & label_i)
+	{
+		const Recurrence::iterator first = recurrence_i.begin();
+
+		labels_a.push_back(label_i);
+		if (!first.done()) {
+			heap_a.push_back({first->minutes(), labels_a.size() - 1, first});
+			std::push_heap(heap_a.begin(), heap_a.end(), [](const Cursor & lhs_i, const Cursor & rhs_i) { return rhs_i < lhs_i; });
+		}
+		return labels_a.size() - 1;
+	}
+
+	void RecurrenceMerge::read(std::istream & is_io, const uint32_t days_i, const HoursMinutes & now_i)
+	{
+		std::string line;
+		size_t lineno = 0;
+
+		while (std::getline(is_io, line)) {
+			const size_t hash = std::min(line.find('#'), line.size());
+			const size_t first = line.find_first_not_of(" \t");
+			const size_t last = line.find_last_not_of(" \t\r", hash ? hash - 1 : 0);
+			const size_t labelFirst = line.find_first_not_of(" \t", hash + 1);
+			const size_t labelLast = line.find_last_not_of(" \t\r");
+			BatchParser::Record rec;
+
+			lineno++;
+			if (first >= hash) continue;
+
+			const std::string_view calc(line.data() + first, last + 1 - first);
+
+			BatchParser::parseLine(calc.data(), calc.data() + calc.size(), rec);
+			if (rec.result.ec != std::errc()) {
+				std::ostringstream oss;
+
+				HoursMinutes::printError(oss, rec.result, calc.data() + calc.size());
+				throw std::invalid_argument("Line " + std::to_string(lineno) + ": " + oss.str());
+			}
+			if (rec.kind == BatchParser::Kind::chained) {
+				throw std::invalid_argument("Line " + std::to_string(lineno) + ": A recurrence can't continue another one");
+			}
+
+			try {
+				add(
+					Recurrence(rec.kind == BatchParser::Kind::full ? rec.reference : now_i, rec.duration, days_i),
+					labelFirst == std::string::npos ? "" : line.substr(labelFirst, labelLast + 1 - labelFirst)
+				);
+			} catch (const std::invalid_argument & ia) {
+				throw std::invalid_argument("Line " + std::to_string(lineno) + ": " + ia.what());
+			}
+		}
+	}
+
+	void RecurrenceMerge::siftDown()
+	{
+		const size_t size = heap_a.size();
+		const Cursor moved = heap_a[0];
+		size_t hole = 0;
+
+		for (;;) {
+			size_t child = 2 * hole + 1;
+
+			if (child >= size) break;
+			if (child + 1 < size) child += heap_a[child + 1] < heap_a[child];
+			if (!(heap_a[child] < moved)) break;
+			heap_a[hole] = heap_a[child];
+			hole = child;
+		}
+		heap_a[hole] = moved;
+	}
+
+	bool RecurrenceMerge::next(Moment & occurrence_o, size_t & source_o)
+	{
+		if (heap_a.empty()) return false;
+
+		Cursor & top = heap_a[0];
+
+		occurrence_o = *top.pos;
+		source_o = top.source;
+
+		// The next occurrence replaces this one, or the last cursor does
+		if (!(++top.pos).done()) {
+			top.minutes = top.pos->minutes();
+		} else {
+			top = heap_a.back();
+			heap_a.pop_back();
+			if (heap_a.empty()) return true;
+		}
+		siftDown();
+		return true;
+	}
+
+} // SdH namespace
@@ -0,0 +1,220 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "HoursMinutes.h"
+#include "Moment.h"
+
+namespace SdH {
+
+	/** Something that happens every interval from a start time, like
+	 * "every 2:45 from 06:10", within a window of whole days. Occurrences
+	 * are computed one at a time while iterating, by adding the interval
+	 * to the previous one and counting the midnights passed, so a
+	 * recurrence takes the same memory however many times it occurs. */
+	class Recurrence
+	{
+		public:
+			/** Input iterator over the occurrences, in time order. */
+			class iterator
+			{
+				protected:
+					/** Current occurrence. */
+					Moment occurrence_a;
+
+					/** Time between occurrences. */
+					HoursMinutes interval_a;
+
+					/** First day after the window. */
+					uint32_t days_a;
+
+				public:
+					using iterator_category = std::input_iterator_tag;
+					using value_type = Moment;
+					using difference_type = std::ptrdiff_t;
+					using pointer = const Moment *;
+					using reference = const Moment &;
+
+					/** Constructor.
+					 * @param first_i First occurrence.
+					 * @param interval_i Time between occurrences, not 00:00.
+					 * @param days_i Number of days in the window. */
+					constexpr iterator(const Moment & first_i, const HoursMinutes & interval_i, const uint32_t days_i) noexcept:
+						occurrence_a(first_i),
+						interval_a(interval_i),
+						days_a(days_i)
+					{ }
+
+					/** Whether all occurrences in the window were visited. */
+					constexpr bool done() const noexcept { return occurrence_a.day >= days_a; }
+
+					constexpr reference operator*() const noexcept { return occurrence_a; }
+					constexpr pointer operator->() const noexcept { return &occurrence_a; }
+
+					/** Move to the next occurrence. */
+					inline iterator & operator++() noexcept {
+						occurrence_a += interval_a;
+						return *this;
+					}
+
+					inline iterator operator++(int) noexcept {
+						iterator retval(*this);
+
+						++*this;
+						return retval;
+					}
+
+					/** Iterators past the window are all equal. */
+					inline bool operator==(const iterator & rhs_i) const noexcept {
+						return done() ? rhs_i.done() : !rhs_i.done() && occurrence_a.minutes() == rhs_i.occurrence_a.minutes();
+					}
+
+					inline bool operator!=(const iterator & rhs_i) const noexcept { return !(*this == rhs_i); }
+			};
+
+		protected:
+			/** First occurrence, on the start day. */
+			HoursMinutes start_a;
+
+			/** Time between occurrences. */
+			HoursMinutes interval_a;
+
+			/** Number of days in the window. */
+			uint32_t days_a;
+
+		public:
+			/** Constructor.
+			 * @param start_i Time of the first occurrence, on the start day.
+			 * @param interval_i Time between occurrences.
+			 * @param days_i Number of days in the window, starting with the
+			 * start day.
+			 * @throws std::invalid_argument when @p interval_i is 00:00. */
+			Recurrence(const HoursMinutes & start_i, const HoursMinutes & interval_i, const uint32_t days_i);
+
+			/** Get the time of the first occurrence. */
+			inline const HoursMinutes & start() const { return start_a; }
+
+			/** Get the time between occurrences. */
+			inline const HoursMinutes & interval() const { return interval_a; }
+
+			/** Get the number of days in the window. */
+			inline uint32_t days() const { return days_a; }
+
+			/** Get the first occurrence. */
+			inline iterator begin() const { return iterator({0, start_a}, interval_a, days_a); }
+
+			/** Get the iterator past the window. */
+			inline iterator end() const { return iterator({days_a, HoursMinutes()}, interval_a, days_a); }
+
+			/** Get the number of occurrences in the window, without
+			 * visiting them. */
+			uint64_t size() const noexcept;
+	};
+
+	/** Merges the occurrences of many recurrences into a single stream in
+	 * time order. Only the next occurrence of every recurrence is kept, in
+	 * a binary heap, so the memory used only depends on the number of
+	 * recurrences and every occurrence takes O(log k) for k recurrences. */
+	class RecurrenceMerge
+	{
+		protected:
+			/** Next occurrence of a recurrence. */
+			struct Cursor {
+				/** Minutes of the occurrence since the start of the start
+				 * day, kept next to the position for cheap comparisons. */
+				uint64_t minutes;
+
+				/** Index of the recurrence, in the order it was added. */
+				size_t source;
+
+				/** Position in the recurrence. */
+				Recurrence::iterator pos;
+
+				/** Earlier occurrences come first, ties in the order added. */
+				inline bool operator<(const Cursor & rhs_i) const {
+					return minutes < rhs_i.minutes || (minutes == rhs_i.minutes && source < rhs_i.source);
+				}
+			};
+
+			/** Binary min-heap of the recurrences with occurrences left.
+			 * Taking an occurrence replaces the top and sifts it down once,
+			 * instead of popping and pushing as std::priority_queue would. */
+			std::vector<Cursor> heap_a;
+
+			/** Restore the heap after the top was replaced. */
+			void siftDown();
+
+			/** Description per recurrence. */
+			std::vector<std::string> labels_a;
+
+		public:
+			/** Add a recurrence.
+			 * @param recurrence_i Recurrence to add. Its occurrences are
+			 * computed from a copy.
+			 * @param label_i Optional description.
+			 * @returns The index of the recurrence, as returned by next(). */
+			size_t add(const Recurrence & recurrence_i, const std::string & label_i = "");
+
+			/** Read recurrences, one per line in the grammar of the
+			 * interactive mode, optionally followed by '#' and a description.
+			 * The reference time is the first occurrence and the duration
+			 * the interval, a lone duration starts at @p now_i. Empty lines
+			 * and lines starting with '#' are ignored.
+			 * @param is_io Stream to read from.
+			 * @param days_i Number of days in the window.
+			 * @param now_i Start of lines without a reference time.
+			 * @throws std::invalid_argument when a line is invalid, continues
+			 * a previous line or has an interval of 00:00, with the line
+			 * number in the message. */
+			void read(std::istream & is_io, const uint32_t days_i, const HoursMinutes & now_i);
+
+			/** Get the next occurrence of all recurrences.
+			 * @param occurrence_o Receives the occurrence.
+			 * @param source_o Receives the index of its recurrence.
+			 * @returns Whether there was an occurrence left. */
+			bool next(Moment & occurrence_o, size_t & source_o);
+
+			/** Get the number of recurrences with occurrences left. */
+			inline size_t size() const { return heap_a.size(); }
+
+			/** Get the description of a recurrence. */
+			inline const std::string & label(const size_t source_i) const { return labels_a[source_i]; }
+	};
+
+} // SdH namespace
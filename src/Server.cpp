@@ -0,0 +1,407 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Server.h"
+#include "Stats.h"
+
+namespace {
+
+	/** Maximum number of events handled per epoll_wait(2) call. */
+	constexpr int maxEvents = 64;
+
+	/** Number of bytes read from a connection at once. */
+	constexpr size_t readSize = 1 << 16;
+
+	/** Fill a socket address for @p path_i.
+	 * @throws std::invalid_argument when @p path_i doesn't fit. */
+	sockaddr_un address(const std::string & path_i)
+	{
+		sockaddr_un addr;
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (path_i.empty() || path_i.size() >= sizeof(addr.sun_path)) {
+			throw std::invalid_argument("Invalid socket path \"" + path_i + "\"");
+		}
+		memcpy(addr.sun_path, path_i.data(), path_i.size());
+		return addr;
+	}
+
+} // anonymous namespace
+
+namespace SdH {
+
+	Server::Server(const std::string & path_i):
+		path_a(path_i),
+		listenFd_a(-1),
+		epollFd_a(-1),
+		wakeFd_a(-1),
+		spareFd_a(-1),
+		paused_a(false)
+	{
+		epoll_event ev;
+
+		try {
+			bind();
+
+			epollFd_a = epoll_create1(EPOLL_CLOEXEC);
+			if (epollFd_a < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to create epoll instance");
+			}
+
+			wakeFd_a = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (wakeFd_a < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to create event file descriptor");
+			}
+
+			spareFd_a = open("/dev/null", O_RDONLY | O_CLOEXEC);
+			if (spareFd_a < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to reserve a file descriptor");
+			}
+
+			memset(&ev, 0, sizeof(ev));
+			ev.events = EPOLLIN;
+			ev.data.fd = listenFd_a;
+			if (epoll_ctl(epollFd_a, EPOLL_CTL_ADD, listenFd_a, &ev) < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to watch socket");
+			}
+			ev.data.fd = wakeFd_a;
+			if (epoll_ctl(epollFd_a, EPOLL_CTL_ADD, wakeFd_a, &ev) < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to watch event file descriptor");
+			}
+		} catch (...) {
+			cleanup();
+			throw;
+		}
+	}
+
+	Server::~Server()
+	{
+		cleanup();
+	}
+
+	void Server::cleanup() noexcept
+	{
+		for (const auto & conn : connections_a) ::close(conn.first);
+		connections_a.clear();
+
+		if (spareFd_a >= 0) ::close(spareFd_a);
+		if (wakeFd_a >= 0) ::close(wakeFd_a);
+		if (epollFd_a >= 0) ::close(epollFd_a);
+		if (listenFd_a >= 0) {
+			::close(listenFd_a);
+			unlink(path_a.c_str());
+		}
+		spareFd_a = wakeFd_a = epollFd_a = listenFd_a = -1;
+		paused_a = false;
+	}
+
+	void Server::bind()
+	{
+		const sockaddr_un addr = address(path_a);
+		const sockaddr *sa = reinterpret_cast<const sockaddr *>(&addr);
+		const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		int rc = 0;
+
+		if (fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "Unable to create socket");
+		}
+
+		rc = ::bind(fd, sa, sizeof(addr));
+		if (rc < 0 && errno == EADDRINUSE) {
+			// Only replace the socket file when nobody answers on it
+			const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+			if (probe >= 0) {
+				if (connect(probe, sa, sizeof(addr)) < 0 && errno == ECONNREFUSED) {
+					unlink(path_a.c_str());
+				}
+				::close(probe);
+			}
+			rc = ::bind(fd, sa, sizeof(addr));
+		}
+
+		if (rc < 0) {
+			const int err = errno;
+
+			::close(fd);
+			throw std::system_error(err, std::generic_category(), "Unable to bind socket to " + path_a);
+		}
+
+		// From here on cleanup() removes the socket file
+		listenFd_a = fd;
+		if (::listen(fd, SOMAXCONN) < 0) {
+			throw std::system_error(errno, std::generic_category(), "Unable to listen on " + path_a);
+		}
+	}
+
+	void Server::accept()
+	{
+		epoll_event ev;
+
+		memset(&ev, 0, sizeof(ev));
+		for (;;) {
+			const int fd = accept4(listenFd_a, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+			if (fd < 0) {
+				// Retry on interruption, otherwise wait for the next event
+				if (errno == EINTR || errno == ECONNABORTED) continue;
+				if (errno == EMFILE || errno == ENFILE) exhausted();
+				return;
+			}
+
+			std::unique_ptr<Connection> conn(new Connection());
+
+			conn->fd = fd;
+			conn->events = EPOLLIN;
+			conn->closing = false;
+			ev.events = conn->events;
+			ev.data.fd = fd;
+			if (epoll_ctl(epollFd_a, EPOLL_CTL_ADD, fd, &ev) < 0) {
+				::close(fd);
+				continue;
+			}
+			connections_a[fd] = std::move(conn);
+		}
+	}
+
+	void Server::exhausted() noexcept
+	{
+		// The listening socket stays readable, so without a connection
+		// to wait for, make room with the spare descriptor and drop the
+		// pending connection instead
+		if (spareFd_a < 0) spareFd_a = open("/dev/null", O_RDONLY | O_CLOEXEC);
+		if (!connections_a.empty() || spareFd_a < 0) {
+			listen(false);
+			return;
+		}
+
+		::close(spareFd_a);
+		const int fd = accept4(listenFd_a, nullptr, nullptr, SOCK_CLOEXEC);
+
+		if (fd >= 0) ::close(fd);
+		spareFd_a = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	}
+
+	void Server::listen(const bool listen_i) noexcept
+	{
+		epoll_event ev;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = listen_i ? static_cast<uint32_t>(EPOLLIN) : 0;
+		ev.data.fd = listenFd_a;
+		epoll_ctl(epollFd_a, EPOLL_CTL_MOD, listenFd_a, &ev);
+		paused_a = !listen_i;
+	}
+
+	bool Server::receive(Connection & conn_io)
+	{
+		const size_t used = conn_io.input.size();
+		size_t begin = 0, nl = 0;
+		ssize_t count = 0;
+
+		conn_io.input.resize(used + readSize);
+		do {
+			count = read(conn_io.fd, &conn_io.input[used], readSize);
+		} while (count < 0 && errno == EINTR);
+
+		if (count < 0) {
+			conn_io.input.resize(used);
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		conn_io.input.resize(used + count);
+
+		// Answer all complete lines, in order
+		while (!conn_io.closing && (nl = conn_io.input.find('\n', begin)) != std::string::npos) {
+			answer(conn_io, std::string_view(conn_io.input.data() + begin, nl - begin));
+			begin = nl + 1;
+		}
+		conn_io.input.erase(0, begin);
+
+		if (count == 0) {
+			// A final line without newline is answered like in batch mode
+			if (!conn_io.closing && !conn_io.input.empty()) answer(conn_io, conn_io.input);
+			conn_io.input.clear();
+			conn_io.closing = true;
+		}
+
+		return conn_io.closing || conn_io.input.size() <= maxLineLength;
+	}
+
+	void Server::answer(Connection & conn_io, const std::string_view & line_i)
+	{
+		Stats & stats = Stats::instance();
+		const bool timed = stats.enabled();
+		uint64_t ticks[4] = {timed ? Stats::ticks() : 0, 0, 0, 0};
+		BatchParser::Record rec = {};
+
+		if (line_i == "q" || line_i == "quit") {
+			conn_io.closing = true;
+			return;
+		}
+
+		if (!line_i.empty()) {
+			BatchParser::parseLine(line_i.data(), line_i.data() + line_i.size(), rec);
+			if (timed) ticks[1] = Stats::ticks();
+			if (rec.result.ec == std::errc()) conn_io.calc.apply(rec);
+			if (timed) ticks[2] = Stats::ticks();
+
+			if (rec.result.ec == std::errc()) {
+				char buf[HoursMinutes::charsLength];
+
+				conn_io.output.append(buf, conn_io.calc.result().toChars(buf) - buf);
+			} else {
+				errors_a.str("");
+				HoursMinutes::printError(errors_a, rec.result, line_i.data() + line_i.size());
+				conn_io.output += errors_a.str();
+			}
+		}
+		conn_io.output += '\n';
+
+		if (timed) {
+			Stats::Counters & counters = stats.local();
+
+			if (!line_i.empty()) counters.round(ticks);
+			counters.count(line_i.empty(), rec.result.ec);
+		}
+	}
+
+	bool Server::send(Connection & conn_io)
+	{
+		ssize_t count = 0;
+
+		while (!conn_io.output.empty()) {
+			count = ::send(conn_io.fd, conn_io.output.data(), conn_io.output.size(), MSG_NOSIGNAL);
+			if (count < 0) {
+				if (errno == EINTR) continue;
+				return errno == EAGAIN || errno == EWOULDBLOCK;
+			}
+			conn_io.output.erase(0, count);
+		}
+
+		return true;
+	}
+
+	void Server::update(Connection & conn_io)
+	{
+		epoll_event ev;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = 0;
+		if (!conn_io.closing && conn_io.output.size() < maxBacklog) ev.events |= EPOLLIN;
+		if (!conn_io.output.empty()) ev.events |= EPOLLOUT;
+		if (ev.events == conn_io.events) return;
+
+		ev.data.fd = conn_io.fd;
+		epoll_ctl(epollFd_a, EPOLL_CTL_MOD, conn_io.fd, &ev);
+		conn_io.events = ev.events;
+	}
+
+	void Server::close(const int fd_i) noexcept
+	{
+		// Closing also removes the descriptor from the epoll set
+		::close(fd_i);
+		connections_a.erase(fd_i);
+		if (paused_a) listen(true);
+	}
+
+	void Server::run()
+	{
+		epoll_event events[maxEvents];
+		uint64_t wakeups = 0;
+		int count = 0;
+
+		for (;;) {
+			count = epoll_wait(epollFd_a, events, maxEvents, -1);
+			if (count < 0) {
+				if (errno == EINTR) continue;
+				throw std::system_error(errno, std::generic_category(), "Unable to wait for events");
+			}
+
+			for (int i = 0; i < count; i++) {
+				const int fd = events[i].data.fd;
+
+				if (fd == wakeFd_a) {
+					// Reset the counter, so a later run() keeps running
+					if (read(wakeFd_a, &wakeups, sizeof(wakeups)) < 0) {
+						// Nothing to reset
+					}
+					return;
+				}
+
+				if (fd == listenFd_a) {
+					accept();
+					continue;
+				}
+
+				const auto it = connections_a.find(fd);
+
+				if (it == connections_a.end()) continue;
+
+				Connection & conn = *it->second;
+				bool ok = true;
+
+				// Input after "quit" is ignored, errors show when sending
+				if (!conn.closing && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+					ok = receive(conn);
+				}
+				if (ok) ok = send(conn);
+
+				if (!ok || (conn.closing && conn.output.empty())) {
+					close(fd);
+				} else {
+					update(conn);
+				}
+			}
+		}
+	}
+
+	void Server::stop() noexcept
+	{
+		const uint64_t one = 1;
+
+		if (write(wakeFd_a, &one, sizeof(one)) < 0) {
+			// The counter is already non-zero, so run() wakes up anyway
+		}
+	}
+
+} // SdH namespace
@@ -0,0 +1,180 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "Calculator.h"
+
+namespace SdH {
+
+	/** Answers lines in the grammar of the interactive mode on a Unix
+	 * domain stream socket, so scripts can avoid starting a process per
+	 * calculation. Every connection has its own Calculator and thus its
+	 * own previous answer. Replies are written like in batch mode: one
+	 * line with the result, the error message or nothing per request line.
+	 * Requests may be pipelined; "q" or "quit" closes the connection after
+	 * all earlier replies have been sent. All connections are served by a
+	 * single thread with epoll(7). */
+	class Server
+	{
+		protected:
+			/** State of a single client connection. */
+			struct Connection {
+				/** Socket of the client. */
+				int fd;
+
+				/** Events the socket is registered for. */
+				uint32_t events;
+
+				/** Whether to close once all output has been sent. */
+				bool closing;
+
+				/** Received bytes not yet forming a complete line. */
+				std::string input;
+
+				/** Replies not yet sent. */
+				std::string output;
+
+				/** Evaluates the lines of this connection. */
+				Calculator calc;
+			};
+
+			/** Path the socket is bound to. */
+			std::string path_a;
+
+			/** Listening socket, -1 when not open. */
+			int listenFd_a;
+
+			/** Epoll instance, -1 when not open. */
+			int epollFd_a;
+
+			/** Event file descriptor used to wake up run(), -1 when not open. */
+			int wakeFd_a;
+
+			/** Descriptor kept in reserve to refuse a connection when no
+			 * other descriptors are left, -1 when not open. */
+			int spareFd_a;
+
+			/** Whether the listening socket is left unwatched until a
+			 * connection closes, because no descriptors are left. */
+			bool paused_a;
+
+			/** Open connections by file descriptor. */
+			std::unordered_map<int, std::unique_ptr<Connection>> connections_a;
+
+			/** Formats error messages. */
+			std::ostringstream errors_a;
+
+			/** Close all file descriptors and remove the socket file. */
+			void cleanup() noexcept;
+
+			/** Bind the listening socket, replacing a stale socket file
+			 * left behind by a server that is no longer running.
+			 * @throws std::system_error when binding fails. */
+			void bind();
+
+			/** Accept all pending connections. */
+			void accept();
+
+			/** Stop a listening socket without free descriptors from
+			 * waking up run() at once again. Waits for a connection to
+			 * close, or refuses the pending connection when there are
+			 * none. */
+			void exhausted() noexcept;
+
+			/** Watch the listening socket for connections or not. */
+			void listen(const bool listen_i) noexcept;
+
+			/** Read from a connection and answer all complete lines.
+			 * @returns False when the connection failed. */
+			bool receive(Connection & conn_io);
+
+			/** Answer a single request line. */
+			void answer(Connection & conn_io, const std::string_view & line_i);
+
+			/** Send as much pending output as the socket accepts.
+			 * @returns False when the connection failed. */
+			bool send(Connection & conn_io);
+
+			/** Register for the events a connection currently needs. */
+			void update(Connection & conn_io);
+
+			/** Close a connection and forget about it. */
+			void close(const int fd_i) noexcept;
+
+		public:
+			/** Maximum length of a request line. Longer lines close the
+			 * connection. */
+			static constexpr size_t maxLineLength = 4096;
+
+			/** Stop reading from a connection while this many bytes of
+			 * replies are waiting to be sent. */
+			static constexpr size_t maxBacklog = 1 << 20;
+
+			/** Constructor creates the socket and starts listening.
+			 * @param path_i Path of the socket file.
+			 * @throws std::invalid_argument when @p path_i is too long.
+			 * @throws std::system_error when the socket can't be created,
+			 * for example because another server is using @p path_i. */
+			explicit Server(const std::string & path_i);
+
+			/** Destructor closes all connections and removes the socket
+			 * file. */
+			~Server();
+
+			/** Copying would close the sockets twice, so don't. */
+			Server(const Server &) = delete;
+			Server & operator=(const Server &) = delete;
+
+			/** Serve clients until stop() is called.
+			 * @throws std::system_error when waiting for events fails. */
+			void run();
+
+			/** Make run() return. Safe to call from another thread and
+			 * from a signal handler. */
+			void stop() noexcept;
+
+			/** Get the path of the socket file. */
+			inline const std::string & path() const { return path_a; }
+
+			/** Get the number of open connections. */
+			inline size_t connections() const { return connections_a.size(); }
+	};
+
+} // SdH namespace
@@ -0,0 +1,229 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <ostream>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "Stats.h"
+
+namespace SdH {
+
+	struct Stats::Slot {
+		/** Counters of this thread, if it counted anything. */
+		Counters * counters = nullptr;
+
+		/** Destructor hands the counters to the next thread. */
+		~Slot() {
+			if (counters != nullptr) instance().release(counters);
+		}
+	};
+
+	thread_local Stats::Slot Stats::slot_a;
+
+	Stats::Histogram::Histogram()
+	{
+		for (std::atomic<uint64_t> & count : counts_a) count.store(0, std::memory_order_relaxed);
+	}
+
+	void Stats::Histogram::addTo(std::vector<uint64_t> & sums_io) const
+	{
+		sums_io.resize(bucketCount, 0);
+		for (size_t i = 0; i < bucketCount; i++) sums_io[i] += counts_a[i].load(std::memory_order_relaxed);
+	}
+
+	Stats::Counters::Counters()
+	{
+		for (std::atomic<uint64_t> & lines : lines_a) lines.store(0, std::memory_order_relaxed);
+	}
+
+	Stats::Stats():
+		enabled_a(false),
+		startTicks_a(0),
+		signo_a(0),
+		stopping_a(false)
+	{ }
+
+	Stats::~Stats()
+	{
+		if (reporter_a.joinable()) {
+			stopping_a.store(true);
+			pthread_kill(reporter_a.native_handle(), signo_a);
+			reporter_a.join();
+		}
+	}
+
+	Stats & Stats::instance()
+	{
+		static Stats stats;
+		return stats;
+	}
+
+	uint64_t Stats::ticks() noexcept
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		struct timespec ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+	}
+
+	void Stats::enable()
+	{
+		std::lock_guard<std::mutex> lock(mutex_a);
+
+		startTime_a = std::chrono::steady_clock::now();
+		startTicks_a = ticks();
+		enabled_a.store(true, std::memory_order_relaxed);
+	}
+
+	Stats::Counters * Stats::acquire()
+	{
+		std::lock_guard<std::mutex> lock(mutex_a);
+		Counters *retval = nullptr;
+
+		if (!free_a.empty()) {
+			retval = free_a.back();
+			free_a.pop_back();
+			return retval;
+		}
+
+		all_a.emplace_back(new Counters());
+		return all_a.back().get();
+	}
+
+	void Stats::release(Counters * counters_i)
+	{
+		std::lock_guard<std::mutex> lock(mutex_a);
+
+		free_a.push_back(counters_i);
+	}
+
+	Stats::Counters & Stats::local()
+	{
+		if (slot_a.counters == nullptr) slot_a.counters = acquire();
+		return *slot_a.counters;
+	}
+
+	void Stats::report(std::ostream & os_io)
+	{
+		std::array<uint64_t, outcomeCount> lines = {};
+		std::array<std::vector<uint64_t>, stageCount> stages;
+		double elapsed = 0, nsPerTick = 1;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_a);
+			const uint64_t spent = ticks() - startTicks_a;
+
+			for (const std::unique_ptr<Counters> & counters : all_a) {
+				for (size_t i = 0; i < outcomeCount; i++) lines[i] += counters->lines_a[i].load(std::memory_order_relaxed);
+				for (size_t i = 0; i < stageCount; i++) counters->stages_a[i].addTo(stages[i]);
+			}
+			elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime_a).count();
+			if (spent > 0) nsPerTick = elapsed * 1e9 / spent;
+		}
+
+		const uint64_t total = lines[0] + lines[1] + lines[2] + lines[3];
+		static const char * const names[stageCount] = {"parse", "compute", "format"};
+		static const double percentiles[] = {50, 90, 99, 99.9, 100};
+		char buf[128];
+
+		os_io << "Lines: " << total << " (" << lines[static_cast<size_t>(Outcome::valid)] << " valid, ";
+		os_io << lines[static_cast<size_t>(Outcome::empty)] << " empty, ";
+		os_io << lines[static_cast<size_t>(Outcome::invalid)] << " invalid, ";
+		os_io << lines[static_cast<size_t>(Outcome::overflow)] << " out of range)\n";
+		snprintf(buf, sizeof(buf), "Throughput: %.0f lines/s over %.3f s\n", elapsed > 0 ? total / elapsed : 0.0, elapsed);
+		os_io << buf;
+		os_io << "Stage         lines      p50      p90      p99    p99.9      max (ns)\n";
+
+		// Report the lowest value of the bucket holding each percentile
+		for (size_t s = 0; s < stageCount; s++) {
+			const std::vector<uint64_t> & counts = stages[s];
+			uint64_t count = 0;
+
+			for (const uint64_t c : counts) count += c;
+			snprintf(buf, sizeof(buf), "%-8s %10llu", names[s], static_cast<unsigned long long>(count));
+			os_io << buf;
+			for (const double pct : percentiles) {
+				const uint64_t rank = count == 0 ? 0 : std::max<uint64_t>(1, static_cast<uint64_t>(count * pct / 100 + 0.5));
+				uint64_t seen = 0;
+				size_t b = 0;
+
+				for (; b + 1 < counts.size() && seen + counts[b] < rank; b++) seen += counts[b];
+				snprintf(buf, sizeof(buf), " %8.0f", count == 0 ? 0.0 : Histogram::lowest(b) * nsPerTick);
+				os_io << buf;
+			}
+			os_io << '\n';
+		}
+		os_io.flush();
+	}
+
+	void Stats::reportOnSignal(const int signo_i, const int fd_i)
+	{
+		sigset_t set;
+
+		if (reporter_a.joinable()) return;
+
+		sigemptyset(&set);
+		sigaddset(&set, signo_i);
+		pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+		signo_a = signo_i;
+		reporter_a = std::thread([this, set, fd_i]() {
+			int signo = 0;
+
+			while (sigwait(&set, &signo) == 0 && !stopping_a.load()) {
+				std::ostringstream oss;
+
+				report(oss);
+
+				const std::string text = oss.str();
+
+				// Best effort, there is nobody to tell when this fails
+				if (write(fd_i, text.data(), text.size()) < 0) break;
+			}
+		});
+	}
+
+} // SdH namespace
@@ -0,0 +1,262 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace SdH {
+
+	/** Process wide statistics on evaluated lines: how many there were,
+	 * how many failed and why, and how long parsing, computing and
+	 * formatting took. Collecting is off until enable() is called, which
+	 * leaves a single relaxed load per line or round of lines.
+	 *
+	 * Every thread counts in its own Counters, which only that thread
+	 * writes, so counting needs no locks or atomic read-modify-write
+	 * instructions. Counters of finished threads are handed to the next
+	 * new thread, so their counts stay in the totals. Stages are timed
+	 * with the processor's time stamp counter where available. */
+	class Stats
+	{
+		public:
+			/** Processing stages that are timed. */
+			enum class Stage : uint8_t { parse, compute, format };
+
+			/** Number of stages. */
+			static constexpr size_t stageCount = 3;
+
+			/** Outcome of a single line. */
+			enum class Outcome : uint8_t {
+				valid,    ///< Evaluated
+				empty,    ///< Nothing to evaluate
+				invalid,  ///< Malformed, std::invalid_argument when thrown
+				overflow  ///< Out of range, std::overflow_error when thrown
+			};
+
+			/** Number of outcomes. */
+			static constexpr size_t outcomeCount = 4;
+
+			/** Histogram with logarithmic buckets that are each split into
+			 * 16 linear ones, like HdrHistogram, so every value is known
+			 * within 1/16 of its size over the full 64 bit range. */
+			class Histogram
+			{
+				public:
+					/** Number of bits of linear sub-buckets. */
+					static constexpr unsigned subBits = 4;
+
+					/** Number of buckets for 64 bit values. */
+					static constexpr size_t bucketCount = (64 - subBits + 1) << subBits;
+
+				protected:
+					/** Number of values per bucket. */
+					std::array<std::atomic<uint64_t>, bucketCount> counts_a;
+
+				public:
+					/** Constructor creates an empty histogram. */
+					Histogram();
+
+					/** Get the bucket of a value. */
+					static constexpr size_t bucket(const uint64_t value_i) noexcept {
+						if (value_i < (1U << subBits)) return value_i;
+
+						const unsigned shift = 63 - __builtin_clzll(value_i) - subBits;
+
+						return (static_cast<size_t>(shift) << subBits) + (value_i >> shift);
+					}
+
+					/** Get the smallest value in a bucket. */
+					static constexpr uint64_t lowest(const size_t bucket_i) noexcept {
+						if (bucket_i < (1U << subBits) * 2) return bucket_i;
+						return static_cast<uint64_t>((bucket_i & ((1U << subBits) - 1)) | (1U << subBits))
+							<< ((bucket_i >> subBits) - 1);
+					}
+
+					/** Add a value a number of times. Only the owning thread
+					 * may call this. */
+					inline void record(const uint64_t value_i, const uint64_t count_i = 1) noexcept {
+						std::atomic<uint64_t> & slot = counts_a[bucket(value_i)];
+
+						slot.store(slot.load(std::memory_order_relaxed) + count_i, std::memory_order_relaxed);
+					}
+
+					/** Add the counts of this histogram to @p sums_io. */
+					void addTo(std::vector<uint64_t> & sums_io) const;
+			};
+
+			/** Counts of a single thread. */
+			class Counters
+			{
+				protected:
+					/** Number of lines per Outcome. */
+					std::array<std::atomic<uint64_t>, outcomeCount> lines_a;
+
+					/** Time per line in ticks, per Stage. */
+					std::array<Histogram, stageCount> stages_a;
+
+					friend class Stats;
+
+				public:
+					/** Constructor starts with no lines. */
+					Counters();
+
+					/** Count lines with an outcome. */
+					inline void count(const Outcome outcome_i, const uint64_t lines_i = 1) noexcept {
+						std::atomic<uint64_t> & slot = lines_a[static_cast<size_t>(outcome_i)];
+
+						slot.store(slot.load(std::memory_order_relaxed) + lines_i, std::memory_order_relaxed);
+					}
+
+					/** Count a line by the result of parsing it. */
+					inline void count(const bool empty_i, const std::errc ec_i) noexcept {
+						count(
+							empty_i ? Outcome::empty :
+							ec_i == std::errc() ? Outcome::valid :
+							ec_i == std::errc::result_out_of_range ? Outcome::overflow : Outcome::invalid
+						);
+					}
+
+					/** Record the time a stage took for a number of lines, as
+					 * that many lines that took an equal share each. */
+					inline void time(const Stage stage_i, const uint64_t ticks_i, const uint64_t lines_i = 1) noexcept {
+						if (lines_i > 0) stages_a[static_cast<size_t>(stage_i)].record(ticks_i / lines_i, lines_i);
+					}
+
+					/** Finish timing a round of lines: read the ticks at the end
+					 * of formatting and record every stage for the lines.
+					 * @param ticks_io Ticks at the start of parsing, computing
+					 * and formatting, receives the ticks at the end.
+					 * @param lines_i Number of lines in the round. */
+					inline void round(uint64_t (&ticks_io)[stageCount + 1], const uint64_t lines_i = 1) noexcept {
+						ticks_io[stageCount] = Stats::ticks();
+						time(Stage::parse, ticks_io[1] - ticks_io[0], lines_i);
+						time(Stage::compute, ticks_io[2] - ticks_io[1], lines_i);
+						time(Stage::format, ticks_io[3] - ticks_io[2], lines_i);
+					}
+			};
+
+		protected:
+			/** Whether statistics are collected. */
+			std::atomic<bool> enabled_a;
+
+			/** Guards the lists of counters. */
+			std::mutex mutex_a;
+
+			/** Counters of all threads that ever counted. */
+			std::vector<std::unique_ptr<Counters>> all_a;
+
+			/** Counters of finished threads, ready for reuse. */
+			std::vector<Counters *> free_a;
+
+			/** Ticks when collecting started. */
+			uint64_t startTicks_a;
+
+			/** Time when collecting started. */
+			std::chrono::steady_clock::time_point startTime_a;
+
+			/** Thread started by reportOnSignal(), joined by the destructor. */
+			std::thread reporter_a;
+
+			/** Signal the reporter waits for. */
+			int signo_a;
+
+			/** Makes the reporter return on its next signal. */
+			std::atomic<bool> stopping_a;
+
+			/** Holds the counters of a thread and hands them back to
+			 * release() when the thread ends. */
+			struct Slot;
+
+			/** Slot of the calling thread. */
+			static thread_local Slot slot_a;
+
+			/** Get counters for a new thread. */
+			Counters * acquire();
+
+			/** Return the counters of a finished thread. */
+			void release(Counters * counters_i);
+
+			/** Constructor, collecting is off. There is only one, as
+			 * every thread holds its counters in a single slot. */
+			Stats();
+
+			/** Destructor stops the reporter before anything it reports
+			 * on is destroyed. */
+			~Stats();
+
+		public:
+			/** Copying would split the counts, so don't. */
+			Stats(const Stats &) = delete;
+			Stats & operator=(const Stats &) = delete;
+
+			/** Get the process wide statistics. */
+			static Stats & instance();
+
+			/** Read the time stamp counter, or a monotonic clock in
+			 * nanoseconds on processors without one. */
+			static uint64_t ticks() noexcept;
+
+			/** Start collecting statistics. */
+			void enable();
+
+			/** Check whether statistics are collected. */
+			inline bool enabled() const noexcept { return enabled_a.load(std::memory_order_relaxed); }
+
+			/** Get the counters of the calling thread.
+			 * @throws std::bad_alloc when out of memory. */
+			Counters & local();
+
+			/** Write the totals of all threads: lines per outcome, lines per
+			 * second since enable() and percentiles of the time per line
+			 * of every stage in nanoseconds. */
+			void report(std::ostream & os_io);
+
+			/** Write a report to @p fd_i every time signal @p signo_i
+			 * arrives, from a thread of its own. The signal is blocked in
+			 * the calling thread, so call this before starting others.
+			 * Only the first call starts a thread.
+			 * @throws std::system_error when the thread can't be started. */
+			void reportOnSignal(const int signo_i, const int fd_i);
+	};
+
+} // SdH namespace
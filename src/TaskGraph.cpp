@@ -0,0 +1,267 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "TaskGraph.h"
+
+namespace SdH {
+
+	TaskGraph::TaskGraph(const HoursMinutes & start_i):
+		start_a(start_i.minutesOfDay())
+	{ }
+
+	void TaskGraph::check(const Node node_i) const
+	{
+		if (node_i >= size()) throw std::out_of_range("Unknown node " + std::to_string(node_i));
+	}
+
+	void TaskGraph::mark(const Node node_i)
+	{
+		if (queued_a[node_i]) return;
+		queued_a[node_i] = true;
+		dirty_a.emplace(order_a[node_i], node_i);
+	}
+
+	TaskGraph::Node TaskGraph::addNode(const HoursMinutes & duration_i)
+	{
+		const Node node = size();
+
+		if (node == none) throw std::length_error("Too many nodes");
+
+		// Without dependencies a node is computed right away
+		duration_a.push_back(duration_i.minutesOfDay());
+		release_a.push_back(start_a);
+		earliest_a.push_back(start_a);
+		finish_a.push_back(start_a + duration_i.minutesOfDay());
+		critical_a.push_back(none);
+		preds_a.emplace_back();
+		succs_a.emplace_back();
+		order_a.push_back(node);
+		nodes_a.push_back(node);
+		queued_a.push_back(false);
+		visited_a.push_back(false);
+		latest_a.emplace(finish_a.back(), node);
+		return node;
+	}
+
+	void TaskGraph::reorder(const Node from_i, const Node to_i)
+	{
+		const Node lower = order_a[to_i];
+		const Node upper = order_a[from_i];
+		std::vector<Node> forward(1, to_i), backward(1, from_i), positions;
+		bool cycle = false;
+
+		// Nodes reachable from to_i that are not after from_i yet
+		visited_a[to_i] = true;
+		for (size_t i = 0; i < forward.size() && !cycle; i++) {
+			for (const Node succ : succs_a[forward[i]]) {
+				if (succ == from_i) cycle = true;
+				if (visited_a[succ] || order_a[succ] >= upper) continue;
+				visited_a[succ] = true;
+				forward.push_back(succ);
+			}
+		}
+
+		if (cycle) {
+			for (const Node node : forward) visited_a[node] = false;
+			throw std::invalid_argument(
+				"Dependency of node " + std::to_string(to_i) + " on node " +
+				std::to_string(from_i) + " closes a cycle"
+			);
+		}
+
+		// Nodes from_i is reachable from that are not before to_i yet
+		visited_a[from_i] = true;
+		for (size_t i = 0; i < backward.size(); i++) {
+			for (const Node pred : preds_a[backward[i]]) {
+				if (visited_a[pred] || order_a[pred] <= lower) continue;
+				visited_a[pred] = true;
+				backward.push_back(pred);
+			}
+		}
+
+		// Give both sets the same positions, backward ones first
+		const auto before = [this](const Node a_i, const Node b_i) { return order_a[a_i] < order_a[b_i]; };
+
+		std::sort(forward.begin(), forward.end(), before);
+		std::sort(backward.begin(), backward.end(), before);
+		for (const Node node : backward) positions.push_back(order_a[node]);
+		for (const Node node : forward) positions.push_back(order_a[node]);
+		std::sort(positions.begin(), positions.end());
+
+		size_t i = 0;
+
+		for (const Node node : backward) {
+			visited_a[node] = false;
+			order_a[node] = positions[i++];
+			nodes_a[order_a[node]] = node;
+		}
+		for (const Node node : forward) {
+			visited_a[node] = false;
+			order_a[node] = positions[i++];
+			nodes_a[order_a[node]] = node;
+		}
+
+		// Queued nodes may have moved
+		if (!dirty_a.empty()) {
+			std::vector<Node> queued;
+
+			for (; !dirty_a.empty(); dirty_a.pop()) queued.push_back(dirty_a.top().second);
+			for (const Node node : queued) dirty_a.emplace(order_a[node], node);
+		}
+	}
+
+	void TaskGraph::addEdge(const Node from_i, const Node to_i)
+	{
+		check(from_i);
+		check(to_i);
+		if (from_i == to_i) {
+			throw std::invalid_argument("Node " + std::to_string(to_i) + " can't depend on itself");
+		}
+
+		const std::vector<Node> & succs = succs_a[from_i];
+
+		if (std::find(succs.begin(), succs.end(), to_i) != succs.end()) return;
+		if (order_a[to_i] < order_a[from_i]) reorder(from_i, to_i);
+
+		succs_a[from_i].push_back(to_i);
+		preds_a[to_i].push_back(from_i);
+		mark(to_i);
+	}
+
+	bool TaskGraph::removeEdge(const Node from_i, const Node to_i)
+	{
+		check(from_i);
+		check(to_i);
+
+		std::vector<Node> & succs = succs_a[from_i];
+		std::vector<Node> & preds = preds_a[to_i];
+		const auto succ = std::find(succs.begin(), succs.end(), to_i);
+
+		if (succ == succs.end()) return false;
+
+		*succ = succs.back();
+		succs.pop_back();
+		*std::find(preds.begin(), preds.end(), from_i) = preds.back();
+		preds.pop_back();
+		mark(to_i);
+		return true;
+	}
+
+	HoursMinutes TaskGraph::duration(const Node node_i) const
+	{
+		HoursMinutes retval;
+
+		retval.minutesOfDay(duration_a[node_i]);
+		return retval;
+	}
+
+	void TaskGraph::duration(const Node node_i, const HoursMinutes & duration_i)
+	{
+		check(node_i);
+		if (duration_a[node_i] == duration_i.minutesOfDay()) return;
+		duration_a[node_i] = duration_i.minutesOfDay();
+		mark(node_i);
+	}
+
+	void TaskGraph::release(const Node node_i, const Moment & release_i)
+	{
+		check(node_i);
+		if (release_a[node_i] == release_i.minutes()) return;
+		release_a[node_i] = release_i.minutes();
+		mark(node_i);
+	}
+
+	size_t TaskGraph::update()
+	{
+		size_t count = 0;
+
+		while (!dirty_a.empty()) {
+			const Node node = dirty_a.top().second;
+			uint64_t earliest = release_a[node];
+			Node critical = none;
+
+			dirty_a.pop();
+			if (!queued_a[node]) continue;
+			queued_a[node] = false;
+			count++;
+
+			for (const Node pred : preds_a[node]) {
+				if (finish_a[pred] <= earliest) continue;
+				earliest = finish_a[pred];
+				critical = pred;
+			}
+			earliest_a[node] = earliest;
+			critical_a[node] = critical;
+
+			// Successors only need work when the finish moves
+			if (earliest + duration_a[node] == finish_a[node]) continue;
+			finish_a[node] = earliest + duration_a[node];
+			latest_a.emplace(finish_a[node], node);
+			for (const Node succ : succs_a[node]) mark(succ);
+		}
+
+		// Keep an up to date latest finish on top, or start over
+		if (latest_a.size() > 2 * size() + 1024) {
+			std::vector<std::pair<uint64_t, Node>> latest;
+
+			latest.reserve(size());
+			for (Node node = 0; node < size(); node++) latest.emplace_back(finish_a[node], node);
+			latest_a = std::priority_queue<std::pair<uint64_t, Node>>(latest.begin(), latest.end());
+		}
+		while (!latest_a.empty() && latest_a.top().first != finish_a[latest_a.top().second]) {
+			latest_a.pop();
+		}
+
+		return count;
+	}
+
+	Moment TaskGraph::finish() const
+	{
+		return Moment::fromMinutes(latest_a.empty() ? start_a : latest_a.top().first);
+	}
+
+	std::vector<TaskGraph::Node> TaskGraph::criticalPath() const
+	{
+		std::vector<Node> retval;
+
+		if (latest_a.empty()) return retval;
+		for (Node node = latest_a.top().second; node != none; node = critical_a[node]) {
+			retval.push_back(node);
+		}
+		std::reverse(retval.begin(), retval.end());
+		return retval;
+	}
+
+} // SdH namespace
@@ -0,0 +1,191 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "HoursMinutes.h"
+#include "Moment.h"
+
+namespace SdH {
+
+	/** Directed acyclic graph of processes with a duration each, where a
+	 * process can only start when all processes it depends on are done.
+	 * Computes the earliest start and finish of every node and the
+	 * critical path that determines when everything is done.
+	 *
+	 * Edits only mark the nodes they touch. update() then recomputes those
+	 * nodes in topological order and continues to successors only when a
+	 * finish time actually changed, so the cost of an edit is bounded by
+	 * the affected downstream subgraph. The topological order is kept up
+	 * to date on every new edge with the algorithm of Pearce and Kelly,
+	 * which only reorders the nodes between the two ends of the edge. */
+	class TaskGraph
+	{
+		public:
+			/** Index of a node. */
+			typedef uint32_t Node;
+
+			/** No node, for example the critical predecessor of a node
+			 * that starts at its release time. */
+			static constexpr Node none = UINT32_MAX;
+
+		protected:
+			/** Release time used for new nodes, in minutes since day 0. */
+			uint64_t start_a;
+
+			/** Duration per node in minutes. */
+			std::vector<uint16_t> duration_a;
+
+			/** Earliest start per node regardless of dependencies. */
+			std::vector<uint64_t> release_a;
+
+			/** Earliest start per node, as of the last update(). */
+			std::vector<uint64_t> earliest_a;
+
+			/** Earliest finish per node, as of the last update(). */
+			std::vector<uint64_t> finish_a;
+
+			/** Predecessor finishing last per node, or none. */
+			std::vector<Node> critical_a;
+
+			/** Nodes each node depends on. */
+			std::vector<std::vector<Node>> preds_a;
+
+			/** Nodes depending on each node. */
+			std::vector<std::vector<Node>> succs_a;
+
+			/** Topological position per node. */
+			std::vector<Node> order_a;
+
+			/** Node per topological position. */
+			std::vector<Node> nodes_a;
+
+			/** Whether a node is waiting in dirty_a. */
+			std::vector<bool> queued_a;
+
+			/** Marks used while searching for nodes to reorder. */
+			std::vector<bool> visited_a;
+
+			/** Nodes to recompute, by topological position. */
+			std::priority_queue<
+				std::pair<Node, Node>,
+				std::vector<std::pair<Node, Node>>,
+				std::greater<std::pair<Node, Node>>
+			> dirty_a;
+
+			/** Latest finishes with their node, possibly outdated. */
+			std::priority_queue<std::pair<uint64_t, Node>> latest_a;
+
+			/** Queue a node for recomputation. */
+			void mark(const Node node_i);
+
+			/** Check that a node exists.
+			 * @throws std::out_of_range when it doesn't. */
+			void check(const Node node_i) const;
+
+			/** Restore the topological order after adding the edge
+			 * @p from_i to @p to_i, with @p to_i currently before
+			 * @p from_i.
+			 * @throws std::invalid_argument when the edge closes a cycle. */
+			void reorder(const Node from_i, const Node to_i);
+
+		public:
+			/** Constructor.
+			 * @param start_i Release time of new nodes on day 0. */
+			explicit TaskGraph(const HoursMinutes & start_i = HoursMinutes());
+
+			/** Get the number of nodes. */
+			inline size_t size() const { return duration_a.size(); }
+
+			/** Add a node without dependencies.
+			 * @param duration_i Duration of the process.
+			 * @returns The new node. */
+			Node addNode(const HoursMinutes & duration_i);
+
+			/** Make @p to_i depend on @p from_i. Adding an existing edge
+			 * has no effect.
+			 * @throws std::out_of_range when a node doesn't exist.
+			 * @throws std::invalid_argument when the edge closes a cycle. */
+			void addEdge(const Node from_i, const Node to_i);
+
+			/** Remove the dependency of @p to_i on @p from_i.
+			 * @returns False when there was no such dependency.
+			 * @throws std::out_of_range when a node doesn't exist. */
+			bool removeEdge(const Node from_i, const Node to_i);
+
+			/** Get the duration of a node. */
+			HoursMinutes duration(const Node node_i) const;
+
+			/** Change the duration of a node.
+			 * @throws std::out_of_range when the node doesn't exist. */
+			void duration(const Node node_i, const HoursMinutes & duration_i);
+
+			/** Get the release time of a node. */
+			inline Moment release(const Node node_i) const { return Moment::fromMinutes(release_a[node_i]); }
+
+			/** Change the time before which a node can't start, regardless
+			 * of its dependencies.
+			 * @throws std::out_of_range when the node doesn't exist. */
+			void release(const Node node_i, const Moment & release_i);
+
+			/** Recompute all nodes affected by edits since the last call.
+			 * @returns The number of recomputed nodes. */
+			size_t update();
+
+			/** Get the earliest start of a node, as of the last update(). */
+			inline Moment earliestStart(const Node node_i) const { return Moment::fromMinutes(earliest_a[node_i]); }
+
+			/** Get the earliest finish of a node, as of the last update(). */
+			inline Moment earliestFinish(const Node node_i) const { return Moment::fromMinutes(finish_a[node_i]); }
+
+			/** Get the predecessor that finishes last and thus determines
+			 * the earliest start of a node, or none when the release time
+			 * does, as of the last update(). */
+			inline Node criticalPredecessor(const Node node_i) const { return critical_a[node_i]; }
+
+			/** Get the moment all nodes are done as of the last update(),
+			 * or the start when there are no nodes. */
+			Moment finish() const;
+
+			/** Get the critical path as of the last update(): the chain of
+			 * critical predecessors ending in the node that finishes last,
+			 * first node first. Empty when there are no nodes. */
+			std::vector<Node> criticalPath() const;
+	};
+
+} // SdH namespace
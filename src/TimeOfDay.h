@@ -0,0 +1,320 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include "HoursMinutes.h"
+
+namespace SdH {
+
+	/** Smallest step of a time of day, as the number of milliseconds. */
+	enum class Resolution : uint32_t {
+		minutes = 60000,    ///< HH:MM
+		seconds = 1000,     ///< HH:MM:SS
+		milliseconds = 1    ///< HH:MM:SS.mmm
+	};
+
+	/** Time of day or duration below a day at a given resolution, stored
+	 * as the number of steps since midnight. All limits are constants of
+	 * the instantiation, so divisions compile to multiplications.
+	 * Strings look like [HH:]MM[:SS[.mmm]], where seconds and fractions
+	 * are only accepted as far as the resolution allows. */
+	template <Resolution R>
+	class TimeOfDay
+	{
+		public:
+			/** Number of milliseconds per step. */
+			static constexpr uint32_t msPerTick = static_cast<uint32_t>(R);
+
+			/** Number of steps per second, 0 when seconds are too fine. */
+			static constexpr uint32_t ticksPerSecond = R == Resolution::minutes ? 0 : 1000 / msPerTick;
+
+			/** Number of steps per minute. */
+			static constexpr uint32_t ticksPerMinute = 60000 / msPerTick;
+
+			/** Number of steps per hour. */
+			static constexpr uint32_t ticksPerHour = 60 * ticksPerMinute;
+
+			/** Number of steps per day, where times wrap. */
+			static constexpr uint32_t ticksPerDay = 24 * ticksPerHour;
+
+			/** Smallest unsigned type holding two days of steps, so a sum
+			 * of two times can't overflow before wrapping. */
+			using Ticks = std::conditional_t<2 * ticksPerDay <= UINT16_MAX, uint16_t, uint32_t>;
+
+			/** Number of characters written by toChars(). */
+			static constexpr size_t charsLength = R == Resolution::minutes ? 5 : R == Resolution::seconds ? 8 : 12;
+
+		protected:
+			/** Steps since midnight, always below ticksPerDay. */
+			Ticks ticks_a;
+
+			/** Parse one field of at most @p digits_i digits.
+			 * @returns Parse result, see fromChars(). */
+			static constexpr HoursMinutes::ParseResult parseField(
+				const char * first_i,
+				const char * last_i,
+				const size_t digits_i,
+				const uint32_t max_i,
+				uint32_t & value_o
+			) noexcept {
+				uint32_t rv = 0; // Return Value
+
+				for (const char *cp = first_i; cp != last_i; cp++) {
+					if (*cp < '0' || *cp > '9') return {cp, std::errc::invalid_argument};
+					rv = rv * 10 + (*cp - '0');
+				}
+				if (static_cast<size_t>(last_i - first_i) > digits_i) return {first_i + digits_i, std::errc::invalid_argument};
+				if (rv > max_i) return {first_i, std::errc::result_out_of_range};
+
+				value_o = rv;
+				return {last_i, std::errc()};
+			}
+
+			/** Throw the exception belonging to a failed parse. Not being
+			 * constexpr, reaching it while evaluating a constant expression
+			 * makes the compilation fail.
+			 * @throws std::invalid_argument when string can't be parsed.
+			 * @throws std::overflow_error when a value is out of range. */
+			[[noreturn]] static void throwParseError(const std::string_view & str_i, const HoursMinutes::ParseResult & res_i) {
+				const std::string field(res_i.ptr, str_i.data() + str_i.size());
+
+				if (res_i.ec == std::errc::result_out_of_range) {
+					throw std::overflow_error("Value out of range at \"" + field + '"');
+				}
+				throw std::invalid_argument("Invalid time at \"" + field + '"');
+			}
+
+		public:
+			/** Empty constructor initializes to midnight. */
+			constexpr TimeOfDay() : ticks_a(0) {}
+
+			/** String constructor, at compile time when used in a
+			 * constant expression.
+			 * @param str_i String to parse.
+			 * @throws std::invalid_argument when string can't be parsed.
+			 * @throws std::overflow_error when a value is out of range. */
+			explicit constexpr TimeOfDay(const std::string_view & str_i) : ticks_a(0) {
+				set(str_i);
+			}
+
+			/** Convert from minute resolution, which is always exact. */
+			explicit constexpr TimeOfDay(const HoursMinutes & hm_i) : ticks_a(hm_i.minutesOfDay() * ticksPerMinute) {}
+
+			/** Create a time from the number of steps since midnight.
+			 * @throws std::overflow_error in case @p ticks_i is a day or more. */
+			static constexpr TimeOfDay fromTicks(const uint32_t ticks_i) {
+				TimeOfDay retval;
+
+				if (ticks_i >= ticksPerDay) throw std::overflow_error("Time should be smaller than a day.");
+				retval.ticks_a = ticks_i;
+				return retval;
+			}
+
+			/** Get the number of steps since midnight. */
+			constexpr Ticks ticks() const { return ticks_a; }
+
+			/** Get the number of hours in 24-hour format. */
+			constexpr uint8_t hours() const { return ticks_a / ticksPerHour; }
+
+			/** Get the number of minutes within the hour. */
+			constexpr uint8_t minutes() const { return ticks_a / ticksPerMinute % 60; }
+
+			/** Get the number of seconds within the minute. */
+			constexpr uint8_t seconds() const {
+				if constexpr (ticksPerSecond == 0) return 0;
+				else return ticks_a / ticksPerSecond % 60;
+			}
+
+			/** Get the number of milliseconds within the second. */
+			constexpr uint16_t milliseconds() const {
+				if constexpr (ticksPerSecond == 0) return 0;
+				else return ticks_a % ticksPerSecond * msPerTick;
+			}
+
+			/** Get the time rounded down to minute resolution. */
+			constexpr HoursMinutes hoursMinutes() const {
+				HoursMinutes retval;
+
+				retval.minutesOfDay(ticks_a / ticksPerMinute);
+				return retval;
+			}
+
+			/** Add in-place operator, wrapping at midnight.
+			 * @returns A reference to the current object. */
+			constexpr TimeOfDay & operator+=(const TimeOfDay & rhs_i) {
+				Ticks sum = ticks_a + rhs_i.ticks_a;
+
+				sum -= sum >= ticksPerDay ? ticksPerDay : 0;
+				ticks_a = sum;
+				return *this;
+			}
+
+			/** Addition operator. */
+			constexpr TimeOfDay operator+(const TimeOfDay & rhs_i) const {
+				TimeOfDay retval(*this);
+				return retval += rhs_i;
+			}
+
+			/** Equality operator. */
+			constexpr bool operator==(const TimeOfDay & rhs_i) const { return ticks_a == rhs_i.ticks_a; }
+
+			/** Inequality operator. */
+			constexpr bool operator!=(const TimeOfDay & rhs_i) const { return ticks_a != rhs_i.ticks_a; }
+
+			/** Set the time from a string formatted like HH:MM:SS.mmm.
+			 * @throws std::invalid_argument when string can't be parsed.
+			 * @throws std::overflow_error when a value is out of range. */
+			constexpr void set(const std::string_view & str_i) {
+				const HoursMinutes::ParseResult res = fromChars(str_i.data(), str_i.data() + str_i.size(), *this);
+
+				if (res.ec != std::errc()) throwParseError(str_i, res);
+			}
+
+			/** Parse a time formatted like [HH:]MM[:SS[.mmm]] without
+			 * throwing or allocating memory. A lone field holds minutes,
+			 * like with HoursMinutes. Fractions have up to three digits,
+			 * where ".5" means half a second.
+			 * @param first_i First character to parse.
+			 * @param last_i One past the last character to parse.
+			 * @param tod_o Receives the time on success, untouched otherwise.
+			 * @returns The parse result, with ptr set to @p last_i on
+			 * success. */
+			static constexpr HoursMinutes::ParseResult fromChars(
+				const char * first_i,
+				const char * last_i,
+				TimeOfDay & tod_o
+			) noexcept {
+				const char *ends[3] = {last_i, last_i, last_i}; // Ends of the fields
+				const char *dot = last_i;
+				uint32_t values[3] = {0, 0, 0};
+				uint32_t frac = 0;
+				size_t fields = 1;
+
+				for (const char *cp = first_i; cp != last_i && dot == last_i; cp++) {
+					if (*cp == '.') {
+						dot = cp;
+					} else if (*cp == ':') {
+						if (fields == 3 || (fields == 2 && ticksPerSecond == 0)) return {cp, std::errc::invalid_argument};
+						ends[fields++ - 1] = cp;
+					}
+				}
+				ends[fields - 1] = dot;
+
+				// Hours and minutes, or minutes only, then seconds
+				const char *start = first_i;
+
+				for (size_t i = 0; i < fields; i++) {
+					const uint32_t max = fields > 1 && i == 0 ? 23 : 59;
+					const HoursMinutes::ParseResult res = parseField(start, ends[i], 2, max, values[i]);
+
+					if (res.ec != std::errc()) return res;
+					start = ends[i] + 1;
+				}
+
+				// Fraction of a second, only after seconds
+				if (dot != last_i) {
+					const size_t digits = ticksPerSecond >= 1000 ? 3 : ticksPerSecond >= 100 ? 2 : ticksPerSecond >= 10 ? 1 : 0;
+
+					if (fields < 3 || digits == 0) return {dot, std::errc::invalid_argument};
+
+					const HoursMinutes::ParseResult res = parseField(dot + 1, last_i, digits, 999, frac);
+
+					if (res.ec != std::errc()) return res;
+					for (ptrdiff_t i = last_i - dot - 1; i < 3; i++) frac *= 10;
+				}
+
+				if (fields == 1) {
+					tod_o.ticks_a = values[0] * ticksPerMinute;
+				} else {
+					tod_o.ticks_a = values[0] * ticksPerHour + values[1] * ticksPerMinute
+						+ (fields == 3 ? values[2] * ticksPerSecond + frac / msPerTick : 0);
+				}
+				return {last_i, std::errc()};
+			}
+
+			/** Write the time formatted as HH:MM, HH:MM:SS or HH:MM:SS.mmm
+			 * depending on the resolution, without terminating null
+			 * character.
+			 * @param out_o Buffer with room for charsLength characters.
+			 * @returns Position after the last written character. */
+			inline char * toChars(char * out_o) const noexcept {
+				const char *pairs = HoursMinutes::digitPairs;
+
+				out_o[0] = pairs[2 * hours()];
+				out_o[1] = pairs[2 * hours() + 1];
+				out_o[2] = ':';
+				out_o[3] = pairs[2 * minutes()];
+				out_o[4] = pairs[2 * minutes() + 1];
+				if constexpr (ticksPerSecond != 0) {
+					out_o[5] = ':';
+					out_o[6] = pairs[2 * seconds()];
+					out_o[7] = pairs[2 * seconds() + 1];
+				}
+				if constexpr (R == Resolution::milliseconds) {
+					const uint16_t ms = milliseconds();
+
+					out_o[8] = '.';
+					out_o[9] = '0' + ms / 100;
+					out_o[10] = pairs[2 * (ms % 100)];
+					out_o[11] = pairs[2 * (ms % 100) + 1];
+				}
+				return out_o + charsLength;
+			}
+	};
+
+	/** Picks the type for a resolution: HoursMinutes for minutes, which
+	 * keeps its own fields, and TimeOfDay otherwise. */
+	template <Resolution R>
+	struct TimeType { using type = TimeOfDay<R>; };
+
+	template <>
+	struct TimeType<Resolution::minutes> { using type = HoursMinutes; };
+
+	/** Time of day at a given resolution. */
+	template <Resolution R>
+	using Time = typename TimeType<R>::type;
+
+	/** Time of day with second resolution. */
+	using HoursMinutesSeconds = Time<Resolution::seconds>;
+
+	/** Time of day with millisecond resolution. */
+	using HoursMinutesMillis = Time<Resolution::milliseconds>;
+
+} // SdH namespace
@@ -0,0 +1,519 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <unistd.h>
+#include "TimeZone.h"
+
+namespace {
+
+	constexpr int64_t secsPerDay = 24 * 60 * 60;
+
+	/** Years for which POSIX TZ rules are expanded into transitions. */
+	constexpr int64_t firstRuleYear = 1900;
+	constexpr int64_t lastRuleYear = 2400;
+
+	/** Days since 1970-01-01 of a date in the proleptic Gregorian
+	 * calendar, after Howard Hinnant's days_from_civil(). */
+	int64_t daysFromCivil(int64_t year_i, const unsigned month_i, const unsigned day_i)
+	{
+		year_i -= month_i <= 2;
+		const int64_t era = (year_i >= 0 ? year_i : year_i - 399) / 400;
+		const unsigned yoe = static_cast<unsigned>(year_i - era * 400);
+		const unsigned doy = (153 * (month_i > 2 ? month_i - 3 : month_i + 9) + 2) / 5 + day_i - 1;
+		const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+		return era * 146097 + static_cast<int64_t>(doe) - 719468;
+	}
+
+	/** Year of an epoch timestamp in UTC, after civil_from_days(). */
+	int64_t yearOf(const int64_t epoch_i)
+	{
+		int64_t days = epoch_i / secsPerDay;
+
+		if (epoch_i % secsPerDay < 0) days--;
+		days += 719468;
+
+		const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+		const unsigned doe = static_cast<unsigned>(days - era * 146097);
+		const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+		const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+		const unsigned mp = (5 * doy + 2) / 153;
+
+		return static_cast<int64_t>(yoe) + era * 400 + (mp >= 10);
+	}
+
+	inline bool isLeap(const int64_t year_i)
+	{
+		return year_i % 4 == 0 && (year_i % 100 != 0 || year_i % 400 == 0);
+	}
+
+	/** Date of a daylight saving change in a POSIX TZ rule. */
+	struct RuleDate {
+		char type;      ///< 'J' for Jn, 'n' for n and 'M' for Mm.w.d
+		unsigned month; ///< Month for 'M'
+		unsigned week;  ///< Week for 'M', 5 means the last one
+		unsigned day;   ///< Day of week for 'M', day number otherwise
+		int32_t time;   ///< Local time of the change in seconds
+	};
+
+	/** Parsed POSIX TZ rule. */
+	struct PosixRule {
+		int32_t stdOffset;
+		int32_t dstOffset;
+		bool hasDst;
+		RuleDate start;
+		RuleDate end;
+	};
+
+	/** Moment of a rule change in local wall clock seconds since epoch. */
+	int64_t ruleLocal(const RuleDate & date_i, const int64_t year_i)
+	{
+		int64_t days = daysFromCivil(year_i, 1, 1);
+
+		switch (date_i.type) {
+			case 'J':
+				// Day 1 up to 365, February 29th is never counted
+				days += date_i.day - 1 + (isLeap(year_i) && date_i.day >= 60);
+				break;
+
+			case 'n':
+				days += date_i.day;
+				break;
+
+			default: {
+				static const unsigned monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+				const unsigned mdays = monthDays[date_i.month - 1] + (date_i.month == 2 && isLeap(year_i));
+				const int64_t first = daysFromCivil(year_i, date_i.month, 1);
+				const unsigned wday = static_cast<unsigned>(((first + 4) % 7 + 7) % 7);
+				unsigned mday = (date_i.day + 7 - wday) % 7 + (date_i.week - 1) * 7;
+
+				while (mday >= mdays) mday -= 7;
+				days = first + mday;
+			}
+		}
+
+		return days * secsPerDay + date_i.time;
+	}
+
+	/** Minimal cursor to parse POSIX TZ rules. */
+	class RuleParser
+	{
+		protected:
+			const char *pos_a;
+			const char *end_a;
+
+			bool number(unsigned & value_o, const unsigned max_i) {
+				if (pos_a == end_a || *pos_a < '0' || *pos_a > '9') return false;
+				value_o = 0;
+				while (pos_a != end_a && *pos_a >= '0' && *pos_a <= '9') {
+					value_o = value_o * 10 + (*pos_a++ - '0');
+					if (value_o > max_i) return false;
+				}
+				return true;
+			}
+
+		public:
+			RuleParser(const std::string & rule_i):
+				pos_a(rule_i.data()),
+				end_a(rule_i.data() + rule_i.size())
+			{ }
+
+			bool atEnd() const { return pos_a == end_a; }
+
+			bool accept(const char ch_i) {
+				if (pos_a == end_a || *pos_a != ch_i) return false;
+				pos_a++;
+				return true;
+			}
+
+			/** Zone abbreviation, either alphabetic or between < and >. */
+			bool name() {
+				const char *start = pos_a;
+
+				if (accept('<')) {
+					while (pos_a != end_a && *pos_a != '>') pos_a++;
+					return accept('>') && pos_a - start >= 5;
+				}
+				while (
+					pos_a != end_a &&
+					((*pos_a >= 'a' && *pos_a <= 'z') || (*pos_a >= 'A' && *pos_a <= 'Z'))
+				) {
+					pos_a++;
+				}
+				return pos_a - start >= 3;
+			}
+
+			bool peek(const char ch_i) const {
+				return pos_a != end_a && *pos_a == ch_i;
+			}
+
+			/** Signed [+-]hh[:mm[:ss]] in seconds. */
+			bool time(int32_t & secs_o, const unsigned maxhrs_i) {
+				unsigned hrs = 0, min = 0, sec = 0;
+				int32_t sign = 1;
+
+				if (accept('-')) sign = -1; else accept('+');
+				if (!number(hrs, maxhrs_i)) return false;
+				if (accept(':')) {
+					if (!number(min, 59)) return false;
+					if (accept(':') && !number(sec, 59)) return false;
+				}
+				secs_o = sign * static_cast<int32_t>(hrs * 3600 + min * 60 + sec);
+				return true;
+			}
+
+			/** Date with optional /time. */
+			bool date(RuleDate & date_o) {
+				date_o.time = 2 * 3600;
+				date_o.month = date_o.week = 0;
+
+				if (accept('J')) {
+					date_o.type = 'J';
+					if (!number(date_o.day, 365) || date_o.day < 1) return false;
+				} else if (accept('M')) {
+					date_o.type = 'M';
+					if (!number(date_o.month, 12) || date_o.month < 1 || !accept('.')) return false;
+					if (!number(date_o.week, 5) || date_o.week < 1 || !accept('.')) return false;
+					if (!number(date_o.day, 6)) return false;
+				} else {
+					date_o.type = 'n';
+					if (!number(date_o.day, 365)) return false;
+				}
+
+				return !accept('/') || time(date_o.time, 167);
+			}
+	};
+
+	bool parseRule(const std::string & rule_i, PosixRule & rule_o)
+	{
+		RuleParser parser(rule_i);
+		int32_t secs = 0;
+
+		if (!parser.name() || !parser.time(secs, 24)) return false;
+		rule_o.stdOffset = -secs;
+		rule_o.hasDst = false;
+		if (parser.atEnd()) return true;
+
+		if (!parser.name()) return false;
+		rule_o.hasDst = true;
+		rule_o.dstOffset = rule_o.stdOffset + 3600;
+		if (!parser.atEnd() && !parser.peek(',')) {
+			if (!parser.time(secs, 24)) return false;
+			rule_o.dstOffset = -secs;
+		}
+
+		if (parser.atEnd()) {
+			// Same default as the C library: the rules of the USA
+			rule_o.start = {'M', 3, 2, 0, 2 * 3600};
+			rule_o.end = {'M', 11, 1, 0, 2 * 3600};
+			return true;
+		}
+
+		if (!parser.accept(',') || !parser.date(rule_o.start)) return false;
+		if (!parser.accept(',') || !parser.date(rule_o.end)) return false;
+		return parser.atEnd();
+	}
+
+	inline int64_t be64(const unsigned char * ptr_i)
+	{
+		uint64_t rv = 0;
+
+		for (unsigned i = 0; i < 8; i++) rv = (rv << 8) | ptr_i[i];
+		return static_cast<int64_t>(rv);
+	}
+
+	inline int32_t be32(const unsigned char * ptr_i)
+	{
+		return static_cast<int32_t>(
+			(static_cast<uint32_t>(ptr_i[0]) << 24) | (static_cast<uint32_t>(ptr_i[1]) << 16) |
+			(static_cast<uint32_t>(ptr_i[2]) << 8) | static_cast<uint32_t>(ptr_i[3])
+		);
+	}
+
+} // anonymous namespace
+
+namespace SdH {
+
+	TimeZone::TimeZone():
+		offsets_a(1, 0)
+	{ }
+
+	void TimeZone::expand(const std::string & rule_i, const int64_t after_i)
+	{
+		std::vector<std::pair<int64_t, int32_t>> changes;
+		PosixRule rule;
+		int32_t current = 0;
+
+		if (!parseRule(rule_i, rule)) {
+			throw std::invalid_argument("Invalid time zone rule \"" + rule_i + "\"");
+		}
+
+		if (!rule.hasDst) {
+			offsets_a.back() = rule.stdOffset;
+			return;
+		}
+
+		for (
+			int64_t year = std::max(firstRuleYear, after_i == std::numeric_limits<int64_t>::min() ? firstRuleYear : yearOf(after_i) - 1);
+			year <= lastRuleYear;
+			year++
+		) {
+			// Daylight saving time starts in standard time and ends in
+			// daylight saving time
+			changes.emplace_back(ruleLocal(rule.start, year) - rule.stdOffset, rule.dstOffset);
+			changes.emplace_back(ruleLocal(rule.end, year) - rule.dstOffset, rule.stdOffset);
+		}
+
+		if (changes.empty()) return;
+		std::stable_sort(changes.begin(), changes.end(),
+			[](const std::pair<int64_t, int32_t> & lhs, const std::pair<int64_t, int32_t> & rhs) {
+				return lhs.first < rhs.first;
+			}
+		);
+
+		// The offset before the first change is the opposite one
+		current = changes.front().second == rule.dstOffset ? rule.stdOffset : rule.dstOffset;
+		for (const std::pair<int64_t, int32_t> & change : changes) {
+			if (change.first > after_i) break;
+			current = change.second;
+		}
+		offsets_a.back() = current;
+
+		for (const std::pair<int64_t, int32_t> & change : changes) {
+			if (change.first <= after_i) continue;
+			transitions_a.push_back(change.first);
+			offsets_a.push_back(change.second);
+		}
+	}
+
+	TimeZone TimeZone::local()
+	{
+		const char *tz = getenv("TZ");
+
+		try {
+			if (tz != nullptr) return named(tz);
+			return fromFile("/etc/localtime");
+		} catch (const std::exception &) {
+			return TimeZone();
+		}
+	}
+
+	TimeZone TimeZone::named(const std::string & name_i)
+	{
+		const char *tzdir = getenv("TZDIR");
+		std::string path;
+
+		if (name_i.empty()) return TimeZone();
+
+		path = name_i[0] == ':' ? name_i.substr(1) : name_i;
+		if (path.empty()) return TimeZone();
+		if (path[0] != '/') {
+			path = std::string(tzdir != nullptr && *tzdir != '\0' ? tzdir : "/usr/share/zoneinfo") + "/" + path;
+		}
+
+		if (access(path.c_str(), R_OK) == 0) {
+			try {
+				return fromFile(path);
+			} catch (const std::runtime_error &) {
+				// Try it as rule instead
+			}
+		}
+
+		return fromRule(name_i);
+	}
+
+	TimeZone TimeZone::fromRule(const std::string & rule_i)
+	{
+		TimeZone retval;
+
+		retval.expand(rule_i, std::numeric_limits<int64_t>::min());
+		return retval;
+	}
+
+	TimeZone TimeZone::fromFile(const std::string & path_i)
+	{
+		std::ifstream in(path_i, std::ios::binary);
+		std::string data;
+		const unsigned char *ptr = nullptr;
+		size_t pos = 0;
+		uint32_t isutcnt = 0, isstdcnt = 0, leapcnt = 0, timecnt = 0, typecnt = 0, charcnt = 0;
+		unsigned timesize = 4;
+		std::vector<int32_t> utoffs;
+		std::vector<bool> isdsts;
+		TimeZone retval;
+
+		if (!in) throw std::runtime_error("Unable to open time zone file " + path_i);
+		data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		ptr = reinterpret_cast<const unsigned char *>(data.data());
+
+		auto need = [&](const size_t size_i) {
+			if (data.size() - pos < size_i) {
+				throw std::runtime_error("Malformed time zone file " + path_i);
+			}
+		};
+
+		auto header = [&]() {
+			need(44);
+			if (data.compare(pos, 4, "TZif") != 0) {
+				throw std::runtime_error("Not a time zone file: " + path_i);
+			}
+			isutcnt = be32(ptr + pos + 20);
+			isstdcnt = be32(ptr + pos + 24);
+			leapcnt = be32(ptr + pos + 28);
+			timecnt = be32(ptr + pos + 32);
+			typecnt = be32(ptr + pos + 36);
+			charcnt = be32(ptr + pos + 40);
+			pos += 44;
+
+			// Every count takes at least a byte, so a larger one can't be
+			// valid and is rejected before the sizes are computed
+			for (const uint32_t count : {isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt}) {
+				need(count);
+			}
+		};
+
+		auto blockSize = [&]() -> size_t {
+			return static_cast<size_t>(timecnt) * (timesize + 1) + static_cast<size_t>(typecnt) * 6 +
+				static_cast<size_t>(charcnt) + static_cast<size_t>(leapcnt) * (timesize + 4) +
+				static_cast<size_t>(isstdcnt) + static_cast<size_t>(isutcnt);
+		};
+
+		header();
+		if (data[4] >= '2') {
+			// Skip the 32-bit data in favour of the 64-bit data
+			need(blockSize());
+			pos += blockSize();
+			timesize = 8;
+			header();
+		}
+
+		need(blockSize());
+		if (typecnt == 0) throw std::runtime_error("Malformed time zone file " + path_i);
+
+		for (uint32_t i = 0; i < typecnt; i++) {
+			const unsigned char *type = ptr + pos + static_cast<size_t>(timecnt) * (timesize + 1) + static_cast<size_t>(i) * 6;
+			utoffs.push_back(be32(type));
+			isdsts.push_back(type[4] != 0);
+		}
+
+		// Like the C library, use the first standard time type before
+		// the first transition
+		retval.offsets_a[0] = utoffs[0];
+		for (uint32_t i = 0; i < typecnt; i++) {
+			if (!isdsts[i]) {
+				retval.offsets_a[0] = utoffs[i];
+				break;
+			}
+		}
+
+		for (uint32_t i = 0; i < timecnt; i++) {
+			const unsigned char *tptr = ptr + pos + static_cast<size_t>(i) * timesize;
+			const uint8_t index = ptr[pos + static_cast<size_t>(timecnt) * timesize + i];
+
+			if (index >= typecnt) throw std::runtime_error("Malformed time zone file " + path_i);
+			retval.transitions_a.push_back(timesize == 8 ? be64(tptr) : be32(tptr));
+			retval.offsets_a.push_back(utoffs[index]);
+		}
+		pos += blockSize();
+
+		// The footer rule covers everything after the last transition
+		if (timesize == 8 && timecnt > 0 && pos < data.size() && data[pos] == '\n') {
+			const size_t end = data.find('\n', pos + 1);
+
+			if (end != std::string::npos && end > pos + 1) {
+				try {
+					retval.expand(data.substr(pos + 1, end - pos - 1), retval.transitions_a.back());
+				} catch (const std::invalid_argument &) {
+					// Keep the last offset, as the C library does
+				}
+			}
+		}
+
+		return retval;
+	}
+
+	int32_t TimeZone::utcOffset(const int64_t epoch_i) const noexcept
+	{
+		return offsets_a[
+			std::upper_bound(transitions_a.begin(), transitions_a.end(), epoch_i) - transitions_a.begin()
+		];
+	}
+
+	HoursMinutes TimeZone::at(const int64_t epoch_i) const
+	{
+		// Reduce the timestamp first, so timestamps near the limits of
+		// int64_t cannot overflow when the offset is added
+		int64_t secs = (epoch_i % secsPerDay + utcOffset(epoch_i)) % secsPerDay;
+		HoursMinutes retval;
+
+		if (secs < 0) secs += secsPerDay;
+		retval.minutesOfDay(secs / 60);
+		return retval;
+	}
+
+	void TimeZone::convert(
+		const int64_t * epochs_i,
+		const size_t count_i,
+		uint16_t * mins_o
+	) const noexcept
+	{
+		const int64_t *trans = transitions_a.data();
+		const size_t count = transitions_a.size();
+		size_t idx = 0; // Offset index of the previous timestamp
+
+		for (size_t i = 0; i < count_i; i++) {
+			const int64_t epoch = epochs_i[i];
+			int64_t secs = 0;
+
+			if ((idx > 0 && epoch < trans[idx - 1]) || (idx < count && epoch >= trans[idx])) {
+				if (idx < count && epoch >= trans[idx] && (idx + 1 == count || epoch < trans[idx + 1])) {
+					idx++;
+				} else {
+					idx = std::upper_bound(trans, trans + count, epoch) - trans;
+				}
+			}
+
+			secs = (epoch % secsPerDay + offsets_a[idx]) % secsPerDay;
+			secs += secs < 0 ? secsPerDay : 0;
+			mins_o[i] = secs / 60;
+		}
+	}
+
+} // SdH namespace
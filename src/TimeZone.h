@@ -0,0 +1,121 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "HoursMinutes.h"
+
+namespace SdH {
+
+	/** Time zone loaded once into a sorted table of UTC offset changes, so
+	 * converting epoch timestamps to local time needs no C library calls.
+	 *
+	 * The table comes from a TZif file (RFC 8536) or from a POSIX TZ rule
+	 * such as "CET-1CEST,M3.5.0,M10.5.0/3". The rule in the footer of a
+	 * TZif file is expanded into transitions up to the year 2400, beyond
+	 * which the last offset stays in effect. Leap second tables are
+	 * ignored. Results match localtime_r() of glibc for the same zone. */
+	class TimeZone
+	{
+		protected:
+			/** Moments at which the UTC offset changes, ascending. */
+			std::vector<int64_t> transitions_a;
+
+			/** UTC offsets in seconds. Element 0 applies before the first
+			 * transition and element i + 1 from transition i onwards. */
+			std::vector<int32_t> offsets_a;
+
+			/** Append the transitions of a POSIX TZ rule for a range of
+			 * years, or just its offset when it has no daylight saving time.
+			 * @param rule_i Rule to expand.
+			 * @param after_i Only transitions after this moment are added.
+			 * The offset in effect at that moment replaces the last one.
+			 * @throws std::invalid_argument when the rule can't be parsed. */
+			void expand(const std::string & rule_i, const int64_t after_i);
+
+		public:
+			/** Empty constructor gives UTC. */
+			TimeZone();
+
+			/** Load the zone the C library would use: the one named by the
+			 * TZ environment variable, or /etc/localtime. Falls back to UTC
+			 * like the C library when neither can be loaded. */
+			static TimeZone local();
+
+			/** Load a zone by name, like the TZ environment variable. A
+			 * name is looked up as file below $TZDIR or
+			 * /usr/share/zoneinfo, unless it is an absolute path. When no
+			 * such file exists, the name is parsed as POSIX TZ rule.
+			 * @throws std::invalid_argument when neither works. */
+			static TimeZone named(const std::string & name_i);
+
+			/** Load a TZif file.
+			 * @throws std::runtime_error when the file can't be read or
+			 * is malformed. */
+			static TimeZone fromFile(const std::string & path_i);
+
+			/** Parse a POSIX TZ rule.
+			 * @throws std::invalid_argument when the rule can't be parsed. */
+			static TimeZone fromRule(const std::string & rule_i);
+
+			/** Get the number of transitions in the table. */
+			inline size_t transitions() const { return transitions_a.size(); }
+
+			/** Get the moment of a transition.
+			 * @param index_i Index below transitions(), not range checked. */
+			inline int64_t transition(const size_t index_i) const { return transitions_a[index_i]; }
+
+			/** Get the UTC offset in seconds at a certain moment. */
+			int32_t utcOffset(const int64_t epoch_i) const noexcept;
+
+			/** Get the local time of day at a certain moment. */
+			HoursMinutes at(const int64_t epoch_i) const;
+
+			/** Convert many epoch timestamps to local minutes since
+			 * midnight. Each lookup first tries the interval of the previous
+			 * timestamp and the one after it, so sorted input needs no
+			 * search at all. Other input costs a binary search each.
+			 * @param epochs_i Epoch timestamps to convert.
+			 * @param count_i Number of timestamps.
+			 * @param mins_o Receives minutes since midnight, below 1440. */
+			void convert(
+				const int64_t * epochs_i,
+				const size_t count_i,
+				uint16_t * mins_o
+			) const noexcept;
+	};
+
+} // SdH namespace
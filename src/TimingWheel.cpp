@@ -0,0 +1,204 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <stdexcept>
+#include "TimingWheel.h"
+
+namespace SdH {
+
+	TimingWheel::TimingWheel(const uint64_t now_i):
+		free_a(none),
+		heads_a(firing + 1, none),
+		tails_a(firing + 1, none),
+		occupied_a(),
+		now_a(now_i),
+		size_a(0)
+	{ }
+
+	void TimingWheel::link(const uint32_t node_i)
+	{
+		Node & node = nodes_a[node_i];
+		unsigned level = 0;
+
+		// The lowest level above which the due tick has the same digits
+		while (level < levels && (node.when >> (bits * (level + 1))) != (now_a >> (bits * (level + 1)))) level++;
+
+		const uint32_t slot = (node.when >> (bits * level)) & (slots - 1);
+		const uint32_t list = level < levels ? level * slots + slot : overflow;
+
+		node.list = list;
+		node.next = none;
+		node.prev = tails_a[list];
+		if (node.prev == none) {
+			heads_a[list] = node_i;
+		} else {
+			nodes_a[node.prev].next = node_i;
+		}
+		tails_a[list] = node_i;
+		if (list < overflow) occupied_a[level] |= uint64_t(1) << slot;
+	}
+
+	void TimingWheel::unlink(const uint32_t node_i)
+	{
+		Node & node = nodes_a[node_i];
+
+		if (node.prev == none) {
+			heads_a[node.list] = node.next;
+		} else {
+			nodes_a[node.prev].next = node.next;
+		}
+		if (node.next == none) {
+			tails_a[node.list] = node.prev;
+		} else {
+			nodes_a[node.next].prev = node.prev;
+		}
+		if (heads_a[node.list] == none && node.list < overflow) {
+			occupied_a[node.list / slots] &= ~(uint64_t(1) << (node.list % slots));
+		}
+		node.list = none;
+	}
+
+	void TimingWheel::release(const uint32_t node_i)
+	{
+		unlink(node_i);
+		nodes_a[node_i].generation++;
+		nodes_a[node_i].next = free_a;
+		free_a = node_i;
+		size_a--;
+	}
+
+	void TimingWheel::cascade(const uint32_t list_i)
+	{
+		uint32_t node = heads_a[list_i];
+
+		heads_a[list_i] = none;
+		tails_a[list_i] = none;
+		if (list_i < overflow) occupied_a[list_i / slots] &= ~(uint64_t(1) << (list_i % slots));
+
+		while (node != none) {
+			const uint32_t next = nodes_a[node].next;
+
+			link(node);
+			node = next;
+		}
+	}
+
+	TimingWheel::Timer TimingWheel::add(const uint64_t when_i, const uint64_t tag_i)
+	{
+		uint32_t node = free_a;
+
+		if (node != none) {
+			free_a = nodes_a[node].next;
+		} else {
+			if (nodes_a.size() >= none) throw std::length_error("Too many timers");
+			node = nodes_a.size();
+			nodes_a.push_back({0, 0, none, none, none, 0});
+		}
+
+		nodes_a[node].when = std::max(when_i, now_a + 1);
+		nodes_a[node].tag = tag_i;
+		link(node);
+		size_a++;
+		return uint64_t(nodes_a[node].generation) << 32 | node;
+	}
+
+	bool TimingWheel::cancel(const Timer timer_i)
+	{
+		const uint32_t node = timer_i & UINT32_MAX;
+
+		if (node >= nodes_a.size()) return false;
+		if (nodes_a[node].generation != timer_i >> 32 || nodes_a[node].list == none) return false;
+
+		release(node);
+		return true;
+	}
+
+	uint64_t TimingWheel::next() const
+	{
+		if (!size_a) return UINT64_MAX;
+
+		// Due timers and timers in higher levels are always in a slot
+		// after the one of the current tick
+		for (unsigned level = 0; level < levels; level++) {
+			const unsigned shift = bits * level;
+			const unsigned index = (now_a >> shift) & (slots - 1);
+			const uint64_t later = index + 1 < slots ? occupied_a[level] & (~uint64_t(0) << (index + 1)) : 0;
+
+			if (later) {
+				return (now_a >> (shift + bits) << (shift + bits)) | uint64_t(__builtin_ctzll(later)) << shift;
+			}
+		}
+
+		// Only overflow left, so the next turn of the highest level
+		return ((now_a >> (bits * levels)) + 1) << (bits * levels);
+	}
+
+	size_t TimingWheel::advance(const uint64_t to_i, const Fire & fire_i)
+	{
+		size_t retval = 0;
+
+		for (uint64_t tick = next(); tick <= to_i; tick = next()) {
+			now_a = tick;
+
+			// Timers move down from every level whose slot starts now
+			if (!(tick & ((uint64_t(1) << (bits * levels)) - 1))) cascade(overflow);
+			for (unsigned level = levels - 1; level > 0; level--) {
+				if (tick & ((uint64_t(1) << (bits * level)) - 1)) continue;
+				cascade(level * slots + ((tick >> (bits * level)) & (slots - 1)));
+			}
+
+			// Fire from a separate list, so the callback can add to the slot
+			const uint32_t due = tick & (slots - 1);
+
+			for (uint32_t node = heads_a[due]; node != none; node = nodes_a[node].next) nodes_a[node].list = firing;
+			heads_a[firing] = heads_a[due];
+			tails_a[firing] = tails_a[due];
+			heads_a[due] = none;
+			tails_a[due] = none;
+			occupied_a[0] &= ~(uint64_t(1) << due);
+
+			while (heads_a[firing] != none) {
+				const uint32_t node = heads_a[firing];
+				const Timer timer = uint64_t(nodes_a[node].generation) << 32 | node;
+
+				release(node);
+				retval++;
+				fire_i(timer, nodes_a[node].tag);
+			}
+		}
+
+		now_a = std::max(now_a, to_i);
+		return retval;
+	}
+
+} // SdH namespace
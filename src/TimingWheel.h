@@ -0,0 +1,179 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace SdH {
+
+	/** Hierarchical timing wheel: timers due at a tick, like a second since
+	 * the epoch, fire when the wheel advances past that tick. Level 0 has a
+	 * slot per tick for the next 64 ticks, every next level a slot per 64
+	 * slots of the level below. A timer is kept in the lowest level where
+	 * its due tick shares the higher digits with the current tick, and it
+	 * moves down a level whenever the current tick reaches its slot. Timers
+	 * beyond the highest level wait in an overflow list, which is sorted
+	 * into the levels once per turn of the highest level.
+	 *
+	 * Adding, cancelling and firing a timer are O(1): timers live in a pool
+	 * linked into doubly linked lists per slot, and a bitmap per level of
+	 * occupied slots finds the next slot to visit with a single bit scan,
+	 * so empty ticks cost nothing. */
+	class TimingWheel
+	{
+		public:
+			/** Identifies an added timer. Identifiers of fired or cancelled
+			 * timers are never valid again. */
+			typedef uint64_t Timer;
+
+			/** Called with a timer and its tag when it fires. */
+			typedef std::function<void(const Timer timer_i, const uint64_t tag_i)> Fire;
+
+			/** Number of bits of a tick per level. */
+			static constexpr unsigned bits = 6;
+
+			/** Number of slots per level. */
+			static constexpr unsigned slots = 1 << bits;
+
+			/** Number of levels. */
+			static constexpr unsigned levels = 4;
+
+		protected:
+			/** Index meaning no node or no list. */
+			static constexpr uint32_t none = UINT32_MAX;
+
+			/** A timer, or an unused entry of the pool. */
+			struct Node {
+				/** Tick the timer is due. */
+				uint64_t when;
+
+				/** Value given when adding the timer. */
+				uint64_t tag;
+
+				/** Previous node in the same list, or none. */
+				uint32_t prev;
+
+				/** Next node in the same list or in the free list, or none. */
+				uint32_t next;
+
+				/** List holding the node, or none when unused. */
+				uint32_t list;
+
+				/** Incremented on every reuse, so old identifiers fail. */
+				uint32_t generation;
+			};
+
+			/** All nodes. */
+			std::vector<Node> nodes_a;
+
+			/** First unused node, or none. */
+			uint32_t free_a;
+
+			/** Index of the overflow list, after the lists of the slots. */
+			static constexpr uint32_t overflow = levels * slots;
+
+			/** Index of the list of timers being fired. */
+			static constexpr uint32_t firing = overflow + 1;
+
+			/** First node per list: the slots level by level, the overflow
+			 * list and the timers being fired. */
+			std::vector<uint32_t> heads_a;
+
+			/** Last node per list. */
+			std::vector<uint32_t> tails_a;
+
+			/** Bitmap of non-empty slots per level. */
+			uint64_t occupied_a[levels];
+
+			/** Last tick advanced to. */
+			uint64_t now_a;
+
+			/** Number of pending timers. */
+			size_t size_a;
+
+			/** Put a node in the list of the slot for its due tick. */
+			void link(const uint32_t node_i);
+
+			/** Take a node out of its list. */
+			void unlink(const uint32_t node_i);
+
+			/** Take a node out of its list and make it available for reuse. */
+			void release(const uint32_t node_i);
+
+			/** Put all nodes of a list back in the lists for their due
+			 * tick, which changed when the current tick reached it. */
+			void cascade(const uint32_t list_i);
+
+		public:
+			/** Constructor.
+			 * @param now_i Current tick. Timers due at it or before fire
+			 * on the next advance. */
+			explicit TimingWheel(const uint64_t now_i = 0);
+
+			/** Get the last tick advanced to. */
+			inline uint64_t now() const { return now_a; }
+
+			/** Get the number of pending timers. */
+			inline size_t size() const { return size_a; }
+
+			/** Add a timer.
+			 * @param when_i Tick at which it is due. Ticks that have passed
+			 * fire on the next tick.
+			 * @param tag_i Value passed back when the timer fires.
+			 * @returns The identifier of the timer.
+			 * @throws std::length_error when there are too many timers. */
+			Timer add(const uint64_t when_i, const uint64_t tag_i = 0);
+
+			/** Cancel a timer.
+			 * @returns False when it fired or was cancelled already. */
+			bool cancel(const Timer timer_i);
+
+			/** Get the earliest tick at which the wheel has work to do:
+			 * either timers are due or timers move down a level. Sleeping
+			 * until then and advancing to it visits no empty ticks.
+			 * @returns The tick, or UINT64_MAX when no timers are pending. */
+			uint64_t next() const;
+
+			/** Fire all timers due up to and including a tick, in order of
+			 * due tick and then in order of adding. The callback may add
+			 * and cancel timers; ones due by @p to_i fire in this call.
+			 * @param to_i Tick to advance to. Earlier ticks are ignored.
+			 * @param fire_i Called for every timer that fires.
+			 * @returns The number of fired timers. */
+			size_t advance(const uint64_t to_i, const Fire & fire_i);
+	};
+
+} // SdH namespace
@@ -0,0 +1,231 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+#include "BatchParser.h"
+#include "Stats.h"
+#include "Watch.h"
+
+namespace SdH {
+
+	Watch::Watch(const int64_t now_i):
+		wheel_a(now_i - 1),
+		now_a(now_i),
+		timerFd_a(timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC))
+	{
+		if (timerFd_a < 0) {
+			throw std::system_error(errno, std::generic_category(), "Unable to create timer file descriptor");
+		}
+	}
+
+	Watch::~Watch()
+	{
+		::close(timerFd_a);
+		reap(true);
+	}
+
+	void Watch::add(const int64_t when_i, const HoursMinutes & at_i, const std::string & label_i)
+	{
+		wheel_a.add(when_i < 0 ? 0 : when_i, alarms_a.size());
+		alarms_a.push_back({at_i, label_i});
+	}
+
+	void Watch::read(std::istream & is_io, const TimeZone & tz_i)
+	{
+		const int64_t local = now_a + tz_i.utcOffset(now_a);
+		const int64_t midnight = now_a - (local % 86400 + 86400) % 86400;
+		std::string line;
+		size_t lineno = 0;
+		int64_t previous = -1;
+		HoursMinutes result;
+		Stats & stats = Stats::instance();
+		const bool timed = stats.enabled();
+
+		while (std::getline(is_io, line)) {
+			const size_t hash = std::min(line.find('#'), line.size());
+			const size_t first = line.find_first_not_of(" \t");
+			const size_t last = line.find_last_not_of(" \t\r", hash ? hash - 1 : 0);
+			const size_t labelFirst = line.find_first_not_of(" \t", hash + 1);
+			const size_t labelLast = line.find_last_not_of(" \t\r");
+			BatchParser::Record rec;
+			int64_t ref = now_a;
+
+			lineno++;
+			if (first >= hash) continue;
+
+			const std::string_view calc(line.data() + first, last + 1 - first);
+			uint64_t ticks[Stats::stageCount] = {timed ? Stats::ticks() : 0, 0, 0};
+
+			BatchParser::parseLine(calc.data(), calc.data() + calc.size(), rec);
+			if (timed) {
+				ticks[1] = Stats::ticks();
+				stats.local().count(false, rec.result.ec);
+			}
+			if (rec.result.ec != std::errc()) {
+				std::ostringstream oss;
+
+				HoursMinutes::printError(oss, rec.result, calc.data() + calc.size());
+				throw std::invalid_argument("Line " + std::to_string(lineno) + ": " + oss.str());
+			}
+
+			switch (rec.kind) {
+				case BatchParser::Kind::now:
+					result = tz_i.at(now_a);
+					break;
+
+				case BatchParser::Kind::chained:
+					if (previous < 0) {
+						throw std::invalid_argument("Line " + std::to_string(lineno) + ": No previous timer to continue");
+					}
+					ref = previous;
+					break;
+
+				case BatchParser::Kind::full:
+					ref = midnight + rec.reference.minutesOfDay() * 60;
+					if (ref > now_a) ref -= 86400;
+					result = rec.reference;
+					break;
+			}
+
+			result += rec.duration;
+			previous = ref + rec.duration.minutesOfDay() * 60;
+			add(previous, result, labelFirst == std::string::npos ? "" : line.substr(labelFirst, labelLast + 1 - labelFirst));
+
+			// Formatting is timed when the timer fires
+			if (timed) {
+				Stats::Counters & counters = stats.local();
+
+				ticks[2] = Stats::ticks();
+				counters.time(Stats::Stage::parse, ticks[1] - ticks[0]);
+				counters.time(Stats::Stage::compute, ticks[2] - ticks[1]);
+			}
+		}
+	}
+
+	void Watch::fire(const Alarm & alarm_i, std::ostream & os_io)
+	{
+		char buf[HoursMinutes::charsLength];
+		Stats & stats = Stats::instance();
+		const uint64_t start = stats.enabled() ? Stats::ticks() : 0;
+		const std::string at(buf, alarm_i.at.toChars(buf) - buf);
+
+		os_io << at;
+		if (!alarm_i.label.empty()) os_io << ' ' << alarm_i.label;
+		os_io << '\n';
+		if (stats.enabled()) stats.local().time(Stats::Stage::format, Stats::ticks() - start);
+
+		if (hook_a.empty()) return;
+
+		// Output written so far goes before anything the hook writes
+		os_io.flush();
+
+		// Only async-signal-safe calls are allowed after forking a
+		// process with other threads, so the environment is built here
+		const std::string timevar = "TIMECAL_TIME=" + at;
+		const std::string labelvar = "TIMECAL_LABEL=" + alarm_i.label;
+		const char * const argv[] = {"sh", "-c", hook_a.c_str(), nullptr};
+		std::vector<const char *> envp;
+
+		for (char **var = environ; *var != nullptr; var++) {
+			const std::string_view name(*var, std::string_view(*var).find('='));
+
+			if (name != "TIMECAL_TIME" && name != "TIMECAL_LABEL") envp.push_back(*var);
+		}
+		envp.push_back(timevar.c_str());
+		envp.push_back(labelvar.c_str());
+		envp.push_back(nullptr);
+
+		const pid_t pid = fork();
+
+		if (pid < 0) throw std::system_error(errno, std::generic_category(), "Unable to run hook");
+		if (pid == 0) {
+			execve("/bin/sh", const_cast<char * const *>(argv), const_cast<char * const *>(envp.data()));
+			_exit(127);
+		}
+		children_a.push_back(pid);
+	}
+
+	void Watch::reap(const bool wait_i)
+	{
+		size_t kept = 0;
+
+		for (const pid_t pid : children_a) {
+			pid_t rc = 0;
+
+			do {
+				rc = waitpid(pid, nullptr, wait_i ? 0 : WNOHANG);
+			} while (rc < 0 && errno == EINTR);
+			if (rc == 0) children_a[kept++] = pid;
+		}
+		children_a.resize(kept);
+	}
+
+	void Watch::run(std::ostream & os_io)
+	{
+		const auto fire = [this, &os_io](const TimingWheel::Timer, const uint64_t tag_i) {
+			this->fire(alarms_a[tag_i], os_io);
+		};
+
+		while (true) {
+			timespec now;
+			itimerspec spec = {};
+			uint64_t expirations = 0;
+
+			clock_gettime(CLOCK_REALTIME, &now);
+			wheel_a.advance(now.tv_sec, fire);
+			os_io.flush();
+			reap(false);
+			if (!wheel_a.size()) break;
+
+			// Sleep until the wheel has work, or the clock is set
+			spec.it_value.tv_sec = wheel_a.next();
+			if (timerfd_settime(timerFd_a, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr) < 0) {
+				throw std::system_error(errno, std::generic_category(), "Unable to set timer");
+			}
+			if (::read(timerFd_a, &expirations, sizeof(expirations)) < 0 && errno != EINTR && errno != ECANCELED) {
+				throw std::system_error(errno, std::generic_category(), "Unable to wait for timer");
+			}
+		}
+	}
+
+} // SdH namespace
@@ -0,0 +1,142 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+#include "HoursMinutes.h"
+#include "TimeZone.h"
+#include "TimingWheel.h"
+
+namespace SdH {
+
+	/** Waits for running timers and announces each one when it is done,
+	 * by writing a line and optionally running a command. Timers are kept
+	 * in a TimingWheel with a tick per second of the real time clock, and
+	 * the wait between completions is a single blocking read of a
+	 * timerfd(2) that expires at the next tick the wheel has work for. So
+	 * there is no polling and an idle watch takes no processor time,
+	 * however many timers are running. Changes of the system clock wake
+	 * the watch up to look again. */
+	class Watch
+	{
+		protected:
+			/** A running timer. */
+			struct Alarm {
+				/** Time of day it is done. */
+				HoursMinutes at;
+
+				/** Optional description. */
+				std::string label;
+			};
+
+			/** Pending timers, one tick per second since the epoch. */
+			TimingWheel wheel_a;
+
+			/** All timers, the tag in the wheel being the index. */
+			std::vector<Alarm> alarms_a;
+
+			/** Moment the watch was created, as epoch timestamp. */
+			int64_t now_a;
+
+			/** Timer file descriptor that wakes run() up. */
+			int timerFd_a;
+
+			/** Shell command to run for every finished timer, if any. */
+			std::string hook_a;
+
+			/** Hook processes that may not have exited yet. */
+			std::vector<pid_t> children_a;
+
+			/** Announce a finished timer. */
+			void fire(const Alarm & alarm_i, std::ostream & os_io);
+
+			/** Clean up hook processes that exited.
+			 * @param wait_i Whether to wait for all of them to exit. */
+			void reap(const bool wait_i);
+
+		public:
+			/** Constructor.
+			 * @param now_i Current epoch timestamp. Timers done at or
+			 * before it fire right away, in the order they were added.
+			 * @throws std::system_error when no timerfd can be created. */
+			explicit Watch(const int64_t now_i);
+
+			/** Copying would share the timerfd, so don't. */
+			Watch(const Watch &) = delete;
+			Watch & operator=(const Watch &) = delete;
+
+			/** Destructor waits for hook processes. */
+			~Watch();
+
+			/** Add a timer.
+			 * @param when_i Epoch timestamp at which it is done.
+			 * @param at_i Time of day to announce.
+			 * @param label_i Optional description. */
+			void add(const int64_t when_i, const HoursMinutes & at_i, const std::string & label_i = "");
+
+			/** Read timers, one per line in the grammar of the interactive
+			 * mode, optionally followed by '#' and a description. A lone
+			 * duration runs from the moment the watch was created, one with
+			 * a plus sign from the end of the timer on the previous line. A
+			 * reference time is the latest moment with that local time of
+			 * day, as timers that are running have started already. Empty
+			 * lines and lines starting with '#' are ignored.
+			 * @param is_io Stream to read from.
+			 * @param tz_i Time zone of reference times.
+			 * @throws std::invalid_argument when a line is invalid, with
+			 * the line number in the message. */
+			void read(std::istream & is_io, const TimeZone & tz_i);
+
+			/** Set a shell command to run for every finished timer, with
+			 * TIMECAL_TIME and TIMECAL_LABEL in its environment. Commands
+			 * run in the background. An empty command runs nothing. */
+			inline void hook(const std::string & command_i) { hook_a = command_i; }
+
+			/** Get the number of timers that are still running. */
+			inline size_t size() const { return wheel_a.size(); }
+
+			/** Wait for all timers and announce each of them when it is done,
+			 * with a line holding the time of day and description.
+			 * @param os_io Stream to write to, flushed after every wake up.
+			 * @throws std::system_error when waiting or running the hook
+			 * fails. */
+			void run(std::ostream & os_io);
+	};
+
+} // SdH namespace
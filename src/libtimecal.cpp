@@ -0,0 +1,296 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include "BatchParser.h"
+#include "Calculator.h"
+#include "HoursMinutes.h"
+#include "HoursMinutesArray.h"
+#include "LocalClock.h"
+#include "Recurrence.h"
+#include "TimeZone.h"
+#include "libtimecal.h"
+
+struct timecal_calc {
+	SdH::Calculator calc;
+};
+
+struct timecal_tz {
+	SdH::TimeZone tz;
+};
+
+struct timecal_recur {
+	SdH::RecurrenceMerge merge;
+};
+
+namespace {
+
+	/** Number of records parsed at once by timecal_calc_eval_lines(). */
+	constexpr size_t recordCount = 256;
+
+	/** Translate a parse result to a timecal_status. */
+	inline int status(const SdH::HoursMinutes::ParseResult & res_i)
+	{
+		if (res_i.ec == std::errc()) return TIMECAL_OK;
+		if (res_i.ec == std::errc::result_out_of_range) return TIMECAL_ERANGE;
+		return TIMECAL_EINVAL;
+	}
+
+	/** Calculate the answer of a parsed record.
+	 * @returns A timecal_status. */
+	int apply(timecal_calc * calc_io, const SdH::BatchParser::Record & rec_i, uint16_t * result_o)
+	{
+		try {
+			calc_io->calc.apply(rec_i);
+		} catch (const std::exception &) {
+			return TIMECAL_ECLOCK;
+		}
+
+		*result_o = calc_io->calc.result().minutesOfDay();
+		return TIMECAL_OK;
+	}
+
+} // anonymous namespace
+
+int timecal_parse(const char * str_i, size_t len_i, uint16_t * minutes_o)
+{
+	SdH::HoursMinutes hm;
+	const SdH::HoursMinutes::ParseResult res = SdH::HoursMinutes::fromChars(str_i, str_i + len_i, hm);
+
+	if (res.ec == std::errc()) *minutes_o = hm.minutesOfDay();
+	return status(res);
+}
+
+uint16_t timecal_add(uint16_t ref_i, uint16_t dur_i)
+{
+	return (ref_i % SdH::HoursMinutes::minutesPerDay + dur_i % SdH::HoursMinutes::minutesPerDay)
+		% SdH::HoursMinutes::minutesPerDay;
+}
+
+uint16_t timecal_now(void)
+{
+	try {
+		return SdH::LocalClock::instance().now().minutesOfDay();
+	} catch (const std::exception &) {
+		return SdH::LocalClock::epoch() % 86400 / 60;
+	}
+}
+
+char * timecal_format(uint16_t minutes_i, char * buf_o)
+{
+	SdH::HoursMinutes hm;
+
+	hm.minutesOfDay(minutes_i % SdH::HoursMinutes::minutesPerDay);
+	return hm.toChars(buf_o);
+}
+
+size_t timecal_message(const char * line_i, size_t len_i, char * buf_o, size_t size_i)
+{
+	SdH::BatchParser::Record rec;
+	std::string msg;
+
+	SdH::BatchParser::parseLine(line_i, line_i + len_i, rec);
+	if (rec.result.ec != std::errc()) {
+		try {
+			std::ostringstream oss;
+
+			SdH::HoursMinutes::printError(oss, rec.result, line_i + len_i);
+			msg = oss.str();
+		} catch (const std::exception &) {
+			msg = "Out of memory";
+		}
+	}
+
+	if (size_i > 0) {
+		const size_t count = std::min(msg.size(), size_i - 1);
+
+		memcpy(buf_o, msg.data(), count);
+		buf_o[count] = '\0';
+	}
+	return msg.size();
+}
+
+void timecal_add_n(const uint16_t * refs_i, const uint16_t * durs_i, uint16_t * out_o, size_t count_i)
+{
+	SdH::HoursMinutesArray::add(refs_i, durs_i, out_o, count_i);
+}
+
+void timecal_add_duration_n(const uint16_t * refs_i, uint16_t dur_i, uint16_t * out_o, size_t count_i)
+{
+	SdH::HoursMinutesArray::add(refs_i, dur_i, out_o, count_i);
+}
+
+char * timecal_format_n(const uint16_t * minutes_i, size_t count_i, char * buf_o, char sep_i)
+{
+	return SdH::HoursMinutesArray::format(minutes_i, count_i, buf_o, sep_i);
+}
+
+size_t timecal_next_n(const uint16_t * minutes_i, size_t count_i, uint16_t from_i)
+{
+	return SdH::HoursMinutesArray::next(minutes_i, count_i, from_i);
+}
+
+size_t timecal_count_n(const uint16_t * minutes_i, size_t count_i, uint16_t from_i, uint16_t to_i)
+{
+	return SdH::HoursMinutesArray::count(minutes_i, count_i, from_i, to_i);
+}
+
+timecal_calc * timecal_calc_new(void)
+{
+	return new (std::nothrow) timecal_calc();
+}
+
+void timecal_calc_free(timecal_calc * calc_i)
+{
+	delete calc_i;
+}
+
+int timecal_calc_eval(timecal_calc * calc_io, const char * line_i, size_t len_i, uint16_t * result_o)
+{
+	SdH::BatchParser::Record rec;
+
+	if (len_i == 0) return TIMECAL_EEMPTY;
+
+	SdH::BatchParser::parseLine(line_i, line_i + len_i, rec);
+	if (rec.result.ec != std::errc()) return status(rec.result);
+	return apply(calc_io, rec, result_o);
+}
+
+size_t timecal_calc_eval_lines(
+	timecal_calc * calc_io,
+	const char * text_i,
+	size_t len_i,
+	uint16_t * results_o,
+	uint8_t * status_o,
+	size_t max_i,
+	size_t * consumed_o
+) {
+	static const SdH::BatchParser parser;
+	SdH::BatchParser::Record recs[recordCount];
+	const char *pos = text_i;
+	const char *last = text_i + len_i;
+	size_t count = 0, parsed = 0;
+
+	while (pos != last && count < max_i) {
+		pos = parser.parse(pos, last, recs, std::min(max_i - count, recordCount), parsed);
+
+		for (size_t i = 0; i < parsed; i++, count++) {
+			const SdH::BatchParser::Record & rec = recs[i];
+
+			results_o[count] = 0;
+			if (rec.first == rec.last) {
+				status_o[count] = TIMECAL_EEMPTY;
+			} else if (rec.result.ec != std::errc()) {
+				status_o[count] = status(rec.result);
+			} else {
+				status_o[count] = apply(calc_io, rec, results_o + count);
+			}
+		}
+	}
+
+	if (consumed_o != nullptr) *consumed_o = pos - text_i;
+	return count;
+}
+
+timecal_tz * timecal_tz_local(void)
+{
+	try {
+		return new timecal_tz{SdH::TimeZone::local()};
+	} catch (const std::exception &) {
+		return nullptr;
+	}
+}
+
+timecal_tz * timecal_tz_named(const char * name_i)
+{
+	try {
+		return new timecal_tz{SdH::TimeZone::named(name_i)};
+	} catch (const std::exception &) {
+		return nullptr;
+	}
+}
+
+void timecal_tz_free(timecal_tz * tz_i)
+{
+	delete tz_i;
+}
+
+void timecal_tz_convert(const timecal_tz * tz_i, const int64_t * epochs_i, size_t count_i, uint16_t * minutes_o)
+{
+	tz_i->tz.convert(epochs_i, count_i, minutes_o);
+}
+
+timecal_recur * timecal_recur_new(const uint16_t * starts_i, const uint16_t * intervals_i, size_t count_i, uint32_t days_i)
+{
+	try {
+		std::unique_ptr<timecal_recur> retval(new timecal_recur());
+		SdH::HoursMinutes start, interval;
+
+		for (size_t i = 0; i < count_i; i++) {
+			if (starts_i[i] >= TIMECAL_MINUTES_PER_DAY || intervals_i[i] >= TIMECAL_MINUTES_PER_DAY) return nullptr;
+			start.minutesOfDay(starts_i[i]);
+			interval.minutesOfDay(intervals_i[i]);
+			retval->merge.add(SdH::Recurrence(start, interval, days_i));
+		}
+		return retval.release();
+	} catch (const std::exception &) {
+		return nullptr;
+	}
+}
+
+void timecal_recur_free(timecal_recur * recur_i)
+{
+	delete recur_i;
+}
+
+size_t timecal_recur_next_n(
+	timecal_recur * recur_io,
+	uint32_t * days_o,
+	uint16_t * minutes_o,
+	size_t * sources_o,
+	size_t max_i
+) {
+	SdH::Moment occurrence;
+	size_t source = 0, count = 0;
+
+	for (; count < max_i && recur_io->merge.next(occurrence, source); count++) {
+		days_o[count] = occurrence.day;
+		minutes_o[count] = occurrence.time.minutesOfDay();
+		if (sources_o != nullptr) sources_o[count] = source;
+	}
+	return count;
+}
@@ -0,0 +1,238 @@
+/* BSD 3-Clause License
+ *
+ * Copyright (c) 2020, Simon de Hartog <simon@dehartog.name>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * vim:set ts=4 sw=4 noexpandtab: */
+
+#pragma once
+
+/* C interface to the time calculations of timecal. Times and durations
+ * are passed as minutes since midnight, 0 up to and including 1439. No
+ * function throws and all of them may be called from multiple threads,
+ * as long as each handle is used by one thread at a time. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMECAL_API __attribute__((visibility("default")))
+
+/** Number of characters written by timecal_format(). */
+#define TIMECAL_CHARS 5
+
+/** Number of minutes in a day. */
+#define TIMECAL_MINUTES_PER_DAY 1440
+
+/** Outcome of parsing a time or a line. */
+enum timecal_status {
+	TIMECAL_OK = 0,     /**< Success */
+	TIMECAL_EINVAL = 1, /**< Invalid character or field too long */
+	TIMECAL_ERANGE = 2, /**< Hours above 23 or minutes above 59 */
+	TIMECAL_EEMPTY = 3, /**< Empty line, nothing to evaluate */
+	TIMECAL_ECLOCK = 4  /**< The current local time is unavailable */
+};
+
+/** Keeps the previous answer between lines, like the interactive mode. */
+typedef struct timecal_calc timecal_calc;
+
+/** Time zone for converting epoch timestamps to local time. */
+typedef struct timecal_tz timecal_tz;
+
+/** Merges the occurrences of recurrences into a single ordered stream. */
+typedef struct timecal_recur timecal_recur;
+
+/** Parse a time or duration in [HH:]MM format.
+ * @param str_i Characters to parse, need not be NUL terminated.
+ * @param len_i Number of characters in @p str_i.
+ * @param minutes_o Receives the minutes since midnight on success.
+ * @returns A timecal_status. */
+TIMECAL_API int timecal_parse(const char *str_i, size_t len_i, uint16_t *minutes_o);
+
+/** Add a duration to a time, wrapping around at midnight. */
+TIMECAL_API uint16_t timecal_add(uint16_t ref_i, uint16_t dur_i);
+
+/** Get the current local time, or the UTC time when the local time is
+ * unavailable.
+ * @returns Minutes since midnight. */
+TIMECAL_API uint16_t timecal_now(void);
+
+/** Write a time as HH:MM, without NUL terminator.
+ * @param minutes_i Minutes since midnight, taken modulo a day.
+ * @param buf_o Receives TIMECAL_CHARS characters.
+ * @returns Position after the last written character. */
+TIMECAL_API char *timecal_format(uint16_t minutes_i, char *buf_o);
+
+/** Describe why a line in the interactive grammar can't be evaluated,
+ * like snprintf(3).
+ * @param line_i Line to describe, without newline.
+ * @param len_i Number of characters in @p line_i.
+ * @param buf_o Receives the NUL terminated message, possibly truncated.
+ * Empty when @p line_i is valid.
+ * @param size_i Size of @p buf_o.
+ * @returns Length of the complete message. */
+TIMECAL_API size_t timecal_message(const char *line_i, size_t len_i, char *buf_o, size_t size_i);
+
+/** Add durations to references element by element. All values must be
+ * below TIMECAL_MINUTES_PER_DAY.
+ * @param refs_i Reference times.
+ * @param durs_i Durations.
+ * @param out_o Receives the results, may be @p refs_i or @p durs_i.
+ * @param count_i Number of elements in each array. */
+TIMECAL_API void timecal_add_n(const uint16_t *refs_i, const uint16_t *durs_i, uint16_t *out_o, size_t count_i);
+
+/** Add a single duration to every reference. All values must be below
+ * TIMECAL_MINUTES_PER_DAY.
+ * @param refs_i Reference times.
+ * @param dur_i Duration to add.
+ * @param out_o Receives the results, may be @p refs_i.
+ * @param count_i Number of elements in each array. */
+TIMECAL_API void timecal_add_duration_n(const uint16_t *refs_i, uint16_t dur_i, uint16_t *out_o, size_t count_i);
+
+/** Write times as HH:MM, each followed by a separator.
+ * @param minutes_i Minutes since midnight, below TIMECAL_MINUTES_PER_DAY.
+ * @param count_i Number of times.
+ * @param buf_o Receives (TIMECAL_CHARS + 1) * @p count_i characters.
+ * @param sep_i Separator written after each time.
+ * @returns Position after the last written character. */
+TIMECAL_API char *timecal_format_n(const uint16_t *minutes_i, size_t count_i, char *buf_o, char sep_i);
+
+/** Find the time that comes first at or after a reference time, counting
+ * times before the reference as tomorrow.
+ * @param minutes_i Minutes since midnight, below TIMECAL_MINUTES_PER_DAY.
+ * @param count_i Number of times.
+ * @param from_i Reference time.
+ * @returns Index of the first such time, or @p count_i when there are none. */
+TIMECAL_API size_t timecal_next_n(const uint16_t *minutes_i, size_t count_i, uint16_t from_i);
+
+/** Count the times from @p from_i up to and including @p to_i, wrapping
+ * past midnight when @p to_i comes before @p from_i.
+ * @param minutes_i Minutes since midnight, below TIMECAL_MINUTES_PER_DAY.
+ * @param count_i Number of times.
+ * @param from_i First time of the window.
+ * @param to_i Last time of the window.
+ * @returns The number of times in the window. */
+TIMECAL_API size_t timecal_count_n(const uint16_t *minutes_i, size_t count_i, uint16_t from_i, uint16_t to_i);
+
+/** Create a calculator with a previous answer of 00:00.
+ * @returns The calculator, or NULL when out of memory. */
+TIMECAL_API timecal_calc *timecal_calc_new(void);
+
+/** Free a calculator, NULL is ignored. */
+TIMECAL_API void timecal_calc_free(timecal_calc *calc_i);
+
+/** Evaluate a line in the interactive grammar: "[HH:]MM", "+[HH:]MM" or
+ * "[HH:]MM [HH:]MM". On failure the previous answer is left untouched.
+ * @param calc_io Calculator to use.
+ * @param line_i Line to evaluate, without newline.
+ * @param len_i Number of characters in @p line_i.
+ * @param result_o Receives the answer on success.
+ * @returns A timecal_status. */
+TIMECAL_API int timecal_calc_eval(timecal_calc *calc_io, const char *line_i, size_t len_i, uint16_t *result_o);
+
+/** Evaluate newline separated lines, like the batch mode. Every newline
+ * ends a line and characters after the last newline form a final line.
+ * @param calc_io Calculator to use.
+ * @param text_i Lines to evaluate.
+ * @param len_i Number of characters in @p text_i.
+ * @param results_o Receives the answer for each line, 0 on failure.
+ * @param status_o Receives a timecal_status for each line.
+ * @param max_i Capacity of @p results_o and @p status_o.
+ * @param consumed_o Receives the number of characters evaluated, which
+ * is less than @p len_i when more than @p max_i lines are given. May be
+ * NULL.
+ * @returns The number of evaluated lines. */
+TIMECAL_API size_t timecal_calc_eval_lines(
+	timecal_calc *calc_io,
+	const char *text_i,
+	size_t len_i,
+	uint16_t *results_o,
+	uint8_t *status_o,
+	size_t max_i,
+	size_t *consumed_o
+);
+
+/** Load the local time zone from TZ or /etc/localtime, or UTC.
+ * @returns The time zone, or NULL when out of memory. */
+TIMECAL_API timecal_tz *timecal_tz_local(void);
+
+/** Load a time zone by name, like "Europe/Amsterdam", or from a POSIX
+ * rule like "CET-1CEST,M3.5.0,M10.5.0/3".
+ * @returns The time zone, or NULL when it can't be loaded. */
+TIMECAL_API timecal_tz *timecal_tz_named(const char *name_i);
+
+/** Free a time zone, NULL is ignored. */
+TIMECAL_API void timecal_tz_free(timecal_tz *tz_i);
+
+/** Convert epoch timestamps to local times of day.
+ * @param tz_i Time zone to convert to.
+ * @param epochs_i Epoch timestamps.
+ * @param count_i Number of timestamps.
+ * @param minutes_o Receives minutes since local midnight. */
+TIMECAL_API void timecal_tz_convert(const timecal_tz *tz_i, const int64_t *epochs_i, size_t count_i, uint16_t *minutes_o);
+
+/** Create a merge of recurrences, each occurring every interval from a
+ * start time, within a window of whole days. Occurrences are computed
+ * while they are taken, so memory only depends on @p count_i.
+ * @param starts_i First occurrence of each recurrence, in minutes since
+ * midnight of the first day.
+ * @param intervals_i Minutes between occurrences of each recurrence,
+ * from 1 up to 1439.
+ * @param count_i Number of recurrences.
+ * @param days_i Number of days in the window.
+ * @returns The merge, or NULL when an interval or start is invalid or
+ * out of memory. */
+TIMECAL_API timecal_recur *timecal_recur_new(const uint16_t *starts_i, const uint16_t *intervals_i, size_t count_i, uint32_t days_i);
+
+/** Free a merge of recurrences, NULL is ignored. */
+TIMECAL_API void timecal_recur_free(timecal_recur *recur_i);
+
+/** Take the next occurrences of all recurrences, in time order. Equal
+ * times come in the order of the recurrences.
+ * @param recur_io Merge to take from.
+ * @param days_o Receives the number of midnights passed per occurrence.
+ * @param minutes_o Receives the time of day per occurrence.
+ * @param sources_o Receives the index of the recurrence per occurrence.
+ * May be NULL.
+ * @param max_i Capacity of the output arrays.
+ * @returns The number of occurrences taken, less than @p max_i when the
+ * window is exhausted. */
+TIMECAL_API size_t timecal_recur_next_n(
+	timecal_recur *recur_io,
+	uint32_t *days_o,
+	uint16_t *minutes_o,
+	size_t *sources_o,
+	size_t max_i
+);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -1,15 +1,62 @@
 #include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <fcntl.h>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+#include "Batch.h"
+#include "Calculator.h"
+#include "ColumnFile.h"
+#include "Follow.h"
 #include "HoursMinutes.h"
+#include "HoursMinutesArray.h"
+#include "Optimizer.h"
+#include "OutputBuffer.h"
+#include "Planner.h"
+#include "Recurrence.h"
+#include "Server.h"
+#include "Stats.h"
+#include "TimeZone.h"
+#include "Watch.h"
 
 using std::cerr, std::cin, std::cout, std::endl;
 
 std::string appname;
 
+/** Server to stop on SIGINT or SIGTERM. */
+SdH::Server * server = nullptr;
+
+/** Follower to stop on SIGINT or SIGTERM. */
+SdH::Follow * follower = nullptr;
+
+/** Writes the statistics to standard error when leaving main(). */
+struct StatsReport {
+	~StatsReport() { SdH::Stats::instance().report(cerr); }
+};
+
+/** Write a time and a newline with a single system call. One-shot calls
+ * come from shell prompts and hooks, so they skip the stream buffers.
+ * @returns The exit code, 1 when standard output can't be written. */
+int writeTime(const SdH::HoursMinutes & hm_i)
+{
+	char buf[SdH::HoursMinutes::charsLength + 1];
+	char *end = hm_i.toChars(buf);
+
+	*end++ = '\n';
+	return write(STDOUT_FILENO, buf, end - buf) == end - buf ? 0 : 1;
+}
+
 int help(const std::string & msg = "")
 {
 	int retval = 0;
@@ -19,6 +66,20 @@ int help(const std::string & msg = "")
 		retval = 1;
 	}
 	cerr << "Usage: " << appname << " [<HH>:<MM>] [[<HH>:]MM]" << endl;
+	cerr << "       " << appname << " [--stats]" << endl;
+	cerr << "       " << appname << " [--stats] --batch [--input <file>]" << endl;
+	cerr << "       " << appname << " [--stats] --parallel [--threads <n>] [--input <file>]" << endl;
+	cerr << "       " << appname << " --epochs [--input <file>]" << endl;
+	cerr << "       " << appname << " --chain [--input <file>] [--threads <n>]" << endl;
+	cerr << "       " << appname << " --sorted [--days] [--input <file>]" << endl;
+	cerr << "       " << appname << " [--next <HH:MM>] [--count <HH:MM> <HH:MM>] [--from-binary] [--input <file>]" << endl;
+	cerr << "       " << appname << " --to-binary [--days] [--input <file>]" << endl;
+	cerr << "       " << appname << " --from-binary [--input <file>]" << endl;
+	cerr << "       " << appname << " [--stats] --serve <socket>" << endl;
+	cerr << "       " << appname << " --plan <file> [--optimize <goal>] [--budget <s>] [--threads <n>]" << endl;
+	cerr << "       " << appname << " [--stats] --watch <file> [--exec <cmd>]" << endl;
+	cerr << "       " << appname << " [--stats] --follow <file> <out>" << endl;
+	cerr << "       " << appname << " --recur <file> [--window <n>]" << endl;
 	cerr << "This application calculates the time after a specified" << endl;
 	cerr << "duration, with an optional reference time. The default" << endl;
 	cerr << "reference time is now." << endl;
@@ -31,60 +92,606 @@ int help(const std::string & msg = "")
 	cerr << "              Use 24-hour time format." << endl;
 	cerr << "[<HH>:]MM      Duration to add to reference time. The optional H is the number" << endl;
 	cerr << "              of hours to add with a literal ':' as separator. The MM" << endl;
-	cerr << "              are the number of minutes to add. " << endl << endl;
+	cerr << "              are the number of minutes to add. " << endl;
+	cerr << "--batch       Read lines like in interactive mode from standard input without" << endl;
+	cerr << "              prompting and write one result per input line." << endl;
+	cerr << "--input <file> Read batch lines from <file> instead of standard input." << endl;
+	cerr << "              Implies --batch." << endl;
+	cerr << "--parallel    Like --batch, but map the input into memory and evaluate" << endl;
+	cerr << "              parts of it on one thread per processor." << endl;
+	cerr << "--threads <n> Use <n> threads. Implies --parallel." << endl;
+	cerr << "--epochs      Like --batch, but convert lines holding an epoch timestamp" << endl;
+	cerr << "              to the local time of day." << endl;
+	cerr << "--chain       Like --batch, but read a start time on the first line and a" << endl;
+	cerr << "              duration on every next one, and write the end of every" << endl;
+	cerr << "              duration with the number of days passed. Takes --threads." << endl;
+	cerr << "--sorted      Like --batch, but write every distinct result once, ordered by" << endl;
+	cerr << "              time of day, followed by the numbers of the lines with it." << endl;
+	cerr << "--days        With --sorted, order on the number of midnights passed first" << endl;
+	cerr << "              and write it before the result, like +1 02:06. With" << endl;
+	cerr << "              --to-binary, add a column with the midnights passed." << endl;
+	cerr << "--next <HH:MM> Like --batch, but only write the result that comes first at" << endl;
+	cerr << "              or after <HH:MM>, or now for the current time." << endl;
+	cerr << "--count <from> <to> Like --batch, but only write the number of results" << endl;
+	cerr << "              from <from> up to and including <to>, past midnight when" << endl;
+	cerr << "              <to> comes first. Can be combined with --next." << endl;
+	cerr << "--to-binary   Like --batch, but write the reference times, durations and" << endl;
+	cerr << "              results as a binary column file. See the README for the format." << endl;
+	cerr << "--from-binary Read a binary column file and write its reference times and" << endl;
+	cerr << "              durations as lines. With --next and --count, query its results." << endl;
+	cerr << "--plan <file> Plan a timetable for the slots and jobs described in <file>," << endl;
+	cerr << "              or standard input for -. See the README for the format." << endl;
+	cerr << "--optimize <goal> With --plan, reorder the jobs to finish first (finish) or" << endl;
+	cerr << "              to need the fewest check-ins (checkins). Also takes --threads." << endl;
+	cerr << "--budget <s>  Stop optimizing after <s> seconds, default 5, and use the best" << endl;
+	cerr << "              order found so far." << endl;
+	cerr << "--watch <file> Wait for the timers in <file>, or standard input for -, one" << endl;
+	cerr << "              per line like in interactive mode with an optional '# label'," << endl;
+	cerr << "              and write the time and label of each one when it is done." << endl;
+	cerr << "--exec <cmd>  With --watch, also run <cmd> with the shell for every timer," << endl;
+	cerr << "              with TIMECAL_TIME and TIMECAL_LABEL set." << endl;
+	cerr << "--recur <file> Write when the recurrences in <file>, or standard input for" << endl;
+	cerr << "              -, occur in time order. Every line holds a start time and an" << endl;
+	cerr << "              interval like in interactive mode, with an optional '# label'." << endl;
+	cerr << "--window <n>  With --recur, write the occurrences of <n> days, default 1." << endl;
+	cerr << "--follow <file> <out> Write the results of the lines of <file> to <out>" << endl;
+	cerr << "              like in batch mode and keep them up to date while <file> is" << endl;
+	cerr << "              edited, evaluating only the changed lines, until interrupted." << endl;
+	cerr << "--serve <socket> Answer lines like in batch mode on a Unix domain socket" << endl;
+	cerr << "              until interrupted, with a previous answer per connection." << endl;
+	cerr << "--stats       In interactive, batch, parallel, server, follow and watch mode," << endl;
+	cerr << "              write line counts, throughput and time per line to standard" << endl;
+	cerr << "              error on exit and whenever SIGUSR1 arrives." << endl << endl;
 	cerr << "Examples:" << endl;
 	cerr << appname << " 09:34 1:48 # will return 11:22" << endl;
 	cerr << appname << " 23:12 2:54 # will return 02:06" << endl;
 	return retval;
 }
 
+int query(const char * input_i, const char * next_i, const char * from_i, const char * to_i, const bool binary_i)
+{
+	std::unique_ptr<SdH::ColumnFile> columns;
+	SdH::HoursMinutesArray times;
+	SdH::HoursMinutes next, from, to;
+	const uint16_t * results = nullptr;
+	size_t count = 0;
+	int fd = STDIN_FILENO;
+
+	try {
+		if (next_i != nullptr) next = strcmp(next_i, "now") ? SdH::HoursMinutes(next_i) : SdH::HoursMinutes::now();
+		if (from_i != nullptr) {
+			from.set(from_i);
+			to.set(to_i);
+		}
+	} catch (const std::exception & e) {
+		return help(e.what());
+	}
+
+	if (input_i != nullptr) {
+		fd = open(input_i, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return help(std::string("Unable to open ") + input_i + ": " + strerror(errno));
+		}
+	}
+
+	// Results of a column file are queried where they are mapped
+	try {
+		if (binary_i) {
+			columns.reset(new SdH::ColumnFile(fd));
+			results = columns->results();
+			count = columns->size();
+		} else {
+			SdH::collectBatch(fd, times);
+			results = times.data();
+			count = times.size();
+		}
+	} catch (const std::exception & e) {
+		cerr << "Error: " << e.what() << endl;
+		if (input_i != nullptr) close(fd);
+		return 1;
+	}
+	if (input_i != nullptr) close(fd);
+
+	if (next_i != nullptr) {
+		const size_t idx = SdH::HoursMinutesArray::next(results, count, next.minutesOfDay());
+
+		if (idx == count) {
+			cerr << "Error: No times to choose from" << endl;
+			return 1;
+		}
+		next.minutesOfDay(results[idx]);
+		cout << next << endl;
+	}
+	if (from_i != nullptr) {
+		cout << SdH::HoursMinutesArray::count(results, count, from.minutesOfDay(), to.minutesOfDay()) << endl;
+	}
+	return 0;
+}
+
+int batch(const char * input_i, const bool epochs_i, const bool chain_i, const bool sorted_i, const bool days_i, const bool parallel_i, const unsigned threads_i)
+{
+	int fd = STDIN_FILENO;
+
+	if (input_i != nullptr) {
+		fd = open(input_i, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return help(std::string("Unable to open ") + input_i + ": " + strerror(errno));
+		}
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+
+	try {
+		if (epochs_i) {
+			SdH::processEpochs(fd, STDOUT_FILENO, SdH::TimeZone::local());
+		} else if (sorted_i) {
+			SdH::processSorted(fd, STDOUT_FILENO, days_i);
+		} else if (chain_i) {
+			SdH::processChain(fd, STDOUT_FILENO, threads_i);
+		} else if (parallel_i) {
+			SdH::processParallel(fd, STDOUT_FILENO, threads_i);
+		} else {
+			SdH::processBatch(fd, STDOUT_FILENO);
+		}
+	} catch (const std::system_error & se) {
+		cerr << "Error: " << se.what() << endl;
+		if (input_i != nullptr) close(fd);
+		return 1;
+	} catch (const std::invalid_argument & ia) {
+		cerr << "Error: " << ia.what() << endl;
+		if (input_i != nullptr) close(fd);
+		return 1;
+	}
+
+	if (input_i != nullptr) close(fd);
+	return 0;
+}
+
+int convert(const char * input_i, const bool toBinary_i, const bool days_i)
+{
+	int fd = STDIN_FILENO;
+
+	if (toBinary_i && isatty(STDOUT_FILENO)) return help("Refusing to write binary output to a terminal");
+	if (input_i != nullptr) {
+		fd = open(input_i, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return help(std::string("Unable to open ") + input_i + ": " + strerror(errno));
+		}
+	}
+
+	try {
+		if (toBinary_i) {
+			SdH::convertToColumns(fd, STDOUT_FILENO, days_i);
+		} else {
+			SdH::convertFromColumns(fd, STDOUT_FILENO);
+		}
+	} catch (const std::exception & e) {
+		cerr << "Error: " << e.what() << endl;
+		if (input_i != nullptr) close(fd);
+		return 1;
+	}
+
+	if (input_i != nullptr) close(fd);
+	return 0;
+}
+
+void stopServer(int)
+{
+	if (server != nullptr) server->stop();
+}
+
+int serve(const char * path_i)
+{
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = stopServer;
+	sigemptyset(&sa.sa_mask);
+
+	try {
+		SdH::Server srv(path_i);
+
+		// Load the time zone before the first client arrives
+		SdH::HoursMinutes::now();
+
+		server = &srv;
+		sigaction(SIGINT, &sa, nullptr);
+		sigaction(SIGTERM, &sa, nullptr);
+		srv.run();
+		server = nullptr;
+	} catch (const std::exception & se) {
+		server = nullptr;
+		cerr << "Error: " << se.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+void stopFollow(int)
+{
+	if (follower != nullptr) follower->stop();
+}
+
+int follow(const char * path_i, const char * out_i)
+{
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = stopFollow;
+	sigemptyset(&sa.sa_mask);
+
+	try {
+		SdH::Follow flw(path_i, out_i);
+
+		follower = &flw;
+		sigaction(SIGINT, &sa, nullptr);
+		sigaction(SIGTERM, &sa, nullptr);
+		flw.run();
+		follower = nullptr;
+	} catch (const std::exception & se) {
+		follower = nullptr;
+		cerr << "Error: " << se.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+int plan(const char * path_i, const char * goal_i, const double budget_i, const unsigned threads_i)
+{
+	SdH::Planner planner(SdH::HoursMinutes::now());
+	std::ifstream file;
+	std::istream *in = &cin;
+
+	if (strcmp(path_i, "-")) {
+		file.open(path_i);
+		if (!file) return help(std::string("Unable to open ") + path_i + ": " + strerror(errno));
+		in = &file;
+	}
+
+	try {
+		planner.read(*in);
+	} catch (const std::invalid_argument & ia) {
+		cerr << "Error: " << ia.what() << endl;
+		return 1;
+	}
+
+	if (goal_i != nullptr) {
+		SdH::Optimizer optimizer(planner, strcmp(goal_i, "finish") ? SdH::Optimizer::Goal::checkins : SdH::Optimizer::Goal::finish);
+		const std::chrono::duration<double> budget(budget_i);
+
+		// Report every improvement, so an interrupted search isn't wasted
+		const bool optimal = optimizer.solve(
+			std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget),
+			threads_i,
+			[](const SdH::Moment & finish_i, const size_t checkins_i) {
+				cerr << "Found: done +" << finish_i.day << ' ' << finish_i.time;
+				cerr << ", " << checkins_i << " check-ins" << endl;
+			}
+		);
+
+		cerr << (optimal ? "Optimal" : "Best found in time") << " after " << optimizer.nodes() << " steps" << endl;
+		optimizer.apply(planner);
+	}
+
+	planner.plan();
+	planner.print(cout).flush();
+	return 0;
+}
+
+int watch(const char * path_i, const char * hook_i)
+{
+	std::ifstream file;
+	std::istream *in = &cin;
+
+	if (strcmp(path_i, "-")) {
+		file.open(path_i);
+		if (!file) return help(std::string("Unable to open ") + path_i + ": " + strerror(errno));
+		in = &file;
+	}
+
+	try {
+		SdH::Watch watch(time(nullptr));
+
+		watch.read(*in, SdH::TimeZone::local());
+		if (hook_i != nullptr) watch.hook(hook_i);
+		watch.run(cout);
+	} catch (const std::invalid_argument & ia) {
+		cerr << "Error: " << ia.what() << endl;
+		return 1;
+	} catch (const std::system_error & se) {
+		cerr << "Error: " << se.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+int recur(const char * path_i, const uint32_t days_i)
+{
+	SdH::RecurrenceMerge merge;
+	std::ifstream file;
+	std::istream *in = &cin;
+	SdH::Moment occurrence;
+	size_t source = 0;
+
+	if (strcmp(path_i, "-")) {
+		file.open(path_i);
+		if (!file) return help(std::string("Unable to open ") + path_i + ": " + strerror(errno));
+		in = &file;
+	}
+
+	try {
+		merge.read(*in, days_i, SdH::HoursMinutes::now());
+
+		SdH::OutputBuffer outbuf(STDOUT_FILENO);
+
+		// Occurrences are written as they come off the merge
+		while (merge.next(occurrence, source)) {
+			const std::string & label = merge.label(source);
+			char *buf = outbuf.reserve(1 + 10 + 1 + SdH::HoursMinutes::charsLength + 1);
+
+			*buf++ = '+';
+			buf = std::to_chars(buf, buf + 10, occurrence.day).ptr;
+			*buf++ = ' ';
+			buf = occurrence.time.toChars(buf);
+			if (!label.empty()) *buf++ = ' ';
+			outbuf.commit(buf);
+			outbuf.append(label.data(), label.size());
+			outbuf.append("\n", 1);
+		}
+		outbuf.flush();
+	} catch (const std::invalid_argument & ia) {
+		cerr << "Error: " << ia.what() << endl;
+		return 1;
+	} catch (const std::system_error & se) {
+		cerr << "Error: " << se.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	size_t pos = std::string::npos;
 	SdH::HoursMinutes ref, dur;
+	SdH::Calculator calc;
+	SdH::BatchParser::Record rec;
+	std::unique_ptr<StatsReport> report;
 	std::string line; // Input line
+	bool batchmode = false;
+	bool epochs = false;
+	bool chain = false;
+	bool sorted = false;
+	bool days = false;
+	bool parallel = false;
+	bool toBinary = false;
+	bool statistics = false;
+	bool fromBinary = false;
+	unsigned threads = 0;
+	unsigned long window = 0;
+	char * end = nullptr;
+	const char * input = nullptr;
+	const char * sockpath = nullptr;
+	const char * planpath = nullptr;
+	const char * goal = nullptr;
+	const char * watchpath = nullptr;
+	const char * hook = nullptr;
+	const char * followpath = nullptr;
+	const char * outpath = nullptr;
+	const char * recurpath = nullptr;
+	const char * next = nullptr;
+	const char * from = nullptr;
+	const char * to = nullptr;
+	double budget = -1;
+	int argi = 1;
 
 	// C++ version of basename(3)
 	appname = argv[0];
 	pos = appname.rfind('/');
 	if (pos != std::string::npos) appname.erase(0, pos+1);
 
-	switch (argc) {
-		case 3:
+	// Long options come first, durations never start with two dashes
+	for (; argi < argc && !strncmp(argv[argi], "--", 2); argi++) {
+		if (!strcmp(argv[argi], "--batch")) {
+			batchmode = true;
+		} else if (!strcmp(argv[argi], "--epochs")) {
+			batchmode = true;
+			epochs = true;
+		} else if (!strcmp(argv[argi], "--chain")) {
+			batchmode = true;
+			chain = true;
+		} else if (!strcmp(argv[argi], "--next")) {
+			if (++argi == argc) return help("Option --next requires a time");
+			next = argv[argi];
+			batchmode = true;
+		} else if (!strcmp(argv[argi], "--count")) {
+			if (argi + 2 >= argc) return help("Option --count requires two times");
+			from = argv[++argi];
+			to = argv[++argi];
+			batchmode = true;
+		} else if (!strcmp(argv[argi], "--sorted")) {
+			batchmode = true;
+			sorted = true;
+		} else if (!strcmp(argv[argi], "--days")) {
+			days = true;
+		} else if (!strcmp(argv[argi], "--to-binary")) {
+			batchmode = true;
+			toBinary = true;
+		} else if (!strcmp(argv[argi], "--from-binary")) {
+			batchmode = true;
+			fromBinary = true;
+		} else if (!strcmp(argv[argi], "--parallel")) {
+			batchmode = true;
+			parallel = true;
+		} else if (!strcmp(argv[argi], "--threads")) {
+			if (++argi == argc) return help("Option --threads requires a number");
+			threads = strtoul(argv[argi], &end, 10);
+			if (*end != '\0' || threads == 0) return help(std::string("Invalid number of threads ") + argv[argi]);
+		} else if (!strcmp(argv[argi], "--input")) {
+			if (++argi == argc) return help("Option --input requires a file name");
+			input = argv[argi];
+			batchmode = true;
+		} else if (!strcmp(argv[argi], "--plan")) {
+			if (++argi == argc) return help("Option --plan requires a file name");
+			planpath = argv[argi];
+		} else if (!strcmp(argv[argi], "--optimize")) {
+			if (++argi == argc) return help("Option --optimize requires a goal");
+			goal = argv[argi];
+			if (strcmp(goal, "finish") && strcmp(goal, "checkins")) return help(std::string("Unknown goal ") + goal);
+		} else if (!strcmp(argv[argi], "--budget")) {
+			if (++argi == argc) return help("Option --budget requires a number of seconds");
+			budget = strtod(argv[argi], &end);
+			if (*end != '\0' || !(budget >= 0)) return help(std::string("Invalid budget ") + argv[argi]);
+		} else if (!strcmp(argv[argi], "--watch")) {
+			if (++argi == argc) return help("Option --watch requires a file name");
+			watchpath = argv[argi];
+		} else if (!strcmp(argv[argi], "--exec")) {
+			if (++argi == argc) return help("Option --exec requires a command");
+			hook = argv[argi];
+		} else if (!strcmp(argv[argi], "--recur")) {
+			if (++argi == argc) return help("Option --recur requires a file name");
+			recurpath = argv[argi];
+		} else if (!strcmp(argv[argi], "--window")) {
+			if (++argi == argc) return help("Option --window requires a number of days");
+			window = strtoul(argv[argi], &end, 10);
+			if (*end != '\0' || window == 0 || window > UINT32_MAX) return help(std::string("Invalid number of days ") + argv[argi]);
+		} else if (!strcmp(argv[argi], "--follow")) {
+			if (argi + 2 >= argc) return help("Option --follow requires a file name and an output file name");
+			followpath = argv[++argi];
+			outpath = argv[++argi];
+		} else if (!strcmp(argv[argi], "--serve")) {
+			if (++argi == argc) return help("Option --serve requires a socket path");
+			sockpath = argv[argi];
+		} else if (!strcmp(argv[argi], "--stats")) {
+			statistics = true;
+		} else if (!strcmp(argv[argi], "--help")) {
+			return help();
+		} else {
+			return help(std::string("Unknown option ") + argv[argi]);
+		}
+	}
+
+	if (days && !sorted && !toBinary) return help("Option --days requires --sorted or --to-binary");
+
+	// Only modes that evaluate lines one at a time count them
+	if (statistics) {
+		if (
+			planpath != nullptr || recurpath != nullptr || epochs || chain || sorted || next != nullptr ||
+			from != nullptr || toBinary || fromBinary || (argi != argc && !batchmode)
+		) {
+			return help("Option --stats only takes batch, parallel, server, follow, watch and interactive mode");
+		}
+
+		// Before any other thread starts, which then blocks SIGUSR1 too
+		SdH::Stats::instance().enable();
+		SdH::Stats::instance().reportOnSignal(SIGUSR1, STDERR_FILENO);
+		report.reset(new StatsReport());
+	}
+
+	if (followpath != nullptr) {
+		if (
+			batchmode || watchpath != nullptr || hook != nullptr || planpath != nullptr || sockpath != nullptr ||
+			recurpath != nullptr || window != 0 || goal != nullptr || budget >= 0 || threads != 0 || argi != argc
+		) {
+			return help("Option --follow takes no other options or times");
+		}
+		return follow(followpath, outpath);
+	}
+
+	if (watchpath != nullptr) {
+		if (
+			batchmode || planpath != nullptr || sockpath != nullptr || recurpath != nullptr || window != 0 ||
+			goal != nullptr || budget >= 0 || threads != 0 || argi != argc
+		) {
+			return help("Option --watch takes no other options than --exec or times");
+		}
+		return watch(watchpath, hook);
+	}
+	if (hook != nullptr) return help("Option --exec requires --watch");
+
+	if (recurpath != nullptr) {
+		if (batchmode || planpath != nullptr || sockpath != nullptr || goal != nullptr || budget >= 0 || threads != 0 || argi != argc) {
+			return help("Option --recur takes no other options than --window or times");
+		}
+		return recur(recurpath, window == 0 ? 1 : window);
+	}
+	if (window != 0) return help("Option --window requires --recur");
+
+	if (planpath != nullptr) {
+		if (batchmode || sockpath != nullptr || argi != argc) return help("Option --plan takes no other options or times");
+		if (goal == nullptr && threads != 0) return help("Option --threads needs --optimize with --plan");
+		if (goal == nullptr && budget >= 0) return help("Option --budget requires --optimize");
+		return plan(planpath, goal, budget < 0 ? 5 : budget, threads);
+	}
+	if (goal != nullptr || budget >= 0) return help("Options --optimize and --budget require --plan");
+
+	// Without --plan, --threads is about batch mode, and chain mode takes it
+	if (threads != 0) {
+		batchmode = true;
+		parallel = parallel || !chain;
+	}
+
+	if (sockpath != nullptr) {
+		if (batchmode || argi != argc) return help("Option --serve takes no other options or times");
+		return serve(sockpath);
+	}
+
+	if (batchmode) {
+		if (argi != argc) return help("Batch mode takes no times as parameters");
+		if (next != nullptr || from != nullptr) {
+			if (epochs || chain || parallel || toBinary) return help("Options --next and --count only take --input and --from-binary");
+			return query(input, next, from, to, fromBinary);
+		}
+		if (toBinary || fromBinary) {
+			if (toBinary && fromBinary) return help("Options --to-binary and --from-binary can't be combined");
+			if (epochs || chain || sorted || parallel) return help("Options --to-binary and --from-binary only take --input");
+			return convert(input, toBinary, days);
+		}
+		if (epochs && parallel) return help("Option --epochs can't be combined with --parallel");
+		if (epochs && chain) return help("Option --epochs can't be combined with --chain");
+		if (chain && parallel) return help("Option --chain can't be combined with --parallel");
+		if (sorted && (epochs || chain || parallel)) return help("Option --sorted only takes --days and --input");
+		return batch(input, epochs, chain, sorted, days, parallel, threads);
+	}
+
+	// Times follow the options
+	switch (argc - argi) {
+		case 2:
 			try {
-				ref.set(argv[1]);
-				dur.set(argv[2]);
+				ref.set(argv[argi]);
+				dur.set(argv[argi + 1]);
 				ref += dur;
-				cout << ref << endl;
-				return 0;
+				return writeTime(ref);
 			} catch (const std::exception & se) {
 				return help(se.what());
 			}
 
 			break;
 
-		case 2:
+		case 1:
 			if (
-				!strcmp(argv[1], "-h") ||
-				!strcmp(argv[1], "--help") ||
-				!strcmp(argv[1], "-?") ||
-				!strcmp(argv[1], "help") ||
-				!strcmp(argv[1], "?")
+				!strcmp(argv[argi], "-h") ||
+				!strcmp(argv[argi], "--help") ||
+				!strcmp(argv[argi], "-?") ||
+				!strcmp(argv[argi], "help") ||
+				!strcmp(argv[argi], "?")
 			) {
 				return help();
 			}
 
 			try {
+				// Parse first, the time zone is only loaded when needed
+				dur.set(argv[argi]);
 				ref = SdH::HoursMinutes::now();
-				dur.set(argv[1]);
 				ref += dur;
-				cout << ref << endl;
-				return 0;
+				return writeTime(ref);
 			} catch (const std::exception & se) {
 				return help(se.what());
 			}
 
-		case 1:
+		case 0:
 			// Run the interactive loop outside this switch statement
 			break;
 
@@ -92,6 +699,8 @@ int main(int argc, char *argv[])
 			return help();
 	}
 
+	SdH::Stats & stats = SdH::Stats::instance();
+
 	cout << "Welcome to " << appname << "!" << endl;
 	cout << "You are in interactive mode. Use Ctrl-C, Ctrl-D, \"q\" or \"quit\" command to exit." << endl;
 	cout << "Enter either a duration in [HH:]MM format, or a reference time followed by a duration." << endl;
@@ -108,28 +717,26 @@ int main(int argc, char *argv[])
 		if (line.empty()) continue;
 		if (line == "q" || line == "quit") break;
 
-		try {
-			pos = line.find(' ');
-			if (pos == std::string::npos) {
-				if (line[0] == '+') {
-					// Remove the plus, use previous result as new reference
-					line.replace(0, 1, "");
-				} else {
-					// Use current time as reference
-					ref = SdH::HoursMinutes::now();
-				}
-				dur.set(line);
-			} else {
-				ref.set(line.substr(0, pos));
-				dur.set(line.substr(pos+1));
-			}
-			cout << ref << " + " << dur << " = ";
-			ref += dur;
-			cout << ref << endl;
-		} catch (const std::invalid_argument & ia) {
-			cout << ia.what() << endl;
-		} catch (const std::overflow_error & ofe) {
-			cout << ofe.what() << endl;
+		const bool timed = stats.enabled();
+		uint64_t ticks[4] = {timed ? SdH::Stats::ticks() : 0, 0, 0, 0};
+
+		SdH::BatchParser::parseLine(line.data(), line.data() + line.size(), rec);
+		if (timed) ticks[1] = SdH::Stats::ticks();
+		if (rec.result.ec == std::errc()) calc.apply(rec);
+		if (timed) ticks[2] = SdH::Stats::ticks();
+
+		if (rec.result.ec == std::errc()) {
+			cout << calc.reference() << " + " << calc.duration() << " = ";
+			cout << calc.result() << endl;
+		} else {
+			SdH::HoursMinutes::printError(cout, rec.result, line.data() + line.size()) << endl;
+		}
+
+		if (timed) {
+			SdH::Stats::Counters & counters = stats.local();
+
+			counters.round(ticks);
+			counters.count(false, rec.result.ec);
 		}
 
 	} while (cin.good());